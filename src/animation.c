@@ -0,0 +1,342 @@
+#include <assert.h>
+
+#include "animation.h"
+#include "animationprivate.h"
+#include "logview.h"
+#include "tableview.h"
+#include "treeview.h"
+#include "util.h"
+#include "utilprivate.h"
+
+// Running animations are kept in an array in start order. There are usually only a handful, so lookups are linear.
+// Entries finished or cancelled during a tick are only marked (by clearing function) and are removed once the tick completes, so callbacks can start and cancel animations freely.
+typedef struct {
+	DAnimationId id;
+	DWidget *widget;
+	DAnimationFunction *function; // NULL once finished or cancelled
+	void *userData;
+	bool freeUserData; // userData was allocated for a common property, so is freed along with the animation
+	DTimeMs start;
+	DTimeMs duration;
+	DAnimationEasing easing;
+} DAnimation;
+
+typedef struct {
+	int fromTop, fromBottom, fromLeft, fromRight;
+	int toTop, toBottom, toLeft, toRight;
+} DAnimationPadding;
+
+typedef struct {
+	size_t from, to;
+} DAnimationScroll;
+
+const DTimeMs dAnimationFrameInterval=16; // minimum time between ticks (roughly 60 fps)
+
+DAnimation *dAnimations=NULL;
+size_t dAnimationCount=0;
+size_t dAnimationAlloc=0;
+DAnimationId dAnimationNextId=1;
+DTimeMs dAnimationLastTick=0;
+bool dAnimationTicking=false; // true while dAnimationTick is invoking callbacks
+
+DAnimationId dAnimationStartInternal(DWidget *widget, DTimeMs delay, DTimeMs duration, DAnimationEasing easing, DAnimationFunction *function, void *userData, bool freeUserData);
+void dAnimationEnd(DAnimation *animation); // marks as no longer running, freeing any property state
+void dAnimationRemoveEnded(void);
+void dAnimationCancelProperty(DWidget *widget, DAnimationFunction *function); // cancels any animation of widget with the given function
+int dAnimationLerpInt(int from, int to, float progress);
+
+void dAnimationPaddingFunction(DWidget *widget, float progress, void *userData);
+void dAnimationScrollFunction(DWidget *widget, float progress, void *userData);
+
+DAnimationId dAnimationStart(DWidget *widget, DTimeMs delay, DTimeMs duration, DAnimationEasing easing, DAnimationFunction *function, void *userData) {
+	assert(widget!=NULL);
+	assert(function!=NULL);
+
+	return dAnimationStartInternal(widget, delay, duration, easing, function, userData, false);
+}
+
+bool dAnimationCancel(DAnimationId id) {
+	for(size_t i=0; i<dAnimationCount; ++i)
+		if (dAnimations[i].id==id) {
+			if (dAnimations[i].function==NULL)
+				return false;
+			dAnimationEnd(&dAnimations[i]);
+			dAnimationRemoveEnded();
+			return true;
+		}
+
+	return false;
+}
+
+bool dAnimationIsRunning(DAnimationId id) {
+	for(size_t i=0; i<dAnimationCount; ++i)
+		if (dAnimations[i].id==id)
+			return (dAnimations[i].function!=NULL);
+
+	return false;
+}
+
+float dAnimationEase(DAnimationEasing easing, float t) {
+	if (t<=0.0f)
+		return 0.0f;
+	if (t>=1.0f)
+		return 1.0f;
+
+	switch(easing) {
+		case DAnimationEasingLinear:
+			return t;
+		case DAnimationEasingInQuad:
+			return t*t;
+		case DAnimationEasingOutQuad:
+			return t*(2.0f-t);
+		case DAnimationEasingInOutQuad:
+			return (t<0.5f ? 2.0f*t*t : 1.0f-2.0f*(1.0f-t)*(1.0f-t));
+		case DAnimationEasingInCubic:
+			return t*t*t;
+		case DAnimationEasingOutCubic: {
+			float u=1.0f-t;
+			return 1.0f-u*u*u;
+		}
+		case DAnimationEasingInOutCubic: {
+			float u=1.0f-t;
+			return (t<0.5f ? 4.0f*t*t*t : 1.0f-4.0f*u*u*u);
+		}
+	}
+
+	return t;
+}
+
+void dAnimationLerpColour(DColour *result, const DColour *from, const DColour *to, float progress) {
+	assert(result!=NULL);
+	assert(from!=NULL);
+	assert(to!=NULL);
+
+	// Clamp each channel in case progress is outside of [0,1]
+	int channels[4]={
+	    dAnimationLerpInt(from->r, to->r, progress),
+	    dAnimationLerpInt(from->g, to->g, progress),
+	    dAnimationLerpInt(from->b, to->b, progress),
+	    dAnimationLerpInt(from->a, to->a, progress),
+	};
+	for(int i=0; i<4; ++i)
+		channels[i]=(channels[i]<0 ? 0 : (channels[i]>255 ? 255 : channels[i]));
+
+	result->r=channels[0];
+	result->g=channels[1];
+	result->b=channels[2];
+	result->a=channels[3];
+}
+
+DAnimationId dAnimationPadding(DWidget *widget, int top, int bottom, int left, int right, DTimeMs duration, DAnimationEasing easing) {
+	assert(widget!=NULL);
+
+	dAnimationCancelProperty(widget, &dAnimationPaddingFunction);
+
+	DAnimationPadding *padding=dMallocTaggedNoFail(sizeof(DAnimationPadding), dWidgetGetBaseType(widget));
+	padding->fromTop=dWidgetGetPaddingTop(widget);
+	padding->fromBottom=dWidgetGetPaddingBottom(widget);
+	padding->fromLeft=dWidgetGetPaddingLeft(widget);
+	padding->fromRight=dWidgetGetPaddingRight(widget);
+	padding->toTop=top;
+	padding->toBottom=bottom;
+	padding->toLeft=left;
+	padding->toRight=right;
+
+	return dAnimationStartInternal(widget, 0, duration, easing, &dAnimationPaddingFunction, padding, true);
+}
+
+DAnimationId dAnimationScroll(DWidget *widget, size_t row, DTimeMs duration, DAnimationEasing easing) {
+	assert(widget!=NULL);
+
+	dAnimationCancelProperty(widget, &dAnimationScrollFunction);
+
+	DAnimationScroll *scroll=dMallocTaggedNoFail(sizeof(DAnimationScroll), dWidgetGetBaseType(widget));
+	switch(dWidgetGetBaseType(widget)) {
+		case DWidgetTypeLogView: scroll->from=dLogViewGetScrollLine(widget); break;
+		case DWidgetTypeTableView: scroll->from=dTableViewGetScrollRow(widget); break;
+		case DWidgetTypeTreeView: scroll->from=dTreeViewGetScrollRow(widget); break;
+		default:
+			dFatalError("error: cannot animate scrolling of widget %p (%s)\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+	}
+	scroll->to=row;
+
+	return dAnimationStartInternal(widget, 0, duration, easing, &dAnimationScrollFunction, scroll, true);
+}
+
+bool dAnimationGetNextDeadline(DTimeMs *deadline) {
+	assert(deadline!=NULL);
+
+	// Next frame is due one interval after the last, unless every animation is still waiting out its delay
+	bool found=false;
+	for(size_t i=0; i<dAnimationCount; ++i) {
+		DTimeMs due=dAnimations[i].start;
+		if (due<dAnimationLastTick+dAnimationFrameInterval)
+			due=dAnimationLastTick+dAnimationFrameInterval;
+		if (!found || due<*deadline)
+			*deadline=due;
+		found=true;
+	}
+
+	return found;
+}
+
+void dAnimationTick(DTimeMs now) {
+	// Nothing running? Leave the loop to sleep
+	if (dAnimationCount==0)
+		return;
+
+	// Not yet time for another frame? (e.g. woken early by an event)
+	if (now<dAnimationLastTick+dAnimationFrameInterval)
+		return;
+	dAnimationLastTick=now;
+
+	// Advance animations which have started (any added by callbacks are left until the next tick)
+	dAnimationTicking=true;
+	size_t count=dAnimationCount;
+	for(size_t i=0; i<count; ++i) {
+		DAnimation animation=dAnimations[i];
+		if (animation.function==NULL || now<animation.start)
+			continue;
+
+		// Final call has progress exactly 1
+		bool finished=(now>=animation.start+animation.duration);
+		float progress=(finished ? 1.0f : dAnimationEase(animation.easing, (float)(now-animation.start)/(float)animation.duration));
+		animation.function(animation.widget, progress, animation.userData);
+
+		// Array may have moved if callback started another animation
+		if (finished && dAnimations[i].function!=NULL)
+			dAnimationEnd(&dAnimations[i]);
+	}
+	dAnimationTicking=false;
+
+	dAnimationRemoveEnded();
+}
+
+void dAnimationForgetWidget(DWidget *widget) {
+	assert(widget!=NULL);
+
+	for(size_t i=0; i<dAnimationCount; ++i)
+		if (dAnimations[i].widget==widget && dAnimations[i].function!=NULL)
+			dAnimationEnd(&dAnimations[i]);
+	dAnimationRemoveEnded();
+}
+
+void dAnimationQuit(void) {
+	for(size_t i=0; i<dAnimationCount; ++i)
+		if (dAnimations[i].function!=NULL)
+			dAnimationEnd(&dAnimations[i]);
+	dAnimationCount=0;
+
+	dFree(dAnimations);
+	dAnimations=NULL;
+	dAnimationAlloc=0;
+}
+
+DAnimationId dAnimationStartInternal(DWidget *widget, DTimeMs delay, DTimeMs duration, DAnimationEasing easing, DAnimationFunction *function, void *userData, bool freeUserData) {
+	assert(widget!=NULL);
+	assert(function!=NULL);
+
+	// Add to array (shared by animations of all widgets, so not owned by any one widget type)
+	if (dAnimationCount==dAnimationAlloc) {
+		dAnimationAlloc=(dAnimationAlloc>0 ? dAnimationAlloc*2 : 16);
+		dAnimations=dReallocTaggedNoFail(dAnimations, sizeof(DAnimation)*dAnimationAlloc, DWidgetTypeNB);
+	}
+
+	DAnimation *animation=&dAnimations[dAnimationCount++];
+	animation->id=dAnimationNextId++;
+	animation->widget=widget;
+	animation->function=function;
+	animation->userData=userData;
+	animation->freeUserData=freeUserData;
+	animation->start=dGetTimeMs()+delay;
+	animation->duration=duration;
+	animation->easing=easing;
+
+	// Tick on the next frame, rather than waiting a full interval after the last tick (which may have been long ago)
+	if (dAnimationCount==1)
+		dAnimationLastTick=0;
+
+	return animation->id;
+}
+
+void dAnimationEnd(DAnimation *animation) {
+	assert(animation!=NULL);
+	assert(animation->function!=NULL);
+
+	animation->function=NULL;
+	if (animation->freeUserData)
+		dFree(animation->userData);
+	animation->userData=NULL;
+}
+
+void dAnimationRemoveEnded(void) {
+	// Callbacks still running? Then entries must stay where they are for now
+	if (dAnimationTicking)
+		return;
+
+	// Compact array, keeping remaining animations in start order
+	size_t count=0;
+	for(size_t i=0; i<dAnimationCount; ++i)
+		if (dAnimations[i].function!=NULL)
+			dAnimations[count++]=dAnimations[i];
+	dAnimationCount=count;
+}
+
+void dAnimationCancelProperty(DWidget *widget, DAnimationFunction *function) {
+	assert(widget!=NULL);
+	assert(function!=NULL);
+
+	for(size_t i=0; i<dAnimationCount; ++i)
+		if (dAnimations[i].widget==widget && dAnimations[i].function==function)
+			dAnimationEnd(&dAnimations[i]);
+	dAnimationRemoveEnded();
+}
+
+int dAnimationLerpInt(int from, int to, float progress) {
+	// Round to nearest, rather than towards zero
+	float value=from+(to-from)*progress;
+	return (int)(value>=0.0f ? value+0.5f : value-0.5f);
+}
+
+void dAnimationPaddingFunction(DWidget *widget, float progress, void *userData) {
+	assert(widget!=NULL);
+	assert(userData!=NULL);
+
+	const DAnimationPadding *padding=(const DAnimationPadding *)userData;
+
+	int top=dAnimationLerpInt(padding->fromTop, padding->toTop, progress);
+	int bottom=dAnimationLerpInt(padding->fromBottom, padding->toBottom, progress);
+	int left=dAnimationLerpInt(padding->fromLeft, padding->toLeft, progress);
+	int right=dAnimationLerpInt(padding->fromRight, padding->toRight, progress);
+
+	// Padding affects layout, so each change marks the widget dirty rather than just its appearance - avoid this for sides which have not changed this frame
+	// (this only invalidates cached layout within the widget's own window, and the transaction means the window is only marked dirty once)
+	dWidgetBeginUpdate(widget);
+	if (top!=dWidgetGetPaddingTop(widget))
+		dWidgetSetPaddingTop(widget, top);
+	if (bottom!=dWidgetGetPaddingBottom(widget))
+		dWidgetSetPaddingBottom(widget, bottom);
+	if (left!=dWidgetGetPaddingLeft(widget))
+		dWidgetSetPaddingLeft(widget, left);
+	if (right!=dWidgetGetPaddingRight(widget))
+		dWidgetSetPaddingRight(widget, right);
+	dWidgetEndUpdate(widget);
+}
+
+void dAnimationScrollFunction(DWidget *widget, float progress, void *userData) {
+	assert(widget!=NULL);
+	assert(userData!=NULL);
+
+	const DAnimationScroll *scroll=(const DAnimationScroll *)userData;
+
+	// Interpolate in double precision as rows can exceed what a float represents exactly
+	double value=(double)scroll->from+((double)scroll->to-(double)scroll->from)*progress;
+	size_t row=(value>0.0 ? (size_t)(value+0.5) : 0);
+
+	switch(dWidgetGetBaseType(widget)) {
+		case DWidgetTypeLogView: dLogViewScrollTo(widget, row); break;
+		case DWidgetTypeTableView: dTableViewScrollTo(widget, row); break;
+		case DWidgetTypeTreeView: dTreeViewScrollTo(widget, row); break;
+		default: assert(false); break;
+	}
+}
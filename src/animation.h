@@ -0,0 +1,42 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util.h"
+#include "widget.h"
+
+// Animations move a widget property smoothly to a new value over a duration, following an easing curve.
+// Running animations are ticked once per frame by digitsLoop, and once none are running the loop sleeps as before, so an idle UI costs nothing.
+// Each tick only sets the animated property, so only the animated widget is invalidated (and only its appearance, for properties which cannot affect layout).
+// Giving animations a delay builds a timeline, e.g. to run several one after another. Animations are cancelled if their widget is freed.
+// All functions should only be called from the UI thread.
+
+typedef uint64_t DAnimationId; // 0 is never a valid id, and ids are not reused
+
+typedef enum {
+	DAnimationEasingLinear,
+	DAnimationEasingInQuad,
+	DAnimationEasingOutQuad,
+	DAnimationEasingInOutQuad,
+	DAnimationEasingInCubic,
+	DAnimationEasingOutCubic,
+	DAnimationEasingInOutCubic,
+} DAnimationEasing;
+
+typedef void (DAnimationFunction)(DWidget *widget, float progress, void *userData); // progress is eased, and is exactly 1 on the final call
+
+DAnimationId dAnimationStart(DWidget *widget, DTimeMs delay, DTimeMs duration, DAnimationEasing easing, DAnimationFunction *function, void *userData); // first call is on the first frame after delay. a duration of 0 jumps straight to the end
+bool dAnimationCancel(DAnimationId id); // leaves the property where it is. returns false if the animation has already finished or been cancelled
+bool dAnimationIsRunning(DAnimationId id); // includes delayed animations which have not yet started
+
+float dAnimationEase(DAnimationEasing easing, float t); // maps linear progress t in [0,1] through an easing curve
+void dAnimationLerpColour(DColour *result, const DColour *from, const DColour *to, float progress);
+
+// Common properties - each starts from the property's current value, replacing any previous animation of the same property of the widget
+DAnimationId dAnimationPadding(DWidget *widget, int top, int bottom, int left, int right, DTimeMs duration, DAnimationEasing easing);
+DAnimationId dAnimationScroll(DWidget *widget, size_t row, DTimeMs duration, DAnimationEasing easing); // widget must be a LogView, TableView or TreeView
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef ANIMATIONPRIVATE_H
+#define ANIMATIONPRIVATE_H
+
+#include <stdbool.h>
+
+#include "animation.h"
+
+bool dAnimationGetNextDeadline(DTimeMs *deadline); // time of the next frame which needs ticking. returns false if no animations are running
+void dAnimationTick(DTimeMs now); // advances all running animations (called by digitsLoop once per frame)
+
+void dAnimationForgetWidget(DWidget *widget); // cancels the widget's animations (called when it is freed)
+void dAnimationQuit(void); // cancels all animations (called by digitsQuit)
+
+#endif
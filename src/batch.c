@@ -0,0 +1,263 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "batch.h"
+#include "batchprivate.h"
+#include "digitsprivate.h"
+#include "label.h"
+#include "number.h"
+#include "textbutton.h"
+#include "traceprivate.h"
+#include "util.h"
+
+typedef enum {
+	DBatchOpTypePadding,
+	DBatchOpTypePaddingTop,
+	DBatchOpTypePaddingBottom,
+	DBatchOpTypePaddingLeft,
+	DBatchOpTypePaddingRight,
+	DBatchOpTypeOrientation,
+	DBatchOpTypeHExpand,
+	DBatchOpTypeVExpand,
+	DBatchOpTypeLabelText,
+	DBatchOpTypeTextButtonText,
+	DBatchOpTypeNumberValue,
+} DBatchOpType;
+
+typedef struct {
+	DBatchOpType type;
+	DWidget *widget;
+	union {
+		int padding;
+		DWidgetOrientation orientation;
+		bool expand;
+		size_t textOffset; // of null terminated string within text array
+		int64_t value;
+	} d;
+} DBatchOp;
+
+struct DBatch {
+	DBatchOp *ops;
+	size_t opCount, opAlloc;
+	char *text;
+	size_t textSize, textAlloc;
+
+	DBatch *next; // used once committed
+};
+
+// Batches committed but not yet applied, most recently committed first
+// (producers push with a compare and swap, while the UI thread takes the whole list at once, so neither ever waits for the other)
+_Atomic(DBatch *) dBatchCommitted=NULL;
+
+DBatchOp *dBatchAddOp(DBatch *batch, DBatchOpType type, DWidget *widget);
+size_t dBatchAddText(DBatch *batch, const char *text); // returns offset of copy within text array
+
+void dBatchApplyOp(const DBatch *batch, const DBatchOp *op);
+
+DBatch *dBatchNew(void) {
+	DBatch *batch=dMallocNoFail(sizeof(DBatch));
+	batch->ops=NULL;
+	batch->opCount=0;
+	batch->opAlloc=0;
+	batch->text=NULL;
+	batch->textSize=0;
+	batch->textAlloc=0;
+	batch->next=NULL;
+
+	return batch;
+}
+
+void dBatchFree(DBatch *batch) {
+	if (batch==NULL)
+		return;
+
+	dFree(batch->ops);
+	dFree(batch->text);
+	dFree(batch);
+}
+
+void dBatchCommit(DBatch *batch) {
+	assert(batch!=NULL);
+
+	// Nothing to apply?
+	if (batch->opCount==0) {
+		dBatchFree(batch);
+		return;
+	}
+
+	// Push onto committed list
+	DBatch *head=atomic_load(&dBatchCommitted);
+	do {
+		batch->next=head;
+	} while(!atomic_compare_exchange_weak(&dBatchCommitted, &head, batch));
+
+	// Make sure the loop notices
+	digitsWake();
+}
+
+bool dBatchIsEmpty(const DBatch *batch) {
+	assert(batch!=NULL);
+
+	return (batch->opCount==0);
+}
+
+void dBatchSetPadding(DBatch *batch, DWidget *widget, int padding) {
+	dBatchAddOp(batch, DBatchOpTypePadding, widget)->d.padding=padding;
+}
+
+void dBatchSetPaddingTop(DBatch *batch, DWidget *widget, int padding) {
+	dBatchAddOp(batch, DBatchOpTypePaddingTop, widget)->d.padding=padding;
+}
+
+void dBatchSetPaddingBottom(DBatch *batch, DWidget *widget, int padding) {
+	dBatchAddOp(batch, DBatchOpTypePaddingBottom, widget)->d.padding=padding;
+}
+
+void dBatchSetPaddingLeft(DBatch *batch, DWidget *widget, int padding) {
+	dBatchAddOp(batch, DBatchOpTypePaddingLeft, widget)->d.padding=padding;
+}
+
+void dBatchSetPaddingRight(DBatch *batch, DWidget *widget, int padding) {
+	dBatchAddOp(batch, DBatchOpTypePaddingRight, widget)->d.padding=padding;
+}
+
+void dBatchSetOrientation(DBatch *batch, DWidget *widget, DWidgetOrientation orientation) {
+	assert(dWidgetOrientationIsValid(orientation));
+
+	dBatchAddOp(batch, DBatchOpTypeOrientation, widget)->d.orientation=orientation;
+}
+
+void dBatchSetHExpand(DBatch *batch, DWidget *widget, bool hexpand) {
+	dBatchAddOp(batch, DBatchOpTypeHExpand, widget)->d.expand=hexpand;
+}
+
+void dBatchSetVExpand(DBatch *batch, DWidget *widget, bool vexpand) {
+	dBatchAddOp(batch, DBatchOpTypeVExpand, widget)->d.expand=vexpand;
+}
+
+void dBatchSetLabelText(DBatch *batch, DWidget *label, const char *text) {
+	assert(text!=NULL);
+
+	size_t offset=dBatchAddText(batch, text);
+	dBatchAddOp(batch, DBatchOpTypeLabelText, label)->d.textOffset=offset;
+}
+
+void dBatchSetTextButtonText(DBatch *batch, DWidget *button, const char *text) {
+	assert(text!=NULL);
+
+	size_t offset=dBatchAddText(batch, text);
+	dBatchAddOp(batch, DBatchOpTypeTextButtonText, button)->d.textOffset=offset;
+}
+
+void dBatchSetNumberValue(DBatch *batch, DWidget *number, int64_t value) {
+	dBatchAddOp(batch, DBatchOpTypeNumberValue, number)->d.value=value;
+}
+
+DBatchOp *dBatchAddOp(DBatch *batch, DBatchOpType type, DWidget *widget) {
+	assert(batch!=NULL);
+	assert(widget!=NULL);
+
+	if (batch->opCount==batch->opAlloc) {
+		batch->opAlloc=(batch->opAlloc>0 ? 2*batch->opAlloc : 16);
+		batch->ops=dReallocNoFail(batch->ops, sizeof(DBatchOp)*batch->opAlloc);
+	}
+
+	DBatchOp *op=&batch->ops[batch->opCount++];
+	op->type=type;
+	op->widget=widget;
+
+	return op;
+}
+
+size_t dBatchAddText(DBatch *batch, const char *text) {
+	assert(batch!=NULL);
+	assert(text!=NULL);
+
+	size_t length=strlen(text)+1;
+	if (batch->textSize+length>batch->textAlloc) {
+		while(batch->textSize+length>batch->textAlloc)
+			batch->textAlloc=(batch->textAlloc>0 ? 2*batch->textAlloc : 256);
+		batch->text=dReallocNoFail(batch->text, batch->textAlloc);
+	}
+
+	size_t offset=batch->textSize;
+	memcpy(batch->text+offset, text, length);
+	batch->textSize+=length;
+
+	return offset;
+}
+
+void dBatchApplyCommitted(void) {
+	// Take all committed batches at once
+	DBatch *batch=atomic_exchange(&dBatchCommitted, NULL);
+	if (batch==NULL)
+		return;
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Reverse list so batches are applied in the order they were committed
+	DBatch *ordered=NULL;
+	while(batch!=NULL) {
+		DBatch *next=batch->next;
+		batch->next=ordered;
+		ordered=batch;
+		batch=next;
+	}
+
+	// Apply everything within transactions, so each affected window is invalidated once, after the last batch
+	// Note: transactions are per window, so open one for each op's widget (these nest, so each window commits when its last one ends)
+	for(batch=ordered; batch!=NULL; batch=batch->next)
+		for(size_t i=0; i<batch->opCount; ++i)
+			dWidgetBeginUpdate(batch->ops[i].widget);
+	size_t opCount=0;
+	for(batch=ordered; batch!=NULL; batch=batch->next) {
+		for(size_t i=0; i<batch->opCount; ++i)
+			dBatchApplyOp(batch, &batch->ops[i]);
+		opCount+=batch->opCount;
+	}
+	for(batch=ordered; batch!=NULL; batch=batch->next)
+		for(size_t i=0; i<batch->opCount; ++i)
+			dWidgetEndUpdate(batch->ops[i].widget);
+
+	// Tidy up
+	while(ordered!=NULL) {
+		DBatch *next=ordered->next;
+		dBatchFree(ordered);
+		ordered=next;
+	}
+
+	char detail[64];
+	snprintf(detail, sizeof(detail), "%zu ops", opCount);
+	dTraceEnd(traceStart, "batches", "posted", detail);
+}
+
+void dBatchQuit(void) {
+	// Discard anything not yet applied
+	DBatch *batch=atomic_exchange(&dBatchCommitted, NULL);
+	while(batch!=NULL) {
+		DBatch *next=batch->next;
+		dBatchFree(batch);
+		batch=next;
+	}
+}
+
+void dBatchApplyOp(const DBatch *batch, const DBatchOp *op) {
+	assert(batch!=NULL);
+	assert(op!=NULL);
+
+	switch(op->type) {
+		case DBatchOpTypePadding: dWidgetSetPadding(op->widget, op->d.padding); break;
+		case DBatchOpTypePaddingTop: dWidgetSetPaddingTop(op->widget, op->d.padding); break;
+		case DBatchOpTypePaddingBottom: dWidgetSetPaddingBottom(op->widget, op->d.padding); break;
+		case DBatchOpTypePaddingLeft: dWidgetSetPaddingLeft(op->widget, op->d.padding); break;
+		case DBatchOpTypePaddingRight: dWidgetSetPaddingRight(op->widget, op->d.padding); break;
+		case DBatchOpTypeOrientation: dWidgetSetOrientation(op->widget, op->d.orientation); break;
+		case DBatchOpTypeHExpand: dWidgetSetHExpand(op->widget, op->d.expand); break;
+		case DBatchOpTypeVExpand: dWidgetSetVExpand(op->widget, op->d.expand); break;
+		case DBatchOpTypeLabelText: dLabelSetText(op->widget, batch->text+op->d.textOffset); break;
+		case DBatchOpTypeTextButtonText: dTextButtonSetText(op->widget, batch->text+op->d.textOffset); break;
+		case DBatchOpTypeNumberValue: dNumberSetValue(op->widget, op->d.value); break;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "widget.h"
+
+// Batches let other threads prepare the next UI state without touching widgets.
+// A producer stages property changes into a batch it owns (nothing is shared, so staging never blocks or takes a lock),
+// then commits it, handing it to the UI thread. Once per frame, before timers, layout and redrawing, the UI thread takes every batch committed
+// since the previous frame and applies them all within a single update transaction, so rendering only ever sees whole batches and each
+// affected window is invalidated once. Changes are applied in the order they were staged, and batches in the order they were committed.
+// Widgets referenced by a batch must not be freed until it has been applied.
+
+typedef struct DBatch DBatch;
+
+DBatch *dBatchNew(void); // safe to call from any thread
+void dBatchFree(DBatch *batch); // discards a batch without committing it
+void dBatchCommit(DBatch *batch); // safe to call from any thread (after digitsInit). takes ownership of batch, which is freed once applied
+
+bool dBatchIsEmpty(const DBatch *batch);
+
+// Each of these stages a call to the setter of the same name, made on the UI thread when the batch is applied
+void dBatchSetPadding(DBatch *batch, DWidget *widget, int padding);
+void dBatchSetPaddingTop(DBatch *batch, DWidget *widget, int padding);
+void dBatchSetPaddingBottom(DBatch *batch, DWidget *widget, int padding);
+void dBatchSetPaddingLeft(DBatch *batch, DWidget *widget, int padding);
+void dBatchSetPaddingRight(DBatch *batch, DWidget *widget, int padding);
+void dBatchSetOrientation(DBatch *batch, DWidget *widget, DWidgetOrientation orientation);
+void dBatchSetHExpand(DBatch *batch, DWidget *widget, bool hexpand);
+void dBatchSetVExpand(DBatch *batch, DWidget *widget, bool vexpand);
+void dBatchSetLabelText(DBatch *batch, DWidget *label, const char *text); // text is copied
+void dBatchSetTextButtonText(DBatch *batch, DWidget *button, const char *text); // text is copied
+void dBatchSetNumberValue(DBatch *batch, DWidget *number, int64_t value);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef BATCHPRIVATE_H
+#define BATCHPRIVATE_H
+
+#include "batch.h"
+
+void dBatchApplyCommitted(void); // applies all batches committed since the last call, in commit order (called once per frame by digitsLoop)
+void dBatchQuit(void); // frees any committed batches which have not yet been applied (called by digitsQuit)
+
+#endif
@@ -13,6 +13,8 @@ int dBoxVTableGetHeight(DWidget *widget);
 int dBoxVTableGetChildXOffset(DWidget *parent, DWidget *child);
 int dBoxVTableGetChildYOffset(DWidget *parent, DWidget *child);
 
+int dBoxGetChildOffset(DWidget *parent, DWidget *child); // sum of sizes of all children before the given one, along the box's orientation
+
 DWidget *dBoxNew(DWidgetOrientation orientation) {
 	assert(dWidgetOrientationIsValid(orientation));
 
@@ -34,6 +36,11 @@ void dBoxConstructor(DWidget *widget, DWidgetObjectData *data, DWidgetOrientatio
 	// Call super constructor first
 	dContainerConstructor(widget, data->super);
 
+	// Init fields
+	data->d.box.offsetGeneration=0;
+	data->d.box.offsetIndex=0;
+	data->d.box.offset=0;
+
 	// Setup vtable
 	data->vtable.getMinWidth=&dBoxVTableGetMinWidth;
 	data->vtable.getMinHeight=&dBoxVTableGetMinHeight;
@@ -177,16 +184,10 @@ int dBoxVTableGetChildXOffset(DWidget *parent, DWidget *child) {
 	int offset=dWidgetGetPaddingLeft(parent);
 
 	switch(dWidgetGetOrientation(parent)) {
-		case DWidgetOrientationHorizontal: {
+		case DWidgetOrientationHorizontal:
 			// In horizontal case need to sum all previous child widths
-			size_t childCount=dContainerGetChildCount(parent);
-			for(size_t i=0; i<childCount; ++i) {
-				DWidget *loopChild=dContainerGetChildN(parent, i);
-				if (loopChild==child)
-					break;
-				offset+=dWidgetGetWidth(loopChild);
-			}
-		} break;
+			offset+=dBoxGetChildOffset(parent, child);
+		break;
 		case DWidgetOrientationVertical:
 			// In vertical case all widgets are aligned at the left hand edge
 		break;
@@ -205,17 +206,52 @@ int dBoxVTableGetChildYOffset(DWidget *parent, DWidget *child) {
 		case DWidgetOrientationHorizontal:
 			// In horizontal case all widgets are aligned at the top edge
 		break;
-		case DWidgetOrientationVertical: {
+		case DWidgetOrientationVertical:
 			// In vertical case need to sum all previous child heights
-			size_t childCount=dContainerGetChildCount(parent);
-			for(size_t i=0; i<childCount; ++i) {
-				DWidget *loopChild=dContainerGetChildN(parent, i);
-				if (loopChild==child)
-					break;
-				offset+=dWidgetGetHeight(loopChild);
-			}
-		} break;
+			offset+=dBoxGetChildOffset(parent, child);
+		break;
 	}
 
 	return offset;
 }
+
+int dBoxGetChildOffset(DWidget *parent, DWidget *child) {
+	assert(parent!=NULL);
+	assert(child!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(parent, DWidgetTypeBox);
+
+	bool horizontal=(dWidgetGetOrientation(parent)==DWidgetOrientationHorizontal);
+	size_t childCount=dContainerGetChildCount(parent);
+	size_t lastIndex=data->d.box.offsetIndex;
+	bool lastValid=(data->d.box.offsetGeneration==dWidgetGetLayoutGeneration(parent) && lastIndex<childCount);
+
+	// Same child as last time?
+	if (lastValid && dContainerGetChildN(parent, lastIndex)==child)
+		return data->d.box.offset;
+
+	size_t index;
+	int offset;
+	if (lastValid && lastIndex+1<childCount && dContainerGetChildN(parent, lastIndex+1)==child) {
+		// Child directly follows the one last looked up (common when iterating over children) so simply add on the size of that one
+		DWidget *lastChild=dContainerGetChildN(parent, lastIndex);
+		index=lastIndex+1;
+		offset=data->d.box.offset+(horizontal ? dWidgetGetWidth(lastChild) : dWidgetGetHeight(lastChild));
+	} else {
+		// Otherwise sum sizes of all previous children
+		offset=0;
+		for(index=0; index<childCount; ++index) {
+			DWidget *loopChild=dContainerGetChildN(parent, index);
+			if (loopChild==child)
+				break;
+			offset+=(horizontal ? dWidgetGetWidth(loopChild) : dWidgetGetHeight(loopChild));
+		}
+	}
+
+	// Remember result for next time
+	data->d.box.offsetGeneration=dWidgetGetLayoutGeneration(parent);
+	data->d.box.offsetIndex=index;
+	data->d.box.offset=offset;
+
+	return offset;
+}
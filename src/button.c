@@ -1,5 +1,6 @@
 #include <assert.h>
 
+#include "animation.h"
 #include "bin.h"
 #include "binprivate.h"
 #include "button.h"
@@ -11,12 +12,18 @@
 const DColour dButtonPressedColour={.r=192, .g=192, .b=192, .a=255};
 const DColour dButtonReleasedColour={.r=128, .g=128, .b=128, .a=255};
 
+const DTimeMs dButtonPressDuration=60; // time to fade to the pressed colour (short so that presses still feel immediate)
+const DTimeMs dButtonReleaseDuration=150;
+
 void dButtonVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
 
 DWidgetSignalReturn dButtonHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData);
 DWidgetSignalReturn dButtonHandlerWidgetButtonRelease(const DWidgetSignalEvent *event, void *userData);
 DWidgetSignalReturn dButtonHandlerWidgetLeave(const DWidgetSignalEvent *event, void *userData);
 
+void dButtonSetPressed(DWidget *widget, bool pressed); // fades body colour to match
+void dButtonColourAnimate(DWidget *widget, float progress, void *userData);
+
 DWidget *dButtonNew(DWidget *child) {
 	// Create widget instance
 	DWidget *button=dWidgetNew(DWidgetTypeButton);
@@ -37,6 +44,9 @@ void dButtonConstructor(DWidget *widget, DWidgetObjectData *data, DWidget *child
 
 	// Init fields
 	data->d.button.pressed=false;
+	data->d.button.colour=dButtonReleasedColour;
+	data->d.button.colourFrom=dButtonReleasedColour;
+	data->d.button.colourAnimation=0;
 
 	// Setup vtable
 	data->vtable.redraw=&dButtonVTableRedraw;
@@ -57,7 +67,7 @@ void dButtonVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeButton);
 
 	// Draw rectangle to represent body of button
-	dSetRenderDrawColour(renderer, (data->d.button.pressed ? &dButtonPressedColour : &dButtonReleasedColour));
+	dSetRenderDrawColour(renderer, &data->d.button.colour);
 	SDL_Rect rect;
 	rect.x=dWidgetGetGlobalX(widget);
 	rect.y=dWidgetGetGlobalY(widget);
@@ -80,10 +90,7 @@ DWidgetSignalReturn dButtonHandlerWidgetButtonPress(const DWidgetSignalEvent *ev
 		return DWidgetSignalReturnContinue;
 
 	// Set pressed flag
-	data->d.button.pressed=true;
-
-	// Mark window as dirty to redraw
-	dWidgetSetDirty(event->widget);
+	dButtonSetPressed(event->widget, true);
 
 	// Indicate we have handled this event
 	return DWidgetSignalReturnStop;
@@ -100,10 +107,7 @@ DWidgetSignalReturn dButtonHandlerWidgetButtonRelease(const DWidgetSignalEvent *
 		return DWidgetSignalReturnContinue;
 
 	// Clear pressed flag
-	data->d.button.pressed=false;
-
-	// Mark window as dirty to redraw
-	dWidgetSetDirty(event->widget);
+	dButtonSetPressed(event->widget, false);
 
 	// Invoke button click signal
 	DWidgetSignalEvent dEvent;
@@ -126,10 +130,39 @@ DWidgetSignalReturn dButtonHandlerWidgetLeave(const DWidgetSignalEvent *event, v
 		return DWidgetSignalReturnContinue;
 
 	// Clear pressed flag (but do not invoke clicked signal - consider process aborted)
-	data->d.button.pressed=false;
-
-	// Mark window as dirty to redraw
-	dWidgetSetDirty(event->widget);
+	dButtonSetPressed(event->widget, false);
 
 	return DWidgetSignalReturnStop;
 }
+
+void dButtonSetPressed(DWidget *widget, bool pressed) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeButton);
+
+	data->d.button.pressed=pressed;
+
+	// Fade from the current colour (which may be part way through a previous fade) - each frame of this only redraws the button
+	if (data->d.button.colourAnimation!=0)
+		dAnimationCancel(data->d.button.colourAnimation);
+	data->d.button.colourFrom=data->d.button.colour;
+	data->d.button.colourAnimation=dAnimationStart(widget, 0, (pressed ? dButtonPressDuration : dButtonReleaseDuration), DAnimationEasingOutQuad, &dButtonColourAnimate, NULL);
+}
+
+void dButtonColourAnimate(DWidget *widget, float progress, void *userData) {
+	assert(widget!=NULL);
+	assert(userData==NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeButton);
+
+	// Update colour, only redrawing if it has visibly changed
+	DColour colour;
+	dAnimationLerpColour(&colour, &data->d.button.colourFrom, (data->d.button.pressed ? &dButtonPressedColour : &dButtonReleasedColour), progress);
+	if (colour.r!=data->d.button.colour.r || colour.g!=data->d.button.colour.g || colour.b!=data->d.button.colour.b || colour.a!=data->d.button.colour.a) {
+		data->d.button.colour=colour;
+		dWidgetSetDirtyBounds(widget);
+	}
+
+	if (progress>=1.0f)
+		data->d.button.colourAnimation=0;
+}
@@ -0,0 +1,642 @@
+#include <assert.h>
+#include <string.h>
+
+#include <SDL2/SDL_ttf.h>
+
+#include "canvas.h"
+#include "canvasprivate.h"
+#include "fontprivate.h"
+#include "traceprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+const DColour dCanvasDefaultColour={.r=255, .g=255, .b=255, .a=255};
+
+void dCanvasVTableDestructor(DWidget *widget);
+void dCanvasVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dCanvasVTableGetWidth(DWidget *widget);
+int dCanvasVTableGetHeight(DWidget *widget);
+
+void dCanvasModified(DWidget *canvas); // marks texture as out of date and queues a redraw
+void dCanvasRecordIfPending(DWidget *canvas);
+DCanvasCommand *dCanvasAddCommand(DWidget *canvas, DCanvasCommandType type);
+DCanvasCommand *dCanvasGetBatch(DWidget *canvas, DCanvasCommandType type); // returns last command if of the given type, otherwise adds one
+void dCanvasAddRect(DWidget *canvas, DCanvasCommandType type, int x, int y, int w, int h);
+void dCanvasAddPoint(DWidget *canvas, int x, int y);
+void *dCanvasGrow(DWidget *canvas, void *array, size_t *alloc, size_t needed, size_t entrySize); // returns array with at least needed entries allocated
+
+bool dCanvasTextureUpdate(DWidget *canvas, SDL_Renderer *renderer); // ensures texture exists and is up to date, returns false if not possible
+void dCanvasReplay(DWidget *canvas, SDL_Renderer *renderer, int offsetX, int offsetY); // draws commands with the canvas' top left at the given offset
+const SDL_Rect *dCanvasOffsetRects(DWidget *canvas, size_t start, size_t count, int offsetX, int offsetY);
+void dCanvasDrawTextDirect(DWidget *canvas, SDL_Renderer *renderer, const DColour *colour, int x, int y, const char *text);
+
+int dCanvasCeil(double x); // avoids needing libm
+int dCanvasCompareDouble(const void *a, const void *b);
+
+DWidget *dCanvasNew(int width, int height) {
+	assert(width>=0);
+	assert(height>=0);
+
+	// Create widget instance
+	DWidget *canvas=dWidgetNew(DWidgetTypeCanvas);
+
+	// Call constructor
+	dCanvasConstructor(canvas, canvas->base, width, height);
+
+	return canvas;
+}
+
+void dCanvasConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeCanvas);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields
+	data->d.canvas.width=width;
+	data->d.canvas.height=height;
+	data->d.canvas.commands=NULL;
+	data->d.canvas.commandCount=0;
+	data->d.canvas.commandAlloc=0;
+	data->d.canvas.points=NULL;
+	data->d.canvas.pointCount=0;
+	data->d.canvas.pointAlloc=0;
+	data->d.canvas.rects=NULL;
+	data->d.canvas.rectCount=0;
+	data->d.canvas.rectAlloc=0;
+	data->d.canvas.text=NULL;
+	data->d.canvas.textSize=0;
+	data->d.canvas.textAlloc=0;
+	data->d.canvas.colour=dCanvasDefaultColour;
+	data->d.canvas.recordCallback=NULL;
+	data->d.canvas.recordUserData=NULL;
+	data->d.canvas.recordPending=false;
+	data->d.canvas.recording=false;
+	data->d.canvas.texture=NULL;
+	data->d.canvas.textureRenderer=NULL;
+	data->d.canvas.textureValid=false;
+	data->d.canvas.scratch=NULL;
+	data->d.canvas.scratchAlloc=0;
+
+	// Setup vtable
+	data->vtable.destructor=&dCanvasVTableDestructor;
+	data->vtable.redraw=&dCanvasVTableRedraw;
+	data->vtable.getMinWidth=&dCanvasVTableGetWidth;
+	data->vtable.getMinHeight=&dCanvasVTableGetHeight;
+	data->vtable.getWidth=&dCanvasVTableGetWidth;
+	data->vtable.getHeight=&dCanvasVTableGetHeight;
+}
+
+void dCanvasSetRecordCallback(DWidget *canvas, DCanvasRecordCallback *callback, void *userData) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+	assert(!data->d.canvas.recording);
+
+	data->d.canvas.recordCallback=callback;
+	data->d.canvas.recordUserData=userData;
+
+	// Record using new callback
+	if (callback!=NULL)
+		dCanvasInvalidate(canvas);
+}
+
+void dCanvasInvalidate(DWidget *canvas) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+	assert(!data->d.canvas.recording);
+
+	dCanvasClear(canvas);
+
+	// Re-record lazily, so that many invalidations before the next redraw only record once
+	if (data->d.canvas.recordCallback!=NULL)
+		data->d.canvas.recordPending=true;
+}
+
+void dCanvasClear(DWidget *canvas) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	// Keep allocations for recording into again
+	data->d.canvas.commandCount=0;
+	data->d.canvas.pointCount=0;
+	data->d.canvas.rectCount=0;
+	data->d.canvas.textSize=0;
+	data->d.canvas.colour=dCanvasDefaultColour;
+
+	dCanvasModified(canvas);
+}
+
+void dCanvasSetColour(DWidget *canvas, const DColour *colour) {
+	assert(canvas!=NULL);
+	assert(colour!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	// No change?
+	if (memcmp(&data->d.canvas.colour, colour, sizeof(DColour))==0)
+		return;
+	data->d.canvas.colour=*colour;
+
+	// Overwrite previous colour if nothing was drawn with it
+	DCanvasCommand *command;
+	if (data->d.canvas.commandCount>0 && data->d.canvas.commands[data->d.canvas.commandCount-1].type==DCanvasCommandTypeColour)
+		command=&data->d.canvas.commands[data->d.canvas.commandCount-1];
+	else
+		command=dCanvasAddCommand(canvas, DCanvasCommandTypeColour);
+	command->d.colour=*colour;
+}
+
+void dCanvasDrawLine(DWidget *canvas, int x1, int y1, int x2, int y2) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	// Continue previous line strip if this line starts where it ended, otherwise begin a new strip
+	DCanvasCommand *command=NULL;
+	if (data->d.canvas.commandCount>0 && data->d.canvas.commands[data->d.canvas.commandCount-1].type==DCanvasCommandTypeLines) {
+		command=&data->d.canvas.commands[data->d.canvas.commandCount-1];
+		const SDL_Point *last=&data->d.canvas.points[command->d.batch.start+command->d.batch.count-1];
+		if (last->x!=x1 || last->y!=y1)
+			command=NULL;
+	}
+	if (command==NULL) {
+		command=dCanvasAddCommand(canvas, DCanvasCommandTypeLines);
+		dCanvasAddPoint(canvas, x1, y1);
+	}
+	dCanvasAddPoint(canvas, x2, y2);
+
+	dCanvasModified(canvas);
+}
+
+void dCanvasDrawRect(DWidget *canvas, int x, int y, int w, int h) {
+	assert(canvas!=NULL);
+
+	dCanvasAddRect(canvas, DCanvasCommandTypeRects, x, y, w, h);
+}
+
+void dCanvasFillRect(DWidget *canvas, int x, int y, int w, int h) {
+	assert(canvas!=NULL);
+
+	dCanvasAddRect(canvas, DCanvasCommandTypeFillRects, x, y, w, h);
+}
+
+void dCanvasFillPolygon(DWidget *canvas, const DWidgetPoint *points, size_t pointCount) {
+	assert(canvas!=NULL);
+	assert(points!=NULL || pointCount==0);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	if (pointCount<3)
+		return;
+
+	// Find vertical extent, limited to the canvas
+	int minY=points[0].y, maxY=points[0].y;
+	for(size_t i=1; i<pointCount; ++i) {
+		if (points[i].y<minY)
+			minY=points[i].y;
+		if (points[i].y>maxY)
+			maxY=points[i].y;
+	}
+	if (minY<0)
+		minY=0;
+	if (maxY>data->d.canvas.height)
+		maxY=data->d.canvas.height;
+
+	// Scan convert into one span per pair of edge crossings on each row (sampling at pixel centres), so replaying is a single FillRects call
+	double *crossings=dMallocTaggedNoFail(sizeof(double)*pointCount, dWidgetGetBaseType(canvas));
+	for(int y=minY; y<maxY; ++y) {
+		double sampleY=y+0.5;
+
+		// Find where each edge crosses this row
+		size_t crossingCount=0;
+		for(size_t i=0; i<pointCount; ++i) {
+			const DWidgetPoint *a=&points[i];
+			const DWidgetPoint *b=&points[(i+1)%pointCount];
+			if (a->y==b->y)
+				continue;
+			if ((sampleY<a->y)==(sampleY<b->y))
+				continue;
+			crossings[crossingCount++]=a->x+(sampleY-a->y)*(b->x-a->x)/(b->y-a->y);
+		}
+		qsort(crossings, crossingCount, sizeof(double), &dCanvasCompareDouble);
+
+		// Fill between pairs of crossings (even-odd rule)
+		for(size_t i=0; i+1<crossingCount; i+=2) {
+			int startX=dCanvasCeil(crossings[i]-0.5);
+			int endX=dCanvasCeil(crossings[i+1]-0.5);
+			if (endX>startX)
+				dCanvasAddRect(canvas, DCanvasCommandTypeFillRects, startX, y, endX-startX, 1);
+		}
+	}
+	dFree(crossings);
+}
+
+void dCanvasDrawText(DWidget *canvas, int x, int y, const char *text) {
+	assert(canvas!=NULL);
+	assert(text!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	if (text[0]=='\0')
+		return;
+
+	// Copy text into string pool
+	size_t length=strlen(text)+1;
+	data->d.canvas.text=dCanvasGrow(canvas, data->d.canvas.text, &data->d.canvas.textAlloc, data->d.canvas.textSize+length, sizeof(char));
+	memcpy(data->d.canvas.text+data->d.canvas.textSize, text, length);
+
+	DCanvasCommand *command=dCanvasAddCommand(canvas, DCanvasCommandTypeText);
+	command->d.text.x=x;
+	command->d.text.y=y;
+	command->d.text.offset=data->d.canvas.textSize;
+	data->d.canvas.textSize+=length;
+
+	dCanvasModified(canvas);
+}
+
+size_t dCanvasGetCommandCount(const DWidget *canvas) {
+	assert(canvas!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(canvas, DWidgetTypeCanvas);
+
+	size_t count=0;
+	for(size_t i=0; i<data->d.canvas.commandCount; ++i)
+		if (data->d.canvas.commands[i].type!=DCanvasCommandTypeColour)
+			++count;
+	return count;
+}
+
+void dCanvasVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeCanvas);
+
+	// Free command buffer and texture
+	dFree(data->d.canvas.commands);
+	data->d.canvas.commands=NULL;
+	dFree(data->d.canvas.points);
+	data->d.canvas.points=NULL;
+	dFree(data->d.canvas.rects);
+	data->d.canvas.rects=NULL;
+	dFree(data->d.canvas.text);
+	data->d.canvas.text=NULL;
+	dFree(data->d.canvas.scratch);
+	data->d.canvas.scratch=NULL;
+
+	dDestroyTexture(data->d.canvas.texture);
+	data->d.canvas.texture=NULL;
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dCanvasVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeCanvas);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	dCanvasRecordIfPending(widget);
+
+	if (data->d.canvas.width==0 || data->d.canvas.height==0 || data->d.canvas.commandCount==0)
+		return;
+
+	SDL_Rect destRect={
+	    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
+	    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
+	    .w=data->d.canvas.width,
+	    .h=data->d.canvas.height,
+	};
+
+	// Copy cached rendering of commands if possible
+	if (dCanvasTextureUpdate(widget, renderer)) {
+		SDL_RenderCopy(renderer, data->d.canvas.texture, NULL, &destRect);
+		return;
+	}
+
+	// Otherwise replay commands directly, clipped to the canvas (and any existing clip rect)
+	SDL_Rect oldClipRect;
+	bool oldClipEnabled=SDL_RenderIsClipEnabled(renderer);
+	SDL_RenderGetClipRect(renderer, &oldClipRect);
+
+	SDL_Rect clipRect=destRect;
+	if (oldClipEnabled && !SDL_IntersectRect(&oldClipRect, &destRect, &clipRect))
+		return;
+	SDL_RenderSetClipRect(renderer, &clipRect);
+
+	dCanvasReplay(widget, renderer, destRect.x, destRect.y);
+
+	SDL_RenderSetClipRect(renderer, (oldClipEnabled ? &oldClipRect : NULL));
+}
+
+int dCanvasVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeCanvas);
+
+	return data->d.canvas.width+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dCanvasVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeCanvas);
+
+	return data->d.canvas.height+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+void dCanvasModified(DWidget *canvas) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	data->d.canvas.textureValid=false;
+
+	// Commands recorded by the callback are already part of a redraw
+	// (otherwise only the canvas's own area needs redrawing, as its size does not depend on its commands)
+	if (!data->d.canvas.recording)
+		dWidgetSetDirtyBounds(canvas);
+}
+
+void dCanvasRecordIfPending(DWidget *canvas) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	if (!data->d.canvas.recordPending)
+		return;
+	data->d.canvas.recordPending=false;
+
+	DTimeUs traceStart=dTraceBegin();
+
+	data->d.canvas.recording=true;
+	data->d.canvas.recordCallback(canvas, data->d.canvas.recordUserData);
+	data->d.canvas.recording=false;
+
+	dTraceEnd(traceStart, "canvas record", "render", NULL);
+}
+
+DCanvasCommand *dCanvasAddCommand(DWidget *canvas, DCanvasCommandType type) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	data->d.canvas.commands=dCanvasGrow(canvas, data->d.canvas.commands, &data->d.canvas.commandAlloc, data->d.canvas.commandCount+1, sizeof(DCanvasCommand));
+	DCanvasCommand *command=&data->d.canvas.commands[data->d.canvas.commandCount++];
+	command->type=type;
+	switch(type) {
+		case DCanvasCommandTypeColour:
+		case DCanvasCommandTypeText:
+		break;
+		case DCanvasCommandTypeLines:
+			command->d.batch.start=data->d.canvas.pointCount;
+			command->d.batch.count=0;
+		break;
+		case DCanvasCommandTypeRects:
+		case DCanvasCommandTypeFillRects:
+			command->d.batch.start=data->d.canvas.rectCount;
+			command->d.batch.count=0;
+		break;
+	}
+
+	return command;
+}
+
+DCanvasCommand *dCanvasGetBatch(DWidget *canvas, DCanvasCommandType type) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	if (data->d.canvas.commandCount>0 && data->d.canvas.commands[data->d.canvas.commandCount-1].type==type)
+		return &data->d.canvas.commands[data->d.canvas.commandCount-1];
+
+	return dCanvasAddCommand(canvas, type);
+}
+
+void dCanvasAddRect(DWidget *canvas, DCanvasCommandType type, int x, int y, int w, int h) {
+	assert(canvas!=NULL);
+	assert(type==DCanvasCommandTypeRects || type==DCanvasCommandTypeFillRects);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	if (w<=0 || h<=0)
+		return;
+
+	DCanvasCommand *command=dCanvasGetBatch(canvas, type);
+
+	data->d.canvas.rects=dCanvasGrow(canvas, data->d.canvas.rects, &data->d.canvas.rectAlloc, data->d.canvas.rectCount+1, sizeof(SDL_Rect));
+	data->d.canvas.rects[data->d.canvas.rectCount++]=(SDL_Rect){.x=x, .y=y, .w=w, .h=h};
+	++command->d.batch.count;
+
+	dCanvasModified(canvas);
+}
+
+void dCanvasAddPoint(DWidget *canvas, int x, int y) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+	assert(data->d.canvas.commandCount>0 && data->d.canvas.commands[data->d.canvas.commandCount-1].type==DCanvasCommandTypeLines);
+
+	data->d.canvas.points=dCanvasGrow(canvas, data->d.canvas.points, &data->d.canvas.pointAlloc, data->d.canvas.pointCount+1, sizeof(SDL_Point));
+	data->d.canvas.points[data->d.canvas.pointCount++]=(SDL_Point){.x=x, .y=y};
+	++data->d.canvas.commands[data->d.canvas.commandCount-1].d.batch.count;
+}
+
+void *dCanvasGrow(DWidget *canvas, void *array, size_t *alloc, size_t needed, size_t entrySize) {
+	assert(canvas!=NULL);
+	assert(alloc!=NULL);
+	assert(entrySize>0);
+
+	if (needed<=*alloc)
+		return array;
+
+	// Double to keep recording amortised O(1)
+	size_t newAlloc=(*alloc>0 ? *alloc*2 : 16);
+	while(newAlloc<needed)
+		newAlloc*=2;
+	*alloc=newAlloc;
+
+	return dReallocTaggedNoFail(array, newAlloc*entrySize, dWidgetGetBaseType(canvas));
+}
+
+bool dCanvasTextureUpdate(DWidget *canvas, SDL_Renderer *renderer) {
+	assert(canvas!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	if (!SDL_RenderTargetSupported(renderer))
+		return false;
+
+	// Already up to date?
+	if (data->d.canvas.texture!=NULL && data->d.canvas.textureRenderer==renderer && data->d.canvas.textureValid)
+		return true;
+
+	// (Re)create texture if needed (e.g. if moved to another window)
+	if (data->d.canvas.texture!=NULL && data->d.canvas.textureRenderer!=renderer) {
+		dDestroyTexture(data->d.canvas.texture);
+		data->d.canvas.texture=NULL;
+	}
+	if (data->d.canvas.texture==NULL) {
+		data->d.canvas.texture=dCreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, data->d.canvas.width, data->d.canvas.height);
+		if (data->d.canvas.texture==NULL) {
+			dWarning("warning: could not create canvas texture for widget %p (%s)\n", canvas, dWidgetTypeToString(dWidgetGetBaseType(canvas)));
+			return false;
+		}
+		SDL_SetTextureBlendMode(data->d.canvas.texture, SDL_BLENDMODE_BLEND);
+		data->d.canvas.textureRenderer=renderer;
+	}
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Save current target (the window's own, if it has one) and clip rect, as changing target resets clipping
+	SDL_Texture *oldTarget=SDL_GetRenderTarget(renderer);
+	SDL_Rect oldClipRect;
+	bool oldClipEnabled=SDL_RenderIsClipEnabled(renderer);
+	SDL_RenderGetClipRect(renderer, &oldClipRect);
+
+	// Render commands into texture, starting from transparent
+	SDL_SetRenderTarget(renderer, data->d.canvas.texture);
+	SDL_RenderSetClipRect(renderer, NULL);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	SDL_RenderClear(renderer);
+	dCanvasReplay(canvas, renderer, 0, 0);
+
+	// Restore previous state
+	SDL_SetRenderTarget(renderer, oldTarget);
+	SDL_RenderSetClipRect(renderer, (oldClipEnabled ? &oldClipRect : NULL));
+
+	data->d.canvas.textureValid=true;
+
+	dTraceEnd(traceStart, "canvas texture", "render", NULL);
+
+	return true;
+}
+
+void dCanvasReplay(DWidget *canvas, SDL_Renderer *renderer, int offsetX, int offsetY) {
+	assert(canvas!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+
+	// Blend translucent colours with whatever was drawn before them
+	SDL_BlendMode oldBlendMode;
+	SDL_GetRenderDrawBlendMode(renderer, &oldBlendMode);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+	const DColour *colour=&dCanvasDefaultColour;
+	dSetRenderDrawColour(renderer, colour);
+
+	for(size_t i=0; i<data->d.canvas.commandCount; ++i) {
+		const DCanvasCommand *command=&data->d.canvas.commands[i];
+		switch(command->type) {
+			case DCanvasCommandTypeColour:
+				colour=&command->d.colour;
+				dSetRenderDrawColour(renderer, colour);
+			break;
+			case DCanvasCommandTypeLines:
+				if (offsetX==0 && offsetY==0)
+					SDL_RenderDrawLines(renderer, data->d.canvas.points+command->d.batch.start, command->d.batch.count);
+				else {
+					for(size_t j=1; j<command->d.batch.count; ++j) {
+						const SDL_Point *a=&data->d.canvas.points[command->d.batch.start+j-1];
+						const SDL_Point *b=&data->d.canvas.points[command->d.batch.start+j];
+						SDL_RenderDrawLine(renderer, a->x+offsetX, a->y+offsetY, b->x+offsetX, b->y+offsetY);
+					}
+				}
+			break;
+			case DCanvasCommandTypeRects:
+				SDL_RenderDrawRects(renderer, dCanvasOffsetRects(canvas, command->d.batch.start, command->d.batch.count, offsetX, offsetY), command->d.batch.count);
+			break;
+			case DCanvasCommandTypeFillRects:
+				SDL_RenderFillRects(renderer, dCanvasOffsetRects(canvas, command->d.batch.start, command->d.batch.count, offsetX, offsetY), command->d.batch.count);
+			break;
+			case DCanvasCommandTypeText:
+				dCanvasDrawTextDirect(canvas, renderer, colour, command->d.text.x+offsetX, command->d.text.y+offsetY, data->d.canvas.text+command->d.text.offset);
+				dSetRenderDrawColour(renderer, colour);
+			break;
+		}
+	}
+
+	SDL_SetRenderDrawBlendMode(renderer, oldBlendMode);
+}
+
+const SDL_Rect *dCanvasOffsetRects(DWidget *canvas, size_t start, size_t count, int offsetX, int offsetY) {
+	assert(canvas!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(canvas, DWidgetTypeCanvas);
+	assert(start+count<=data->d.canvas.rectCount);
+
+	// Recorded rects can be used as they are
+	if (offsetX==0 && offsetY==0)
+		return data->d.canvas.rects+start;
+
+	data->d.canvas.scratch=dCanvasGrow(canvas, data->d.canvas.scratch, &data->d.canvas.scratchAlloc, count, sizeof(SDL_Rect));
+	for(size_t i=0; i<count; ++i) {
+		data->d.canvas.scratch[i]=data->d.canvas.rects[start+i];
+		data->d.canvas.scratch[i].x+=offsetX;
+		data->d.canvas.scratch[i].y+=offsetY;
+	}
+
+	return data->d.canvas.scratch;
+}
+
+void dCanvasDrawTextDirect(DWidget *canvas, SDL_Renderer *renderer, const DColour *colour, int x, int y, const char *text) {
+	assert(canvas!=NULL);
+	assert(renderer!=NULL);
+	assert(colour!=NULL);
+	assert(text!=NULL);
+
+	// Grab font
+	TTF_Font *font=dFontGet();
+	if (font==NULL) {
+		dWarning("warning: could not draw canvas text for widget %p (%s) - could not open font at '%s'\n", canvas, dWidgetTypeToString(dWidgetGetBaseType(canvas)), dFontPath);
+		return;
+	}
+
+	// Render text to surface and then to a temporary texture
+	SDL_Color textColour={colour->r, colour->g, colour->b, colour->a};
+	SDL_Surface *surface=TTF_RenderUTF8_Blended(font, text, textColour);
+	if (surface==NULL) {
+		dWarning("warning: could not draw canvas text for widget %p (%s) - could not render to surface\n", canvas, dWidgetTypeToString(dWidgetGetBaseType(canvas)));
+		return;
+	}
+
+	SDL_Texture *texture=dCreateTextureFromSurface(renderer, surface);
+	if (texture==NULL) {
+		dWarning("warning: could not draw canvas text for widget %p (%s) - could not create texture\n", canvas, dWidgetTypeToString(dWidgetGetBaseType(canvas)));
+		SDL_FreeSurface(surface);
+		return;
+	}
+
+	SDL_Rect destRect={.x=x, .y=y, .w=surface->w, .h=surface->h};
+	SDL_RenderCopy(renderer, texture, NULL, &destRect);
+
+	// Tidy up
+	dDestroyTexture(texture);
+	SDL_FreeSurface(surface);
+}
+
+int dCanvasCeil(double x) {
+	int result=(int)x;
+	if (result<x)
+		++result;
+	return result;
+}
+
+int dCanvasCompareDouble(const void *a, const void *b) {
+	double x=*(const double *)a;
+	double y=*(const double *)b;
+	return (x>y)-(x<y);
+}
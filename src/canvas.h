@@ -0,0 +1,30 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <stddef.h>
+
+#include "util.h"
+#include "widget.h"
+
+// A Canvas draws a list of recorded commands, which are rendered once into a texture and then only copied on each redraw.
+// Commands only need recording again when the drawing itself changes - either record them directly (after dCanvasClear), or set a record callback which is called before the next redraw following each dCanvasInvalidate.
+// Coordinates are in pixels relative to the top left of the canvas (excluding padding), and anything drawn outside of the canvas is clipped.
+
+typedef void (DCanvasRecordCallback)(DWidget *canvas, void *userData);
+
+DWidget *dCanvasNew(int width, int height);
+
+void dCanvasSetRecordCallback(DWidget *canvas, DCanvasRecordCallback *callback, void *userData); // callback can be NULL. if not, it is called before the next redraw
+void dCanvasInvalidate(DWidget *canvas); // clears commands, calling the record callback (if any) again before the next redraw
+
+void dCanvasClear(DWidget *canvas);
+void dCanvasSetColour(DWidget *canvas, const DColour *colour); // applies to following commands (initially opaque white)
+void dCanvasDrawLine(DWidget *canvas, int x1, int y1, int x2, int y2);
+void dCanvasDrawRect(DWidget *canvas, int x, int y, int w, int h); // outline only
+void dCanvasFillRect(DWidget *canvas, int x, int y, int w, int h);
+void dCanvasFillPolygon(DWidget *canvas, const DWidgetPoint *points, size_t pointCount); // using the even-odd rule. converted to horizontal spans when recorded
+void dCanvasDrawText(DWidget *canvas, int x, int y, const char *text); // UTF-8, with x and y giving the top left corner
+
+size_t dCanvasGetCommandCount(const DWidget *canvas); // number of draw calls needed to replay the commands (consecutive primitives of the same kind are batched)
+
+#endif
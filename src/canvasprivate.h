@@ -0,0 +1,8 @@
+#ifndef CANVASPRIVATE_H
+#define CANVASPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dCanvasConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height);
+
+#endif
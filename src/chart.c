@@ -0,0 +1,490 @@
+#include <assert.h>
+#include <float.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "chart.h"
+#include "chartprivate.h"
+#include "digits.h"
+#include "traceprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+// Per chart state which appending threads need, kept separate from the widget so that a notification still queued when the chart is freed has something to find
+struct DChartShared {
+	atomic_bool notifyPending; // a notification has been posted to the UI thread but has not yet run
+	DWidget *chart; // NULL once the chart has been freed (UI thread only)
+};
+
+struct DChartSeries {
+	DChartShared *shared;
+	DColour colour;
+
+	// Samples waiting to be taken by the UI thread, with the appending thread as the single producer and the UI thread as the single consumer
+	float *ring;
+	size_t ringSize; // always a power of two
+	atomic_size_t head; // total samples written (only changed by the producer)
+	char headPadding[64-sizeof(atomic_size_t)]; // keep head and tail on separate cache lines
+	atomic_size_t tail; // total samples taken (only changed by the UI thread)
+	atomic_size_t dropped;
+
+	// Decimated samples (UI thread only) - bucket i holds the min and max of samples [i*bucketSize, (i+1)*bucketSize), and only the most recent bucketCount are kept
+	float *bucketMin, *bucketMax;
+	size_t bucketCount;
+	size_t sampleCount; // total samples taken
+};
+
+const size_t dChartRingSizeMin=16384; // enough for a few frames of samples at a million samples per second
+
+void dChartVTableDestructor(DWidget *widget);
+void dChartVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dChartVTableGetWidth(DWidget *widget);
+int dChartVTableGetHeight(DWidget *widget);
+
+void dChartNotify(void *userData); // posted to the UI thread after samples are appended
+void dChartSeriesTake(DChartSeries *series, size_t bucketSize); // moves waiting samples into buckets
+bool dChartGetRange(DWidget *chart, size_t *newestBucket, float *min, float *max); // returns false if there is nothing to draw
+int dChartValueToY(DWidget *chart, float value, float min, float max);
+
+void dChartMinMax(const float *samples, size_t count, float *min, float *max); // updates min and max to include the samples given
+
+DWidget *dChartNew(int width, int height, size_t capacity) {
+	assert(width>=0);
+	assert(height>=0);
+	assert(capacity>0);
+
+	// Create widget instance
+	DWidget *chart=dWidgetNew(DWidgetTypeChart);
+
+	// Call constructor
+	dChartConstructor(chart, chart->base, width, height, capacity);
+
+	return chart;
+}
+
+void dChartConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height, size_t capacity) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeChart);
+	assert(width>=0);
+	assert(height>=0);
+	assert(capacity>0);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields
+	size_t columns=(width>0 ? width : 1);
+	data->d.chart.width=width;
+	data->d.chart.height=height;
+	data->d.chart.bucketSize=(capacity+columns-1)/columns;
+	data->d.chart.capacity=data->d.chart.bucketSize*columns;
+	data->d.chart.shared=dMallocTaggedNoFail(sizeof(DChartShared), dWidgetGetBaseType(widget));
+	atomic_init(&data->d.chart.shared->notifyPending, false);
+	data->d.chart.shared->chart=widget;
+	data->d.chart.series=NULL;
+	data->d.chart.seriesCount=0;
+	data->d.chart.autoRange=true;
+	data->d.chart.rangeMin=0.0;
+	data->d.chart.rangeMax=1.0;
+	data->d.chart.rects=dMallocTaggedNoFail(sizeof(SDL_Rect)*columns, dWidgetGetBaseType(widget));
+
+	// Setup vtable
+	data->vtable.destructor=&dChartVTableDestructor;
+	data->vtable.redraw=&dChartVTableRedraw;
+	data->vtable.getMinWidth=&dChartVTableGetWidth;
+	data->vtable.getMinHeight=&dChartVTableGetHeight;
+	data->vtable.getWidth=&dChartVTableGetWidth;
+	data->vtable.getHeight=&dChartVTableGetHeight;
+}
+
+DChartSeries *dChartAddSeries(DWidget *chart, const DColour *colour) {
+	assert(chart!=NULL);
+	assert(colour!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(chart, DWidgetTypeChart);
+	DWidgetType tag=dWidgetGetBaseType(chart);
+
+	// Create series
+	DChartSeries *series=dMallocTaggedNoFail(sizeof(DChartSeries), tag);
+	series->shared=data->d.chart.shared;
+	series->colour=*colour;
+
+	series->ringSize=dChartRingSizeMin;
+	while(series->ringSize<data->d.chart.capacity)
+		series->ringSize*=2;
+	series->ring=dMallocTaggedNoFail(sizeof(float)*series->ringSize, tag);
+	atomic_init(&series->head, 0);
+	atomic_init(&series->tail, 0);
+	atomic_init(&series->dropped, 0);
+
+	series->bucketCount=(data->d.chart.width>0 ? data->d.chart.width : 1);
+	series->bucketMin=dMallocTaggedNoFail(sizeof(float)*series->bucketCount, tag);
+	series->bucketMax=dMallocTaggedNoFail(sizeof(float)*series->bucketCount, tag);
+	series->sampleCount=0;
+
+	// Add to array
+	data->d.chart.series=dReallocTaggedNoFail(data->d.chart.series, sizeof(DChartSeries *)*(data->d.chart.seriesCount+1), tag);
+	data->d.chart.series[data->d.chart.seriesCount++]=series;
+
+	return series;
+}
+
+void dChartSetRange(DWidget *chart, float min, float max) {
+	assert(chart!=NULL);
+	assert(min<max);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(chart, DWidgetTypeChart);
+
+	data->d.chart.autoRange=false;
+	data->d.chart.rangeMin=min;
+	data->d.chart.rangeMax=max;
+
+	dWidgetSetDirtyBounds(chart);
+}
+
+void dChartSetAutoRange(DWidget *chart) {
+	assert(chart!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(chart, DWidgetTypeChart);
+
+	if (data->d.chart.autoRange)
+		return;
+	data->d.chart.autoRange=true;
+
+	dWidgetSetDirtyBounds(chart);
+}
+
+void dChartSeriesAppend(DChartSeries *series, const float *samples, size_t count) {
+	assert(series!=NULL);
+	assert(samples!=NULL || count==0);
+
+	if (count==0)
+		return;
+
+	// Only take as many samples as there is space for, dropping the oldest of those given
+	size_t head=atomic_load_explicit(&series->head, memory_order_relaxed);
+	size_t tail=atomic_load_explicit(&series->tail, memory_order_acquire);
+	size_t space=series->ringSize-(head-tail);
+	if (count>space) {
+		atomic_fetch_add_explicit(&series->dropped, count-space, memory_order_relaxed);
+		samples+=count-space;
+		count=space;
+	}
+
+	// Copy into ring (in two parts if wrapping around the end) and then publish
+	size_t ringIndex=head&(series->ringSize-1);
+	size_t firstCount=series->ringSize-ringIndex;
+	if (firstCount>count)
+		firstCount=count;
+	memcpy(series->ring+ringIndex, samples, sizeof(float)*firstCount);
+	memcpy(series->ring, samples+firstCount, sizeof(float)*(count-firstCount));
+	atomic_store_explicit(&series->head, head+count, memory_order_release);
+
+	// Ask UI thread to redraw chart, unless already asked and not yet done so
+	if (!atomic_exchange(&series->shared->notifyPending, true))
+		digitsPost(&dChartNotify, series->shared);
+}
+
+size_t dChartSeriesGetDroppedCount(const DChartSeries *series) {
+	assert(series!=NULL);
+
+	return atomic_load_explicit(&((DChartSeries *)series)->dropped, memory_order_relaxed);
+}
+
+void dChartVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeChart);
+
+	// Free series
+	for(size_t i=0; i<data->d.chart.seriesCount; ++i) {
+		DChartSeries *series=data->d.chart.series[i];
+		dFree(series->ring);
+		dFree(series->bucketMin);
+		dFree(series->bucketMax);
+		dFree(series);
+	}
+	dFree(data->d.chart.series);
+	data->d.chart.series=NULL;
+	data->d.chart.seriesCount=0;
+
+	dFree(data->d.chart.rects);
+	data->d.chart.rects=NULL;
+
+	// Free shared state, unless a queued notification still refers to it (in which case that frees it instead)
+	if (atomic_load(&data->d.chart.shared->notifyPending))
+		data->d.chart.shared->chart=NULL;
+	else
+		dFree(data->d.chart.shared);
+	data->d.chart.shared=NULL;
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dChartVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeChart);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	// Take any waiting samples
+	for(size_t i=0; i<data->d.chart.seriesCount; ++i)
+		dChartSeriesTake(data->d.chart.series[i], data->d.chart.bucketSize);
+
+	if (data->d.chart.width==0 || data->d.chart.height==0)
+		return;
+
+	DTimeUs traceStart=dTraceBegin();
+
+	size_t newestBucket;
+	float min, max;
+	if (!dChartGetRange(widget, &newestBucket, &min, &max)) {
+		dTraceEnd(traceStart, "chart redraw", "render", NULL);
+		return;
+	}
+
+	int x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget);
+	int y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget);
+	size_t width=data->d.chart.width;
+
+	// Draw each series as one vertical span per pixel column (with the newest samples on the right), joined to the previous column's span
+	for(size_t i=0; i<data->d.chart.seriesCount; ++i) {
+		DChartSeries *series=data->d.chart.series[i];
+		if (series->sampleCount==0)
+			continue;
+
+		// Series lagging behind the newest end before the rightmost column
+		size_t seriesNewestBucket=(series->sampleCount-1)/data->d.chart.bucketSize;
+		size_t lag=newestBucket-seriesNewestBucket;
+		if (lag>=width)
+			continue;
+		size_t bucketCount=seriesNewestBucket+1;
+		if (bucketCount>width-lag)
+			bucketCount=width-lag;
+		size_t column=width-lag-bucketCount;
+
+		int prevTop=0, prevBottom=0;
+		size_t rectCount=0;
+		for(size_t bucket=seriesNewestBucket+1-bucketCount; bucket<=seriesNewestBucket; ++bucket, ++column) {
+			size_t index=bucket%series->bucketCount;
+			int top=dChartValueToY(widget, series->bucketMax[index], min, max);
+			int bottom=dChartValueToY(widget, series->bucketMin[index], min, max);
+
+			SDL_Rect *rect=&data->d.chart.rects[rectCount++];
+			rect->x=x+column;
+			rect->y=y+top;
+			rect->w=1;
+			rect->h=bottom-top+1;
+			if (rectCount>1) {
+				if (top>prevBottom) {
+					rect->y=y+prevBottom;
+					rect->h=bottom-prevBottom+1;
+				} else if (bottom<prevTop)
+					rect->h=prevTop-top+1;
+			}
+			prevTop=top;
+			prevBottom=bottom;
+		}
+
+		dSetRenderDrawColour(renderer, &series->colour);
+		SDL_RenderFillRects(renderer, data->d.chart.rects, rectCount);
+	}
+
+	dTraceEnd(traceStart, "chart redraw", "render", NULL);
+}
+
+int dChartVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeChart);
+
+	return data->d.chart.width+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dChartVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeChart);
+
+	return data->d.chart.height+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+void dChartNotify(void *userData) {
+	assert(userData!=NULL);
+
+	DChartShared *shared=(DChartShared *)userData;
+
+	// Chart freed since this was posted?
+	if (shared->chart==NULL) {
+		dFree(shared);
+		return;
+	}
+
+	// Clear flag first so that samples appended from now on post again
+	atomic_store(&shared->notifyPending, false);
+	dWidgetSetDirtyBounds(shared->chart);
+}
+
+void dChartSeriesTake(DChartSeries *series, size_t bucketSize) {
+	assert(series!=NULL);
+	assert(bucketSize>0);
+
+	size_t tail=atomic_load_explicit(&series->tail, memory_order_relaxed);
+	size_t head=atomic_load_explicit(&series->head, memory_order_acquire);
+
+	while(tail!=head) {
+		// Take the longest run of samples which neither wraps around the ring nor crosses into another bucket
+		size_t ringIndex=tail&(series->ringSize-1);
+		size_t bucketOffset=series->sampleCount%bucketSize;
+		size_t count=head-tail;
+		if (count>series->ringSize-ringIndex)
+			count=series->ringSize-ringIndex;
+		if (count>bucketSize-bucketOffset)
+			count=bucketSize-bucketOffset;
+
+		// Reduce run into its bucket (starting it afresh if this is the bucket's first sample)
+		size_t index=(series->sampleCount/bucketSize)%series->bucketCount;
+		if (bucketOffset==0) {
+			series->bucketMin[index]=FLT_MAX;
+			series->bucketMax[index]=-FLT_MAX;
+		}
+		dChartMinMax(series->ring+ringIndex, count, &series->bucketMin[index], &series->bucketMax[index]);
+
+		tail+=count;
+		series->sampleCount+=count;
+	}
+
+	// Release space back to the producer
+	atomic_store_explicit(&series->tail, tail, memory_order_release);
+}
+
+bool dChartGetRange(DWidget *chart, size_t *newestBucket, float *min, float *max) {
+	assert(chart!=NULL);
+	assert(newestBucket!=NULL);
+	assert(min!=NULL);
+	assert(max!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(chart, DWidgetTypeChart);
+
+	// Find newest bucket of any series, which is drawn in the rightmost column
+	bool found=false;
+	*newestBucket=0;
+	for(size_t i=0; i<data->d.chart.seriesCount; ++i) {
+		DChartSeries *series=data->d.chart.series[i];
+		if (series->sampleCount==0)
+			continue;
+		size_t bucket=(series->sampleCount-1)/data->d.chart.bucketSize;
+		if (!found || bucket>*newestBucket)
+			*newestBucket=bucket;
+		found=true;
+	}
+	if (!found)
+		return false;
+
+	if (!data->d.chart.autoRange) {
+		*min=data->d.chart.rangeMin;
+		*max=data->d.chart.rangeMax;
+		return true;
+	}
+
+	// Fit range to visible buckets
+	size_t width=data->d.chart.width;
+	size_t oldestBucket=(*newestBucket+1>width ? *newestBucket+1-width : 0);
+	*min=FLT_MAX;
+	*max=-FLT_MAX;
+	for(size_t i=0; i<data->d.chart.seriesCount; ++i) {
+		DChartSeries *series=data->d.chart.series[i];
+		if (series->sampleCount==0)
+			continue;
+		size_t seriesNewestBucket=(series->sampleCount-1)/data->d.chart.bucketSize;
+		size_t seriesOldestBucket=(seriesNewestBucket+1>width ? seriesNewestBucket+1-width : 0);
+		if (seriesOldestBucket<oldestBucket)
+			seriesOldestBucket=oldestBucket;
+		for(size_t bucket=seriesOldestBucket; bucket<=seriesNewestBucket; ++bucket) {
+			size_t index=bucket%series->bucketCount;
+			if (series->bucketMin[index]<*min)
+				*min=series->bucketMin[index];
+			if (series->bucketMax[index]>*max)
+				*max=series->bucketMax[index];
+		}
+	}
+	if (*min>*max)
+		return false;
+
+	// Avoid a zero range for flat lines (centring them instead)
+	if (*max-*min<FLT_EPSILON) {
+		*min-=1.0;
+		*max+=1.0;
+	}
+
+	return true;
+}
+
+int dChartValueToY(DWidget *chart, float value, float min, float max) {
+	assert(chart!=NULL);
+	assert(min<max);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(chart, DWidgetTypeChart);
+
+	// Clamp to range, with larger values towards the top
+	int height=data->d.chart.height;
+	if (value<=min)
+		return height-1;
+	if (value>=max)
+		return 0;
+	return (height-1)-(int)((value-min)/(max-min)*(height-1)+0.5);
+}
+
+void dChartMinMax(const float *samples, size_t count, float *min, float *max) {
+	assert(samples!=NULL || count==0);
+	assert(min!=NULL);
+	assert(max!=NULL);
+
+	float resultMin=*min, resultMax=*max;
+	size_t i=0;
+
+#ifdef __SSE2__
+	// Reduce 8 samples at a time using two pairs of accumulators (to hide instruction latency), then combine the lanes
+	if (count>=8) {
+		__m128 min0=_mm_set1_ps(resultMin), min1=min0;
+		__m128 max0=_mm_set1_ps(resultMax), max1=max0;
+		for(; i+8<=count; i+=8) {
+			__m128 a=_mm_loadu_ps(samples+i);
+			__m128 b=_mm_loadu_ps(samples+i+4);
+			min0=_mm_min_ps(min0, a);
+			max0=_mm_max_ps(max0, a);
+			min1=_mm_min_ps(min1, b);
+			max1=_mm_max_ps(max1, b);
+		}
+		min0=_mm_min_ps(min0, min1);
+		max0=_mm_max_ps(max0, max1);
+		min0=_mm_min_ps(min0, _mm_shuffle_ps(min0, min0, _MM_SHUFFLE(1, 0, 3, 2)));
+		max0=_mm_max_ps(max0, _mm_shuffle_ps(max0, max0, _MM_SHUFFLE(1, 0, 3, 2)));
+		min0=_mm_min_ps(min0, _mm_shuffle_ps(min0, min0, _MM_SHUFFLE(2, 3, 0, 1)));
+		max0=_mm_max_ps(max0, _mm_shuffle_ps(max0, max0, _MM_SHUFFLE(2, 3, 0, 1)));
+		resultMin=_mm_cvtss_f32(min0);
+		resultMax=_mm_cvtss_f32(max0);
+	}
+#endif
+
+	// Remaining samples (or all of them without SSE2)
+	for(; i<count; ++i) {
+		if (samples[i]<resultMin)
+			resultMin=samples[i];
+		if (samples[i]>resultMax)
+			resultMax=samples[i];
+	}
+
+	*min=resultMin;
+	*max=resultMax;
+}
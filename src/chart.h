@@ -0,0 +1,27 @@
+#ifndef CHART_H
+#define CHART_H
+
+#include <stddef.h>
+
+#include "util.h"
+#include "widget.h"
+
+// A Chart plots the most recent samples of one or more series, scrolling as new samples arrive.
+// Samples are reduced to a min/max pair per pixel column as they arrive, so drawing costs the same regardless of how many samples are shown.
+// Appending is lock-free and can be done from any thread (though only one thread at a time per series), with the chart redrawn on the UI thread once per frame at most.
+
+typedef struct DChartSeries DChartSeries;
+
+DWidget *dChartNew(int width, int height, size_t capacity); // capacity is the number of samples shown per series (rounded up to a multiple of width)
+
+DChartSeries *dChartAddSeries(DWidget *chart, const DColour *colour); // UI thread only. the series is freed with the chart
+
+void dChartSetRange(DWidget *chart, float min, float max); // fixed vertical range
+void dChartSetAutoRange(DWidget *chart); // fit vertical range to the samples shown (default)
+
+// Safe to call from any thread, provided only one thread appends to a given series at a time, and all appending stops before the chart is freed.
+// Samples which arrive faster than the UI thread can take them (i.e. which do not fit in the series' buffer) are dropped.
+void dChartSeriesAppend(DChartSeries *series, const float *samples, size_t count);
+size_t dChartSeriesGetDroppedCount(const DChartSeries *series);
+
+#endif
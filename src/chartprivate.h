@@ -0,0 +1,8 @@
+#ifndef CHARTPRIVATE_H
+#define CHARTPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dChartConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height, size_t capacity);
+
+#endif
@@ -2,8 +2,11 @@
 
 #include "container.h"
 #include "containerprivate.h"
+#include "profilerprivate.h"
 #include "util.h"
+#include "utilprivate.h"
 #include "widgetprivate.h"
+#include "windowprivate.h"
 
 void dContainerVTableDestructor(DWidget *widget);
 void dContainerVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
@@ -19,6 +22,7 @@ void dContainerConstructor(DWidget *widget, DWidgetObjectData *data) {
 	// Init fields
 	data->d.container.children=NULL;
 	data->d.container.childCount=0;
+	data->d.container.childAlloc=0;
 
 	// Setup vtable
 	data->vtable.destructor=&dContainerVTableDestructor;
@@ -36,18 +40,44 @@ bool dContainerAdd(DWidget *container, DWidget *child) {
 	// Add child to container
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(container, DWidgetTypeContainer);
 
-	data->d.container.children=dReallocNoFail(data->d.container.children, sizeof(DWidget *)*(data->d.container.childCount+1));
+	if (data->d.container.childCount==data->d.container.childAlloc)
+		dContainerReserve(container, (data->d.container.childAlloc>0 ? 2*data->d.container.childAlloc : 1));
 	data->d.container.children[data->d.container.childCount++]=child;
 
 	// Set child's parent to container
 	child->parent=container;
 
+	// Update subtree sizes of all ancestors
+	for(DWidget *ancestor=container; ancestor!=NULL; ancestor=ancestor->parent)
+		ancestor->subtreeSize+=child->subtreeSize;
+
+	// Child's subtree now shares its layout generation with the rest of container's tree
+	dWidgetSetLayoutRoot(child, container->layoutRoot);
+
+	// Window's hit testing index no longer covers every widget
+	DWidget *window=dWidgetGetWindow(container);
+	if (window!=NULL)
+		dWindowHitIndexInvalidate(window);
+
 	// Mark window as dirty to redraw
 	dWidgetSetDirty(container);
 
 	return true;
 }
 
+void dContainerReserve(DWidget *container, size_t count) {
+	assert(container!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(container, DWidgetTypeContainer);
+
+	// Already have enough space?
+	if (count<=data->d.container.childAlloc)
+		return;
+
+	data->d.container.children=dReallocTaggedNoFail(data->d.container.children, sizeof(DWidget *)*count, dWidgetGetBaseType(container));
+	data->d.container.childAlloc=count;
+}
+
 DWidget *dContainerGetChildN(DWidget *container, size_t n) {
 	assert(container!=NULL);
 
@@ -84,7 +114,7 @@ void dContainerVTableDestructor(DWidget *widget) {
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeContainer);
 
 	// Free memory
-	free(data->d.container.children);
+	dFree(data->d.container.children);
 
 	// Call super destructor
 	dWidgetDestructor(widget, data->super);
@@ -99,9 +129,21 @@ void dContainerVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
 	// Call super redraw
 	dWidgetRedraw(widget, data->super, renderer);
 
+	// If only part of the window is being redrawn, we can skip children entirely outside of it
+	SDL_Rect clip;
+	bool clipped=SDL_RenderIsClipEnabled(renderer);
+	if (clipped)
+		SDL_RenderGetClipRect(renderer, &clip);
+
 	// Loop to draw children
 	for(size_t i=0; i<data->d.container.childCount; ++i) {
 		DWidget *child=data->d.container.children[i];
+		if (clipped) {
+			SDL_Rect childRect={.x=dWidgetGetGlobalX(child), .y=dWidgetGetGlobalY(child), .w=dWidgetGetWidth(child), .h=dWidgetGetHeight(child)};
+			if (!SDL_HasIntersection(&clip, &childRect))
+				continue;
+		}
+		dProfilerCountWidgetDrawn();
 		dWidgetRedraw(child, child->base, renderer);
 	}
 }
@@ -5,4 +5,6 @@
 
 void dContainerConstructor(DWidget *widget, DWidgetObjectData *data);
 
+void dContainerReserve(DWidget *container, size_t count); // preallocates space so that count children can be held without further allocations
+
 #endif
@@ -1,11 +1,27 @@
 #include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "animationprivate.h"
+#include "batchprivate.h"
 #include "digits.h"
 #include "digitsprivate.h"
+#include "fontprivate.h"
+#include "glyphatlasprivate.h"
+#include "imagecacheprivate.h"
+#include "latencyprivate.h"
+#include "logviewprivate.h"
+#include "poolprivate.h"
+#include "profilerprivate.h"
+#include "queue.h"
+#include "replayprivate.h"
+#include "timerprivate.h"
+#include "traceprivate.h"
 #include "util.h"
+#include "utilprivate.h"
 #include "windowprivate.h"
 
 bool digitsInitFlag=false;
@@ -14,10 +30,36 @@ bool digitsQuitFlag=false;
 DWidget **digitsWindows=NULL;
 size_t digitWindowCount=0;
 
+// Callbacks posted from other threads (see digitsPost)
+const size_t digitsPostBatchSize=4096; // max callbacks run per loop iteration, so a flood of posts cannot starve redrawing
+DQueue *digitsPostQueue=NULL;
+Uint32 digitsPostEventType=(Uint32)-1; // SDL user event used to wake the loop
+atomic_bool digitsPostWakePending=false; // set while a wake event is in SDL's queue, so producers push at most one
+bool digitsPostBacklog=false; // did the last batch stop early?
+
+// Pending mouse motion (see digitsLoopMergeMouseMotion)
+bool digitsMotionPending=false;
+SDL_MouseMotionEvent digitsMotionEvent; // most recent event, but with relative motion accumulated over all merged events
+Uint32 digitsMotionFirstTimestamp; // timestamp of the oldest merged event (used for latency stats)
+DWidgetPoint *digitsMotionPath=NULL; // position from each merged event, oldest first
+size_t digitsMotionPathCount=0;
+size_t digitsMotionPathAlloc=0;
+
 void digitsLoopHandleSdlEvents(void);
+void digitsLoopConsumeSdlEvent(const SDL_Event *sdlEvent); // merges or handles event, timing it for latency stats
+void digitsLoopHandleSdlEvent(const SDL_Event *sdlEvent);
+void digitsLoopMergeMouseMotion(const SDL_MouseMotionEvent *motion);
+void digitsLoopFlushMouseMotion(void); // handles pending mouse motion (if any)
 void digitsLoopRedrawWindows(void);
+void digitsLoopRunPosted(void);
+void digitsLoopWait(void); // sleeps until an event arrives or the next timer (or animation frame) is due
+void digitsLoopWaitReplay(void); // as digitsLoopWait, but advances virtual time instead of sleeping
+bool digitsLoopGetNextDeadline(DTimeMs *deadline); // earliest of the next timer and the next animation frame. returns false if neither is pending
 
 DWidget *digitsGetWidgetFromSdlWindowId(unsigned id);
+DWidget *digitsFindWidgetFromSdlWindowId(unsigned id); // as digitsGetWidgetFromSdlWindowId but returns NULL without warning (e.g. if the window has since been closed)
+bool digitsGetSdlEventWindowId(const SDL_Event *sdlEvent, unsigned *id); // returns false if event is not associated with a window
+bool digitsGetMouseButtonFromSdlButton(Uint8 sdlButton, DWidgetMouseButton *button); // returns false if SDL button has no DWidgetMouseButton equivalent
 
 ssize_t digitsGetWindowIndex(const DWidget *widget); // find index of given window widget in the windows array. returns -1 on failure
 
@@ -39,6 +81,26 @@ bool digitsInit(void) {
 		return false;
 	}
 
+	// Setup post queue and event used to wake the loop
+	digitsPostEventType=SDL_RegisterEvents(1);
+	if (digitsPostEventType==(Uint32)-1) {
+		TTF_Quit();
+		SDL_Quit();
+		return false;
+	}
+	digitsPostQueue=dQueueNew();
+	atomic_store(&digitsPostWakePending, false);
+	digitsPostBacklog=false;
+
+	// Start worker threads
+	if (!dPoolInit()) {
+		dQueueFree(digitsPostQueue);
+		digitsPostQueue=NULL;
+		TTF_Quit();
+		SDL_Quit();
+		return false;
+	}
+
 	// Initialisation complete
 	digitsInitFlag=true;
 
@@ -50,12 +112,43 @@ void digitsQuit(void) {
 	if (!digitsInitFlag)
 		return;
 
+	// Report latency stats if requested
+	if (dLatencyGetDumpOnQuit())
+		for(size_t i=0; i<digitWindowCount; ++i)
+			dLatencyDump(digitsWindows[i], stderr);
+
+	// Finish any input recording or replay
+	dReplayQuit();
+
 	// Close open windows and free memory
 	for(size_t i=0; i<digitWindowCount; ++i)
 		dWidgetFree(digitsWindows[i]);
-	free(digitsWindows);
+	dFree(digitsWindows);
 	digitsWindows=NULL;
 
+	dFree(digitsMotionPath);
+	digitsMotionPath=NULL;
+	digitsMotionPathCount=0;
+	digitsMotionPathAlloc=0;
+	digitsMotionPending=false;
+
+	// Finish any trace
+	dTraceStop();
+
+	// Free shared resources
+	// (pool first as its workers post completions, any of which are still queued are discarded)
+	dPoolQuit();
+	dQueueFree(digitsPostQueue);
+	digitsPostQueue=NULL;
+	dBatchQuit();
+	dImageCacheQuit();
+	dLogViewQuit();
+	dGlyphAtlasQuit();
+	dFontQuit();
+	dTimerQuit();
+	dAnimationQuit();
+	dWidgetQuit();
+
 	// Quit SDL
 	TTF_Quit();
 	SDL_Quit();
@@ -68,14 +161,39 @@ void digitsQuit(void) {
 void digitsLoop(void) {
 	digitsQuitFlag=false;
 	while(!digitsQuitFlag) {
+		dProfilerFrameBegin();
+		DTimeUs traceStart=dTraceBegin();
+		DTimeUs frameStart=dGetTimeUs();
+
 		// Check SDL events
+		DTimeUs phaseStart=frameStart;
 		digitsLoopHandleSdlEvents();
+		phaseStart=dProfilerPhaseEnd(DProfilerPhaseEvents, phaseStart);
 
-		// Refresh any dirty windows
+		// Run callbacks posted from other threads, then apply batches committed since the last frame
+		digitsLoopRunPosted();
+		dBatchApplyCommitted();
+		phaseStart=dProfilerPhaseEnd(DProfilerPhasePosted, phaseStart);
+
+		// Run any timers which are due, then advance animations (which only tick while any are running)
+		DTimeMs now=dGetTimeMs();
+		dTimerDispatch(now);
+		dAnimationTick(now);
+		dProfilerPhaseEnd(DProfilerPhaseTimers, phaseStart);
+
+		// Refresh any dirty windows (which times its own phases)
 		digitsLoopRedrawWindows();
+		dWidgetCountersFrameEnd();
+
+		// Sleep until there is something to do
+		phaseStart=dGetTimeUs();
+		dReplayCountFrame(phaseStart-frameStart);
+		if (!digitsQuitFlag)
+			digitsLoopWait();
+		dProfilerPhaseEnd(DProfilerPhaseSleep, phaseStart);
 
-		// Delay to avoid high CPU usage
-		dDelayMs(10);
+		dProfilerFrameEnd();
+		dTraceEnd(traceStart, "frame", "loop", NULL);
 	}
 }
 
@@ -83,6 +201,26 @@ void digitsLoopStop(void) {
 	digitsQuitFlag=true;
 }
 
+void digitsPost(DigitsPostCallback *callback, void *userData) {
+	assert(callback!=NULL);
+	assert(digitsPostQueue!=NULL);
+
+	dQueuePush(digitsPostQueue, callback, userData);
+
+	digitsWake();
+}
+
+void digitsWake(void) {
+	// Wake the loop, unless a wake is already pending (in which case the loop has yet to start draining and so will see any new work)
+	if (!atomic_exchange(&digitsPostWakePending, true)) {
+		SDL_Event sdlEvent;
+		SDL_zero(sdlEvent);
+		sdlEvent.type=digitsPostEventType;
+		if (SDL_PushEvent(&sdlEvent)!=1)
+			dWarning("warning: could not push wake event: %s\n", SDL_GetError());
+	}
+}
+
 
 void digitsRegisterWindow(DWidget *widget) {
 	assert(widget!=NULL);
@@ -110,121 +248,428 @@ void digitsDeregisterWindow(DWidget *widget) {
 	memmove(digitsWindows+index, digitsWindows+index+1, sizeof(DWidget *)*((--digitWindowCount)-index));
 }
 
+size_t digitsGetWindowCount(void) {
+	return digitWindowCount;
+}
+
+DWidget *digitsGetWindowN(size_t n) {
+	assert(n<digitWindowCount);
+
+	return digitsWindows[n];
+}
+
 void digitsLoopHandleSdlEvents(void) {
 	// Handle events until none remain
 	SDL_Event sdlEvent;
-	while(SDL_PollEvent(&sdlEvent)) {
-		switch(sdlEvent.type) {
-			case SDL_MOUSEBUTTONDOWN: {
-				// Find widget represented by this event's SDL window ID
-				DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent.button.windowID);
-				if (windowWidget==NULL) {
-					dWarning("warning: could not get window widget for SDL_MOUSEBUTTONDOWN event, ignoring\n");
-					break;
-				}
+	if (dReplayIsReplaying()) {
+		// Real events are ignored while replaying, with recorded events which are now due used instead
+		while(SDL_PollEvent(&sdlEvent))
+			;
+		while(dReplayGetEvent(&sdlEvent))
+			digitsLoopConsumeSdlEvent(&sdlEvent);
+	} else {
+		while(SDL_PollEvent(&sdlEvent)) {
+			dReplayRecordEvent(&sdlEvent);
+			digitsLoopConsumeSdlEvent(&sdlEvent);
+		}
+	}
 
-				// Find widget within the window which is actually under the mouse
-				DWidget *targetWidget=dWidgetGetWidgetByXY(windowWidget, sdlEvent.button.x, sdlEvent.button.y);
-				if (targetWidget==NULL) {
-					dWarning("warning: could not get target widget for SDL_MOUSEBUTTONDOWN event at (%i,%i), ignoring\n", sdlEvent.button.x, sdlEvent.button.y);
-					break;
-				}
-
-				// Invoke widget button press signal
-				// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
-				DWidgetSignalEvent dEvent;
-				dEvent.type=DWidgetSignalTypeWidgetButtonPress;
-				dEvent.d.widgetButtonPress.button=sdlEvent.button.button;
-				while(targetWidget!=NULL) {
-					dEvent.widget=targetWidget;
-					if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
-						break;
-
-					targetWidget=dWidgetGetParent(targetWidget);
-				}
-			} break;
-			case SDL_MOUSEBUTTONUP: {
-				// Find widget represented by this event's SDL window ID
-				DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent.button.windowID);
-				if (windowWidget==NULL) {
-					dWarning("warning: could not get window widget for SDL_MOUSEBUTTONUP event, ignoring\n");
-					break;
-				}
+	digitsLoopFlushMouseMotion();
+}
+
+void digitsLoopConsumeSdlEvent(const SDL_Event *sdlEvent) {
+	assert(sdlEvent!=NULL);
+
+	dProfilerCountEvent();
+
+	// Mouse motion events are not handled immediately, but merged with any directly following motion events for the same window
+	if (sdlEvent->type==SDL_MOUSEMOTION) {
+		digitsLoopMergeMouseMotion(&sdlEvent->motion);
+		return;
+	}
 
-				// Find widget within the window which is actually under the mouse
-				DWidget *targetWidget=dWidgetGetWidgetByXY(windowWidget, sdlEvent.button.x, sdlEvent.button.y);
-				if (targetWidget==NULL) {
-					dWarning("warning: could not get target widget for SDL_MOUSEBUTTONUP event at (%i,%i), ignoring\n", sdlEvent.button.x, sdlEvent.button.y);
+	// Handle any pending motion first so events are still seen in order
+	digitsLoopFlushMouseMotion();
+
+	// Handle event, timing dispatch for latency stats
+	// (SDL_GetTicks is sampled too, as the event's queue time is measured against this)
+	Uint32 dispatchStartTicks=SDL_GetTicks();
+	DTimeUs dispatchStart=dGetTimeUs();
+	digitsLoopHandleSdlEvent(sdlEvent);
+	DTimeUs dispatchEnd=dGetTimeUs();
+
+	unsigned windowId;
+	if (dLatencyGetEnabled() && digitsGetSdlEventWindowId(sdlEvent, &windowId)) {
+		DWidget *windowWidget=digitsFindWidgetFromSdlWindowId(windowId);
+		if (windowWidget!=NULL)
+			dLatencyRecordDispatch(windowWidget, sdlEvent->common.timestamp, dispatchStartTicks, dispatchStart, dispatchEnd);
+	}
+}
+
+void digitsLoopHandleSdlEvent(const SDL_Event *sdlEvent) {
+	assert(sdlEvent!=NULL);
+
+	switch(sdlEvent->type) {
+		case SDL_MOUSEBUTTONDOWN: {
+			// Ignore buttons we have no equivalent for
+			DWidgetMouseButton button;
+			if (!digitsGetMouseButtonFromSdlButton(sdlEvent->button.button, &button))
+				break;
+
+			// Find widget represented by this event's SDL window ID
+			DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent->button.windowID);
+			if (windowWidget==NULL) {
+				dWarning("warning: could not get window widget for SDL_MOUSEBUTTONDOWN event, ignoring\n");
+				break;
+			}
+
+			// Find widget within the window which is actually under the mouse (unless pointer is captured)
+			DWidget *targetWidget=dWindowGetPointerCapture(windowWidget);
+			if (targetWidget==NULL)
+				targetWidget=dWindowGetWidgetByXY(windowWidget, sdlEvent->button.x, sdlEvent->button.y);
+			if (targetWidget==NULL) {
+				dWarning("warning: could not get target widget for SDL_MOUSEBUTTONDOWN event at (%i,%i), ignoring\n", sdlEvent->button.x, sdlEvent->button.y);
+				break;
+			}
+
+			// Invoke widget button press signal
+			// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
+			DWidgetSignalEvent dEvent;
+			dEvent.type=DWidgetSignalTypeWidgetButtonPress;
+			dEvent.d.widgetButtonPress.button=button;
+			dEvent.d.widgetButtonPress.x=sdlEvent->button.x;
+			dEvent.d.widgetButtonPress.y=sdlEvent->button.y;
+			while(targetWidget!=NULL) {
+				dEvent.widget=targetWidget;
+				if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
 					break;
-				}
-
-				// Invoke widget button release signal
-				// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
-				DWidgetSignalEvent dEvent;
-				dEvent.type=DWidgetSignalTypeWidgetButtonRelease;
-				dEvent.d.widgetButtonPress.button=sdlEvent.button.button;
-				while(targetWidget!=NULL) {
-					dEvent.widget=targetWidget;
-					if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
-						break;
-
-					targetWidget=dWidgetGetParent(targetWidget);
-				}
-			} break;
-			case SDL_MOUSEMOTION: {
-				// Find widget represented by this event's SDL window ID
-				DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent.motion.windowID);
-				if (windowWidget==NULL) {
-					dWarning("warning: could not get window widget for SDL_MOUSEMOTION event, ignoring\n");
+
+				targetWidget=dWidgetGetParent(targetWidget);
+			}
+		} break;
+		case SDL_MOUSEBUTTONUP: {
+			// Ignore buttons we have no equivalent for
+			DWidgetMouseButton button;
+			if (!digitsGetMouseButtonFromSdlButton(sdlEvent->button.button, &button))
+				break;
+
+			// Find widget represented by this event's SDL window ID
+			DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent->button.windowID);
+			if (windowWidget==NULL) {
+				dWarning("warning: could not get window widget for SDL_MOUSEBUTTONUP event, ignoring\n");
+				break;
+			}
+
+			// Find widget within the window which is actually under the mouse (unless pointer is captured)
+			DWidget *targetWidget=dWindowGetPointerCapture(windowWidget);
+			if (targetWidget==NULL)
+				targetWidget=dWindowGetWidgetByXY(windowWidget, sdlEvent->button.x, sdlEvent->button.y);
+			if (targetWidget==NULL) {
+				dWarning("warning: could not get target widget for SDL_MOUSEBUTTONUP event at (%i,%i), ignoring\n", sdlEvent->button.x, sdlEvent->button.y);
+				break;
+			}
+
+			// Invoke widget button release signal
+			// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
+			DWidgetSignalEvent dEvent;
+			dEvent.type=DWidgetSignalTypeWidgetButtonRelease;
+			dEvent.d.widgetButtonRelease.button=button;
+			dEvent.d.widgetButtonRelease.x=sdlEvent->button.x;
+			dEvent.d.widgetButtonRelease.y=sdlEvent->button.y;
+			while(targetWidget!=NULL) {
+				dEvent.widget=targetWidget;
+				if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
 					break;
-				}
-
-				// Find widget under new mouse position
-				DWidget *newWidget=dWidgetGetWidgetByXY(windowWidget, sdlEvent.motion.x, sdlEvent.motion.y);
-
-				// Update cached widget under mouse and potentially generate Enter/Leave events
-				dWindowSetMouseFocusWidget(windowWidget, newWidget);
-			} break;
-			case SDL_WINDOWEVENT: {
-				// Find widget represented by this event's SDL window ID
-				DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent.window.windowID);
-				if (windowWidget==NULL) {
-					dWarning("warning: could not get window widget for SDL_WINDOWEVENT event, ignoring\n");
+
+				targetWidget=dWidgetGetParent(targetWidget);
+			}
+		} break;
+		case SDL_MOUSEWHEEL: {
+			// Find widget represented by this event's SDL window ID
+			DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent->wheel.windowID);
+			if (windowWidget==NULL) {
+				dWarning("warning: could not get window widget for SDL_MOUSEWHEEL event, ignoring\n");
+				break;
+			}
+
+			// Send to widget under the mouse (as of the last motion event) unless pointer is captured
+			DWidget *targetWidget=dWindowGetPointerCapture(windowWidget);
+			if (targetWidget==NULL)
+				targetWidget=dWindowGetMouseFocusWidget(windowWidget);
+
+			// Invoke widget mouse wheel signal
+			// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
+			int flip=(sdlEvent->wheel.direction==SDL_MOUSEWHEEL_FLIPPED ? -1 : 1);
+			DWidgetSignalEvent dEvent;
+			dEvent.type=DWidgetSignalTypeWidgetMouseWheel;
+			dEvent.d.widgetMouseWheel.x=sdlEvent->wheel.x*flip;
+			dEvent.d.widgetMouseWheel.y=sdlEvent->wheel.y*flip;
+			while(targetWidget!=NULL) {
+				dEvent.widget=targetWidget;
+				if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
 					break;
-				}
 
-				// Event specific logic
-				switch(sdlEvent.window.event) {
-					case SDL_WINDOWEVENT_EXPOSED:
-						// Mark window as dirty
-						dWindowSetDirty(windowWidget);
+				targetWidget=dWidgetGetParent(targetWidget);
+			}
+		} break;
+		case SDL_KEYDOWN: {
+			// Find widget represented by this event's SDL window ID
+			DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent->key.windowID);
+			if (windowWidget==NULL) {
+				dWarning("warning: could not get window widget for SDL_KEYDOWN event, ignoring\n");
+				break;
+			}
+
+			// Invoke widget key down signal, starting with the focused widget (or the window if none)
+			// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
+			DWidget *targetWidget=dWindowGetKeyboardFocusWidget(windowWidget);
+			if (targetWidget==NULL)
+				targetWidget=windowWidget;
+
+			DWidgetSignalEvent dEvent;
+			dEvent.type=DWidgetSignalTypeWidgetKeyDown;
+			dEvent.d.widgetKeyDown.key=sdlEvent->key.keysym.sym;
+			dEvent.d.widgetKeyDown.mod=sdlEvent->key.keysym.mod;
+			dEvent.d.widgetKeyDown.repeat=(sdlEvent->key.repeat!=0);
+			while(targetWidget!=NULL) {
+				dEvent.widget=targetWidget;
+				if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
 					break;
-					case SDL_WINDOWEVENT_LEAVE:
-						// Update cached widget under mouse to be NULL and potentially generate Leave events
-						dWindowSetMouseFocusWidget(windowWidget, NULL);
+
+				targetWidget=dWidgetGetParent(targetWidget);
+			}
+		} break;
+		case SDL_TEXTINPUT: {
+			// Find widget represented by this event's SDL window ID
+			DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent->text.windowID);
+			if (windowWidget==NULL) {
+				dWarning("warning: could not get window widget for SDL_TEXTINPUT event, ignoring\n");
+				break;
+			}
+
+			// Invoke widget text input signal, as with key down
+			DWidget *targetWidget=dWindowGetKeyboardFocusWidget(windowWidget);
+			if (targetWidget==NULL)
+				targetWidget=windowWidget;
+
+			DWidgetSignalEvent dEvent;
+			dEvent.type=DWidgetSignalTypeWidgetTextInput;
+			dEvent.d.widgetTextInput.text=sdlEvent->text.text;
+			while(targetWidget!=NULL) {
+				dEvent.widget=targetWidget;
+				if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
 					break;
-					case SDL_WINDOWEVENT_CLOSE: {
-						// Invoke window close signal
-						DWidgetSignalEvent dEvent;
-						dEvent.type=DWidgetSignalTypeWindowClose;
-						dEvent.widget=windowWidget;
-						dWidgetSignalInvoke(&dEvent);
-					} break;
-				}
-			} break;
-			case SDL_QUIT:
-				// TODO: remove this once we have a better way of terminating (as otherwise closing all windows will cause this to fire)
-				digitsLoopStop();
+
+				targetWidget=dWidgetGetParent(targetWidget);
+			}
+		} break;
+		case SDL_WINDOWEVENT: {
+			// Find widget represented by this event's SDL window ID
+			DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(sdlEvent->window.windowID);
+			if (windowWidget==NULL) {
+				dWarning("warning: could not get window widget for SDL_WINDOWEVENT event, ignoring\n");
+				break;
+			}
+
+			// Event specific logic
+			switch(sdlEvent->window.event) {
+				case SDL_WINDOWEVENT_EXPOSED:
+					// Mark window as dirty
+					dWindowSetDirty(windowWidget);
+				break;
+				case SDL_WINDOWEVENT_SIZE_CHANGED:
+					// Window size affects layout so invalidate this as well as redrawing
+					dWidgetSetDirty(windowWidget);
+				break;
+				case SDL_WINDOWEVENT_LEAVE:
+					// Update cached widget under mouse to be NULL and potentially generate Leave events
+					dWindowSetMouseInside(windowWidget, false);
+					dWindowSetMouseFocusWidget(windowWidget, NULL);
+				break;
+				case SDL_WINDOWEVENT_CLOSE: {
+					// Invoke window close signal
+					DWidgetSignalEvent dEvent;
+					dEvent.type=DWidgetSignalTypeWindowClose;
+					dEvent.widget=windowWidget;
+					dWidgetSignalInvoke(&dEvent);
+				} break;
+			}
+		} break;
+		case SDL_QUIT:
+			// TODO: remove this once we have a better way of terminating (as otherwise closing all windows will cause this to fire)
+			digitsLoopStop();
+		break;
+	}
+}
+
+void digitsLoopMergeMouseMotion(const SDL_MouseMotionEvent *motion) {
+	assert(motion!=NULL);
+
+	// Different window to the pending event? If so that one has to be handled first
+	if (digitsMotionPending && digitsMotionEvent.windowID!=motion->windowID)
+		digitsLoopFlushMouseMotion();
+
+	// Merge into pending event, accumulating relative movement
+	if (digitsMotionPending) {
+		int relX=digitsMotionEvent.xrel+motion->xrel;
+		int relY=digitsMotionEvent.yrel+motion->yrel;
+		digitsMotionEvent=*motion;
+		digitsMotionEvent.xrel=relX;
+		digitsMotionEvent.yrel=relY;
+	} else {
+		digitsMotionEvent=*motion;
+		digitsMotionFirstTimestamp=motion->timestamp;
+		digitsMotionPending=true;
+	}
+
+	// Record position in path
+	if (digitsMotionPathCount==digitsMotionPathAlloc) {
+		digitsMotionPathAlloc=(digitsMotionPathAlloc>0 ? 2*digitsMotionPathAlloc : 64);
+		digitsMotionPath=dReallocNoFail(digitsMotionPath, sizeof(DWidgetPoint)*digitsMotionPathAlloc);
+	}
+	digitsMotionPath[digitsMotionPathCount].x=motion->x;
+	digitsMotionPath[digitsMotionPathCount].y=motion->y;
+	++digitsMotionPathCount;
+}
+
+void digitsLoopFlushMouseMotion(void) {
+	// No pending motion?
+	if (!digitsMotionPending)
+		return;
+
+	digitsMotionPending=false;
+	Uint32 dispatchStartTicks=SDL_GetTicks();
+	DTimeUs dispatchStart=dGetTimeUs();
+
+	// Find widget represented by this event's SDL window ID
+	DWidget *windowWidget=digitsGetWidgetFromSdlWindowId(digitsMotionEvent.windowID);
+	if (windowWidget==NULL) {
+		dWarning("warning: could not get window widget for SDL_MOUSEMOTION event, ignoring\n");
+		digitsMotionPathCount=0;
+		return;
+	}
+
+	dWindowSetMouseInside(windowWidget, true);
+	dWindowSetMousePosition(windowWidget, digitsMotionEvent.x, digitsMotionEvent.y);
+
+	// If pointer is captured then send straight to the capturing widget, otherwise find widget under new mouse position
+	// Note: cached widget under mouse (and so Enter/Leave events) are not updated while the pointer is captured
+	DWidget *targetWidget=dWindowGetPointerCapture(windowWidget);
+	if (targetWidget==NULL) {
+		targetWidget=dWindowGetWidgetByXY(windowWidget, digitsMotionEvent.x, digitsMotionEvent.y);
+
+		// Update cached widget under mouse and potentially generate Enter/Leave events
+		dWindowSetMouseFocusWidget(windowWidget, targetWidget);
+	}
+
+	// Invoke widget mouse motion signal
+	// Do this recursively up the widget tree until a handler 'accepts' it by returning Stop
+	DWidgetSignalEvent dEvent;
+	dEvent.type=DWidgetSignalTypeWidgetMouseMotion;
+	dEvent.d.widgetMouseMotion.x=digitsMotionEvent.x;
+	dEvent.d.widgetMouseMotion.y=digitsMotionEvent.y;
+	dEvent.d.widgetMouseMotion.relX=digitsMotionEvent.xrel;
+	dEvent.d.widgetMouseMotion.relY=digitsMotionEvent.yrel;
+	dEvent.d.widgetMouseMotion.path=digitsMotionPath;
+	dEvent.d.widgetMouseMotion.pathCount=digitsMotionPathCount;
+	while(targetWidget!=NULL) {
+		dEvent.widget=targetWidget;
+		if (dWidgetSignalInvoke(&dEvent)==DWidgetSignalReturnStop)
 			break;
-		}
+
+		targetWidget=dWidgetGetParent(targetWidget);
 	}
+
+	// Clear path ready for next time (keeping memory allocated)
+	digitsMotionPathCount=0;
+
+	// Record latency from the oldest of the merged events (handlers may have closed the window, so look it up again)
+	windowWidget=digitsFindWidgetFromSdlWindowId(digitsMotionEvent.windowID);
+	if (windowWidget!=NULL)
+		dLatencyRecordDispatch(windowWidget, digitsMotionFirstTimestamp, dispatchStartTicks, dispatchStart, dGetTimeUs());
+}
+
+void digitsLoopRunPosted(void) {
+	// Clear wake flag before draining - any post after this point will push a fresh wake event
+	atomic_store(&digitsPostWakePending, false);
+
+	digitsPostBacklog=(dQueueRun(digitsPostQueue, digitsPostBatchSize)==digitsPostBatchSize);
+}
+
+void digitsLoopWait(void) {
+	// Replaying input? Then time is virtual
+	if (dReplayIsReplaying()) {
+		digitsLoopWaitReplay();
+		return;
+	}
+
+	// More posted callbacks to run?
+	if (digitsPostBacklog)
+		return;
+
+	// No timers or animations? Then only an event can wake us
+	DTimeMs deadline;
+	if (!digitsLoopGetNextDeadline(&deadline)) {
+		SDL_WaitEvent(NULL);
+		return;
+	}
+
+	// Next timer already due?
+	DTimeMs now=dGetTimeMs();
+	if (deadline<=now)
+		return;
+
+	// Wait for an event or the deadline, whichever comes first
+	// (events are left in the queue for digitsLoopHandleSdlEvents)
+	DTimeMs timeout=deadline-now;
+	SDL_WaitEventTimeout(NULL, (timeout<INT_MAX ? (int)timeout : INT_MAX));
+}
+
+void digitsLoopWaitReplay(void) {
+	// More posted callbacks to run?
+	if (digitsPostBacklog)
+		return;
+
+	// All recorded events handled? Then the replay is complete
+	DTimeMs next;
+	if (!dReplayGetNextEventTime(&next)) {
+		dReplayFinish();
+		digitsLoopStop();
+		return;
+	}
+
+	// Jump straight to the next event or timer (or animation frame) deadline, whichever comes first
+	DTimeMs deadline;
+	if (digitsLoopGetNextDeadline(&deadline) && deadline<next)
+		next=deadline;
+	if (next>dGetTimeMs())
+		dSetVirtualTimeMs(next);
+}
+
+bool digitsLoopGetNextDeadline(DTimeMs *deadline) {
+	assert(deadline!=NULL);
+
+	bool found=dTimerGetNextDeadline(deadline);
+
+	DTimeMs animationDeadline;
+	if (dAnimationGetNextDeadline(&animationDeadline) && (!found || animationDeadline<*deadline)) {
+		*deadline=animationDeadline;
+		found=true;
+	}
+
+	return found;
 }
 
 void digitsLoopRedrawWindows(void) {
 	// Call redraw on each window
 	for(size_t i=0; i<digitWindowCount; ++i) {
 		DWidget *window=digitsWindows[i];
+		dProfilerWindowBegin(window);
 		dWidgetRedraw(window, window->base, dWindowGetRenderer(window));
+		dProfilerWindowEnd();
+
+		// Any events not followed by a present had no visible effect, so should not count towards latency
+		dLatencyDiscardPending(window);
 	}
 }
 
@@ -250,6 +695,63 @@ DWidget *digitsGetWidgetFromSdlWindowId(unsigned id) {
 	return widget;
 }
 
+DWidget *digitsFindWidgetFromSdlWindowId(unsigned id) {
+	SDL_Window *sdlWindow=SDL_GetWindowFromID(id);
+	if (sdlWindow==NULL)
+		return NULL;
+
+	DWidget *widget=SDL_GetWindowData(sdlWindow, "widget");
+	if (widget==NULL || dWidgetGetBaseType(widget)!=DWidgetTypeWindow)
+		return NULL;
+
+	return widget;
+}
+
+bool digitsGetSdlEventWindowId(const SDL_Event *sdlEvent, unsigned *id) {
+	assert(sdlEvent!=NULL);
+	assert(id!=NULL);
+
+	switch(sdlEvent->type) {
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			*id=sdlEvent->button.windowID;
+			return true;
+		case SDL_MOUSEMOTION:
+			*id=sdlEvent->motion.windowID;
+			return true;
+		case SDL_MOUSEWHEEL:
+			*id=sdlEvent->wheel.windowID;
+			return true;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			*id=sdlEvent->key.windowID;
+			return true;
+		case SDL_TEXTINPUT:
+			*id=sdlEvent->text.windowID;
+			return true;
+		case SDL_WINDOWEVENT:
+			*id=sdlEvent->window.windowID;
+			return true;
+	}
+
+	return false;
+}
+
+bool digitsGetMouseButtonFromSdlButton(Uint8 sdlButton, DWidgetMouseButton *button) {
+	assert(button!=NULL);
+
+	// SDL numbers buttons from 1, whereas DWidgetMouseButton starts from 0
+	switch(sdlButton) {
+		case SDL_BUTTON_LEFT: *button=DWidgetMouseButtonLeft; return true;
+		case SDL_BUTTON_MIDDLE: *button=DWidgetMouseButtonMiddle; return true;
+		case SDL_BUTTON_RIGHT: *button=DWidgetMouseButtonRight; return true;
+		case SDL_BUTTON_X1: *button=DWidgetMouseButtonX1; return true;
+		case SDL_BUTTON_X2: *button=DWidgetMouseButtonX2; return true;
+	}
+
+	return false;
+}
+
 ssize_t digitsGetWindowIndex(const DWidget *widget) {
 	assert(widget!=NULL);
 
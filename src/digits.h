@@ -3,19 +3,42 @@
 
 #include <stdbool.h>
 
+#include "animation.h"
+#include "batch.h"
 #include "bin.h"
 #include "box.h"
 #include "button.h"
+#include "canvas.h"
+#include "chart.h"
 #include "container.h"
+#include "image.h"
 #include "label.h"
+#include "latency.h"
+#include "logview.h"
+#include "memory.h"
+#include "number.h"
+#include "pool.h"
+#include "profiler.h"
+#include "replay.h"
+#include "tableview.h"
 #include "textbutton.h"
+#include "textview.h"
+#include "timer.h"
+#include "trace.h"
+#include "treeview.h"
+#include "ui.h"
 #include "widget.h"
 #include "window.h"
 
 bool digitsInit(void); // also returns true if already initialised
 void digitsQuit(void); // this should only be called once, regardless of how many times init was called
 
-void digitsLoop(void); // enters the main event loop
+void digitsLoop(void); // enters the main event loop (which sleeps until the next event or timer deadline)
 void digitsLoopStop(void); // exits the loop
 
+// Posting is the only way to touch widgets from other threads: the callback is queued without locking and later invoked on the UI thread by digitsLoop.
+// Callbacks from a single thread run in the order they were posted.
+typedef void (DigitsPostCallback)(void *userData);
+void digitsPost(DigitsPostCallback *callback, void *userData); // safe to call from any thread (after digitsInit)
+
 #endif
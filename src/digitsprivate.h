@@ -1,7 +1,16 @@
 #ifndef DIGITSPRIVATE_H
 #define DIGITSPRIVATE_H
 
+#include <stddef.h>
+
+#include "widget.h"
+
 void digitsRegisterWindow(DWidget *widget);
 void digitsDeregisterWindow(DWidget *widget);
 
+size_t digitsGetWindowCount(void);
+DWidget *digitsGetWindowN(size_t n);
+
+void digitsWake(void); // safe to call from any thread. makes digitsLoop run another iteration soon (e.g. to pick up new work), without posting a callback
+
 #endif
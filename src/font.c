@@ -0,0 +1,24 @@
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+
+const int dFontSize=26;
+const char *dFontPath="./fonts/Montserrat-Regular.ttf";
+
+TTF_Font *dFont=NULL;
+
+TTF_Font *dFontGet(void) {
+	// Open font if not already
+	if (dFont==NULL)
+		dFont=TTF_OpenFont(dFontPath, dFontSize);
+
+	return dFont;
+}
+
+void dFontQuit(void) {
+	// Close font (if opened)
+	if (dFont!=NULL) {
+		TTF_CloseFont(dFont);
+		dFont=NULL;
+	}
+}
@@ -0,0 +1,13 @@
+#ifndef FONTPRIVATE_H
+#define FONTPRIVATE_H
+
+#include <SDL2/SDL_ttf.h>
+
+extern const int dFontSize;
+extern const char *dFontPath;
+
+TTF_Font *dFontGet(void); // returns the font shared by all widgets, opening it on first use. returns NULL on failure
+
+void dFontQuit(void); // closes shared font (called by digitsQuit)
+
+#endif
@@ -0,0 +1,222 @@
+#include <assert.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+#include "glyphatlasprivate.h"
+#include "traceprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+
+#define DGlyphAtlasFirst ' '
+#define DGlyphAtlasLast '~'
+#define DGlyphAtlasCount (DGlyphAtlasLast-DGlyphAtlasFirst+1)
+#define DGlyphAtlasFallback '?'
+
+struct DGlyphAtlas {
+	DGlyphAtlas *next;
+	SDL_Renderer *renderer;
+	SDL_Texture *texture; // white glyphs, tinted via colour and alpha mod when drawn
+	SDL_Rect glyphs[DGlyphAtlasCount]; // area of each glyph within texture
+	int advances[DGlyphAtlasCount];
+	int lineHeight;
+};
+
+const int dGlyphAtlasMaxWidth=1024; // glyphs are packed into rows no wider than this
+
+DGlyphAtlas *dGlyphAtlasList=NULL;
+
+DGlyphAtlas *dGlyphAtlasNew(SDL_Renderer *renderer); // returns NULL on failure
+void dGlyphAtlasFree(DGlyphAtlas *atlas);
+int dGlyphAtlasGetIndex(char c); // returns index of fallback glyph for characters not in atlas
+const char *dGlyphAtlasNextChar(const char *text); // skips over any UTF-8 continuation bytes
+
+DGlyphAtlas *dGlyphAtlasGet(SDL_Renderer *renderer) {
+	assert(renderer!=NULL);
+
+	// Already created?
+	for(DGlyphAtlas *atlas=dGlyphAtlasList; atlas!=NULL; atlas=atlas->next)
+		if (atlas->renderer==renderer)
+			return atlas;
+
+	// Create and add to list
+	DGlyphAtlas *atlas=dGlyphAtlasNew(renderer);
+	if (atlas==NULL)
+		return NULL;
+	atlas->next=dGlyphAtlasList;
+	dGlyphAtlasList=atlas;
+
+	return atlas;
+}
+
+int dGlyphAtlasGetLineHeight(const DGlyphAtlas *atlas) {
+	assert(atlas!=NULL);
+
+	return atlas->lineHeight;
+}
+
+int dGlyphAtlasGetGlyphWidth(const DGlyphAtlas *atlas, char c) {
+	assert(atlas!=NULL);
+
+	return atlas->advances[dGlyphAtlasGetIndex(c)];
+}
+
+int dGlyphAtlasGetTextWidth(const DGlyphAtlas *atlas, const char *text) {
+	assert(atlas!=NULL);
+	assert(text!=NULL);
+
+	int width=0;
+	for(const char *c=text; *c!='\0'; c=dGlyphAtlasNextChar(c))
+		width+=atlas->advances[dGlyphAtlasGetIndex(*c)];
+	return width;
+}
+
+int dGlyphAtlasDrawText(DGlyphAtlas *atlas, SDL_Renderer *renderer, int x, int y, const char *text, const DColour *colour, int maxWidth) {
+	assert(atlas!=NULL);
+	assert(renderer!=NULL);
+	assert(atlas->renderer==renderer);
+	assert(text!=NULL);
+	assert(colour!=NULL);
+
+	SDL_SetTextureColorMod(atlas->texture, colour->r, colour->g, colour->b);
+	SDL_SetTextureAlphaMod(atlas->texture, colour->a);
+
+	int width=0;
+	for(const char *c=text; *c!='\0'; c=dGlyphAtlasNextChar(c)) {
+		int index=dGlyphAtlasGetIndex(*c);
+		const SDL_Rect *srcRect=&atlas->glyphs[index];
+		if (width+srcRect->w>maxWidth)
+			break;
+
+		if (srcRect->w>0) {
+			SDL_Rect destRect={.x=x+width, .y=y, .w=srcRect->w, .h=srcRect->h};
+			SDL_RenderCopy(renderer, atlas->texture, srcRect, &destRect);
+		}
+		width+=atlas->advances[index];
+	}
+
+	return width;
+}
+
+void dGlyphAtlasForgetRenderer(SDL_Renderer *renderer) {
+	assert(renderer!=NULL);
+
+	for(DGlyphAtlas **atlas=&dGlyphAtlasList; *atlas!=NULL; atlas=&(*atlas)->next)
+		if ((*atlas)->renderer==renderer) {
+			DGlyphAtlas *next=(*atlas)->next;
+			dGlyphAtlasFree(*atlas);
+			*atlas=next;
+			break;
+		}
+}
+
+void dGlyphAtlasQuit(void) {
+	while(dGlyphAtlasList!=NULL) {
+		DGlyphAtlas *next=dGlyphAtlasList->next;
+		dGlyphAtlasFree(dGlyphAtlasList);
+		dGlyphAtlasList=next;
+	}
+}
+
+DGlyphAtlas *dGlyphAtlasNew(SDL_Renderer *renderer) {
+	assert(renderer!=NULL);
+
+	// Grab font
+	TTF_Font *font=dFontGet();
+	if (font==NULL) {
+		dWarning("warning: could not create glyph atlas - could not open font at '%s'\n", dFontPath);
+		return NULL;
+	}
+
+	DTimeUs traceStart=dTraceBegin();
+
+	DGlyphAtlas *atlas=dMallocNoFail(sizeof(DGlyphAtlas));
+	atlas->next=NULL;
+	atlas->renderer=renderer;
+	atlas->texture=NULL;
+	atlas->lineHeight=TTF_FontLineSkip(font);
+
+	// Render each glyph, working out where it goes in the atlas
+	SDL_Surface *surfaces[DGlyphAtlasCount];
+	SDL_Color white={255, 255, 255, 255};
+	int x=0, y=0, rowHeight=0, atlasWidth=1, atlasHeight=1;
+	for(int i=0; i<DGlyphAtlasCount; ++i) {
+		Uint16 c=DGlyphAtlasFirst+i;
+		if (TTF_GlyphMetrics(font, c, NULL, NULL, NULL, NULL, &atlas->advances[i])!=0)
+			atlas->advances[i]=0;
+
+		surfaces[i]=TTF_RenderGlyph_Blended(font, c, white);
+		if (surfaces[i]==NULL) {
+			atlas->glyphs[i]=(SDL_Rect){.x=0, .y=0, .w=0, .h=0};
+			continue;
+		}
+
+		if (x+surfaces[i]->w>dGlyphAtlasMaxWidth) {
+			x=0;
+			y+=rowHeight;
+			rowHeight=0;
+		}
+		atlas->glyphs[i]=(SDL_Rect){.x=x, .y=y, .w=surfaces[i]->w, .h=surfaces[i]->h};
+		x+=surfaces[i]->w;
+		if (surfaces[i]->h>rowHeight)
+			rowHeight=surfaces[i]->h;
+		if (x>atlasWidth)
+			atlasWidth=x;
+		if (y+rowHeight>atlasHeight)
+			atlasHeight=y+rowHeight;
+	}
+
+	// Copy glyphs into one surface (replacing rather than blending, to keep their alpha) and upload that
+	SDL_Surface *atlasSurface=SDL_CreateRGBSurfaceWithFormat(0, atlasWidth, atlasHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (atlasSurface!=NULL) {
+		for(int i=0; i<DGlyphAtlasCount; ++i) {
+			if (surfaces[i]==NULL)
+				continue;
+			SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+			SDL_Rect destRect=atlas->glyphs[i];
+			SDL_BlitSurface(surfaces[i], NULL, atlasSurface, &destRect);
+		}
+		atlas->texture=dCreateTextureFromSurface(renderer, atlasSurface);
+		SDL_FreeSurface(atlasSurface);
+	}
+
+	// Tidy up
+	for(int i=0; i<DGlyphAtlasCount; ++i)
+		SDL_FreeSurface(surfaces[i]);
+
+	if (atlas->texture==NULL) {
+		dWarning("warning: could not create glyph atlas - could not create texture\n");
+		dFree(atlas);
+		return NULL;
+	}
+	SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+
+	dTraceEnd(traceStart, "glyph atlas", "render", NULL);
+
+	return atlas;
+}
+
+void dGlyphAtlasFree(DGlyphAtlas *atlas) {
+	assert(atlas!=NULL);
+
+	dDestroyTexture(atlas->texture);
+	dFree(atlas);
+}
+
+int dGlyphAtlasGetIndex(char c) {
+	if (c<DGlyphAtlasFirst || c>DGlyphAtlasLast)
+		c=DGlyphAtlasFallback;
+	return c-DGlyphAtlasFirst;
+}
+
+const char *dGlyphAtlasNextChar(const char *text) {
+	assert(text!=NULL);
+	assert(*text!='\0');
+
+	do
+		++text;
+	while((*text&0xC0)==0x80);
+
+	return text;
+}
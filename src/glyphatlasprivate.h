@@ -0,0 +1,25 @@
+#ifndef GLYPHATLASPRIVATE_H
+#define GLYPHATLASPRIVATE_H
+
+#include <SDL2/SDL.h>
+
+#include "util.h"
+
+// The printable ASCII glyphs of the shared font, rendered once per renderer into a single texture.
+// Drawing text is then one copy per glyph from that texture (which SDL can batch), rather than creating a texture per string,
+// which suits text that changes often or is only briefly visible (e.g. table cells). Other characters are drawn as '?', and kerning is ignored.
+// All functions should only be called from the UI thread.
+
+typedef struct DGlyphAtlas DGlyphAtlas;
+
+DGlyphAtlas *dGlyphAtlasGet(SDL_Renderer *renderer); // creates atlas on first use. returns NULL on failure
+
+int dGlyphAtlasGetLineHeight(const DGlyphAtlas *atlas);
+int dGlyphAtlasGetGlyphWidth(const DGlyphAtlas *atlas, char c);
+int dGlyphAtlasGetTextWidth(const DGlyphAtlas *atlas, const char *text);
+int dGlyphAtlasDrawText(DGlyphAtlas *atlas, SDL_Renderer *renderer, int x, int y, const char *text, const DColour *colour, int maxWidth); // stops before any glyph which would extend past maxWidth. returns width drawn
+
+void dGlyphAtlasForgetRenderer(SDL_Renderer *renderer); // destroys atlas for renderer (called before a window destroys its renderer)
+void dGlyphAtlasQuit(void); // frees all atlases (called by digitsQuit)
+
+#endif
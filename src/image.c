@@ -0,0 +1,165 @@
+#include <assert.h>
+
+#include "image.h"
+#include "imagecacheprivate.h"
+#include "imageprivate.h"
+#include "widgetprivate.h"
+
+void dImageConstructor(DWidget *widget, DWidgetObjectData *data); // common parts of dImageConstructorFile and dImageConstructorPixels
+
+void dImageVTableDestructor(DWidget *widget);
+void dImageVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dImageVTableGetWidth(DWidget *widget);
+int dImageVTableGetHeight(DWidget *widget);
+
+DWidget *dImageNewFromFile(const char *path, int width, int height) {
+	assert(path!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Create widget instance
+	DWidget *image=dWidgetNew(DWidgetTypeImage);
+
+	// Call constructor
+	dImageConstructorFile(image, image->base, path, width, height);
+
+	return image;
+}
+
+DWidget *dImageNewFromPixels(const char *key, const uint32_t *pixels, int pixelsWidth, int pixelsHeight, int width, int height) {
+	assert(key!=NULL);
+	assert(pixels!=NULL);
+	assert(pixelsWidth>0);
+	assert(pixelsHeight>0);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Create widget instance
+	DWidget *image=dWidgetNew(DWidgetTypeImage);
+
+	// Call constructor
+	dImageConstructorPixels(image, image->base, key, pixels, pixelsWidth, pixelsHeight, width, height);
+
+	return image;
+}
+
+void dImageConstructorFile(DWidget *widget, DWidgetObjectData *data, const char *path, int width, int height) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeImage);
+	assert(path!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	dImageConstructor(widget, data);
+
+	// Grab shared image (starting to load it if needed)
+	data->d.image.entry=dImageCacheAcquireFile(path, width, height, widget);
+}
+
+void dImageConstructorPixels(DWidget *widget, DWidgetObjectData *data, const char *key, const uint32_t *pixels, int pixelsWidth, int pixelsHeight, int width, int height) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeImage);
+	assert(key!=NULL);
+	assert(pixels!=NULL);
+	assert(pixelsWidth>0);
+	assert(pixelsHeight>0);
+	assert(width>=0);
+	assert(height>=0);
+
+	dImageConstructor(widget, data);
+
+	// Grab shared image (copying pixels if new)
+	data->d.image.entry=dImageCacheAcquirePixels(key, pixels, pixelsWidth, pixelsHeight, width, height, widget);
+}
+
+bool dImageIsLoaded(const DWidget *image) {
+	assert(image!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(image, DWidgetTypeImage);
+
+	return (dImageCacheGetState(data->d.image.entry)==DImageCacheStateReady);
+}
+
+bool dImageHasFailed(const DWidget *image) {
+	assert(image!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(image, DWidgetTypeImage);
+
+	return (dImageCacheGetState(data->d.image.entry)==DImageCacheStateFailed);
+}
+
+void dImageConstructor(DWidget *widget, DWidgetObjectData *data) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeImage);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields
+	data->d.image.entry=NULL;
+
+	// Setup vtable
+	data->vtable.destructor=&dImageVTableDestructor;
+	data->vtable.redraw=&dImageVTableRedraw;
+	data->vtable.getMinWidth=&dImageVTableGetWidth;
+	data->vtable.getMinHeight=&dImageVTableGetHeight;
+	data->vtable.getWidth=&dImageVTableGetWidth;
+	data->vtable.getHeight=&dImageVTableGetHeight;
+}
+
+void dImageVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeImage);
+
+	// Release shared image
+	dImageCacheRelease(data->d.image.entry, widget);
+	data->d.image.entry=NULL;
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dImageVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeImage);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	// Render shared texture (if loaded)
+	SDL_Texture *texture=dImageCacheGetTexture(data->d.image.entry, renderer);
+	if (texture!=NULL) {
+		SDL_Rect destRect={
+		    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
+		    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
+		};
+		dImageCacheGetSize(data->d.image.entry, &destRect.w, &destRect.h);
+		SDL_RenderCopy(renderer, texture, NULL, &destRect);
+	}
+}
+
+int dImageVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeImage);
+
+	int width, height;
+	dImageCacheGetSize(data->d.image.entry, &width, &height);
+	return width+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dImageVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeImage);
+
+	int width, height;
+	dImageCacheGetSize(data->d.image.entry, &width, &height);
+	return height+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
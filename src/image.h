@@ -0,0 +1,28 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "widget.h"
+
+// Images are shared via a global cache keyed by source and size, so any number of Image widgets showing the same thing use one decoded copy and one texture per window.
+// Files are decoded (and images are scaled) on the pool, so an image draws nothing until loaded, and if no size is given it also has no size until then.
+// width and height of 0 mean the image's own size, and if only one is 0 it is worked out from the other keeping the image's aspect ratio.
+
+typedef struct {
+	size_t sources; // distinct files/pixel buffers
+	size_t entries; // distinct source and size combinations
+	size_t textures;
+} DImageCacheStats;
+
+DWidget *dImageNewFromFile(const char *path, int width, int height); // BMP files only
+DWidget *dImageNewFromPixels(const char *key, const uint32_t *pixels, int pixelsWidth, int pixelsHeight, int width, int height); // pixels are ARGB8888, with no padding between rows. key identifies the pixels in the cache, so images with the same key share the pixels given first
+
+bool dImageIsLoaded(const DWidget *image);
+bool dImageHasFailed(const DWidget *image);
+
+void dImageGetCacheStats(DImageCacheStats *stats);
+
+#endif
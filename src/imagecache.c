@@ -0,0 +1,547 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "image.h"
+#include "imagecacheprivate.h"
+#include "pool.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+#define DImageCachePixelFormat SDL_PIXELFORMAT_ARGB8888
+
+typedef struct DImageCacheSource DImageCacheSource;
+
+typedef struct {
+	SDL_Renderer *renderer;
+	SDL_Texture *texture;
+} DImageCacheTexture;
+
+struct DImageCacheEntry {
+	DImageCacheSource *source;
+	DImageCacheEntry *next; // next entry for the same source
+
+	int width, height; // as requested, 0x0 for the source's own size (or one of them 0 to keep the source's aspect ratio)
+	int scaleWidth, scaleHeight; // actual size, worked out once the source has loaded
+	DImageCacheState state;
+	bool taskPending; // scaling on the pool (entry cannot be freed until it finishes)
+	SDL_Surface *surface; // once ready. either the source's surface, or a scaled copy owned by the entry
+	SDL_Surface *scaled; // written by the pool task, and picked up by its completion
+
+	DWidget **users; // widgets holding a reference, to be marked dirty when loading finishes
+	size_t userCount, userAlloc;
+
+	DImageCacheTexture *textures;
+	size_t textureCount;
+};
+
+struct DImageCacheSource {
+	DImageCacheSource *next;
+
+	char *key; // file path, or user given key for pixel buffers
+	bool isFile;
+	DImageCacheState state;
+	bool taskPending; // decoding on the pool (source cannot be freed until it finishes)
+	SDL_Surface *surface; // once ready, in DImageCachePixelFormat
+	SDL_Surface *decoded; // written by the pool task, and picked up by its completion
+	char decodeError[256]; // if decoding failed, SDL's error message from the pool task (as SDL errors are per thread)
+
+	DImageCacheEntry *entries;
+};
+
+DImageCacheSource *dImageCacheSources=NULL;
+size_t dImageCacheSourceCount=0;
+size_t dImageCacheEntryCount=0;
+size_t dImageCacheTextureCount=0;
+
+DImageCacheSource *dImageCacheSourceGet(const char *key, bool isFile); // creates source if needed (in the loading state)
+void dImageCacheSourceMaybeFree(DImageCacheSource *source); // frees if unused
+
+DImageCacheEntry *dImageCacheEntryGet(DImageCacheSource *source, int width, int height); // creates entry if needed
+void dImageCacheEntryStart(DImageCacheEntry *entry); // called once source has loaded (or failed)
+void dImageCacheEntryFinish(DImageCacheEntry *entry, DImageCacheState state);
+void dImageCacheEntryMaybeFree(DImageCacheEntry *entry); // frees if unused
+void dImageCacheEntryClearTextures(DImageCacheEntry *entry);
+void dImageCacheEntryAddUser(DImageCacheEntry *entry, DWidget *user);
+
+void dImageCacheDecodeTask(void *userData);
+void dImageCacheDecodeComplete(void *userData);
+void dImageCacheScaleTask(void *userData);
+void dImageCacheScaleComplete(void *userData);
+
+SDL_Surface *dImageCacheScale(SDL_Surface *source, int width, int height); // box filter, so downscaled images average all source pixels. returns NULL on failure
+
+DImageCacheEntry *dImageCacheAcquireFile(const char *path, int width, int height, DWidget *user) {
+	assert(path!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+	assert(user!=NULL);
+
+	// Find source, starting decode if new
+	DImageCacheSource *source=dImageCacheSourceGet(path, true);
+	if (source->state==DImageCacheStateLoading && !source->taskPending) {
+		source->taskPending=true;
+		dPoolSubmit(&dImageCacheDecodeTask, &dImageCacheDecodeComplete, source);
+	}
+
+	// Find entry for the size requested
+	DImageCacheEntry *entry=dImageCacheEntryGet(source, width, height);
+	dImageCacheEntryAddUser(entry, user);
+
+	return entry;
+}
+
+DImageCacheEntry *dImageCacheAcquirePixels(const char *key, const uint32_t *pixels, int pixelsWidth, int pixelsHeight, int width, int height, DWidget *user) {
+	assert(key!=NULL);
+	assert(pixels!=NULL);
+	assert(pixelsWidth>0);
+	assert(pixelsHeight>0);
+	assert(width>=0);
+	assert(height>=0);
+	assert(user!=NULL);
+
+	// Find source, copying pixels if new (this is just a memcpy, so is not worth doing on the pool)
+	DImageCacheSource *source=dImageCacheSourceGet(key, false);
+	if (source->state==DImageCacheStateLoading) {
+		source->surface=SDL_CreateRGBSurfaceWithFormat(0, pixelsWidth, pixelsHeight, 32, DImageCachePixelFormat);
+		if (source->surface!=NULL) {
+			for(int y=0; y<pixelsHeight; ++y)
+				memcpy(((uint8_t *)source->surface->pixels)+y*source->surface->pitch, pixels+y*pixelsWidth, sizeof(uint32_t)*pixelsWidth);
+			source->state=DImageCacheStateReady;
+		} else {
+			dWarning("warning: could not create surface for image '%s': %s\n", key, SDL_GetError());
+			source->state=DImageCacheStateFailed;
+		}
+	}
+
+	// Find entry for the size requested
+	DImageCacheEntry *entry=dImageCacheEntryGet(source, width, height);
+	dImageCacheEntryAddUser(entry, user);
+
+	return entry;
+}
+
+void dImageCacheRelease(DImageCacheEntry *entry, DWidget *user) {
+	assert(entry!=NULL);
+	assert(user!=NULL);
+
+	// Remove user (searching from the end, as widgets tend to be freed in reverse order)
+	size_t i;
+	for(i=entry->userCount; i>0; --i)
+		if (entry->users[i-1]==user)
+			break;
+	assert(i>0);
+	entry->users[i-1]=entry->users[--entry->userCount];
+
+	dImageCacheEntryMaybeFree(entry);
+}
+
+DImageCacheState dImageCacheGetState(const DImageCacheEntry *entry) {
+	assert(entry!=NULL);
+
+	return entry->state;
+}
+
+void dImageCacheGetSize(const DImageCacheEntry *entry, int *width, int *height) {
+	assert(entry!=NULL);
+	assert(width!=NULL);
+	assert(height!=NULL);
+
+	if (entry->width>0 && entry->height>0) {
+		*width=entry->width;
+		*height=entry->height;
+	} else if (entry->state==DImageCacheStateReady) {
+		*width=entry->surface->w;
+		*height=entry->surface->h;
+	} else {
+		*width=0;
+		*height=0;
+	}
+}
+
+SDL_Texture *dImageCacheGetTexture(DImageCacheEntry *entry, SDL_Renderer *renderer) {
+	assert(entry!=NULL);
+	assert(renderer!=NULL);
+
+	// Not loaded?
+	if (entry->state!=DImageCacheStateReady)
+		return NULL;
+
+	// Already have a texture for this renderer?
+	for(size_t i=0; i<entry->textureCount; ++i)
+		if (entry->textures[i].renderer==renderer)
+			return entry->textures[i].texture;
+
+	// Create texture
+	SDL_Texture *texture=dCreateTextureFromSurface(renderer, entry->surface);
+	if (texture==NULL) {
+		dWarning("warning: could not create texture for image '%s': %s\n", entry->source->key, SDL_GetError());
+		return NULL;
+	}
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	entry->textures=dReallocTaggedNoFail(entry->textures, sizeof(DImageCacheTexture)*(entry->textureCount+1), DWidgetTypeImage);
+	entry->textures[entry->textureCount].renderer=renderer;
+	entry->textures[entry->textureCount].texture=texture;
+	++entry->textureCount;
+	++dImageCacheTextureCount;
+
+	return texture;
+}
+
+void dImageCacheForgetRenderer(SDL_Renderer *renderer) {
+	assert(renderer!=NULL);
+
+	for(DImageCacheSource *source=dImageCacheSources; source!=NULL; source=source->next)
+		for(DImageCacheEntry *entry=source->entries; entry!=NULL; entry=entry->next)
+			for(size_t i=0; i<entry->textureCount; ++i)
+				if (entry->textures[i].renderer==renderer) {
+					dDestroyTexture(entry->textures[i].texture);
+					entry->textures[i]=entry->textures[--entry->textureCount];
+					--dImageCacheTextureCount;
+					break;
+				}
+}
+
+void dImageCacheQuit(void) {
+	// Free everything, regardless of users (the pool has stopped, so no tasks are still running)
+	while(dImageCacheSources!=NULL) {
+		DImageCacheSource *source=dImageCacheSources;
+		SDL_FreeSurface(source->decoded);
+		source->decoded=NULL;
+
+		// Keep source alive while freeing its entries
+		source->taskPending=true;
+		while(source->entries!=NULL) {
+			DImageCacheEntry *entry=source->entries;
+			entry->userCount=0;
+			entry->taskPending=false;
+			SDL_FreeSurface(entry->scaled);
+			entry->scaled=NULL;
+			dImageCacheEntryMaybeFree(entry);
+		}
+		source->taskPending=false;
+
+		dImageCacheSourceMaybeFree(source);
+	}
+}
+
+void dImageGetCacheStats(DImageCacheStats *stats) {
+	assert(stats!=NULL);
+
+	stats->sources=dImageCacheSourceCount;
+	stats->entries=dImageCacheEntryCount;
+	stats->textures=dImageCacheTextureCount;
+}
+
+DImageCacheSource *dImageCacheSourceGet(const char *key, bool isFile) {
+	assert(key!=NULL);
+
+	// Existing source?
+	for(DImageCacheSource *source=dImageCacheSources; source!=NULL; source=source->next)
+		if (source->isFile==isFile && strcmp(source->key, key)==0)
+			return source;
+
+	// Create new one
+	DImageCacheSource *source=dMallocTaggedNoFail(sizeof(DImageCacheSource), DWidgetTypeImage);
+	size_t keySize=strlen(key)+1;
+	source->key=dMallocTaggedNoFail(keySize, DWidgetTypeImage);
+	memcpy(source->key, key, keySize);
+	source->isFile=isFile;
+	source->state=DImageCacheStateLoading;
+	source->taskPending=false;
+	source->surface=NULL;
+	source->decoded=NULL;
+	source->decodeError[0]='\0';
+	source->entries=NULL;
+
+	source->next=dImageCacheSources;
+	dImageCacheSources=source;
+	++dImageCacheSourceCount;
+
+	return source;
+}
+
+void dImageCacheSourceMaybeFree(DImageCacheSource *source) {
+	assert(source!=NULL);
+
+	// Still in use?
+	if (source->entries!=NULL || source->taskPending)
+		return;
+
+	// Unlink
+	DImageCacheSource **link=&dImageCacheSources;
+	while(*link!=source)
+		link=&(*link)->next;
+	*link=source->next;
+	--dImageCacheSourceCount;
+
+	// Free memory
+	SDL_FreeSurface(source->surface);
+	dFree(source->key);
+	dFree(source);
+}
+
+DImageCacheEntry *dImageCacheEntryGet(DImageCacheSource *source, int width, int height) {
+	assert(source!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Asking for the source's own size explicitly? Then share with those that did not give a size
+	if (source->state==DImageCacheStateReady && width==source->surface->w && height==source->surface->h) {
+		width=0;
+		height=0;
+	}
+
+	// Existing entry?
+	for(DImageCacheEntry *entry=source->entries; entry!=NULL; entry=entry->next)
+		if (entry->width==width && entry->height==height)
+			return entry;
+
+	// Create new one
+	DImageCacheEntry *entry=dMallocTaggedNoFail(sizeof(DImageCacheEntry), DWidgetTypeImage);
+	entry->source=source;
+	entry->width=width;
+	entry->height=height;
+	entry->scaleWidth=0;
+	entry->scaleHeight=0;
+	entry->state=DImageCacheStateLoading;
+	entry->taskPending=false;
+	entry->surface=NULL;
+	entry->scaled=NULL;
+	entry->users=NULL;
+	entry->userCount=0;
+	entry->userAlloc=0;
+	entry->textures=NULL;
+	entry->textureCount=0;
+
+	entry->next=source->entries;
+	source->entries=entry;
+	++dImageCacheEntryCount;
+
+	// If source has already loaded then start on this entry straight away (otherwise this happens when it loads)
+	if (source->state!=DImageCacheStateLoading)
+		dImageCacheEntryStart(entry);
+
+	return entry;
+}
+
+void dImageCacheEntryStart(DImageCacheEntry *entry) {
+	assert(entry!=NULL);
+	assert(entry->state==DImageCacheStateLoading);
+
+	DImageCacheSource *source=entry->source;
+
+	// Source failed?
+	if (source->state==DImageCacheStateFailed) {
+		dImageCacheEntryFinish(entry, DImageCacheStateFailed);
+		return;
+	}
+
+	// Work out actual size, filling in a missing dimension from the source's aspect ratio (rounding to nearest, but at least 1)
+	entry->scaleWidth=entry->width;
+	entry->scaleHeight=entry->height;
+	if (entry->width==0 && entry->height==0) {
+		entry->scaleWidth=source->surface->w;
+		entry->scaleHeight=source->surface->h;
+	} else if (entry->height==0) {
+		int64_t scaled=(((int64_t)entry->width)*source->surface->h+source->surface->w/2)/source->surface->w;
+		entry->scaleHeight=(scaled>0 ? (scaled<INT_MAX ? scaled : INT_MAX) : 1);
+	} else if (entry->width==0) {
+		int64_t scaled=(((int64_t)entry->height)*source->surface->w+source->surface->h/2)/source->surface->h;
+		entry->scaleWidth=(scaled>0 ? (scaled<INT_MAX ? scaled : INT_MAX) : 1);
+	}
+
+	// Use source directly if no scaling is needed, otherwise scale on the pool
+	if (entry->scaleWidth==source->surface->w && entry->scaleHeight==source->surface->h) {
+		entry->surface=source->surface;
+		dImageCacheEntryFinish(entry, DImageCacheStateReady);
+	} else {
+		entry->taskPending=true;
+		dPoolSubmit(&dImageCacheScaleTask, &dImageCacheScaleComplete, entry);
+	}
+}
+
+void dImageCacheEntryFinish(DImageCacheEntry *entry, DImageCacheState state) {
+	assert(entry!=NULL);
+	assert(state!=DImageCacheStateLoading);
+
+	entry->state=state;
+
+	// Size may now be known and there is something to draw, so update users
+	for(size_t i=0; i<entry->userCount; ++i)
+		dWidgetSetDirty(entry->users[i]);
+}
+
+void dImageCacheEntryMaybeFree(DImageCacheEntry *entry) {
+	assert(entry!=NULL);
+
+	// Still in use?
+	if (entry->userCount>0 || entry->taskPending)
+		return;
+
+	DImageCacheSource *source=entry->source;
+
+	// Unlink
+	DImageCacheEntry **link=&source->entries;
+	while(*link!=entry)
+		link=&(*link)->next;
+	*link=entry->next;
+	--dImageCacheEntryCount;
+
+	// Free memory
+	dImageCacheEntryClearTextures(entry);
+	if (entry->surface!=source->surface)
+		SDL_FreeSurface(entry->surface);
+	dFree(entry->users);
+	dFree(entry);
+
+	// Source may now be unused too
+	dImageCacheSourceMaybeFree(source);
+}
+
+void dImageCacheEntryClearTextures(DImageCacheEntry *entry) {
+	assert(entry!=NULL);
+
+	for(size_t i=0; i<entry->textureCount; ++i)
+		dDestroyTexture(entry->textures[i].texture);
+	dImageCacheTextureCount-=entry->textureCount;
+
+	dFree(entry->textures);
+	entry->textures=NULL;
+	entry->textureCount=0;
+}
+
+void dImageCacheEntryAddUser(DImageCacheEntry *entry, DWidget *user) {
+	assert(entry!=NULL);
+	assert(user!=NULL);
+
+	if (entry->userCount==entry->userAlloc) {
+		entry->userAlloc=(entry->userAlloc>0 ? 2*entry->userAlloc : 4);
+		entry->users=dReallocTaggedNoFail(entry->users, sizeof(DWidget *)*entry->userAlloc, DWidgetTypeImage);
+	}
+	entry->users[entry->userCount++]=user;
+}
+
+void dImageCacheDecodeTask(void *userData) {
+	assert(userData!=NULL);
+
+	DImageCacheSource *source=userData;
+
+	// Note: only the key is read here, which does not change
+	SDL_Surface *loaded=SDL_LoadBMP(source->key);
+	if (loaded!=NULL) {
+		source->decoded=SDL_ConvertSurfaceFormat(loaded, DImageCachePixelFormat, 0);
+		SDL_FreeSurface(loaded);
+	}
+
+	// Keep error for the completion, which runs on the UI thread
+	if (source->decoded==NULL)
+		snprintf(source->decodeError, sizeof(source->decodeError), "%s", SDL_GetError());
+}
+
+void dImageCacheDecodeComplete(void *userData) {
+	assert(userData!=NULL);
+
+	DImageCacheSource *source=userData;
+	source->taskPending=false;
+
+	// Pick up result
+	if (source->decoded!=NULL) {
+		source->surface=source->decoded;
+		source->decoded=NULL;
+		source->state=DImageCacheStateReady;
+	} else {
+		dWarning("warning: could not load image '%s': %s\n", source->key, source->decodeError);
+		source->state=DImageCacheStateFailed;
+	}
+
+	// Start on entries waiting for this source (which may have all been released while decoding)
+	for(DImageCacheEntry *entry=source->entries; entry!=NULL; entry=entry->next)
+		dImageCacheEntryStart(entry);
+
+	dImageCacheSourceMaybeFree(source);
+}
+
+void dImageCacheScaleTask(void *userData) {
+	assert(userData!=NULL);
+
+	DImageCacheEntry *entry=userData;
+
+	// Note: the source surface is not modified once loaded, and the entry's size does not change
+	entry->scaled=dImageCacheScale(entry->source->surface, entry->scaleWidth, entry->scaleHeight);
+}
+
+void dImageCacheScaleComplete(void *userData) {
+	assert(userData!=NULL);
+
+	DImageCacheEntry *entry=userData;
+	entry->taskPending=false;
+
+	// Pick up result
+	entry->surface=entry->scaled;
+	entry->scaled=NULL;
+	if (entry->surface!=NULL)
+		dImageCacheEntryFinish(entry, DImageCacheStateReady);
+	else {
+		dWarning("warning: could not scale image '%s' to %ix%i\n", entry->source->key, entry->scaleWidth, entry->scaleHeight);
+		dImageCacheEntryFinish(entry, DImageCacheStateFailed);
+	}
+
+	// All users may have gone while scaling
+	dImageCacheEntryMaybeFree(entry);
+}
+
+SDL_Surface *dImageCacheScale(SDL_Surface *source, int width, int height) {
+	assert(source!=NULL);
+	assert(width>0);
+	assert(height>0);
+
+	SDL_Surface *result=SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, DImageCachePixelFormat);
+	if (result==NULL)
+		return NULL;
+
+	// Each destination pixel averages the box of source pixels it covers (at least one, so this also handles upscaling)
+	// Colours are weighted by alpha so transparent pixels do not darken edges
+	for(int y=0; y<height; ++y) {
+		int y0=(int)(((int64_t)y*source->h)/height);
+		int y1=(int)(((int64_t)(y+1)*source->h)/height);
+		if (y1<=y0)
+			y1=y0+1;
+
+		uint32_t *destRow=(uint32_t *)(((uint8_t *)result->pixels)+y*result->pitch);
+		for(int x=0; x<width; ++x) {
+			int x0=(int)(((int64_t)x*source->w)/width);
+			int x1=(int)(((int64_t)(x+1)*source->w)/width);
+			if (x1<=x0)
+				x1=x0+1;
+
+			uint64_t sumA=0, sumR=0, sumG=0, sumB=0;
+			for(int sy=y0; sy<y1; ++sy) {
+				const uint32_t *sourceRow=(const uint32_t *)(((const uint8_t *)source->pixels)+sy*source->pitch);
+				for(int sx=x0; sx<x1; ++sx) {
+					uint32_t pixel=sourceRow[sx];
+					uint32_t a=pixel>>24;
+					sumA+=a;
+					sumR+=a*((pixel>>16)&0xFF);
+					sumG+=a*((pixel>>8)&0xFF);
+					sumB+=a*(pixel&0xFF);
+				}
+			}
+
+			uint64_t count=(uint64_t)(x1-x0)*(y1-y0);
+			uint32_t a=sumA/count;
+			uint32_t r=(sumA>0 ? sumR/sumA : 0);
+			uint32_t g=(sumA>0 ? sumG/sumA : 0);
+			uint32_t b=(sumA>0 ? sumB/sumA : 0);
+			destRow[x]=(a<<24)|(r<<16)|(g<<8)|b;
+		}
+	}
+
+	return result;
+}
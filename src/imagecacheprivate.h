@@ -0,0 +1,36 @@
+#ifndef IMAGECACHEPRIVATE_H
+#define IMAGECACHEPRIVATE_H
+
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "widget.h"
+
+// Decoded images are shared by all Image widgets showing the same source at the same size.
+// Each entry is one source (a file, or a pixel buffer identified by a key) at one size, and is reference counted by the widgets using it.
+// Files are decoded and entries are scaled on the pool, while textures are created on the UI thread (one per renderer) when first drawn.
+// All functions should only be called from the UI thread.
+
+typedef struct DImageCacheEntry DImageCacheEntry;
+
+typedef enum {
+	DImageCacheStateLoading,
+	DImageCacheStateReady,
+	DImageCacheStateFailed,
+} DImageCacheState;
+
+// Both add user as a reference, and mark it dirty once loading finishes.
+// width and height of 0 mean the image's own size, and if only one is 0 it is worked out from the other keeping the image's aspect ratio
+DImageCacheEntry *dImageCacheAcquireFile(const char *path, int width, int height, DWidget *user);
+DImageCacheEntry *dImageCacheAcquirePixels(const char *key, const uint32_t *pixels, int pixelsWidth, int pixelsHeight, int width, int height, DWidget *user); // pixels are only copied if key is not already cached
+void dImageCacheRelease(DImageCacheEntry *entry, DWidget *user);
+
+DImageCacheState dImageCacheGetState(const DImageCacheEntry *entry);
+void dImageCacheGetSize(const DImageCacheEntry *entry, int *width, int *height); // 0x0 until ready, unless both width and height were given
+SDL_Texture *dImageCacheGetTexture(DImageCacheEntry *entry, SDL_Renderer *renderer); // returns NULL if not ready (or on failure)
+
+void dImageCacheForgetRenderer(SDL_Renderer *renderer); // destroys textures created for renderer (called before a window destroys its renderer)
+void dImageCacheQuit(void); // frees everything (called by digitsQuit once the pool has stopped)
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef IMAGEPRIVATE_H
+#define IMAGEPRIVATE_H
+
+#include <stdint.h>
+
+#include "widgetprivate.h"
+
+void dImageConstructorFile(DWidget *widget, DWidgetObjectData *data, const char *path, int width, int height);
+void dImageConstructorPixels(DWidget *widget, DWidgetObjectData *data, const char *key, const uint32_t *pixels, int pixelsWidth, int pixelsHeight, int width, int height);
+
+#endif
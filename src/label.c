@@ -4,15 +4,17 @@
 
 #include <SDL2/SDL_ttf.h>
 
+#include "fontprivate.h"
 #include "label.h"
 #include "labelprivate.h"
+#include "traceprivate.h"
 #include "util.h"
+#include "utilprivate.h"
 #include "widgetprivate.h"
 
-const int dLabelFontSize=26;
 const SDL_Color dLabelTextColour={255,255,255};
-const char *dLabelFontPath="./fonts/Montserrat-Regular.ttf";
 
+bool dLabelMeasureText(DWidget *label); // attempts to measure text size (if not already measured)
 bool dLabelGenerateTexture(DWidget *label); // attempts to render texture (if not already renderer)
 void dLabelClearTexture(DWidget *label); // clears cached texture (if any)
 
@@ -23,8 +25,8 @@ int dLabelVTableGetMinHeight(DWidget *widget);
 int dLabelVTableGetWidth(DWidget *widget);
 int dLabelVTableGetHeight(DWidget *widget);
 
-int dLabelGetTextureWidth(DWidget *widget);
-int dLabelGetTextureHeight(DWidget *widget);
+int dLabelGetTextWidth(DWidget *widget);
+int dLabelGetTextHeight(DWidget *widget);
 
 DWidget *dLabelNew(const char *text) {
 	assert(text!=NULL);
@@ -48,9 +50,12 @@ void dLabelConstructor(DWidget *widget, DWidgetObjectData *data, const char *tex
 	dWidgetConstructor(widget, data->super);
 
 	// Init fields
-	data->d.label.text=dMallocNoFail(1);
+	data->d.label.text=dMallocTaggedNoFail(1, dWidgetGetBaseType(widget));
 	data->d.label.text[0]='\0';
 	data->d.label.texture=NULL;
+	data->d.label.textWidth=0;
+	data->d.label.textHeight=0;
+	data->d.label.textMeasured=false;
 
 	// Setup vtable
 	data->vtable.destructor=&dLabelVTableDestructor;
@@ -90,10 +95,40 @@ void dLabelSetText(DWidget *label, const char *text) {
 	// Clear cached texture
 	dLabelClearTexture(label);
 
+	// Measure new text now, while on the UI thread, so that parallel layout can size this label without needing the font
+	data->d.label.textMeasured=false;
+	dLabelMeasureText(label);
+
 	// Mark window as dirty to redraw
 	dWidgetSetDirty(label);
 }
 
+bool dLabelMeasureText(DWidget *label) {
+	assert(label!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(label, DWidgetTypeLabel);
+
+	// Already measured?
+	if (data->d.label.textMeasured)
+		return true;
+
+	// The font is not thread safe, so can only be used from the UI thread
+	if (!dWidgetLayoutRequireUiThread())
+		return false;
+
+	// Grab font (failure is reported when generating the texture)
+	TTF_Font *font=dFontGet();
+	if (font==NULL)
+		return false;
+
+	// Measure using font metrics only - no rendering needed
+	if (TTF_SizeText(font, data->d.label.text, &data->d.label.textWidth, &data->d.label.textHeight)!=0)
+		return false;
+
+	data->d.label.textMeasured=true;
+	return true;
+}
+
 bool dLabelGenerateTexture(DWidget *label) {
 	assert(label!=NULL);
 
@@ -103,38 +138,43 @@ bool dLabelGenerateTexture(DWidget *label) {
 	if (data->d.label.texture!=NULL)
 		return true;
 
+	// Rendering needs the font and renderer, which can only be used from the UI thread
+	if (!dWidgetLayoutRequireUiThread())
+		return false;
+
 	// Grab renderer from parent window
 	SDL_Renderer *renderer=dWidgetGetRenderer(label);
 	if (renderer==NULL)
 		return false;
 
-	// Open font
-	TTF_Font *font=TTF_OpenFont(dLabelFontPath, dLabelFontSize);
+	// Grab font
+	TTF_Font *font=dFontGet();
 	if (font==NULL) {
-		dWarning("warning: could not generate label texture for widget %p (%s) - could not open font at '%s'\n", label, dWidgetTypeToString(dWidgetGetBaseType(label)), dLabelFontPath);
+		dWarning("warning: could not generate label texture for widget %p (%s) - could not open font at '%s'\n", label, dWidgetTypeToString(dWidgetGetBaseType(label)), dFontPath);
 		return false;
 	}
 
+	DTimeUs traceStart=dTraceBegin();
+
 	// Render text to surface
 	SDL_Surface *surface=TTF_RenderText_Blended(font, data->d.label.text, dLabelTextColour);
 	if (surface==NULL) {
 		dWarning("warning: could not generate label texture for widget %p (%s) - could not render to surface\n", label, dWidgetTypeToString(dWidgetGetBaseType(label)));
-		TTF_CloseFont(font);
 		return false;
 	}
 
 	// Convert surface to texture for rendering to window later
-	data->d.label.texture=SDL_CreateTextureFromSurface(renderer, surface);
+	data->d.label.texture=dCreateTextureFromSurface(renderer, surface);
 	if (data->d.label.texture==NULL) {
 		dWarning("warning: could not generate label texture for widget %p (%s) - could not create texture\n", label, dWidgetTypeToString(dWidgetGetBaseType(label)));
 		SDL_FreeSurface(surface);
-		TTF_CloseFont(font);
 		return false;
 	}
 
 	// Tidy up
 	SDL_FreeSurface(surface);
-	TTF_CloseFont(font);
+
+	dTraceEnd(traceStart, "label texture", "render", data->d.label.text);
 
 	return true;
 }
@@ -149,7 +189,7 @@ void dLabelClearTexture(DWidget *label) {
 		return;
 
 	// Free memory and set pointer to NULL
-	SDL_DestroyTexture(data->d.label.texture);
+	dDestroyTexture(data->d.label.texture);
 	data->d.label.texture=NULL;
 }
 
@@ -162,7 +202,7 @@ void dLabelVTableDestructor(DWidget *widget) {
 	dLabelClearTexture(widget);
 
 	// Free memory
-	free(data->d.label.text);
+	dFree(data->d.label.text);
 
 	// Call super destructor
 	dWidgetDestructor(widget, data->super);
@@ -182,8 +222,8 @@ void dLabelVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
 		SDL_Rect destRect={
 		    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
 		    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
-		    .w=dLabelGetTextureWidth(widget),
-		    .h=dLabelGetTextureHeight(widget),
+		    .w=dLabelGetTextWidth(widget),
+		    .h=dLabelGetTextHeight(widget),
 		};
 		SDL_RenderCopy(renderer, data->d.label.texture, NULL, &destRect);
 	}
@@ -201,14 +241,14 @@ int dLabelVTableGetMinHeight(DWidget *widget) {
 	assert(widget!=NULL);
 
 	// Minimum is a single line plus padding
-	return dLabelFontSize+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+	return dFontSize+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
 }
 
 
 int dLabelVTableGetWidth(DWidget *widget) {
 	assert(widget!=NULL);
 
-	int width=dLabelGetTextureWidth(widget);
+	int width=dLabelGetTextWidth(widget);
 	width+=dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
 	return width;
 }
@@ -216,35 +256,29 @@ int dLabelVTableGetWidth(DWidget *widget) {
 int dLabelVTableGetHeight(DWidget *widget) {
 	assert(widget!=NULL);
 
-	int height=dLabelGetTextureHeight(widget);
+	int height=dLabelGetTextHeight(widget);
 	height+=dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
 	return height;
 }
 
-int dLabelGetTextureWidth(DWidget *widget) {
+int dLabelGetTextWidth(DWidget *widget) {
 	assert(widget!=NULL);
 
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLabel);
 
-	if (!dLabelGenerateTexture(widget))
+	if (!dLabelMeasureText(widget))
 		return 0;
 
-	int width;
-	SDL_QueryTexture(data->d.label.texture, NULL, NULL, &width, NULL);
-
-	return width;
+	return data->d.label.textWidth;
 }
 
-int dLabelGetTextureHeight(DWidget *widget) {
+int dLabelGetTextHeight(DWidget *widget) {
 	assert(widget!=NULL);
 
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLabel);
 
-	if (!dLabelGenerateTexture(widget))
+	if (!dLabelMeasureText(widget))
 		return 0;
 
-	int height;
-	SDL_QueryTexture(data->d.label.texture, NULL, NULL, NULL, &height);
-
-	return height;
+	return data->d.label.textHeight;
 }
@@ -0,0 +1,259 @@
+#include <assert.h>
+
+#include <SDL2/SDL.h>
+
+#include "latency.h"
+#include "latencyprivate.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+#include "window.h"
+
+bool dLatencyEnabled=true;
+bool dLatencyDumpOnQuit=false;
+
+const char *dLatencyStageStrings[DLatencyStageNB]={
+	[DLatencyStageQueue]="queue",
+	[DLatencyStageDispatch]="dispatch",
+	[DLatencyStageLayout]="layout",
+	[DLatencyStagePresent]="present",
+	[DLatencyStageTotal]="total",
+};
+
+DLatencyWindow *dLatencyGetWindow(DWidget *window); // allocates if needed
+const DLatencyWindow *dLatencyGetWindowConst(const DWidget *window); // returns NULL if nothing recorded yet
+
+void dLatencyHistogramAdd(DLatencyHistogram *histogram, DTimeUs value);
+size_t dLatencyBucketFromValue(DTimeUs value);
+DTimeUs dLatencyBucketUpper(size_t bucket); // largest value which maps to bucket
+
+void dLatencySetEnabled(bool enabled) {
+	dLatencyEnabled=enabled;
+}
+
+bool dLatencyGetEnabled(void) {
+	return dLatencyEnabled;
+}
+
+void dLatencySetDumpOnQuit(bool dump) {
+	dLatencyDumpOnQuit=dump;
+}
+
+bool dLatencyGetDumpOnQuit(void) {
+	return dLatencyDumpOnQuit;
+}
+
+void dLatencyGetSummary(const DWidget *window, DLatencyStage stage, DLatencySummary *summary) {
+	assert(window!=NULL);
+	assert(stage<DLatencyStageNB);
+	assert(summary!=NULL);
+
+	const DLatencyWindow *latency=dLatencyGetWindowConst(window);
+	summary->count=(latency!=NULL ? latency->histograms[stage].total : 0);
+	summary->p50=dLatencyGetPercentile(window, stage, 50.0);
+	summary->p99=dLatencyGetPercentile(window, stage, 99.0);
+	summary->max=(latency!=NULL ? latency->histograms[stage].max : 0);
+}
+
+DTimeUs dLatencyGetPercentile(const DWidget *window, DLatencyStage stage, double percentile) {
+	assert(window!=NULL);
+	assert(stage<DLatencyStageNB);
+	assert(percentile>=0.0 && percentile<=100.0);
+
+	const DLatencyWindow *latency=dLatencyGetWindowConst(window);
+	if (latency==NULL || latency->histograms[stage].total==0)
+		return 0;
+
+	const DLatencyHistogram *histogram=&latency->histograms[stage];
+
+	// Find bucket containing the sample of the required rank
+	double exactRank=percentile/100.0*histogram->total;
+	uint64_t rank=(uint64_t)exactRank;
+	if (rank<exactRank || rank<1)
+		++rank;
+
+	uint64_t sum=0;
+	for(size_t bucket=0; bucket<DLatencyBucketCount; ++bucket) {
+		sum+=histogram->counts[bucket];
+		if (sum>=rank) {
+			DTimeUs upper=dLatencyBucketUpper(bucket);
+			return (upper<histogram->max ? upper : histogram->max);
+		}
+	}
+
+	return histogram->max;
+}
+
+size_t dLatencyGetCountOver(const DWidget *window, DLatencyStage stage, DTimeUs threshold) {
+	assert(window!=NULL);
+	assert(stage<DLatencyStageNB);
+
+	const DLatencyWindow *latency=dLatencyGetWindowConst(window);
+	if (latency==NULL)
+		return 0;
+
+	// Count samples in buckets entirely above the threshold
+	size_t count=0;
+	for(size_t bucket=dLatencyBucketFromValue(threshold)+1; bucket<DLatencyBucketCount; ++bucket)
+		count+=latency->histograms[stage].counts[bucket];
+	return count;
+}
+
+void dLatencyReset(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+	dLatencyWindowFree(data->d.window.latency);
+	data->d.window.latency=NULL;
+}
+
+void dLatencyDump(const DWidget *window, FILE *file) {
+	assert(window!=NULL);
+	assert(file!=NULL);
+
+	fprintf(file, "latency for window '%s' (us):\n", dWindowGetTitle(window));
+	for(DLatencyStage stage=0; stage<DLatencyStageNB; ++stage) {
+		DLatencySummary summary;
+		dLatencyGetSummary(window, stage, &summary);
+		fprintf(file, "	%-8s count %8zu p50 %8llu p99 %8llu max %8llu\n", dLatencyStageToString(stage), summary.count, (unsigned long long)summary.p50, (unsigned long long)summary.p99, (unsigned long long)summary.max);
+	}
+}
+
+const char *dLatencyStageToString(DLatencyStage stage) {
+	assert(stage<DLatencyStageNB);
+
+	return dLatencyStageStrings[stage];
+}
+
+void dLatencyRecordDispatch(DWidget *window, uint32_t eventTimestamp, uint32_t dispatchStartTicks, DTimeUs dispatchStart, DTimeUs dispatchEnd) {
+	assert(window!=NULL);
+	assert(dispatchEnd>=dispatchStart);
+
+	if (!dLatencyEnabled)
+		return;
+
+	DLatencyWindow *latency=dLatencyGetWindow(window);
+
+	// Event timestamps only have millisecond resolution, and are in SDL_GetTicks time, so work out how long the event waited before dispatch started
+	// (unsigned subtraction handles the 32 bit tick count wrapping)
+	DTimeUs queued=((uint32_t)(dispatchStartTicks-eventTimestamp))*(DTimeUs)1000;
+	if (queued>dispatchStart)
+		queued=dispatchStart;
+
+	dLatencyHistogramAdd(&latency->histograms[DLatencyStageQueue], queued);
+	dLatencyHistogramAdd(&latency->histograms[DLatencyStageDispatch], dispatchEnd-dispatchStart);
+
+	// Remaining stages are recorded once the window is presented
+	if (latency->pendingCount==latency->pendingAlloc) {
+		latency->pendingAlloc=(latency->pendingAlloc>0 ? 2*latency->pendingAlloc : 16);
+		latency->pending=dReallocTaggedNoFail(latency->pending, sizeof(DLatencyPending)*latency->pendingAlloc, DWidgetTypeWindow);
+	}
+	latency->pending[latency->pendingCount].origin=dispatchStart-queued;
+	latency->pending[latency->pendingCount].dispatchEnd=dispatchEnd;
+	++latency->pendingCount;
+}
+
+void dLatencyMarkLayout(DWidget *window) {
+	assert(window!=NULL);
+
+	// Nothing waiting to be timed?
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+	DLatencyWindow *latency=data->d.window.latency;
+	if (latency==NULL || latency->pendingCount==0)
+		return;
+
+	latency->layoutTime=dGetTimeUs();
+}
+
+void dLatencyMarkPresent(DWidget *window) {
+	assert(window!=NULL);
+
+	// Nothing waiting to be timed?
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+	DLatencyWindow *latency=data->d.window.latency;
+	if (latency==NULL || latency->pendingCount==0)
+		return;
+
+	// Complete samples for all events shown by this present
+	DTimeUs now=dGetTimeUs();
+	for(size_t i=0; i<latency->pendingCount; ++i) {
+		const DLatencyPending *pending=&latency->pending[i];
+		DTimeUs layoutTime=(latency->layoutTime>pending->dispatchEnd ? latency->layoutTime : pending->dispatchEnd);
+		dLatencyHistogramAdd(&latency->histograms[DLatencyStageLayout], layoutTime-pending->dispatchEnd);
+		dLatencyHistogramAdd(&latency->histograms[DLatencyStagePresent], now-layoutTime);
+		dLatencyHistogramAdd(&latency->histograms[DLatencyStageTotal], now-pending->origin);
+	}
+	latency->pendingCount=0;
+}
+
+void dLatencyDiscardPending(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+	if (data->d.window.latency!=NULL)
+		data->d.window.latency->pendingCount=0;
+}
+
+void dLatencyWindowFree(DLatencyWindow *latency) {
+	if (latency==NULL)
+		return;
+
+	dFree(latency->pending);
+	dFree(latency);
+}
+
+DLatencyWindow *dLatencyGetWindow(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+	if (data->d.window.latency==NULL) {
+		DLatencyWindow *latency=dMallocTaggedNoFail(sizeof(DLatencyWindow), DWidgetTypeWindow);
+		memset(latency, 0, sizeof(DLatencyWindow));
+		data->d.window.latency=latency;
+	}
+
+	return data->d.window.latency;
+}
+
+const DLatencyWindow *dLatencyGetWindowConst(const DWidget *window) {
+	assert(window!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(window, DWidgetTypeWindow);
+	return data->d.window.latency;
+}
+
+void dLatencyHistogramAdd(DLatencyHistogram *histogram, DTimeUs value) {
+	assert(histogram!=NULL);
+
+	if (value>DLatencyValueMax)
+		value=DLatencyValueMax;
+
+	++histogram->counts[dLatencyBucketFromValue(value)];
+	++histogram->total;
+	if (value>histogram->max)
+		histogram->max=value;
+}
+
+size_t dLatencyBucketFromValue(DTimeUs value) {
+	if (value>DLatencyValueMax)
+		value=DLatencyValueMax;
+
+	// Small values get a bucket each
+	if (value<32)
+		return value;
+
+	// Otherwise use the top 5 bits (the leading 1 and 4 below it), with the shift giving the power of two range
+	int shift=(63-__builtin_clzll(value))-4;
+	return 16*shift+(value>>shift);
+}
+
+DTimeUs dLatencyBucketUpper(size_t bucket) {
+	assert(bucket<DLatencyBucketCount);
+
+	if (bucket<32)
+		return bucket;
+
+	// Inverse of dLatencyBucketFromValue
+	int shift=bucket/16-1;
+	DTimeUs top=bucket%16+16;
+	return ((top+1)<<shift)-1;
+}
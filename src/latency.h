@@ -0,0 +1,41 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "util.h"
+#include "widget.h"
+
+// Each window records how long input events take to reach the screen, split into stages.
+// Samples are kept as histograms (with roughly 6% precision) so recording is O(1) and memory use is fixed regardless of how long the program runs.
+// All times are in microseconds.
+
+typedef enum {
+	DLatencyStageQueue, // event timestamp to dispatch start (time spent waiting in SDL's queue, millisecond resolution)
+	DLatencyStageDispatch, // running signal handlers for the event
+	DLatencyStageLayout, // dispatch end to layout being up to date ahead of the redraw
+	DLatencyStagePresent, // layout to SDL_RenderPresent returning
+	DLatencyStageTotal, // event timestamp to SDL_RenderPresent returning
+	DLatencyStageNB,
+} DLatencyStage;
+
+typedef struct {
+	size_t count; // number of samples
+	DTimeUs p50, p99, max; // all 0 if no samples
+} DLatencySummary;
+
+void dLatencySetEnabled(bool enabled); // recording is enabled by default
+bool dLatencyGetEnabled(void);
+void dLatencySetDumpOnQuit(bool dump); // if set then digitsQuit writes a summary for each window to stderr (off by default)
+bool dLatencyGetDumpOnQuit(void);
+
+void dLatencyGetSummary(const DWidget *window, DLatencyStage stage, DLatencySummary *summary);
+DTimeUs dLatencyGetPercentile(const DWidget *window, DLatencyStage stage, double percentile); // percentile in range 0-100. result is an upper bound on the true value (never above the max)
+size_t dLatencyGetCountOver(const DWidget *window, DLatencyStage stage, DTimeUs threshold); // number of samples (approximately) above threshold, e.g. to check against an SLO
+void dLatencyReset(DWidget *window);
+void dLatencyDump(const DWidget *window, FILE *file);
+
+const char *dLatencyStageToString(DLatencyStage stage);
+
+#endif
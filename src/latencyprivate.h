@@ -0,0 +1,41 @@
+#ifndef LATENCYPRIVATE_H
+#define LATENCYPRIVATE_H
+
+#include <stdint.h>
+
+#include "latency.h"
+#include "util.h"
+
+// Histogram buckets are exact below 32us, and above that split each power of two into 16 (see dLatencyBucketFromValue)
+#define DLatencyBucketCount 464
+#define DLatencyValueMax UINT32_MAX // samples are clamped to this (over an hour)
+
+typedef struct {
+	uint64_t counts[DLatencyBucketCount];
+	uint64_t total;
+	DTimeUs max;
+} DLatencyHistogram;
+
+typedef struct {
+	DTimeUs origin; // event timestamp (converted to dGetTimeUs time)
+	DTimeUs dispatchEnd;
+} DLatencyPending;
+
+// Per window state, allocated on first use
+typedef struct {
+	DLatencyHistogram histograms[DLatencyStageNB];
+
+	// Events dispatched since the last present, waiting to be shown
+	DLatencyPending *pending;
+	size_t pendingCount, pendingAlloc;
+	DTimeUs layoutTime; // when layout was last brought up to date
+} DLatencyWindow;
+
+void dLatencyRecordDispatch(DWidget *window, uint32_t eventTimestamp, uint32_t dispatchStartTicks, DTimeUs dispatchStart, DTimeUs dispatchEnd); // eventTimestamp is the SDL event's timestamp, and dispatchStartTicks the value of SDL_GetTicks when dispatch started
+void dLatencyMarkLayout(DWidget *window);
+void dLatencyMarkPresent(DWidget *window); // completes samples for all pending events
+void dLatencyDiscardPending(DWidget *window); // drops pending events which did not lead to a present
+
+void dLatencyWindowFree(DLatencyWindow *latency);
+
+#endif
@@ -0,0 +1,695 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+#include "logview.h"
+#include "logviewprivate.h"
+#include "pool.h"
+#include "traceprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+// The open file and its line index, kept separate from the widget so that a scan still running on the pool when the widget is freed has something to complete into.
+// Only the UI thread changes this, except for the task fields which the scanning task fills in (only one task runs at a time).
+// The file is read with pread rather than mapped, as reading a mapping beyond the end of a file which has since been truncated raises SIGBUS,
+// whereas pread simply returns less data (which is then shown as it is, until the follow timer notices the new size).
+struct DLogViewFile {
+	DWidget *logView; // NULL once the widget has been freed
+	DLogViewFile *orphanNext; // next in dLogViewOrphans, while the widget has been freed but the scan has not completed
+	int fd; // -1 if the file could not be opened
+	size_t size; // as of the last check
+
+	size_t *lineStarts; // offset of the start of each line found so far (the first is always 0)
+	size_t lineCount;
+	size_t lineAlloc;
+	size_t indexedSize; // bytes [0, indexedSize) have been scanned for line ends
+
+	// Scanning task
+	bool taskPending; // a task has been submitted to the pool but has not yet completed
+	size_t taskEnd; // task scans [indexedSize, taskEnd)
+	size_t taskRead; // end of what the task actually read (less than taskEnd if the file was truncated meanwhile)
+	char *taskBuffer; // dLogViewScanBufferSize bytes (allocated by first task)
+	size_t *taskLineStarts; // lines found by task
+	size_t taskLineCount;
+	size_t taskLineAlloc;
+};
+
+const DColour dLogViewBackgroundColour={.r=16, .g=16, .b=16, .a=255};
+const SDL_Color dLogViewTextColour={224,224,224,255};
+
+const size_t dLogViewFirstChunkSize=256*1024; // small so that the first screen is found quickly
+const size_t dLogViewChunkSize=16*1024*1024;
+const size_t dLogViewScanBufferSize=256*1024; // amount read at once while scanning
+const DTimeMs dLogViewFollowInterval=250; // how often to check for the file changing size
+const size_t dLogViewMaxLineLength=1024; // in bytes, longer lines are truncated when shown
+const int dLogViewWheelLines=3; // lines scrolled per step of the mouse wheel
+
+void dLogViewVTableDestructor(DWidget *widget);
+void dLogViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dLogViewVTableGetWidth(DWidget *widget);
+int dLogViewVTableGetHeight(DWidget *widget);
+
+DWidgetSignalReturn dLogViewHandlerWidgetMouseWheel(const DWidgetSignalEvent *event, void *userData);
+
+void dLogViewFollowCallback(DTimerId id, void *userData);
+
+DLogViewFile *dLogViewOrphans=NULL; // files whose widget has been freed while a scan was still pending
+
+// File and line index
+void dLogViewFileFree(DLogViewFile *file);
+void dLogViewFileResize(DLogViewFile *file, size_t size);
+void dLogViewFileStartTask(DLogViewFile *file); // submits scan of the next chunk, if any remains and no task is running
+void dLogViewScanTask(void *userData);
+void dLogViewScanComplete(void *userData);
+size_t dLogViewGetLineCountData(const DWidgetObjectData *data);
+const char *dLogViewCopyLine(DWidgetObjectData *data, size_t line); // returns null terminated copy in scratch buffer, valid until next call
+
+// Rendering helpers
+int dLogViewGetLineHeight(void);
+size_t dLogViewGetVisibleRows(const DWidgetObjectData *data); // includes any partially visible row
+size_t dLogViewGetMaxScrollLine(const DWidgetObjectData *data); // scrolling here shows the last line at the bottom
+
+// Line texture cache
+DLogViewLineCacheEntry *dLogViewLineCacheGet(DWidget *widget, SDL_Renderer *renderer, size_t line); // renders line if not cached. returns NULL on failure
+void dLogViewLineCacheInvalidate(DWidgetObjectData *data, size_t line); // clears entries for line and all after it
+void dLogViewLineCacheEntryClear(DLogViewLineCacheEntry *entry);
+
+DWidget *dLogViewNew(const char *path, int width, int height) {
+	assert(path!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Create widget instance
+	DWidget *logView=dWidgetNew(DWidgetTypeLogView);
+
+	// Call constructor
+	dLogViewConstructor(logView, logView->base, path, width, height);
+
+	return logView;
+}
+
+void dLogViewConstructor(DWidget *widget, DWidgetObjectData *data, const char *path, int width, int height) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeLogView);
+	assert(path!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields
+	DLogViewFile *file=dMallocTaggedNoFail(sizeof(DLogViewFile), dWidgetGetBaseType(widget));
+	file->logView=widget;
+	file->orphanNext=NULL;
+	file->fd=-1;
+	file->size=0;
+	file->lineAlloc=1024;
+	file->lineStarts=dMallocTaggedNoFail(sizeof(size_t)*file->lineAlloc, dWidgetGetBaseType(widget));
+	file->lineStarts[0]=0;
+	file->lineCount=1;
+	file->indexedSize=0;
+	file->taskPending=false;
+	file->taskEnd=0;
+	file->taskRead=0;
+	file->taskBuffer=NULL;
+	file->taskLineStarts=NULL;
+	file->taskLineCount=0;
+	file->taskLineAlloc=0;
+
+	data->d.logView.viewportWidth=width;
+	data->d.logView.viewportHeight=height;
+	data->d.logView.file=file;
+	data->d.logView.followTimer=0;
+	data->d.logView.scrollLine=0;
+	data->d.logView.follow=false;
+	data->d.logView.lineCache=NULL;
+	data->d.logView.lineCacheCount=0;
+	data->d.logView.lineScratch=dMallocTaggedNoFail(dLogViewMaxLineLength+2, dWidgetGetBaseType(widget));
+
+	// Setup vtable
+	data->vtable.destructor=&dLogViewVTableDestructor;
+	data->vtable.redraw=&dLogViewVTableRedraw;
+	data->vtable.getMinWidth=&dLogViewVTableGetWidth;
+	data->vtable.getMinHeight=&dLogViewVTableGetHeight;
+	data->vtable.getWidth=&dLogViewVTableGetWidth;
+	data->vtable.getHeight=&dLogViewVTableGetHeight;
+
+	// Connect signals for scrolling
+	if (!dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetMouseWheel, &dLogViewHandlerWidgetMouseWheel, NULL)) {
+		// This shouldn't really happen - there is no reason the handler can fail to connect
+		dFatalError("error: could not connect internal signals for LogView %p\n", widget);
+	}
+
+	// Open file and start indexing it
+	file->fd=open(path, O_RDONLY|O_CLOEXEC);
+	if (file->fd<0) {
+		dWarning("warning: could not open log file '%s' for widget %p (%s)\n", path, widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+		return;
+	}
+
+	struct stat st;
+	if (fstat(file->fd, &st)==0)
+		dLogViewFileResize(file, (size_t)st.st_size);
+	dLogViewFileStartTask(file);
+
+	// Watch for the file growing
+	data->d.logView.followTimer=dTimerAddRepeating(dLogViewFollowInterval, &dLogViewFollowCallback, widget);
+}
+
+void dLogViewSetSize(DWidget *logView, int width, int height) {
+	assert(logView!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(logView, DWidgetTypeLogView);
+
+	// No change?
+	if (data->d.logView.viewportWidth==width && data->d.logView.viewportHeight==height)
+		return;
+
+	data->d.logView.viewportWidth=width;
+	data->d.logView.viewportHeight=height;
+
+	// More lines may now fit
+	if (data->d.logView.follow)
+		dLogViewSetFollow(logView, true);
+	else
+		dLogViewScrollTo(logView, data->d.logView.scrollLine);
+
+	dWidgetSetDirty(logView);
+}
+
+size_t dLogViewGetLineCount(const DWidget *logView) {
+	assert(logView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(logView, DWidgetTypeLogView);
+
+	return dLogViewGetLineCountData(data);
+}
+
+bool dLogViewIsIndexing(const DWidget *logView) {
+	assert(logView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(logView, DWidgetTypeLogView);
+
+	return (data->d.logView.file->indexedSize<data->d.logView.file->size);
+}
+
+void dLogViewScrollTo(DWidget *logView, size_t line) {
+	assert(logView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(logView, DWidgetTypeLogView);
+
+	// Clamp so that the last line is at the bottom at most, following new lines if scrolled to there
+	size_t maxLine=dLogViewGetMaxScrollLine(data);
+	if (line>=maxLine) {
+		line=maxLine;
+		data->d.logView.follow=true;
+	} else
+		data->d.logView.follow=false;
+
+	if (line==data->d.logView.scrollLine)
+		return;
+	data->d.logView.scrollLine=line;
+
+	dWidgetSetDirtyAppearance(logView);
+}
+
+size_t dLogViewGetScrollLine(const DWidget *logView) {
+	assert(logView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(logView, DWidgetTypeLogView);
+
+	return data->d.logView.scrollLine;
+}
+
+void dLogViewSetFollow(DWidget *logView, bool follow) {
+	assert(logView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(logView, DWidgetTypeLogView);
+
+	if (follow)
+		dLogViewScrollTo(logView, SIZE_MAX);
+	else
+		data->d.logView.follow=false;
+}
+
+bool dLogViewGetFollow(const DWidget *logView) {
+	assert(logView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(logView, DWidgetTypeLogView);
+
+	return data->d.logView.follow;
+}
+
+void dLogViewVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+
+	// Stop watching file
+	if (data->d.logView.followTimer!=0)
+		dTimerCancel(data->d.logView.followTimer);
+
+	// Detach file, leaving it for the scan's completion to free if one is running
+	// (or dLogViewQuit, if the completion is never run)
+	DLogViewFile *file=data->d.logView.file;
+	file->logView=NULL;
+	if (file->taskPending) {
+		file->orphanNext=dLogViewOrphans;
+		dLogViewOrphans=file;
+	} else
+		dLogViewFileFree(file);
+	data->d.logView.file=NULL;
+
+	// Free line cache
+	for(size_t i=0; i<data->d.logView.lineCacheCount; ++i)
+		dLogViewLineCacheEntryClear(&data->d.logView.lineCache[i]);
+	dFree(data->d.logView.lineCache);
+	dFree(data->d.logView.lineScratch);
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dLogViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	// Restrict drawing to the view area (and to any existing clip rect)
+	SDL_Rect viewRect={
+	    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
+	    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
+	    .w=data->d.logView.viewportWidth,
+	    .h=data->d.logView.viewportHeight,
+	};
+
+	SDL_Rect oldClip;
+	bool oldClipped=SDL_RenderIsClipEnabled(renderer);
+	if (oldClipped)
+		SDL_RenderGetClipRect(renderer, &oldClip);
+
+	SDL_Rect clip=viewRect;
+	if (oldClipped && !SDL_IntersectRect(&oldClip, &viewRect, &clip))
+		return;
+	SDL_RenderSetClipRect(renderer, &clip);
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Draw background
+	dSetRenderDrawColour(renderer, &dLogViewBackgroundColour);
+	SDL_RenderFillRect(renderer, &clip);
+
+	// Draw only lines which overlap the clip rect, using cached textures where possible
+	int lineHeight=dLogViewGetLineHeight();
+	size_t lineCount=dLogViewGetLineCountData(data);
+	size_t firstLine=data->d.logView.scrollLine+(clip.y-viewRect.y)/lineHeight;
+	size_t lastLine=data->d.logView.scrollLine+(clip.y+clip.h-1-viewRect.y)/lineHeight;
+	for(size_t line=firstLine; line<=lastLine && line<lineCount; ++line) {
+		DLogViewLineCacheEntry *entry=dLogViewLineCacheGet(widget, renderer, line);
+		if (entry==NULL || entry->texture==NULL)
+			continue;
+
+		SDL_Rect destRect={
+		    .x=viewRect.x,
+		    .y=viewRect.y+(int)(line-data->d.logView.scrollLine)*lineHeight,
+		    .w=entry->width,
+		    .h=entry->height,
+		};
+		SDL_RenderCopy(renderer, entry->texture, NULL, &destRect);
+	}
+
+	// Restore clip rect
+	SDL_RenderSetClipRect(renderer, (oldClipped ? &oldClip : NULL));
+
+	dTraceEnd(traceStart, "log view redraw", "render", NULL);
+}
+
+int dLogViewVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+
+	return data->d.logView.viewportWidth+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dLogViewVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+
+	return data->d.logView.viewportHeight+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+DWidgetSignalReturn dLogViewHandlerWidgetMouseWheel(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+
+	if (event->d.widgetMouseWheel.y==0)
+		return DWidgetSignalReturnContinue;
+
+	// Scroll up for positive y (away from the user)
+	size_t lines=(size_t)(event->d.widgetMouseWheel.y>0 ? event->d.widgetMouseWheel.y : -event->d.widgetMouseWheel.y)*dLogViewWheelLines;
+	size_t scrollLine=data->d.logView.scrollLine;
+	if (event->d.widgetMouseWheel.y>0)
+		scrollLine=(scrollLine>lines ? scrollLine-lines : 0);
+	else
+		scrollLine+=lines;
+	dLogViewScrollTo(widget, scrollLine);
+
+	return DWidgetSignalReturnStop;
+}
+
+void dLogViewFollowCallback(DTimerId id, void *userData) {
+	assert(userData!=NULL);
+
+	DWidget *widget=(DWidget *)userData;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+	DLogViewFile *file=data->d.logView.file;
+
+	// The index cannot change while a scan is running - check again next time
+	if (file->taskPending)
+		return;
+
+	// Has file changed size?
+	struct stat st;
+	if (fstat(file->fd, &st)!=0 || (size_t)st.st_size==file->size)
+		return;
+
+	if ((size_t)st.st_size<file->size) {
+		// File has been truncated (e.g. rotated) - forget everything and index it again
+		file->lineStarts[0]=0;
+		file->lineCount=1;
+		file->indexedSize=0;
+		dLogViewLineCacheInvalidate(data, 0);
+		data->d.logView.scrollLine=0;
+		dWidgetSetDirtyAppearance(widget);
+	}
+
+	// Note new size and scan any new data
+	dLogViewFileResize(file, (size_t)st.st_size);
+	dLogViewFileStartTask(file);
+}
+
+void dLogViewQuit(void) {
+	// The pool has stopped, so these scans will never complete
+	while(dLogViewOrphans!=NULL) {
+		DLogViewFile *file=dLogViewOrphans;
+		dLogViewOrphans=file->orphanNext;
+
+		file->taskPending=false;
+		dLogViewFileFree(file);
+	}
+}
+
+void dLogViewFileFree(DLogViewFile *file) {
+	assert(file!=NULL);
+	assert(file->logView==NULL);
+	assert(!file->taskPending);
+
+	if (file->fd>=0)
+		close(file->fd);
+	dFree(file->lineStarts);
+	dFree(file->taskBuffer);
+	dFree(file->taskLineStarts);
+	dFree(file);
+}
+
+void dLogViewFileResize(DLogViewFile *file, size_t size) {
+	assert(file!=NULL);
+	assert(!file->taskPending);
+
+	file->size=size;
+
+	// Lines being indexed must be within the file
+	if (file->indexedSize>size)
+		file->indexedSize=size;
+}
+
+void dLogViewFileStartTask(DLogViewFile *file) {
+	assert(file!=NULL);
+
+	// Already running or nothing left to scan?
+	if (file->taskPending || file->indexedSize>=file->size)
+		return;
+
+	// Scan next chunk (the first being small so that the first screen of lines is found quickly)
+	size_t chunkSize=(file->indexedSize==0 ? dLogViewFirstChunkSize : dLogViewChunkSize);
+	file->taskEnd=(file->size-file->indexedSize>chunkSize ? file->indexedSize+chunkSize : file->size);
+	file->taskRead=file->indexedSize;
+	file->taskLineCount=0;
+	file->taskPending=true;
+	dPoolSubmit(&dLogViewScanTask, &dLogViewScanComplete, file);
+}
+
+void dLogViewScanTask(void *userData) {
+	assert(userData!=NULL);
+
+	DLogViewFile *file=(DLogViewFile *)userData;
+
+	if (file->taskBuffer==NULL)
+		file->taskBuffer=dMallocTaggedNoFail(dLogViewScanBufferSize, DWidgetTypeLogView);
+
+	// Read chunk a buffer at a time, recording the start of each line after a '\n'
+	while(file->taskRead<file->taskEnd) {
+		size_t readSize=(file->taskEnd-file->taskRead<dLogViewScanBufferSize ? file->taskEnd-file->taskRead : dLogViewScanBufferSize);
+		ssize_t got=pread(file->fd, file->taskBuffer, readSize, (off_t)file->taskRead);
+		if (got<=0)
+			break; // file truncated (or read error) since the scan started - stop here, and the follow timer will notice the new size
+
+		const char *bufferEnd=file->taskBuffer+got;
+		for(const char *c=file->taskBuffer; c<bufferEnd; ++c) {
+			c=memchr(c, '\n', bufferEnd-c);
+			if (c==NULL)
+				break;
+
+			if (file->taskLineCount==file->taskLineAlloc) {
+				file->taskLineAlloc=(file->taskLineAlloc>0 ? file->taskLineAlloc*2 : 1024);
+				file->taskLineStarts=dReallocTaggedNoFail(file->taskLineStarts, sizeof(size_t)*file->taskLineAlloc, DWidgetTypeLogView);
+			}
+			file->taskLineStarts[file->taskLineCount++]=file->taskRead+(size_t)(c-file->taskBuffer)+1;
+		}
+
+		file->taskRead+=(size_t)got;
+	}
+}
+
+void dLogViewScanComplete(void *userData) {
+	assert(userData!=NULL);
+
+	DLogViewFile *file=(DLogViewFile *)userData;
+	assert(file->taskPending);
+	file->taskPending=false;
+
+	// Widget freed while scanning?
+	if (file->logView==NULL) {
+		DLogViewFile **link=&dLogViewOrphans;
+		while(*link!=file)
+			link=&(*link)->orphanNext;
+		*link=file->orphanNext;
+
+		dLogViewFileFree(file);
+		return;
+	}
+
+	DWidget *widget=file->logView;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+	size_t oldLineCount=dLogViewGetLineCountData(data);
+
+	// Append lines found to index
+	if (file->lineCount+file->taskLineCount>file->lineAlloc) {
+		while(file->lineCount+file->taskLineCount>file->lineAlloc)
+			file->lineAlloc*=2;
+		file->lineStarts=dReallocTaggedNoFail(file->lineStarts, sizeof(size_t)*file->lineAlloc, dWidgetGetBaseType(widget));
+	}
+	memcpy(file->lineStarts+file->lineCount, file->taskLineStarts, sizeof(size_t)*file->taskLineCount);
+	file->lineCount+=file->taskLineCount;
+	file->indexedSize=file->taskRead;
+
+	// File shrunk while scanning? Then stop at what could be read, until the follow timer checks the size again
+	if (file->taskRead<file->taskEnd)
+		file->size=file->taskRead;
+
+	// The previous last line may have been incomplete, so re-render it
+	size_t changedLine=(oldLineCount>0 ? oldLineCount-1 : 0);
+	dLogViewLineCacheInvalidate(data, changedLine);
+
+	// Keep end in view if following, otherwise only redraw if a changed line is visible
+	if (data->d.logView.follow)
+		dLogViewSetFollow(widget, true);
+	if (changedLine<data->d.logView.scrollLine+dLogViewGetVisibleRows(data))
+		dWidgetSetDirtyAppearance(widget);
+
+	// Continue with next chunk
+	dLogViewFileStartTask(file);
+}
+
+size_t dLogViewGetLineCountData(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	// Ignore the empty 'line' after a trailing '\n' (or in an empty file) as there is nothing to show for it
+	const DLogViewFile *file=data->d.logView.file;
+	if (file->lineStarts[file->lineCount-1]==file->indexedSize)
+		return file->lineCount-1;
+	return file->lineCount;
+}
+
+const char *dLogViewCopyLine(DWidgetObjectData *data, size_t line) {
+	assert(data!=NULL);
+
+	const DLogViewFile *file=data->d.logView.file;
+	assert(line<file->lineCount);
+
+	// Find line, excluding its '\n'
+	size_t start=file->lineStarts[line];
+	size_t end=(line+1<file->lineCount ? file->lineStarts[line+1]-1 : file->indexedSize);
+
+	// Read line, or for long lines one byte more than is shown (to check for a UTF-8 multi-byte sequence being split)
+	// If the file has been truncated since it was indexed then whatever is left is shown
+	char *scratch=data->d.logView.lineScratch;
+	size_t readSize=(end-start<=dLogViewMaxLineLength+1 ? end-start : dLogViewMaxLineLength+1);
+	ssize_t got=(readSize>0 ? pread(file->fd, scratch, readSize, (off_t)start) : 0);
+	size_t length=(got>0 ? (size_t)got : 0);
+
+	// Exclude '\r' of "\r\n" line endings
+	if (length==end-start && length>0 && scratch[length-1]=='\r')
+		--length;
+
+	// Truncate long lines, without splitting a UTF-8 multi-byte sequence
+	if (length>dLogViewMaxLineLength) {
+		length=dLogViewMaxLineLength;
+		while(length>0 && (scratch[length]&0xC0)==0x80)
+			--length;
+	}
+
+	// Replace tabs and other control characters (which the font cannot show) with spaces
+	for(size_t i=0; i<length; ++i)
+		if ((unsigned char)scratch[i]<' ')
+			scratch[i]=' ';
+	scratch[length]='\0';
+
+	return scratch;
+}
+
+int dLogViewGetLineHeight(void) {
+	TTF_Font *font=dFontGet();
+	int lineHeight=(font!=NULL ? TTF_FontLineSkip(font) : dFontSize);
+	return (lineHeight>0 ? lineHeight : 1);
+}
+
+size_t dLogViewGetVisibleRows(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	int lineHeight=dLogViewGetLineHeight();
+	return (data->d.logView.viewportHeight+lineHeight-1)/lineHeight;
+}
+
+size_t dLogViewGetMaxScrollLine(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	size_t lineCount=dLogViewGetLineCountData(data);
+	size_t fullRows=data->d.logView.viewportHeight/dLogViewGetLineHeight();
+	if (fullRows==0)
+		fullRows=1;
+	return (lineCount>fullRows ? lineCount-fullRows : 0);
+}
+
+DLogViewLineCacheEntry *dLogViewLineCacheGet(DWidget *widget, SDL_Renderer *renderer, size_t line) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeLogView);
+
+	// Ensure cache can hold all visible lines plus one
+	size_t rows=dLogViewGetVisibleRows(data);
+	if (data->d.logView.lineCacheCount<rows+1) {
+		data->d.logView.lineCache=dReallocTaggedNoFail(data->d.logView.lineCache, sizeof(DLogViewLineCacheEntry)*(rows+1), dWidgetGetBaseType(widget));
+		for(size_t i=data->d.logView.lineCacheCount; i<rows+1; ++i) {
+			data->d.logView.lineCache[i].line=SIZE_MAX;
+			data->d.logView.lineCache[i].texture=NULL;
+		}
+		data->d.logView.lineCacheCount=rows+1;
+	}
+
+	// Search for existing entry, noting one which can be reused if not found
+	// (any entry not for a visible line - there must be at least one as there are more entries than rows)
+	DLogViewLineCacheEntry *freeEntry=NULL;
+	for(size_t i=0; i<data->d.logView.lineCacheCount; ++i) {
+		DLogViewLineCacheEntry *entry=&data->d.logView.lineCache[i];
+		if (entry->line==line)
+			return entry;
+		if (freeEntry==NULL && (entry->line==SIZE_MAX || entry->line<data->d.logView.scrollLine || entry->line>=data->d.logView.scrollLine+rows))
+			freeEntry=entry;
+	}
+	assert(freeEntry!=NULL);
+
+	dLogViewLineCacheEntryClear(freeEntry);
+
+	// Empty lines need no texture
+	const char *lineText=dLogViewCopyLine(data, line);
+	if (lineText[0]=='\0') {
+		freeEntry->line=line;
+		return freeEntry;
+	}
+
+	// Render line
+	TTF_Font *font=dFontGet();
+	if (font==NULL) {
+		dWarning("warning: could not generate line texture for widget %p (%s) - could not open font at '%s'\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)), dFontPath);
+		return NULL;
+	}
+
+	SDL_Surface *surface=TTF_RenderUTF8_Blended(font, lineText, dLogViewTextColour);
+	if (surface==NULL) {
+		dWarning("warning: could not generate line texture for widget %p (%s) - could not render to surface\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+		return NULL;
+	}
+
+	freeEntry->texture=dCreateTextureFromSurface(renderer, surface);
+	SDL_FreeSurface(surface);
+	if (freeEntry->texture==NULL) {
+		dWarning("warning: could not generate line texture for widget %p (%s) - could not create texture\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+		return NULL;
+	}
+	SDL_QueryTexture(freeEntry->texture, NULL, NULL, &freeEntry->width, &freeEntry->height);
+	freeEntry->line=line;
+
+	return freeEntry;
+}
+
+void dLogViewLineCacheInvalidate(DWidgetObjectData *data, size_t line) {
+	assert(data!=NULL);
+
+	for(size_t i=0; i<data->d.logView.lineCacheCount; ++i) {
+		DLogViewLineCacheEntry *entry=&data->d.logView.lineCache[i];
+		if (entry->line!=SIZE_MAX && entry->line>=line)
+			dLogViewLineCacheEntryClear(entry);
+	}
+}
+
+void dLogViewLineCacheEntryClear(DLogViewLineCacheEntry *entry) {
+	assert(entry!=NULL);
+
+	if (entry->texture!=NULL) {
+		dDestroyTexture(entry->texture);
+		entry->texture=NULL;
+	}
+	entry->line=SIZE_MAX;
+}
@@ -0,0 +1,28 @@
+#ifndef LOGVIEW_H
+#define LOGVIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "widget.h"
+
+// A read-only view of a (possibly very large) text file, such as a log. The file is never read into memory as a whole -
+// lines are found by scanning it in chunks on the pool, starting with a small chunk so that the first screen can be shown almost immediately,
+// and each visible line is read when it is rendered.
+// Once a line has been found, scrolling to it is O(1). Only visible lines are rendered, with a small cache of line textures.
+// The file is checked periodically for appended data (as with tail -f), and while scrolled to the end the view follows new lines.
+// If the file shrinks it is indexed again from the start. Very long lines are truncated when shown.
+
+DWidget *dLogViewNew(const char *path, int width, int height); // size of the visible area in pixels (excluding padding). if the file cannot be opened the view is left empty
+
+void dLogViewSetSize(DWidget *logView, int width, int height);
+
+size_t dLogViewGetLineCount(const DWidget *logView); // lines found so far
+bool dLogViewIsIndexing(const DWidget *logView); // true while part of the file has still to be scanned for lines
+
+void dLogViewScrollTo(DWidget *logView, size_t line); // line is shown at the top, if possible
+size_t dLogViewGetScrollLine(const DWidget *logView);
+void dLogViewSetFollow(DWidget *logView, bool follow); // if true scrolls to the end and keeps new lines in view (also set by scrolling to the end)
+bool dLogViewGetFollow(const DWidget *logView);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef LOGVIEWPRIVATE_H
+#define LOGVIEWPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dLogViewConstructor(DWidget *widget, DWidgetObjectData *data, const char *path, int width, int height);
+
+void dLogViewQuit(void); // frees files left by freed LogViews whose scan had not completed (called by digitsQuit once the pool has stopped)
+
+#endif
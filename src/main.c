@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "digits.h"
 
@@ -55,9 +56,19 @@ int main(int argc, char **argv) {
 	dWidgetDebug(window, 0);
 	dWidgetDebug(window2, 0);
 
+	// Optionally record input, or replay an earlier recording (e.g. with SDL_VIDEODRIVER=dummy to run headless)
+	bool replay=false;
+	if (argc==3 && strcmp(argv[1], "--record")==0)
+		dReplayRecordStart(argv[2]);
+	else if (argc==3 && strcmp(argv[1], "--replay")==0)
+		replay=dReplayStart(argv[2]);
+
 	// Main loop
 	digitsLoop();
 
+	if (replay)
+		dReplayDump(stdout);
+
 	// Tidy up
 	dWidgetFree(window);
 	dWidgetFree(window2);
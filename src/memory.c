@@ -0,0 +1,213 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "digitsprivate.h"
+#include "memory.h"
+#include "memoryprivate.h"
+#include "widgetprivate.h"
+#include "window.h"
+
+// Heap accounting, indexed by tag (with DWidgetTypeNB for memory not owned by any widget)
+// These are updated from any thread, so are atomic
+atomic_size_t dMemoryBytes[DWidgetTypeNB+1];
+atomic_size_t dMemoryPeakBytes[DWidgetTypeNB+1];
+atomic_size_t dMemoryTotalCount;
+atomic_size_t dMemoryTotalBytes;
+atomic_size_t dMemoryTotalPeakBytes;
+
+// Widget and texture accounting (UI thread only)
+size_t dMemoryWidgetCount[DWidgetTypeNB];
+size_t dMemoryTextureBytes=0;
+size_t dMemoryTexturePeakBytes=0;
+
+void dMemoryAdd(DWidgetType tag, size_t size);
+void dMemorySub(DWidgetType tag, size_t size);
+void dMemoryUpdatePeak(atomic_size_t *peak, size_t value);
+
+DWidget *dMemoryGetTextureWindow(SDL_Texture *texture); // returns NULL if window no longer exists
+size_t dMemoryGetTextureSize(SDL_Texture *texture);
+
+void dMemoryGetTotal(DMemoryStats *stats) {
+	assert(stats!=NULL);
+
+	stats->count=atomic_load(&dMemoryTotalCount);
+	stats->bytes=atomic_load(&dMemoryTotalBytes);
+	stats->peakBytes=atomic_load(&dMemoryTotalPeakBytes);
+}
+
+void dMemoryGetWidgetType(DWidgetType type, DMemoryStats *stats) {
+	assert(dWidgetTypeIsValid(type));
+	assert(stats!=NULL);
+
+	stats->count=dMemoryWidgetCount[type];
+	stats->bytes=atomic_load(&dMemoryBytes[type]);
+	stats->peakBytes=atomic_load(&dMemoryPeakBytes[type]);
+}
+
+size_t dMemoryGetTextureBytes(const DWidget *window) {
+	assert(window!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(window, DWidgetTypeWindow);
+	return data->d.window.textureBytes;
+}
+
+size_t dMemoryGetTexturePeakBytes(const DWidget *window) {
+	assert(window!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(window, DWidgetTypeWindow);
+	return data->d.window.texturePeakBytes;
+}
+
+size_t dMemoryGetTotalTextureBytes(void) {
+	return dMemoryTextureBytes;
+}
+
+size_t dMemoryGetTotalTexturePeakBytes(void) {
+	return dMemoryTexturePeakBytes;
+}
+
+void dMemoryDump(FILE *file) {
+	assert(file!=NULL);
+
+	DMemoryStats stats;
+	dMemoryGetTotal(&stats);
+	fprintf(file, "memory: %zu bytes in %zu allocations (peak %zu bytes)\n", stats.bytes, stats.count, stats.peakBytes);
+
+	for(DWidgetType type=0; type<DWidgetTypeNB; ++type) {
+		dMemoryGetWidgetType(type, &stats);
+		if (stats.count==0 && stats.peakBytes==0)
+			continue;
+		fprintf(file, "	%-10s %8zu widgets %10zu bytes (peak %zu)\n", dWidgetTypeToString(type), stats.count, stats.bytes, stats.peakBytes);
+	}
+
+	fprintf(file, "textures: %zu bytes (peak %zu bytes)\n", dMemoryTextureBytes, dMemoryTexturePeakBytes);
+	for(size_t i=0; i<digitsGetWindowCount(); ++i) {
+		const DWidget *window=digitsGetWindowN(i);
+		fprintf(file, "	window '%s' %zu bytes (peak %zu)\n", dWindowGetTitle(window), dMemoryGetTextureBytes(window), dMemoryGetTexturePeakBytes(window));
+	}
+}
+
+void dMemoryAccountAlloc(DWidgetType tag, size_t size) {
+	assert(tag>=0 && tag<=DWidgetTypeNB);
+
+	atomic_fetch_add(&dMemoryTotalCount, 1);
+	dMemoryAdd(tag, size);
+}
+
+void dMemoryAccountRealloc(DWidgetType tag, size_t oldSize, size_t newSize) {
+	assert(tag>=0 && tag<=DWidgetTypeNB);
+
+	if (newSize>oldSize)
+		dMemoryAdd(tag, newSize-oldSize);
+	else
+		dMemorySub(tag, oldSize-newSize);
+}
+
+void dMemoryAccountFree(DWidgetType tag, size_t size) {
+	assert(tag>=0 && tag<=DWidgetTypeNB);
+
+	atomic_fetch_sub(&dMemoryTotalCount, 1);
+	dMemorySub(tag, size);
+}
+
+void dMemoryAccountWidgetNew(DWidgetType type) {
+	assert(dWidgetTypeIsValid(type));
+
+	++dMemoryWidgetCount[type];
+}
+
+void dMemoryAccountWidgetFree(DWidgetType type) {
+	assert(dWidgetTypeIsValid(type));
+	assert(dMemoryWidgetCount[type]>0);
+
+	--dMemoryWidgetCount[type];
+}
+
+void dMemoryAccountTextureNew(SDL_Renderer *renderer, SDL_Texture *texture) {
+	assert(renderer!=NULL);
+	assert(texture!=NULL);
+
+	// Remember which window the texture belongs to, using the SDL window id as windows may be freed before their textures
+	SDL_Window *sdlWindow=SDL_RenderGetWindow(renderer);
+	uintptr_t windowId=(sdlWindow!=NULL ? SDL_GetWindowID(sdlWindow) : 0);
+	SDL_SetTextureUserData(texture, (void *)windowId);
+
+	size_t size=dMemoryGetTextureSize(texture);
+	dMemoryTextureBytes+=size;
+	if (dMemoryTextureBytes>dMemoryTexturePeakBytes)
+		dMemoryTexturePeakBytes=dMemoryTextureBytes;
+
+	DWidget *window=dMemoryGetTextureWindow(texture);
+	if (window!=NULL) {
+		DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+		data->d.window.textureBytes+=size;
+		if (data->d.window.textureBytes>data->d.window.texturePeakBytes)
+			data->d.window.texturePeakBytes=data->d.window.textureBytes;
+	}
+}
+
+void dMemoryAccountTextureFree(SDL_Texture *texture) {
+	assert(texture!=NULL);
+
+	size_t size=dMemoryGetTextureSize(texture);
+	assert(dMemoryTextureBytes>=size);
+	dMemoryTextureBytes-=size;
+
+	DWidget *window=dMemoryGetTextureWindow(texture);
+	if (window!=NULL) {
+		DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+		assert(data->d.window.textureBytes>=size);
+		data->d.window.textureBytes-=size;
+	}
+}
+
+void dMemoryAdd(DWidgetType tag, size_t size) {
+	size_t bytes=atomic_fetch_add(&dMemoryBytes[tag], size)+size;
+	dMemoryUpdatePeak(&dMemoryPeakBytes[tag], bytes);
+
+	size_t total=atomic_fetch_add(&dMemoryTotalBytes, size)+size;
+	dMemoryUpdatePeak(&dMemoryTotalPeakBytes, total);
+}
+
+void dMemorySub(DWidgetType tag, size_t size) {
+	atomic_fetch_sub(&dMemoryBytes[tag], size);
+	atomic_fetch_sub(&dMemoryTotalBytes, size);
+}
+
+void dMemoryUpdatePeak(atomic_size_t *peak, size_t value) {
+	assert(peak!=NULL);
+
+	size_t old=atomic_load_explicit(peak, memory_order_relaxed);
+	while(value>old && !atomic_compare_exchange_weak_explicit(peak, &old, value, memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+DWidget *dMemoryGetTextureWindow(SDL_Texture *texture) {
+	assert(texture!=NULL);
+
+	uintptr_t windowId=(uintptr_t)SDL_GetTextureUserData(texture);
+	if (windowId==0)
+		return NULL;
+
+	SDL_Window *sdlWindow=SDL_GetWindowFromID(windowId);
+	if (sdlWindow==NULL)
+		return NULL;
+
+	DWidget *window=SDL_GetWindowData(sdlWindow, "widget");
+	if (window==NULL || dWidgetGetBaseType(window)!=DWidgetTypeWindow)
+		return NULL;
+
+	return window;
+}
+
+size_t dMemoryGetTextureSize(SDL_Texture *texture) {
+	assert(texture!=NULL);
+
+	Uint32 format;
+	int width, height;
+	if (SDL_QueryTexture(texture, &format, NULL, &width, &height)!=0)
+		return 0;
+
+	return ((size_t)width)*height*SDL_BYTESPERPIXEL(format);
+}
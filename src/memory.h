@@ -0,0 +1,29 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "widget.h"
+
+// Heap memory allocated via dMallocNoFail/dReallocNoFail is tracked exactly (as requested sizes, so excluding allocator overhead).
+// Memory owned by a widget (the widget itself, its object data, child arrays, strings and other buffers) is attributed to the widget's base type.
+// Texture memory is tracked per window, as width*height*bytes per pixel of each texture created for it.
+
+typedef struct {
+	size_t count; // live allocations (or live widgets, for per type stats)
+	size_t bytes;
+	size_t peakBytes; // high-water mark of bytes
+} DMemoryStats;
+
+void dMemoryGetTotal(DMemoryStats *stats); // all tracked heap memory, whether owned by a widget or not
+void dMemoryGetWidgetType(DWidgetType type, DMemoryStats *stats); // count is the number of live widgets with this base type
+
+size_t dMemoryGetTextureBytes(const DWidget *window);
+size_t dMemoryGetTexturePeakBytes(const DWidget *window);
+size_t dMemoryGetTotalTextureBytes(void); // across all windows
+size_t dMemoryGetTotalTexturePeakBytes(void);
+
+void dMemoryDump(FILE *file); // writes a summary of all of the above (for each open window)
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef MEMORYPRIVATE_H
+#define MEMORYPRIVATE_H
+
+#include <stdbool.h>
+
+#include <SDL2/SDL.h>
+
+#include "memory.h"
+
+// Allocation accounting (safe to call from any thread)
+// tag is the widget type owning the memory, or DWidgetTypeNB if none
+void dMemoryAccountAlloc(DWidgetType tag, size_t size);
+void dMemoryAccountRealloc(DWidgetType tag, size_t oldSize, size_t newSize);
+void dMemoryAccountFree(DWidgetType tag, size_t size);
+
+// Widget and texture accounting (UI thread only)
+void dMemoryAccountWidgetNew(DWidgetType type);
+void dMemoryAccountWidgetFree(DWidgetType type);
+void dMemoryAccountTextureNew(SDL_Renderer *renderer, SDL_Texture *texture); // attributed to the window the renderer belongs to
+void dMemoryAccountTextureFree(SDL_Texture *texture);
+
+#endif
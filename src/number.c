@@ -0,0 +1,229 @@
+#include <assert.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+#include "glyphatlasprivate.h"
+#include "number.h"
+#include "numberprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+const DColour dNumberTextColour={.r=255, .g=255, .b=255, .a=255};
+
+const char dNumberCellChars[]="0123456789-.#"; // every character a cell can show (other than blank), used to size cells
+
+void dNumberVTableDestructor(DWidget *widget);
+void dNumberVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dNumberVTableGetWidth(DWidget *widget);
+int dNumberVTableGetHeight(DWidget *widget);
+
+void dNumberFormat(char *cells, size_t cellCount, unsigned decimals, int64_t value); // right aligned, padded with spaces
+
+DWidget *dNumberNew(size_t cells, unsigned decimals) {
+	assert(cells>0);
+
+	// Create widget instance
+	DWidget *number=dWidgetNew(DWidgetTypeNumber);
+
+	// Call constructor
+	dNumberConstructor(number, number->base, cells, decimals);
+
+	return number;
+}
+
+void dNumberConstructor(DWidget *widget, DWidgetObjectData *data, size_t cells, unsigned decimals) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeNumber);
+	assert(cells>0);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields (all allocation is done here, so setting values never allocates)
+	data->d.number.value=0;
+	data->d.number.decimals=decimals;
+	data->d.number.cellCount=cells;
+	data->d.number.cells=dMallocTaggedNoFail(cells, dWidgetGetBaseType(widget));
+	data->d.number.scratch=dMallocTaggedNoFail(cells, dWidgetGetBaseType(widget));
+	dNumberFormat(data->d.number.cells, cells, decimals, 0);
+
+	// Size cells to fit the widest character
+	TTF_Font *font=dFontGet();
+	data->d.number.cellWidth=0;
+	data->d.number.cellHeight=(font!=NULL ? TTF_FontLineSkip(font) : dFontSize);
+	for(const char *c=dNumberCellChars; *c!='\0' && font!=NULL; ++c) {
+		int advance;
+		if (TTF_GlyphMetrics(font, *c, NULL, NULL, NULL, NULL, &advance)==0 && advance>data->d.number.cellWidth)
+			data->d.number.cellWidth=advance;
+	}
+	if (data->d.number.cellWidth<=0)
+		data->d.number.cellWidth=(dFontSize+1)/2;
+
+	// Setup vtable
+	data->vtable.destructor=&dNumberVTableDestructor;
+	data->vtable.redraw=&dNumberVTableRedraw;
+	data->vtable.getMinWidth=&dNumberVTableGetWidth;
+	data->vtable.getMinHeight=&dNumberVTableGetHeight;
+	data->vtable.getWidth=&dNumberVTableGetWidth;
+	data->vtable.getHeight=&dNumberVTableGetHeight;
+}
+
+void dNumberSetValue(DWidget *number, int64_t value) {
+	assert(number!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(number, DWidgetTypeNumber);
+
+	// No change?
+	if (value==data->d.number.value)
+		return;
+	data->d.number.value=value;
+
+	// Find range of cells which changed
+	size_t cellCount=data->d.number.cellCount;
+	dNumberFormat(data->d.number.scratch, cellCount, data->d.number.decimals, value);
+
+	size_t first=0;
+	while(first<cellCount && data->d.number.scratch[first]==data->d.number.cells[first])
+		++first;
+	if (first==cellCount)
+		return;
+
+	size_t last=cellCount-1;
+	while(data->d.number.scratch[last]==data->d.number.cells[last])
+		--last;
+
+	memcpy(data->d.number.cells+first, data->d.number.scratch+first, last-first+1);
+
+	// Redraw only those cells
+	SDL_Rect rect={
+	    .x=dWidgetGetPaddingLeft(number)+(int)first*data->d.number.cellWidth,
+	    .y=dWidgetGetPaddingTop(number),
+	    .w=(int)(last-first+1)*data->d.number.cellWidth,
+	    .h=data->d.number.cellHeight,
+	};
+	dWidgetSetDirtyRect(number, &rect);
+}
+
+int64_t dNumberGetValue(const DWidget *number) {
+	assert(number!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(number, DWidgetTypeNumber);
+
+	return data->d.number.value;
+}
+
+void dNumberVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeNumber);
+
+	// Free memory
+	dFree(data->d.number.cells);
+	dFree(data->d.number.scratch);
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dNumberVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeNumber);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	DGlyphAtlas *atlas=dGlyphAtlasGet(renderer);
+	if (atlas==NULL)
+		return;
+
+	// Find cells which overlap the clip rect (if any), e.g. only those which changed
+	int x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget);
+	int y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget);
+	int cellWidth=data->d.number.cellWidth;
+	size_t cellCount=data->d.number.cellCount;
+	size_t firstCell=0, lastCell=cellCount-1;
+	if (SDL_RenderIsClipEnabled(renderer)) {
+		SDL_Rect clip;
+		SDL_RenderGetClipRect(renderer, &clip);
+		if (clip.x+clip.w<=x || clip.x>=x+(int)cellCount*cellWidth)
+			return;
+		if (clip.x>x)
+			firstCell=(size_t)((clip.x-x)/cellWidth);
+		if (clip.x+clip.w<x+(int)cellCount*cellWidth)
+			lastCell=(size_t)((clip.x+clip.w-1-x)/cellWidth);
+	}
+
+	// Draw each character centred in its cell
+	for(size_t i=firstCell; i<=lastCell; ++i) {
+		char text[2]={data->d.number.cells[i], '\0'};
+		if (text[0]==' ')
+			continue;
+
+		int offset=(cellWidth-dGlyphAtlasGetGlyphWidth(atlas, text[0]))/2;
+		dGlyphAtlasDrawText(atlas, renderer, x+(int)i*cellWidth+offset, y, text, &dNumberTextColour, cellWidth);
+	}
+}
+
+int dNumberVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeNumber);
+
+	return (int)data->d.number.cellCount*data->d.number.cellWidth+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dNumberVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeNumber);
+
+	return data->d.number.cellHeight+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+void dNumberFormat(char *cells, size_t cellCount, unsigned decimals, int64_t value) {
+	assert(cells!=NULL);
+	assert(cellCount>0);
+
+	// Write digits from the least significant, inserting the point after the fractional digits (and always writing at least one digit before it)
+	uint64_t magnitude=(value<0 ? 0-(uint64_t)value : (uint64_t)value); // also correct for INT64_MIN
+	size_t i=cellCount;
+	bool fits=true;
+	for(unsigned digit=0; fits && (magnitude>0 || digit<=decimals); ++digit) {
+		if (decimals>0 && digit==decimals) {
+			if (i==0) {
+				fits=false;
+				break;
+			}
+			cells[--i]='.';
+		}
+		if (i==0) {
+			fits=false;
+			break;
+		}
+		cells[--i]='0'+(char)(magnitude%10);
+		magnitude/=10;
+	}
+	if (fits && value<0) {
+		if (i==0)
+			fits=false;
+		else
+			cells[--i]='-';
+	}
+
+	// Too wide?
+	if (!fits) {
+		memset(cells, '#', cellCount);
+		return;
+	}
+
+	// Pad on the left
+	while(i>0)
+		cells[--i]=' ';
+}
@@ -0,0 +1,18 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "widget.h"
+
+// A Number shows an integer or fixed-point value right aligned in a fixed number of equal width character cells, for counters and readouts which change often.
+// Setting a value needs no string formatting, text rendering or allocation: characters are drawn from the shared glyph atlas,
+// and only the cells whose character changed are redrawn. Values too wide for the cells are shown as all '#'.
+
+DWidget *dNumberNew(size_t cells, unsigned decimals); // cells includes any sign and decimal point. decimals is the number of digits after the point (0 for integers)
+
+void dNumberSetValue(DWidget *number, int64_t value); // fixed point, e.g. 1234 is shown as 12.34 with 2 decimals
+int64_t dNumberGetValue(const DWidget *number);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef NUMBERPRIVATE_H
+#define NUMBERPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dNumberConstructor(DWidget *widget, DWidgetObjectData *data, size_t cells, unsigned decimals);
+
+#endif
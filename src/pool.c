@@ -0,0 +1,360 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+
+#include "digits.h"
+#include "pool.h"
+#include "poolprivate.h"
+#include "util.h"
+
+typedef struct DPoolTask DPoolTask;
+struct DPoolTask {
+	DPoolTaskFunction *task;
+	DPoolCompletionFunction *completion;
+	void *userData;
+	DPoolTask *next; // used by the shared queue only
+};
+
+// Chase-Lev work-stealing deque (using the C11 memory orderings from Le et al. 2013).
+// The owning worker pushes and takes at the bottom, while thieves steal from the top.
+typedef struct DPoolDequeArray DPoolDequeArray;
+struct DPoolDequeArray {
+	int64_t size; // always a power of two
+	DPoolDequeArray *prev; // previous (smaller) array, kept until quit as thieves may still be reading from it
+	_Atomic(DPoolTask *) tasks[];
+};
+
+typedef struct {
+	atomic_int_fast64_t top;
+	atomic_int_fast64_t bottom;
+	_Atomic(DPoolDequeArray *) array;
+} DPoolDeque;
+
+typedef struct {
+	DPoolDeque deque;
+	SDL_Thread *thread;
+	uint32_t random; // state for choosing steal victims
+} DPoolWorker;
+
+DPoolWorker *dPoolWorkers=NULL;
+size_t dPoolWorkerCount=0;
+
+_Thread_local DPoolWorker *dPoolCurrentWorker=NULL; // NULL if not a worker thread
+
+// Shared queue for tasks submitted from non-worker threads
+SDL_mutex *dPoolSharedMutex=NULL;
+DPoolTask *dPoolSharedHead=NULL;
+DPoolTask *dPoolSharedTail=NULL;
+
+SDL_sem *dPoolWorkSem=NULL; // posted once per submitted task (and once per worker at quit)
+atomic_size_t dPoolPending=0; // tasks submitted but not yet finished
+atomic_bool dPoolQuitFlag=false;
+
+const int64_t dPoolDequeInitialSize=256;
+
+int dPoolWorkerMain(void *userData);
+DPoolTask *dPoolFindTask(DPoolWorker *worker);
+void dPoolRunTask(DPoolTask *task);
+
+void dPoolSharedPush(DPoolTask *task);
+DPoolTask *dPoolSharedPop(void);
+
+void dPoolDequeInit(DPoolDeque *deque);
+void dPoolDequeFree(DPoolDeque *deque);
+void dPoolDequePush(DPoolDeque *deque, DPoolTask *task); // owner only
+DPoolTask *dPoolDequeTake(DPoolDeque *deque); // owner only. returns NULL if empty
+DPoolTask *dPoolDequeSteal(DPoolDeque *deque); // any thread. returns NULL if empty or lost a race
+DPoolDequeArray *dPoolDequeArrayNew(int64_t size);
+
+void dPoolSubmit(DPoolTaskFunction *task, DPoolCompletionFunction *completion, void *userData) {
+	assert(task!=NULL);
+	assert(dPoolWorkSem!=NULL);
+
+	DPoolTask *poolTask=dMallocNoFail(sizeof(DPoolTask));
+	poolTask->task=task;
+	poolTask->completion=completion;
+	poolTask->userData=userData;
+	poolTask->next=NULL;
+
+	atomic_fetch_add(&dPoolPending, 1);
+
+	// Workers keep their own tasks local, everyone else uses the shared queue
+	if (dPoolCurrentWorker!=NULL)
+		dPoolDequePush(&dPoolCurrentWorker->deque, poolTask);
+	else
+		dPoolSharedPush(poolTask);
+
+	// Wake a sleeping worker (if any)
+	SDL_SemPost(dPoolWorkSem);
+}
+
+size_t dPoolGetWorkerCount(void) {
+	return dPoolWorkerCount;
+}
+
+bool dPoolInit(void) {
+	// Create shared state
+	atomic_store(&dPoolQuitFlag, false);
+	atomic_store(&dPoolPending, 0);
+	dPoolSharedHead=NULL;
+	dPoolSharedTail=NULL;
+
+	dPoolSharedMutex=SDL_CreateMutex();
+	dPoolWorkSem=SDL_CreateSemaphore(0);
+	if (dPoolSharedMutex==NULL || dPoolWorkSem==NULL) {
+		dWarning("warning: could not create pool synchronisation objects: %s\n", SDL_GetError());
+		SDL_DestroyMutex(dPoolSharedMutex);
+		SDL_DestroySemaphore(dPoolWorkSem);
+		dPoolSharedMutex=NULL;
+		dPoolWorkSem=NULL;
+		return false;
+	}
+
+	// Create one worker per core
+	// Note: all deques are initialised before any threads start, as workers may steal from each other straight away
+	int cpuCount=SDL_GetCPUCount();
+	dPoolWorkerCount=(cpuCount>1 ? (size_t)cpuCount : 1);
+	dPoolWorkers=dMallocNoFail(sizeof(DPoolWorker)*dPoolWorkerCount);
+	for(size_t i=0; i<dPoolWorkerCount; ++i) {
+		dPoolDequeInit(&dPoolWorkers[i].deque);
+		dPoolWorkers[i].thread=NULL;
+		dPoolWorkers[i].random=2654435761u*(uint32_t)(i+1);
+	}
+
+	for(size_t i=0; i<dPoolWorkerCount; ++i) {
+		dPoolWorkers[i].thread=SDL_CreateThread(&dPoolWorkerMain, "digits pool", &dPoolWorkers[i]);
+		if (dPoolWorkers[i].thread==NULL) {
+			dWarning("warning: could not create pool worker thread: %s\n", SDL_GetError());
+			dPoolQuit();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void dPoolQuit(void) {
+	// Not initialised?
+	if (dPoolWorkSem==NULL)
+		return;
+
+	// Ask workers to stop once there is no more work, and wake them all up so they notice
+	atomic_store(&dPoolQuitFlag, true);
+	for(size_t i=0; i<dPoolWorkerCount; ++i)
+		SDL_SemPost(dPoolWorkSem);
+
+	for(size_t i=0; i<dPoolWorkerCount; ++i)
+		if (dPoolWorkers[i].thread!=NULL)
+			SDL_WaitThread(dPoolWorkers[i].thread, NULL);
+
+	// Free memory
+	for(size_t i=0; i<dPoolWorkerCount; ++i)
+		dPoolDequeFree(&dPoolWorkers[i].deque);
+	dFree(dPoolWorkers);
+	dPoolWorkers=NULL;
+	dPoolWorkerCount=0;
+
+	SDL_DestroyMutex(dPoolSharedMutex);
+	dPoolSharedMutex=NULL;
+	SDL_DestroySemaphore(dPoolWorkSem);
+	dPoolWorkSem=NULL;
+}
+
+int dPoolWorkerMain(void *userData) {
+	DPoolWorker *worker=userData;
+	dPoolCurrentWorker=worker;
+
+	while(1) {
+		DPoolTask *task=dPoolFindTask(worker);
+		if (task!=NULL) {
+			dPoolRunTask(task);
+			continue;
+		}
+
+		// No work found - stop if asked to and all tasks are done (a task still running elsewhere could submit more, which we might need to steal)
+		if (atomic_load(&dPoolQuitFlag) && atomic_load(&dPoolPending)==0)
+			break;
+
+		// Otherwise sleep until a task is submitted
+		// (as every submission posts the semaphore we cannot miss one, although we may wake for a task someone else has already taken)
+		SDL_SemWait(dPoolWorkSem);
+	}
+
+	// Pass on the quit wakeup in case another worker consumed ours
+	SDL_SemPost(dPoolWorkSem);
+
+	return 0;
+}
+
+DPoolTask *dPoolFindTask(DPoolWorker *worker) {
+	assert(worker!=NULL);
+
+	// Our own deque first (most recently pushed, so likely still in cache)
+	DPoolTask *task=dPoolDequeTake(&worker->deque);
+	if (task!=NULL)
+		return task;
+
+	// Then shared queue
+	task=dPoolSharedPop();
+	if (task!=NULL)
+		return task;
+
+	// Finally try to steal, starting from a random victim to spread contention
+	worker->random^=worker->random<<13;
+	worker->random^=worker->random>>17;
+	worker->random^=worker->random<<5;
+	size_t start=worker->random%dPoolWorkerCount;
+	for(size_t i=0; i<dPoolWorkerCount; ++i) {
+		DPoolWorker *victim=&dPoolWorkers[(start+i)%dPoolWorkerCount];
+		if (victim==worker)
+			continue;
+
+		task=dPoolDequeSteal(&victim->deque);
+		if (task!=NULL)
+			return task;
+	}
+
+	return NULL;
+}
+
+void dPoolRunTask(DPoolTask *task) {
+	assert(task!=NULL);
+
+	task->task(task->userData);
+
+	// Marshal completion back to the UI thread
+	if (task->completion!=NULL)
+		digitsPost(task->completion, task->userData);
+
+	dFree(task);
+
+	// Only mark as finished once all side effects are complete (including any subtasks being submitted)
+	atomic_fetch_sub(&dPoolPending, 1);
+}
+
+void dPoolSharedPush(DPoolTask *task) {
+	assert(task!=NULL);
+
+	SDL_LockMutex(dPoolSharedMutex);
+	if (dPoolSharedTail!=NULL)
+		dPoolSharedTail->next=task;
+	else
+		dPoolSharedHead=task;
+	dPoolSharedTail=task;
+	SDL_UnlockMutex(dPoolSharedMutex);
+}
+
+DPoolTask *dPoolSharedPop(void) {
+	SDL_LockMutex(dPoolSharedMutex);
+	DPoolTask *task=dPoolSharedHead;
+	if (task!=NULL) {
+		dPoolSharedHead=task->next;
+		if (dPoolSharedHead==NULL)
+			dPoolSharedTail=NULL;
+	}
+	SDL_UnlockMutex(dPoolSharedMutex);
+
+	return task;
+}
+
+void dPoolDequeInit(DPoolDeque *deque) {
+	assert(deque!=NULL);
+
+	atomic_init(&deque->top, 0);
+	atomic_init(&deque->bottom, 0);
+	atomic_init(&deque->array, dPoolDequeArrayNew(dPoolDequeInitialSize));
+}
+
+void dPoolDequeFree(DPoolDeque *deque) {
+	assert(deque!=NULL);
+
+	DPoolDequeArray *array=atomic_load(&deque->array);
+	while(array!=NULL) {
+		DPoolDequeArray *prev=array->prev;
+		dFree(array);
+		array=prev;
+	}
+}
+
+void dPoolDequePush(DPoolDeque *deque, DPoolTask *task) {
+	assert(deque!=NULL);
+	assert(task!=NULL);
+
+	int64_t bottom=atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	int64_t top=atomic_load_explicit(&deque->top, memory_order_acquire);
+	DPoolDequeArray *array=atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+	// Full? If so grow by copying live entries into a larger array
+	if (bottom-top>array->size-1) {
+		DPoolDequeArray *newArray=dPoolDequeArrayNew(2*array->size);
+		for(int64_t i=top; i<bottom; ++i)
+			atomic_store_explicit(&newArray->tasks[i&(newArray->size-1)], atomic_load_explicit(&array->tasks[i&(array->size-1)], memory_order_relaxed), memory_order_relaxed);
+		newArray->prev=array;
+		atomic_store_explicit(&deque->array, newArray, memory_order_release);
+		array=newArray;
+	}
+
+	atomic_store_explicit(&array->tasks[bottom&(array->size-1)], task, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, bottom+1, memory_order_relaxed);
+}
+
+DPoolTask *dPoolDequeTake(DPoolDeque *deque) {
+	assert(deque!=NULL);
+
+	int64_t bottom=atomic_load_explicit(&deque->bottom, memory_order_relaxed)-1;
+	DPoolDequeArray *array=atomic_load_explicit(&deque->array, memory_order_relaxed);
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t top=atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	// Empty?
+	if (top>bottom) {
+		atomic_store_explicit(&deque->bottom, bottom+1, memory_order_relaxed);
+		return NULL;
+	}
+
+	DPoolTask *task=atomic_load_explicit(&array->tasks[bottom&(array->size-1)], memory_order_relaxed);
+
+	// Last entry? If so we race with thieves for it
+	if (top==bottom) {
+		if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top+1, memory_order_seq_cst, memory_order_relaxed))
+			task=NULL;
+		atomic_store_explicit(&deque->bottom, bottom+1, memory_order_relaxed);
+	}
+
+	return task;
+}
+
+DPoolTask *dPoolDequeSteal(DPoolDeque *deque) {
+	assert(deque!=NULL);
+
+	int64_t top=atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t bottom=atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+	if (top>=bottom)
+		return NULL;
+
+	DPoolDequeArray *array=atomic_load_explicit(&deque->array, memory_order_acquire);
+	DPoolTask *task=atomic_load_explicit(&array->tasks[top&(array->size-1)], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top+1, memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+
+	return task;
+}
+
+DPoolDequeArray *dPoolDequeArrayNew(int64_t size) {
+	assert(size>0 && (size&(size-1))==0);
+
+	DPoolDequeArray *array=dMallocNoFail(sizeof(DPoolDequeArray)+sizeof(_Atomic(DPoolTask *))*size);
+	array->size=size;
+	array->prev=NULL;
+	for(int64_t i=0; i<size; ++i)
+		atomic_init(&array->tasks[i], NULL);
+
+	return array;
+}
@@ -0,0 +1,18 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The pool runs tasks on a set of worker threads (one per core) so that slow work does not block the UI thread.
+// Each worker has its own deque: tasks submitted by a worker (e.g. to split up work) are pushed onto its own deque,
+// while tasks submitted from any other thread go onto a shared queue. Idle workers steal from each other.
+
+typedef void (DPoolTaskFunction)(void *userData); // invoked on a worker thread, so must not touch widgets
+typedef void (DPoolCompletionFunction)(void *userData); // invoked on the UI thread (via digitsPost) once the task has run
+
+void dPoolSubmit(DPoolTaskFunction *task, DPoolCompletionFunction *completion, void *userData); // completion can be NULL. safe to call from any thread (after digitsInit)
+
+size_t dPoolGetWorkerCount(void);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef POOLPRIVATE_H
+#define POOLPRIVATE_H
+
+#include <stdbool.h>
+
+#include "pool.h"
+
+bool dPoolInit(void); // starts worker threads (called by digitsInit)
+void dPoolQuit(void); // waits for all submitted tasks to finish and then stops worker threads (called by digitsQuit)
+
+#endif
@@ -0,0 +1,189 @@
+#include <assert.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "profiler.h"
+#include "profilerprivate.h"
+#include "widgetprivate.h"
+
+bool dProfilerEnabled=true;
+
+DProfilerRecord dProfilerRing[DProfilerRecordMax];
+size_t dProfilerRingNext=0; // index the next record will be written to
+size_t dProfilerRingCount=0;
+
+uint64_t dProfilerFrame=0;
+DProfilerRecord dProfilerLoopRecord; // current frame, added to the ring by dProfilerFrameEnd
+DProfilerRecord dProfilerWindowRecord; // current window, added to the ring by dProfilerWindowEnd
+bool dProfilerWindowActive=false;
+
+const char *dProfilerPhaseStrings[DProfilerPhaseNB]={
+	[DProfilerPhaseEvents]="events",
+	[DProfilerPhasePosted]="posted",
+	[DProfilerPhaseTimers]="timers",
+	[DProfilerPhaseLayout]="layout",
+	[DProfilerPhaseDraw]="draw",
+	[DProfilerPhasePresent]="present",
+	[DProfilerPhaseSleep]="sleep",
+};
+
+void dProfilerRingAdd(const DProfilerRecord *record);
+
+void dProfilerSetEnabled(bool enabled) {
+	dProfilerEnabled=enabled;
+	dProfilerWindowActive=false;
+}
+
+bool dProfilerGetEnabled(void) {
+	return dProfilerEnabled;
+}
+
+void dProfilerClear(void) {
+	dProfilerRingNext=0;
+	dProfilerRingCount=0;
+	dProfilerFrame=0;
+}
+
+size_t dProfilerGetRecordCount(void) {
+	return dProfilerRingCount;
+}
+
+const DProfilerRecord *dProfilerGetRecord(size_t index) {
+	if (index>=dProfilerRingCount)
+		return NULL;
+
+	// Oldest record is just after the most recent one once the ring has wrapped
+	size_t oldest=(dProfilerRingNext+DProfilerRecordMax-dProfilerRingCount)%DProfilerRecordMax;
+	return &dProfilerRing[(oldest+index)%DProfilerRecordMax];
+}
+
+bool dProfilerWriteCsv(FILE *file) {
+	assert(file!=NULL);
+
+	// Header
+	fprintf(file, "frame,window,start_us");
+	for(DProfilerPhase phase=0; phase<DProfilerPhaseNB; ++phase)
+		fprintf(file, ",%s_us", dProfilerPhaseToString(phase));
+	fprintf(file, ",events,widgets_drawn,texture_uploads\n");
+
+	// Records
+	for(size_t i=0; i<dProfilerRingCount; ++i) {
+		const DProfilerRecord *record=dProfilerGetRecord(i);
+		fprintf(file, "%llu,%u,%llu", (unsigned long long)record->frame, (unsigned)record->windowId, (unsigned long long)record->start);
+		for(DProfilerPhase phase=0; phase<DProfilerPhaseNB; ++phase)
+			fprintf(file, ",%llu", (unsigned long long)record->phases[phase]);
+		fprintf(file, ",%u,%u,%u\n", record->events, record->widgetsDrawn, record->textureUploads);
+	}
+
+	return !ferror(file);
+}
+
+bool dProfilerExportCsv(const char *path) {
+	assert(path!=NULL);
+
+	FILE *file=fopen(path, "w");
+	if (file==NULL) {
+		dWarning("warning: could not open '%s' for writing profiler CSV\n", path);
+		return false;
+	}
+
+	bool result=dProfilerWriteCsv(file);
+	if (fclose(file)!=0)
+		result=false;
+	if (!result)
+		dWarning("warning: could not write profiler CSV to '%s'\n", path);
+
+	return result;
+}
+
+const char *dProfilerPhaseToString(DProfilerPhase phase) {
+	assert(phase<DProfilerPhaseNB);
+
+	return dProfilerPhaseStrings[phase];
+}
+
+void dProfilerFrameBegin(void) {
+	if (!dProfilerEnabled)
+		return;
+
+	memset(&dProfilerLoopRecord, 0, sizeof(dProfilerLoopRecord));
+	dProfilerLoopRecord.frame=dProfilerFrame;
+	dProfilerLoopRecord.start=dGetTimeUs();
+}
+
+void dProfilerFrameEnd(void) {
+	if (!dProfilerEnabled)
+		return;
+
+	dProfilerRingAdd(&dProfilerLoopRecord);
+	++dProfilerFrame;
+}
+
+void dProfilerWindowBegin(DWidget *window) {
+	assert(window!=NULL);
+
+	if (!dProfilerEnabled)
+		return;
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(window, DWidgetTypeWindow);
+
+	memset(&dProfilerWindowRecord, 0, sizeof(dProfilerWindowRecord));
+	dProfilerWindowRecord.frame=dProfilerFrame;
+	dProfilerWindowRecord.windowId=SDL_GetWindowID(data->d.window.sdlWindow);
+	dProfilerWindowRecord.start=dGetTimeUs();
+	dProfilerWindowActive=true;
+}
+
+void dProfilerWindowEnd(void) {
+	if (!dProfilerWindowActive)
+		return;
+
+	dProfilerWindowActive=false;
+
+	// Skip windows which were not redrawn, to avoid filling the ring with empty records
+	if (dProfilerWindowRecord.widgetsDrawn==0 && dProfilerWindowRecord.textureUploads==0)
+		return;
+
+	dProfilerRingAdd(&dProfilerWindowRecord);
+}
+
+DTimeUs dProfilerPhaseEnd(DProfilerPhase phase, DTimeUs start) {
+	assert(phase<DProfilerPhaseNB);
+
+	DTimeUs now=dGetTimeUs();
+	if (!dProfilerEnabled)
+		return now;
+
+	DTimeUs duration=(now>start ? now-start : 0);
+	dProfilerLoopRecord.phases[phase]+=duration;
+	if (dProfilerWindowActive)
+		dProfilerWindowRecord.phases[phase]+=duration;
+
+	return now;
+}
+
+void dProfilerCountEvent(void) {
+	++dProfilerLoopRecord.events;
+}
+
+void dProfilerCountWidgetDrawn(void) {
+	++dProfilerLoopRecord.widgetsDrawn;
+	if (dProfilerWindowActive)
+		++dProfilerWindowRecord.widgetsDrawn;
+}
+
+void dProfilerCountTextureUpload(void) {
+	++dProfilerLoopRecord.textureUploads;
+	if (dProfilerWindowActive)
+		++dProfilerWindowRecord.textureUploads;
+}
+
+void dProfilerRingAdd(const DProfilerRecord *record) {
+	assert(record!=NULL);
+
+	dProfilerRing[dProfilerRingNext]=*record;
+	dProfilerRingNext=(dProfilerRingNext+1)%DProfilerRecordMax;
+	if (dProfilerRingCount<DProfilerRecordMax)
+		++dProfilerRingCount;
+}
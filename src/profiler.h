@@ -0,0 +1,49 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "util.h"
+
+// The profiler times each phase of every digitsLoop iteration ('frame'), keeping the most recent records in a fixed-size ring buffer.
+// Each frame produces one record for the loop as a whole (window id 0) plus one for each window which was redrawn.
+// Recording costs a few clock reads per frame, so it is enabled by default.
+
+#define DProfilerRecordMax 4096 // size of the ring buffer
+
+typedef enum {
+	DProfilerPhaseEvents, // handling SDL events
+	DProfilerPhasePosted, // running callbacks posted from other threads
+	DProfilerPhaseTimers,
+	DProfilerPhaseLayout, // bringing layout up to date before redrawing
+	DProfilerPhaseDraw,
+	DProfilerPhasePresent, // copying to the screen and SDL_RenderPresent
+	DProfilerPhaseSleep, // waiting for the next event or timer
+	DProfilerPhaseNB,
+} DProfilerPhase;
+
+typedef struct {
+	uint64_t frame; // frame number, counting from 0 when the profiler was last cleared
+	uint32_t windowId; // SDL window id, or 0 if the record covers the whole loop
+	DTimeUs start; // dGetTimeUs time the frame (or window redraw) started
+	DTimeUs phases[DProfilerPhaseNB]; // time spent in each phase (window records only cover layout, draw and present)
+	unsigned events; // number of SDL events handled (loop records only)
+	unsigned widgetsDrawn;
+	unsigned textureUploads;
+} DProfilerRecord;
+
+void dProfilerSetEnabled(bool enabled);
+bool dProfilerGetEnabled(void);
+void dProfilerClear(void);
+
+size_t dProfilerGetRecordCount(void); // number of records held (at most DProfilerRecordMax)
+const DProfilerRecord *dProfilerGetRecord(size_t index); // 0 is the oldest record held. returns NULL if index is out of range
+
+bool dProfilerWriteCsv(FILE *file); // writes all records held, oldest first, with a header row
+bool dProfilerExportCsv(const char *path);
+
+const char *dProfilerPhaseToString(DProfilerPhase phase);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef PROFILERPRIVATE_H
+#define PROFILERPRIVATE_H
+
+#include "profiler.h"
+#include "widget.h"
+
+void dProfilerFrameBegin(void);
+void dProfilerFrameEnd(void); // adds the loop record to the ring buffer
+
+void dProfilerWindowBegin(DWidget *window); // following phases and counts are also attributed to this window
+void dProfilerWindowEnd(void); // adds the window record to the ring buffer (if it drew anything)
+
+DTimeUs dProfilerPhaseEnd(DProfilerPhase phase, DTimeUs start); // adds the time since start to the given phase. returns the current time so it can be used as the start of the next phase
+
+void dProfilerCountEvent(void);
+void dProfilerCountWidgetDrawn(void);
+void dProfilerCountTextureUpload(void);
+
+#endif
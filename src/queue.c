@@ -0,0 +1,169 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "queue.h"
+#include "util.h"
+
+// This is Dmitry Vyukov's non-intrusive MPSC queue.
+// Producers atomically swap themselves in as the head and then link the previous head to them.
+// The consumer follows next pointers from a dummy tail node; after a pop the popped node becomes the new dummy.
+// A producer which has swapped the head but not yet linked makes the queue briefly appear to end early,
+// so a pop can return false while a push is still completing (the caller must retry after that push returns, e.g. on its wakeup).
+//
+// To avoid allocating on every push, nodes are taken from a preallocated pool via a lock-free free list.
+// Only the consumer returns nodes to the list, but any producer may take them, so the list head carries a count
+// of updates alongside the index of the first node to stop a stale compare-and-swap succeeding (the ABA problem).
+
+#define DQueueNodeIndexNone UINT32_MAX
+
+typedef struct DQueueNode DQueueNode;
+struct DQueueNode {
+	_Atomic(DQueueNode *) next;
+	DQueueCallback *callback;
+	void *userData;
+	uint32_t index; // position within queue's pool, or DQueueNodeIndexNone if allocated separately (or the stub)
+	_Atomic uint32_t freeNext; // index of next node on the free list (only meaningful while on the list)
+};
+
+struct DQueue {
+	_Atomic(DQueueNode *) head; // most recently pushed node (written by producers)
+	DQueueNode *tail; // dummy node before the oldest queued item (owned by consumer)
+	DQueueNode stub;
+
+	DQueueNode *pool;
+	_Atomic uint64_t freeHead; // index of first free pool node in low 32 bits (DQueueNodeIndexNone if none), update count in high 32 bits
+};
+
+const uint32_t dQueuePoolSize=1024;
+
+DQueueNode *dQueueNodeAlloc(DQueue *queue); // safe to call from any thread
+void dQueueNodeFree(DQueue *queue, DQueueNode *node); // consumer only
+
+DQueue *dQueueNew(void) {
+	DQueue *queue=dMallocNoFail(sizeof(DQueue));
+
+	atomic_init(&queue->stub.next, NULL);
+	queue->stub.callback=NULL;
+	queue->stub.userData=NULL;
+	queue->stub.index=DQueueNodeIndexNone;
+	atomic_init(&queue->stub.freeNext, DQueueNodeIndexNone);
+	atomic_init(&queue->head, &queue->stub);
+	queue->tail=&queue->stub;
+
+	// Allocate pool with all nodes initially on the free list
+	queue->pool=dMallocNoFail(sizeof(DQueueNode)*dQueuePoolSize);
+	for(uint32_t i=0; i<dQueuePoolSize; ++i) {
+		queue->pool[i].index=i;
+		atomic_init(&queue->pool[i].freeNext, (i+1<dQueuePoolSize ? i+1 : DQueueNodeIndexNone));
+	}
+	atomic_init(&queue->freeHead, 0);
+
+	return queue;
+}
+
+void dQueueFree(DQueue *queue) {
+	// NULL check
+	if (queue==NULL)
+		return;
+
+	// Discard remaining items
+	DQueueCallback *callback;
+	void *userData;
+	while(dQueuePop(queue, &callback, &userData))
+		;
+
+	dQueueNodeFree(queue, queue->tail);
+	dFree(queue->pool);
+	dFree(queue);
+}
+
+void dQueuePush(DQueue *queue, DQueueCallback *callback, void *userData) {
+	assert(queue!=NULL);
+	assert(callback!=NULL);
+
+	DQueueNode *node=dQueueNodeAlloc(queue);
+	atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+	node->callback=callback;
+	node->userData=userData;
+
+	// Become the new head, then link the previous head to us (release so consumer sees our fields)
+	DQueueNode *prev=atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+	atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+bool dQueuePop(DQueue *queue, DQueueCallback **callback, void **userData) {
+	assert(queue!=NULL);
+	assert(callback!=NULL);
+	assert(userData!=NULL);
+
+	DQueueNode *tail=queue->tail;
+	DQueueNode *next=atomic_load_explicit(&tail->next, memory_order_acquire);
+	if (next==NULL)
+		return false;
+
+	// Take item out of next, which then becomes the dummy node
+	*callback=next->callback;
+	*userData=next->userData;
+	queue->tail=next;
+
+	dQueueNodeFree(queue, tail);
+
+	return true;
+}
+
+size_t dQueueRun(DQueue *queue, size_t max) {
+	assert(queue!=NULL);
+
+	size_t count;
+	for(count=0; count<max; ++count) {
+		DQueueCallback *callback;
+		void *userData;
+		if (!dQueuePop(queue, &callback, &userData))
+			break;
+
+		callback(userData);
+	}
+
+	return count;
+}
+
+DQueueNode *dQueueNodeAlloc(DQueue *queue) {
+	assert(queue!=NULL);
+
+	// Take first node from the free list (acquire so we see the consumer's final writes to it)
+	uint64_t head=atomic_load_explicit(&queue->freeHead, memory_order_acquire);
+	while((uint32_t)head!=DQueueNodeIndexNone) {
+		DQueueNode *node=&queue->pool[(uint32_t)head];
+		uint64_t newHead=(((head>>32)+1)<<32) | atomic_load_explicit(&node->freeNext, memory_order_relaxed);
+		if (atomic_compare_exchange_weak_explicit(&queue->freeHead, &head, newHead, memory_order_acquire, memory_order_acquire))
+			return node;
+	}
+
+	// Pool exhausted - fall back to allocating
+	DQueueNode *node=dMallocNoFail(sizeof(DQueueNode));
+	node->index=DQueueNodeIndexNone;
+	atomic_init(&node->freeNext, DQueueNodeIndexNone);
+	return node;
+}
+
+void dQueueNodeFree(DQueue *queue, DQueueNode *node) {
+	assert(queue!=NULL);
+	assert(node!=NULL);
+
+	if (node==&queue->stub)
+		return;
+
+	// Not from the pool?
+	if (node->index==DQueueNodeIndexNone) {
+		dFree(node);
+		return;
+	}
+
+	// Return node to the free list (release so the next producer to take it sees we are done with it)
+	uint64_t head=atomic_load_explicit(&queue->freeHead, memory_order_relaxed);
+	do {
+		atomic_store_explicit(&node->freeNext, (uint32_t)head, memory_order_relaxed);
+	} while(!atomic_compare_exchange_weak_explicit(&queue->freeHead, &head, (((head>>32)+1)<<32) | node->index, memory_order_release, memory_order_relaxed));
+}
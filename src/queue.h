@@ -0,0 +1,23 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Lock-free multi-producer single-consumer queue of callbacks.
+// Any number of threads may push concurrently, but only one thread (the owner) may pop.
+// Order is FIFO per producer, and pushes never block or take a lock.
+// Nodes come from a pool preallocated per queue, so pushes only allocate if the pool runs out (i.e. with a large backlog).
+
+typedef void (DQueueCallback)(void *userData);
+
+typedef struct DQueue DQueue;
+
+DQueue *dQueueNew(void);
+void dQueueFree(DQueue *queue); // any callbacks still queued are discarded without being invoked. no pushes may be in progress
+
+void dQueuePush(DQueue *queue, DQueueCallback *callback, void *userData); // safe to call from any thread
+bool dQueuePop(DQueue *queue, DQueueCallback **callback, void **userData); // owner thread only. returns false if empty
+size_t dQueueRun(DQueue *queue, size_t max); // owner thread only. pops and invokes up to max callbacks, returning the number invoked
+
+#endif
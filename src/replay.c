@@ -0,0 +1,495 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "replay.h"
+#include "replayprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+
+// File format: the magic bytes and version, followed by one record per event.
+// Each record is a code byte (see DReplayCode), the time since the previous event in ms, and then the fields used by digitsLoop for that type.
+// All integers after the code byte are LEB128 varints, with signed values zigzag encoded, so typical records are only a few bytes.
+const char dReplayMagic[4]={'D', 'R', 'E', 'C'};
+#define DReplayVersion 1
+
+typedef enum {
+	DReplayCodeMouseMotion=1,
+	DReplayCodeMouseButtonDown,
+	DReplayCodeMouseButtonUp,
+	DReplayCodeMouseWheel,
+	DReplayCodeKeyDown,
+	DReplayCodeKeyUp,
+	DReplayCodeTextInput,
+	DReplayCodeWindow,
+	DReplayCodeQuit,
+} DReplayCode;
+
+// Recording
+FILE *dReplayRecordFile=NULL;
+Uint32 dReplayRecordLast; // SDL timestamp of previous event (or when recording started)
+
+// Replaying
+bool dReplayActive=false;
+uint8_t *dReplayData=NULL;
+size_t dReplayDataSize=0;
+size_t dReplayDataOffset=0;
+DTimeMs dReplayStartTime; // virtual time the replay started at
+bool dReplayNextValid=false;
+SDL_Event dReplayNext; // decoded ahead so the time it is due is known
+DTimeMs dReplayNextTime;
+
+// Stats
+size_t dReplayEventCount=0;
+DTimeMs dReplayDuration=0;
+DTimeUs *dReplayFrames=NULL;
+size_t dReplayFrameCount=0;
+size_t dReplayFrameAlloc=0;
+
+void dReplayWriteUnsigned(uint64_t value);
+void dReplayWriteSigned(int64_t value);
+
+bool dReplayDecodeNext(void); // fills dReplayNext and dReplayNextTime, returns false at end of data (or if data is malformed)
+bool dReplayDecodeEvent(SDL_Event *sdlEvent, DTimeMs *delta); // returns false if data is malformed
+bool dReplayReadUnsigned(uint64_t *value);
+bool dReplayReadSigned(int64_t *value);
+
+int dReplayCompareTimes(const void *a, const void *b);
+
+bool dReplayRecordStart(const char *path) {
+	assert(path!=NULL);
+
+	// Already busy?
+	if (dReplayRecordFile!=NULL || dReplayActive) {
+		dWarning("warning: could not start recording to '%s' - already recording or replaying\n", path);
+		return false;
+	}
+
+	// Open file and write header
+	dReplayRecordFile=fopen(path, "wb");
+	if (dReplayRecordFile==NULL) {
+		dWarning("warning: could not start recording - could not open '%s' for writing\n", path);
+		return false;
+	}
+	fwrite(dReplayMagic, 1, sizeof(dReplayMagic), dReplayRecordFile);
+	fputc(DReplayVersion, dReplayRecordFile);
+
+	dReplayRecordLast=SDL_GetTicks();
+
+	return true;
+}
+
+void dReplayRecordStop(void) {
+	// Not even recording?
+	if (dReplayRecordFile==NULL)
+		return;
+
+	if (ferror(dReplayRecordFile) | (fclose(dReplayRecordFile)!=0))
+		dWarning("warning: error writing input recording\n");
+	dReplayRecordFile=NULL;
+}
+
+bool dReplayIsRecording(void) {
+	return (dReplayRecordFile!=NULL);
+}
+
+bool dReplayStart(const char *path) {
+	assert(path!=NULL);
+
+	// Already busy?
+	if (dReplayRecordFile!=NULL || dReplayActive) {
+		dWarning("warning: could not replay '%s' - already recording or replaying\n", path);
+		return false;
+	}
+
+	// Read whole file, so no I/O happens while timing frames
+	FILE *file=fopen(path, "rb");
+	if (file==NULL) {
+		dWarning("warning: could not replay - could not open '%s' for reading\n", path);
+		return false;
+	}
+
+	uint8_t *data=NULL;
+	size_t size=0, alloc=0;
+	while(1) {
+		if (size==alloc) {
+			alloc=(alloc>0 ? 2*alloc : 4096);
+			data=dReallocNoFail(data, alloc);
+		}
+		size_t count=fread(data+size, 1, alloc-size, file);
+		if (count==0)
+			break;
+		size+=count;
+	}
+	bool readError=ferror(file);
+	fclose(file);
+
+	// Check header
+	if (readError || size<sizeof(dReplayMagic)+1 || memcmp(data, dReplayMagic, sizeof(dReplayMagic))!=0 || data[sizeof(dReplayMagic)]!=DReplayVersion) {
+		dWarning("warning: could not replay - '%s' is not a supported input recording\n", path);
+		dFree(data);
+		return false;
+	}
+
+	// Setup replay state, starting virtual time from now
+	dFree(dReplayData);
+	dReplayData=data;
+	dReplayDataSize=size;
+	dReplayDataOffset=sizeof(dReplayMagic)+1;
+
+	dReplayStartTime=dGetTimeMs();
+	dSetVirtualTimeMs(dReplayStartTime);
+	dReplayNextTime=dReplayStartTime;
+	dReplayNextValid=dReplayDecodeNext();
+
+	dReplayEventCount=0;
+	dReplayDuration=0;
+	dReplayFrameCount=0;
+
+	dReplayActive=true;
+
+	return true;
+}
+
+bool dReplayIsReplaying(void) {
+	return dReplayActive;
+}
+
+void dReplayGetStats(DReplayStats *stats) {
+	assert(stats!=NULL);
+
+	stats->events=dReplayEventCount;
+	stats->frames=dReplayFrameCount;
+	stats->duration=(dReplayActive ? dGetTimeMs()-dReplayStartTime : dReplayDuration);
+	stats->total=0;
+	stats->p50=0;
+	stats->p99=0;
+	stats->max=0;
+
+	if (dReplayFrameCount==0)
+		return;
+
+	// Sort a copy of the frame times to find percentiles
+	DTimeUs *sorted=dMallocNoFail(sizeof(DTimeUs)*dReplayFrameCount);
+	memcpy(sorted, dReplayFrames, sizeof(DTimeUs)*dReplayFrameCount);
+	qsort(sorted, dReplayFrameCount, sizeof(DTimeUs), &dReplayCompareTimes);
+
+	for(size_t i=0; i<dReplayFrameCount; ++i)
+		stats->total+=sorted[i];
+	stats->p50=sorted[(dReplayFrameCount-1)*50/100];
+	stats->p99=sorted[(dReplayFrameCount-1)*99/100];
+	stats->max=sorted[dReplayFrameCount-1];
+
+	dFree(sorted);
+}
+
+void dReplayDump(FILE *file) {
+	assert(file!=NULL);
+
+	DReplayStats stats;
+	dReplayGetStats(&stats);
+	fprintf(file, "replay: %zu events over %llu ms (virtual) in %zu frames\n", stats.events, (unsigned long long)stats.duration, stats.frames);
+	fprintf(file, "	frame (us) total %llu p50 %llu p99 %llu max %llu\n", (unsigned long long)stats.total, (unsigned long long)stats.p50, (unsigned long long)stats.p99, (unsigned long long)stats.max);
+}
+
+void dReplayRecordEvent(const SDL_Event *sdlEvent) {
+	assert(sdlEvent!=NULL);
+
+	// Not recording?
+	if (dReplayRecordFile==NULL)
+		return;
+
+	// Work out code, ignoring events which digitsLoop does not act on
+	DReplayCode code;
+	switch(sdlEvent->type) {
+		case SDL_MOUSEMOTION: code=DReplayCodeMouseMotion; break;
+		case SDL_MOUSEBUTTONDOWN: code=DReplayCodeMouseButtonDown; break;
+		case SDL_MOUSEBUTTONUP: code=DReplayCodeMouseButtonUp; break;
+		case SDL_MOUSEWHEEL: code=DReplayCodeMouseWheel; break;
+		case SDL_KEYDOWN: code=DReplayCodeKeyDown; break;
+		case SDL_KEYUP: code=DReplayCodeKeyUp; break;
+		case SDL_TEXTINPUT: code=DReplayCodeTextInput; break;
+		case SDL_WINDOWEVENT: code=DReplayCodeWindow; break;
+		case SDL_QUIT: code=DReplayCodeQuit; break;
+		default: return;
+	}
+
+	// Write code and time since previous event
+	// (unsigned subtraction handles the 32 bit tick count wrapping, but events can arrive slightly out of order, which gives a huge delta)
+	Uint32 delta=sdlEvent->common.timestamp-dReplayRecordLast;
+	if (delta>UINT32_MAX/2)
+		delta=0;
+	else
+		dReplayRecordLast=sdlEvent->common.timestamp;
+
+	fputc(code, dReplayRecordFile);
+	dReplayWriteUnsigned(delta);
+
+	// Write type specific fields
+	switch(code) {
+		case DReplayCodeMouseMotion:
+			dReplayWriteUnsigned(sdlEvent->motion.windowID);
+			dReplayWriteUnsigned(sdlEvent->motion.state);
+			dReplayWriteSigned(sdlEvent->motion.x);
+			dReplayWriteSigned(sdlEvent->motion.y);
+			dReplayWriteSigned(sdlEvent->motion.xrel);
+			dReplayWriteSigned(sdlEvent->motion.yrel);
+		break;
+		case DReplayCodeMouseButtonDown:
+		case DReplayCodeMouseButtonUp:
+			dReplayWriteUnsigned(sdlEvent->button.windowID);
+			dReplayWriteUnsigned(sdlEvent->button.button);
+			dReplayWriteUnsigned(sdlEvent->button.clicks);
+			dReplayWriteSigned(sdlEvent->button.x);
+			dReplayWriteSigned(sdlEvent->button.y);
+		break;
+		case DReplayCodeMouseWheel:
+			dReplayWriteUnsigned(sdlEvent->wheel.windowID);
+			dReplayWriteUnsigned(sdlEvent->wheel.direction);
+			dReplayWriteSigned(sdlEvent->wheel.x);
+			dReplayWriteSigned(sdlEvent->wheel.y);
+		break;
+		case DReplayCodeKeyDown:
+		case DReplayCodeKeyUp:
+			dReplayWriteUnsigned(sdlEvent->key.windowID);
+			dReplayWriteUnsigned(sdlEvent->key.repeat);
+			dReplayWriteUnsigned(sdlEvent->key.keysym.scancode);
+			dReplayWriteSigned(sdlEvent->key.keysym.sym);
+			dReplayWriteUnsigned(sdlEvent->key.keysym.mod);
+		break;
+		case DReplayCodeTextInput: {
+			size_t len=strnlen(sdlEvent->text.text, sizeof(sdlEvent->text.text)-1);
+			dReplayWriteUnsigned(sdlEvent->text.windowID);
+			dReplayWriteUnsigned(len);
+			fwrite(sdlEvent->text.text, 1, len, dReplayRecordFile);
+		} break;
+		case DReplayCodeWindow:
+			dReplayWriteUnsigned(sdlEvent->window.windowID);
+			dReplayWriteUnsigned(sdlEvent->window.event);
+			dReplayWriteSigned(sdlEvent->window.data1);
+			dReplayWriteSigned(sdlEvent->window.data2);
+		break;
+		case DReplayCodeQuit:
+		break;
+	}
+}
+
+bool dReplayGetEvent(SDL_Event *sdlEvent) {
+	assert(sdlEvent!=NULL);
+
+	// Nothing left or next event not yet due?
+	if (!dReplayActive || !dReplayNextValid || dReplayNextTime>dGetTimeMs())
+		return false;
+
+	// Return event with a fresh timestamp (so latency stats measure the replay, not the recording)
+	*sdlEvent=dReplayNext;
+	sdlEvent->common.timestamp=SDL_GetTicks();
+	++dReplayEventCount;
+
+	dReplayNextValid=dReplayDecodeNext();
+
+	return true;
+}
+
+bool dReplayGetNextEventTime(DTimeMs *time) {
+	assert(time!=NULL);
+
+	if (!dReplayActive || !dReplayNextValid)
+		return false;
+
+	*time=dReplayNextTime;
+	return true;
+}
+
+void dReplayFinish(void) {
+	// Not even replaying?
+	if (!dReplayActive)
+		return;
+
+	dReplayDuration=dGetTimeMs()-dReplayStartTime;
+	dReplayActive=false;
+	dClearVirtualTime();
+
+	dFree(dReplayData);
+	dReplayData=NULL;
+	dReplayDataSize=0;
+	dReplayDataOffset=0;
+	dReplayNextValid=false;
+}
+
+void dReplayCountFrame(DTimeUs duration) {
+	// Not replaying?
+	if (!dReplayActive)
+		return;
+
+	if (dReplayFrameCount==dReplayFrameAlloc) {
+		dReplayFrameAlloc=(dReplayFrameAlloc>0 ? 2*dReplayFrameAlloc : 1024);
+		dReplayFrames=dReallocNoFail(dReplayFrames, sizeof(DTimeUs)*dReplayFrameAlloc);
+	}
+	dReplayFrames[dReplayFrameCount++]=duration;
+}
+
+void dReplayQuit(void) {
+	dReplayRecordStop();
+	dReplayFinish();
+
+	dFree(dReplayFrames);
+	dReplayFrames=NULL;
+	dReplayFrameCount=0;
+	dReplayFrameAlloc=0;
+	dReplayEventCount=0;
+	dReplayDuration=0;
+}
+
+void dReplayWriteUnsigned(uint64_t value) {
+	// 7 bits per byte, low bits first, with top bit set on all but the last byte
+	while(value>=0x80) {
+		fputc((value&0x7F)|0x80, dReplayRecordFile);
+		value>>=7;
+	}
+	fputc(value, dReplayRecordFile);
+}
+
+void dReplayWriteSigned(int64_t value) {
+	// Zigzag encode so small negative values are also small
+	dReplayWriteUnsigned((((uint64_t)value)<<1)^(uint64_t)(value>>63));
+}
+
+bool dReplayDecodeNext(void) {
+	// End of data?
+	if (dReplayDataOffset>=dReplayDataSize)
+		return false;
+
+	DTimeMs delta;
+	if (!dReplayDecodeEvent(&dReplayNext, &delta)) {
+		dWarning("warning: input recording is malformed at offset %zu, ending replay early\n", dReplayDataOffset);
+		dReplayDataOffset=dReplayDataSize;
+		return false;
+	}
+	dReplayNextTime+=delta;
+
+	return true;
+}
+
+bool dReplayDecodeEvent(SDL_Event *sdlEvent, DTimeMs *delta) {
+	assert(sdlEvent!=NULL);
+	assert(delta!=NULL);
+	assert(dReplayDataOffset<dReplayDataSize);
+
+	DReplayCode code=dReplayData[dReplayDataOffset++];
+	if (!dReplayReadUnsigned(delta))
+		return false;
+
+	SDL_zero(*sdlEvent);
+
+	uint64_t u[3];
+	int64_t s[4];
+	switch(code) {
+		case DReplayCodeMouseMotion:
+			if (!dReplayReadUnsigned(&u[0]) || !dReplayReadUnsigned(&u[1]) || !dReplayReadSigned(&s[0]) || !dReplayReadSigned(&s[1]) || !dReplayReadSigned(&s[2]) || !dReplayReadSigned(&s[3]))
+				return false;
+			sdlEvent->type=SDL_MOUSEMOTION;
+			sdlEvent->motion.windowID=u[0];
+			sdlEvent->motion.state=u[1];
+			sdlEvent->motion.x=s[0];
+			sdlEvent->motion.y=s[1];
+			sdlEvent->motion.xrel=s[2];
+			sdlEvent->motion.yrel=s[3];
+		break;
+		case DReplayCodeMouseButtonDown:
+		case DReplayCodeMouseButtonUp:
+			if (!dReplayReadUnsigned(&u[0]) || !dReplayReadUnsigned(&u[1]) || !dReplayReadUnsigned(&u[2]) || !dReplayReadSigned(&s[0]) || !dReplayReadSigned(&s[1]))
+				return false;
+			sdlEvent->type=(code==DReplayCodeMouseButtonDown ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP);
+			sdlEvent->button.windowID=u[0];
+			sdlEvent->button.button=u[1];
+			sdlEvent->button.state=(code==DReplayCodeMouseButtonDown ? SDL_PRESSED : SDL_RELEASED);
+			sdlEvent->button.clicks=u[2];
+			sdlEvent->button.x=s[0];
+			sdlEvent->button.y=s[1];
+		break;
+		case DReplayCodeMouseWheel:
+			if (!dReplayReadUnsigned(&u[0]) || !dReplayReadUnsigned(&u[1]) || !dReplayReadSigned(&s[0]) || !dReplayReadSigned(&s[1]))
+				return false;
+			sdlEvent->type=SDL_MOUSEWHEEL;
+			sdlEvent->wheel.windowID=u[0];
+			sdlEvent->wheel.direction=u[1];
+			sdlEvent->wheel.x=s[0];
+			sdlEvent->wheel.y=s[1];
+		break;
+		case DReplayCodeKeyDown:
+		case DReplayCodeKeyUp: {
+			uint64_t mod;
+			if (!dReplayReadUnsigned(&u[0]) || !dReplayReadUnsigned(&u[1]) || !dReplayReadUnsigned(&u[2]) || !dReplayReadSigned(&s[0]) || !dReplayReadUnsigned(&mod))
+				return false;
+			sdlEvent->type=(code==DReplayCodeKeyDown ? SDL_KEYDOWN : SDL_KEYUP);
+			sdlEvent->key.windowID=u[0];
+			sdlEvent->key.state=(code==DReplayCodeKeyDown ? SDL_PRESSED : SDL_RELEASED);
+			sdlEvent->key.repeat=u[1];
+			sdlEvent->key.keysym.scancode=u[2];
+			sdlEvent->key.keysym.sym=s[0];
+			sdlEvent->key.keysym.mod=mod;
+		} break;
+		case DReplayCodeTextInput:
+			if (!dReplayReadUnsigned(&u[0]) || !dReplayReadUnsigned(&u[1]) || u[1]>=sizeof(sdlEvent->text.text) || u[1]>dReplayDataSize-dReplayDataOffset)
+				return false;
+			sdlEvent->type=SDL_TEXTINPUT;
+			sdlEvent->text.windowID=u[0];
+			memcpy(sdlEvent->text.text, dReplayData+dReplayDataOffset, u[1]);
+			sdlEvent->text.text[u[1]]='\0';
+			dReplayDataOffset+=u[1];
+		break;
+		case DReplayCodeWindow:
+			if (!dReplayReadUnsigned(&u[0]) || !dReplayReadUnsigned(&u[1]) || !dReplayReadSigned(&s[0]) || !dReplayReadSigned(&s[1]))
+				return false;
+			sdlEvent->type=SDL_WINDOWEVENT;
+			sdlEvent->window.windowID=u[0];
+			sdlEvent->window.event=u[1];
+			sdlEvent->window.data1=s[0];
+			sdlEvent->window.data2=s[1];
+		break;
+		case DReplayCodeQuit:
+			sdlEvent->type=SDL_QUIT;
+		break;
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+bool dReplayReadUnsigned(uint64_t *value) {
+	assert(value!=NULL);
+
+	*value=0;
+	for(unsigned shift=0; shift<64; shift+=7) {
+		if (dReplayDataOffset>=dReplayDataSize)
+			return false;
+
+		uint8_t byte=dReplayData[dReplayDataOffset++];
+		*value|=((uint64_t)(byte&0x7F))<<shift;
+		if (!(byte&0x80))
+			return true;
+	}
+
+	return false;
+}
+
+bool dReplayReadSigned(int64_t *value) {
+	assert(value!=NULL);
+
+	uint64_t raw;
+	if (!dReplayReadUnsigned(&raw))
+		return false;
+
+	*value=(int64_t)(raw>>1)^-(int64_t)(raw&1);
+	return true;
+}
+
+int dReplayCompareTimes(const void *a, const void *b) {
+	DTimeUs timeA=*(const DTimeUs *)a;
+	DTimeUs timeB=*(const DTimeUs *)b;
+	return (timeA>timeB)-(timeA<timeB);
+}
@@ -0,0 +1,30 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "util.h"
+
+// Input events consumed by digitsLoop can be recorded to a compact binary file, and later replayed against the same UI to give a repeatable benchmark.
+// While replaying, real input is ignored and time (as seen by dGetTimeMs, and so timers) is virtual: the loop never sleeps, instead jumping straight to the next recorded event or timer deadline.
+// Frame timings are still measured in real time. When the last event has been handled digitsLoop returns, after which the timings can be queried.
+// Events refer to windows by SDL window id, so the UI should be created in the same order when replaying as when recording (and run with SDL_VIDEODRIVER=dummy for headless runs).
+
+typedef struct {
+	size_t events; // number of events replayed
+	size_t frames; // loop iterations while replaying
+	DTimeMs duration; // virtual time covered by the recording
+	DTimeUs total, p50, p99, max; // real time spent per frame (excluding sleeping, which replay does not do)
+} DReplayStats;
+
+bool dReplayRecordStart(const char *path); // returns false if already recording or replaying, or if path cannot be opened
+void dReplayRecordStop(void);
+bool dReplayIsRecording(void);
+
+bool dReplayStart(const char *path); // loads the whole recording, then the next call to digitsLoop replays it. returns false on failure
+bool dReplayIsReplaying(void);
+void dReplayGetStats(DReplayStats *stats); // for the most recent replay (including one in progress), until digitsQuit
+void dReplayDump(FILE *file);
+
+#endif
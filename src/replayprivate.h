@@ -0,0 +1,19 @@
+#ifndef REPLAYPRIVATE_H
+#define REPLAYPRIVATE_H
+
+#include <stdbool.h>
+
+#include <SDL2/SDL.h>
+
+#include "replay.h"
+
+void dReplayRecordEvent(const SDL_Event *sdlEvent); // does nothing unless recording, or if the event type is not one digitsLoop handles
+
+bool dReplayGetEvent(SDL_Event *sdlEvent); // gets next event if it is due at the current virtual time. returns false if none due
+bool dReplayGetNextEventTime(DTimeMs *time); // returns false once all events have been returned
+void dReplayFinish(void); // ends the replay, returning to real time
+void dReplayCountFrame(DTimeUs duration);
+
+void dReplayQuit(void); // stops any recording or replay and frees memory (called by digitsQuit)
+
+#endif
@@ -0,0 +1,618 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+#include "glyphatlasprivate.h"
+#include "tableview.h"
+#include "tableviewprivate.h"
+#include "traceprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+const DColour dTableViewBackgroundColour={.r=16, .g=16, .b=16, .a=255};
+const DColour dTableViewStripeColour={.r=24, .g=24, .b=24, .a=255};
+const DColour dTableViewHeaderColour={.r=48, .g=48, .b=48, .a=255};
+const DColour dTableViewTextColour={.r=255, .g=255, .b=255, .a=255};
+
+const int dTableViewCellPadding=6; // on each side of a cell's contents
+const int dTableViewWheelRows=3; // rows scrolled per step of the mouse wheel
+
+void dTableViewVTableDestructor(DWidget *widget);
+void dTableViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dTableViewVTableGetWidth(DWidget *widget);
+int dTableViewVTableGetHeight(DWidget *widget);
+
+DWidgetSignalReturn dTableViewHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData);
+DWidgetSignalReturn dTableViewHandlerWidgetMouseWheel(const DWidgetSignalEvent *event, void *userData);
+
+int dTableViewGetRowHeight(void);
+size_t dTableViewGetVisibleRows(const DWidgetObjectData *data); // fully visible rows below the header
+size_t dTableViewGetSourceRowData(DWidgetObjectData *data, size_t row);
+const char *dTableViewFormatCell(DWidgetObjectData *data, const DTableViewColumn *column, size_t sourceRow); // returns pointer valid until next call
+const char *dTableViewGetHeaderText(DWidgetObjectData *data, size_t column); // as above
+
+// Sorting
+void dTableViewOrderUpdate(DWidget *widget); // sorts if order is out of date
+int dTableViewCompareRows(const DTableViewColumn *column, size_t a, size_t b);
+void dTableViewMergeSort(const DTableViewColumn *column, bool ascending, size_t *order, size_t *scratch, size_t count); // stable
+
+DWidget *dTableViewNew(int width, int height, DTableViewRowCountFunction *rowCountFunction, void *userData) {
+	assert(width>=0);
+	assert(height>=0);
+	assert(rowCountFunction!=NULL);
+
+	// Create widget instance
+	DWidget *tableView=dWidgetNew(DWidgetTypeTableView);
+
+	// Call constructor
+	dTableViewConstructor(tableView, tableView->base, width, height, rowCountFunction, userData);
+
+	return tableView;
+}
+
+void dTableViewConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height, DTableViewRowCountFunction *rowCountFunction, void *userData) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeTableView);
+	assert(width>=0);
+	assert(height>=0);
+	assert(rowCountFunction!=NULL);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields
+	data->d.tableView.viewportWidth=width;
+	data->d.tableView.viewportHeight=height;
+	data->d.tableView.rowCountFunction=rowCountFunction;
+	data->d.tableView.rowCountUserData=userData;
+	data->d.tableView.columns=NULL;
+	data->d.tableView.columnCount=0;
+	data->d.tableView.sortColumn=SIZE_MAX;
+	data->d.tableView.sortAscending=true;
+	data->d.tableView.order=NULL;
+	data->d.tableView.orderCount=0;
+	data->d.tableView.orderValid=false;
+	data->d.tableView.scrollRow=0;
+
+	// Setup vtable
+	data->vtable.destructor=&dTableViewVTableDestructor;
+	data->vtable.redraw=&dTableViewVTableRedraw;
+	data->vtable.getMinWidth=&dTableViewVTableGetWidth;
+	data->vtable.getMinHeight=&dTableViewVTableGetHeight;
+	data->vtable.getWidth=&dTableViewVTableGetWidth;
+	data->vtable.getHeight=&dTableViewVTableGetHeight;
+
+	// Connect signals for sorting and scrolling
+	if (!dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetButtonPress, &dTableViewHandlerWidgetButtonPress, NULL) ||
+	    !dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetMouseWheel, &dTableViewHandlerWidgetMouseWheel, NULL)) {
+		// This shouldn't really happen - there is no reason the handlers can fail to connect
+		dFatalError("error: could not connect internal signals for TableView %p\n", widget);
+	}
+}
+
+size_t dTableViewAddColumn(DWidget *tableView, const char *title, DTableViewColumnType type, const void *values) {
+	assert(tableView!=NULL);
+	assert(title!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+	DWidgetType tag=dWidgetGetBaseType(tableView);
+
+	// Add column to array
+	data->d.tableView.columns=dReallocTaggedNoFail(data->d.tableView.columns, sizeof(DTableViewColumn)*(data->d.tableView.columnCount+1), tag);
+	DTableViewColumn *column=&data->d.tableView.columns[data->d.tableView.columnCount];
+	column->title=dMallocTaggedNoFail(strlen(title)+1, tag);
+	strcpy(column->title, title);
+	column->type=type;
+	column->values=values;
+	column->fixedWidth=0;
+	column->width=0;
+
+	dWidgetSetDirtyAppearance(tableView);
+
+	return data->d.tableView.columnCount++;
+}
+
+void dTableViewSetColumnValues(DWidget *tableView, size_t column, const void *values) {
+	assert(tableView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+	assert(column<data->d.tableView.columnCount);
+
+	data->d.tableView.columns[column].values=values;
+
+	dTableViewRowsChanged(tableView);
+}
+
+void dTableViewSetColumnWidth(DWidget *tableView, size_t column, int width) {
+	assert(tableView!=NULL);
+	assert(width>=0);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+	assert(column<data->d.tableView.columnCount);
+
+	data->d.tableView.columns[column].fixedWidth=width;
+	data->d.tableView.columns[column].width=width;
+
+	dWidgetSetDirtyAppearance(tableView);
+}
+
+void dTableViewRowsChanged(DWidget *tableView) {
+	assert(tableView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+
+	data->d.tableView.orderValid=false;
+
+	// Keep scroll position valid if rows were removed
+	dTableViewScrollTo(tableView, data->d.tableView.scrollRow);
+
+	dWidgetSetDirtyAppearance(tableView);
+}
+
+void dTableViewSetSize(DWidget *tableView, int width, int height) {
+	assert(tableView!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+
+	// No change?
+	if (data->d.tableView.viewportWidth==width && data->d.tableView.viewportHeight==height)
+		return;
+
+	data->d.tableView.viewportWidth=width;
+	data->d.tableView.viewportHeight=height;
+
+	// More rows may now fit
+	dTableViewScrollTo(tableView, data->d.tableView.scrollRow);
+
+	dWidgetSetDirty(tableView);
+}
+
+void dTableViewSort(DWidget *tableView, size_t column, bool ascending) {
+	assert(tableView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+	assert(column<data->d.tableView.columnCount);
+
+	data->d.tableView.sortColumn=column;
+	data->d.tableView.sortAscending=ascending;
+	data->d.tableView.orderValid=false;
+
+	dWidgetSetDirtyAppearance(tableView);
+}
+
+void dTableViewSetUnsorted(DWidget *tableView) {
+	assert(tableView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+
+	if (data->d.tableView.sortColumn==SIZE_MAX)
+		return;
+
+	// Free order as it is no longer needed
+	data->d.tableView.sortColumn=SIZE_MAX;
+	dFree(data->d.tableView.order);
+	data->d.tableView.order=NULL;
+	data->d.tableView.orderCount=0;
+	data->d.tableView.orderValid=false;
+
+	dWidgetSetDirtyAppearance(tableView);
+}
+
+size_t dTableViewGetSortColumn(const DWidget *tableView) {
+	assert(tableView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(tableView, DWidgetTypeTableView);
+
+	return data->d.tableView.sortColumn;
+}
+
+void dTableViewScrollTo(DWidget *tableView, size_t row) {
+	assert(tableView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+
+	// Clamp so that the last row is no further up than the bottom of the view
+	size_t rowCount=dTableViewGetRowCount(tableView);
+	size_t visibleRows=dTableViewGetVisibleRows(data);
+	size_t maxRow=(rowCount>visibleRows ? rowCount-visibleRows : 0);
+	if (row>maxRow)
+		row=maxRow;
+
+	// No change?
+	if (row==data->d.tableView.scrollRow)
+		return;
+
+	data->d.tableView.scrollRow=row;
+
+	dWidgetSetDirtyAppearance(tableView);
+}
+
+size_t dTableViewGetScrollRow(const DWidget *tableView) {
+	assert(tableView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(tableView, DWidgetTypeTableView);
+
+	return data->d.tableView.scrollRow;
+}
+
+size_t dTableViewGetRowCount(const DWidget *tableView) {
+	assert(tableView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(tableView, DWidgetTypeTableView);
+
+	return data->d.tableView.rowCountFunction(data->d.tableView.rowCountUserData);
+}
+
+size_t dTableViewGetSourceRow(DWidget *tableView, size_t row) {
+	assert(tableView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(tableView, DWidgetTypeTableView);
+
+	dTableViewOrderUpdate(tableView);
+
+	return dTableViewGetSourceRowData(data, row);
+}
+
+void dTableViewVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	// Free columns and order (data source itself belongs to the caller)
+	for(size_t i=0; i<data->d.tableView.columnCount; ++i)
+		dFree(data->d.tableView.columns[i].title);
+	dFree(data->d.tableView.columns);
+	data->d.tableView.columns=NULL;
+	data->d.tableView.columnCount=0;
+
+	dFree(data->d.tableView.order);
+	data->d.tableView.order=NULL;
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dTableViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	// Restrict drawing to the table area (and to any existing clip rect)
+	SDL_Rect viewRect={
+	    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
+	    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
+	    .w=data->d.tableView.viewportWidth,
+	    .h=data->d.tableView.viewportHeight,
+	};
+
+	SDL_Rect oldClip;
+	bool oldClipped=SDL_RenderIsClipEnabled(renderer);
+	if (oldClipped)
+		SDL_RenderGetClipRect(renderer, &oldClip);
+
+	SDL_Rect clip=viewRect;
+	if (oldClipped && !SDL_IntersectRect(&oldClip, &viewRect, &clip))
+		return;
+	SDL_RenderSetClipRect(renderer, &clip);
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Draw background
+	dSetRenderDrawColour(renderer, &dTableViewBackgroundColour);
+	SDL_RenderFillRect(renderer, &clip);
+
+	DGlyphAtlas *atlas=dGlyphAtlasGet(renderer);
+	if (atlas!=NULL) {
+		dTableViewOrderUpdate(widget);
+
+		// Find rows which overlap the clip rect (below the header)
+		int rowHeight=dTableViewGetRowHeight();
+		int bodyY=viewRect.y+rowHeight;
+		size_t rowCount=dTableViewGetRowCount(widget);
+		size_t firstRow=data->d.tableView.scrollRow+(clip.y>bodyY ? (size_t)((clip.y-bodyY)/rowHeight) : 0);
+		size_t lastRow=data->d.tableView.scrollRow+(clip.y+clip.h-1>bodyY ? (size_t)((clip.y+clip.h-1-bodyY)/rowHeight) : 0);
+		if (lastRow>=rowCount)
+			lastRow=rowCount-1;
+
+		// Fit column widths to visible cells first, so that columns do not move part way through drawing
+		bool widened=false;
+		for(size_t i=0; i<data->d.tableView.columnCount; ++i) {
+			DTableViewColumn *column=&data->d.tableView.columns[i];
+			if (column->fixedWidth>0)
+				continue;
+
+			int width=dGlyphAtlasGetTextWidth(atlas, dTableViewGetHeaderText(data, i));
+			for(size_t row=firstRow; row<=lastRow && rowCount>0; ++row) {
+				int cellWidth=dGlyphAtlasGetTextWidth(atlas, dTableViewFormatCell(data, column, dTableViewGetSourceRowData(data, row)));
+				if (cellWidth>width)
+					width=cellWidth;
+			}
+			if (width>column->width) {
+				column->width=width;
+				widened=true;
+			}
+		}
+
+		// Draw stripes on alternate rows
+		dSetRenderDrawColour(renderer, &dTableViewStripeColour);
+		for(size_t row=firstRow; row<=lastRow && rowCount>0; ++row) {
+			if (row%2==0)
+				continue;
+			SDL_Rect stripeRect={.x=viewRect.x, .y=bodyY+(int)(row-data->d.tableView.scrollRow)*rowHeight, .w=viewRect.w, .h=rowHeight};
+			SDL_RenderFillRect(renderer, &stripeRect);
+		}
+
+		// Draw header
+		SDL_Rect headerRect={.x=viewRect.x, .y=viewRect.y, .w=viewRect.w, .h=rowHeight};
+		dSetRenderDrawColour(renderer, &dTableViewHeaderColour);
+		SDL_RenderFillRect(renderer, &headerRect);
+
+		int x=viewRect.x;
+		for(size_t i=0; i<data->d.tableView.columnCount && x<viewRect.x+viewRect.w; ++i) {
+			const DTableViewColumn *column=&data->d.tableView.columns[i];
+			dGlyphAtlasDrawText(atlas, renderer, x+dTableViewCellPadding, viewRect.y, dTableViewGetHeaderText(data, i), &dTableViewTextColour, column->width);
+			x+=column->width+2*dTableViewCellPadding;
+		}
+
+		// Draw visible cells only, a column at a time (skipping any off the right hand side)
+		x=viewRect.x;
+		for(size_t i=0; i<data->d.tableView.columnCount && x<viewRect.x+viewRect.w; ++i) {
+			const DTableViewColumn *column=&data->d.tableView.columns[i];
+			for(size_t row=firstRow; row<=lastRow && rowCount>0; ++row) {
+				int y=bodyY+(int)(row-data->d.tableView.scrollRow)*rowHeight;
+				const char *text=dTableViewFormatCell(data, column, dTableViewGetSourceRowData(data, row));
+				dGlyphAtlasDrawText(atlas, renderer, x+dTableViewCellPadding, y, text, &dTableViewTextColour, column->width);
+			}
+			x+=column->width+2*dTableViewCellPadding;
+		}
+
+		// Columns to the right of a widened column have moved, including in any area outside of the clip rect
+		if (widened)
+			dWidgetSetDirtyAppearance(widget);
+	}
+
+	// Restore clip rect
+	SDL_RenderSetClipRect(renderer, (oldClipped ? &oldClip : NULL));
+
+	dTraceEnd(traceStart, "table view redraw", "render", NULL);
+}
+
+int dTableViewVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	return data->d.tableView.viewportWidth+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dTableViewVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	return data->d.tableView.viewportHeight+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+DWidgetSignalReturn dTableViewHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	// Only interested in left clicks on the header
+	if (event->d.widgetButtonPress.button!=DWidgetMouseButtonLeft)
+		return DWidgetSignalReturnContinue;
+
+	int x=event->d.widgetButtonPress.x-dWidgetGetGlobalX(widget)-dWidgetGetPaddingLeft(widget);
+	int y=event->d.widgetButtonPress.y-dWidgetGetGlobalY(widget)-dWidgetGetPaddingTop(widget);
+	if (y<0 || y>=dTableViewGetRowHeight() || x<0)
+		return DWidgetSignalReturnContinue;
+
+	// Find column clicked on and sort by it (reversing the order if already sorted by it)
+	int columnX=0;
+	for(size_t i=0; i<data->d.tableView.columnCount; ++i) {
+		columnX+=data->d.tableView.columns[i].width+2*dTableViewCellPadding;
+		if (x<columnX) {
+			bool ascending=(data->d.tableView.sortColumn==i ? !data->d.tableView.sortAscending : true);
+			dTableViewSort(widget, i, ascending);
+			return DWidgetSignalReturnStop;
+		}
+	}
+
+	return DWidgetSignalReturnContinue;
+}
+
+DWidgetSignalReturn dTableViewHandlerWidgetMouseWheel(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	if (event->d.widgetMouseWheel.y==0)
+		return DWidgetSignalReturnContinue;
+
+	// Scroll up for positive y (away from the user)
+	size_t rows=(size_t)(event->d.widgetMouseWheel.y>0 ? event->d.widgetMouseWheel.y : -event->d.widgetMouseWheel.y)*dTableViewWheelRows;
+	size_t scrollRow=data->d.tableView.scrollRow;
+	if (event->d.widgetMouseWheel.y>0)
+		scrollRow=(scrollRow>rows ? scrollRow-rows : 0);
+	else
+		scrollRow+=rows;
+	dTableViewScrollTo(widget, scrollRow);
+
+	return DWidgetSignalReturnStop;
+}
+
+int dTableViewGetRowHeight(void) {
+	TTF_Font *font=dFontGet();
+	int rowHeight=(font!=NULL ? TTF_FontLineSkip(font) : dFontSize);
+	return (rowHeight>0 ? rowHeight : 1);
+}
+
+size_t dTableViewGetVisibleRows(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	int rowHeight=dTableViewGetRowHeight();
+	int bodyHeight=data->d.tableView.viewportHeight-rowHeight;
+	return (bodyHeight>0 ? (size_t)(bodyHeight/rowHeight) : 0);
+}
+
+size_t dTableViewGetSourceRowData(DWidgetObjectData *data, size_t row) {
+	assert(data!=NULL);
+
+	if (data->d.tableView.sortColumn==SIZE_MAX)
+		return row;
+
+	assert(data->d.tableView.orderValid);
+	assert(row<data->d.tableView.orderCount);
+	return data->d.tableView.order[row];
+}
+
+const char *dTableViewFormatCell(DWidgetObjectData *data, const DTableViewColumn *column, size_t sourceRow) {
+	assert(data!=NULL);
+	assert(column!=NULL);
+
+	if (column->values==NULL)
+		return "";
+
+	switch(column->type) {
+		case DTableViewColumnTypeInt:
+			snprintf(data->d.tableView.cellText, sizeof(data->d.tableView.cellText), "%"PRId64, ((const int64_t *)column->values)[sourceRow]);
+			return data->d.tableView.cellText;
+		break;
+		case DTableViewColumnTypeDouble:
+			snprintf(data->d.tableView.cellText, sizeof(data->d.tableView.cellText), "%g", ((const double *)column->values)[sourceRow]);
+			return data->d.tableView.cellText;
+		break;
+		case DTableViewColumnTypeString: {
+			const char *text=((const char *const *)column->values)[sourceRow];
+			return (text!=NULL ? text : "");
+		} break;
+	}
+
+	assert(false);
+	return "";
+}
+
+const char *dTableViewGetHeaderText(DWidgetObjectData *data, size_t column) {
+	assert(data!=NULL);
+	assert(column<data->d.tableView.columnCount);
+
+	// Mark sorted column
+	const char *title=data->d.tableView.columns[column].title;
+	if (data->d.tableView.sortColumn!=column)
+		return title;
+
+	snprintf(data->d.tableView.cellText, sizeof(data->d.tableView.cellText), "%s %s", title, (data->d.tableView.sortAscending ? "^" : "v"));
+	return data->d.tableView.cellText;
+}
+
+void dTableViewOrderUpdate(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTableView);
+
+	if (data->d.tableView.sortColumn==SIZE_MAX)
+		return;
+
+	// Up to date (and rows not since added or removed)?
+	size_t rowCount=dTableViewGetRowCount(widget);
+	if (data->d.tableView.orderValid && data->d.tableView.orderCount==rowCount)
+		return;
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Start from the current order, so that (as the sort is stable) rows with equal values keep their previous order,
+	// allowing sorting by several columns in turn. If there is no current order, or rows have since been added or removed,
+	// start from the data source's order instead so that equal rows are still in a predictable order.
+	DWidgetType tag=dWidgetGetBaseType(widget);
+	if (data->d.tableView.order==NULL || data->d.tableView.orderCount!=rowCount) {
+		data->d.tableView.order=dReallocTaggedNoFail(data->d.tableView.order, sizeof(size_t)*(rowCount>0 ? rowCount : 1), tag);
+		for(size_t i=0; i<rowCount; ++i)
+			data->d.tableView.order[i]=i;
+	}
+
+	size_t *scratch=dMallocTaggedNoFail(sizeof(size_t)*(rowCount>0 ? rowCount : 1), tag);
+	dTableViewMergeSort(&data->d.tableView.columns[data->d.tableView.sortColumn], data->d.tableView.sortAscending, data->d.tableView.order, scratch, rowCount);
+	dFree(scratch);
+
+	data->d.tableView.orderCount=rowCount;
+	data->d.tableView.orderValid=true;
+
+	dTraceEnd(traceStart, "table view sort", "layout", NULL);
+}
+
+int dTableViewCompareRows(const DTableViewColumn *column, size_t a, size_t b) {
+	assert(column!=NULL);
+
+	if (column->values==NULL)
+		return 0;
+
+	switch(column->type) {
+		case DTableViewColumnTypeInt: {
+			const int64_t *values=column->values;
+			return (values[a]>values[b])-(values[a]<values[b]);
+		} break;
+		case DTableViewColumnTypeDouble: {
+			const double *values=column->values;
+			return (values[a]>values[b])-(values[a]<values[b]);
+		} break;
+		case DTableViewColumnTypeString: {
+			const char *const *values=column->values;
+			return strcmp((values[a]!=NULL ? values[a] : ""), (values[b]!=NULL ? values[b] : ""));
+		} break;
+	}
+
+	assert(false);
+	return 0;
+}
+
+void dTableViewMergeSort(const DTableViewColumn *column, bool ascending, size_t *order, size_t *scratch, size_t count) {
+	assert(column!=NULL);
+	assert(order!=NULL);
+	assert(scratch!=NULL);
+
+	// Bottom up, merging runs of width from src into dest and then swapping them over
+	size_t *src=order, *dest=scratch;
+	for(size_t width=1; width<count; width*=2) {
+		for(size_t start=0; start<count; start+=2*width) {
+			size_t mid=(start+width<count ? start+width : count);
+			size_t end=(mid+width<count ? mid+width : count);
+			size_t i=start, j=mid, k=start;
+			while(i<mid && j<end) {
+				int compare=dTableViewCompareRows(column, src[i], src[j]);
+				if (!ascending)
+					compare=-compare;
+				dest[k++]=(compare<=0 ? src[i++] : src[j++]);
+			}
+			while(i<mid)
+				dest[k++]=src[i++];
+			while(j<end)
+				dest[k++]=src[j++];
+		}
+
+		size_t *temp=src;
+		src=dest;
+		dest=temp;
+	}
+
+	// Result may have ended up in scratch
+	if (src!=order)
+		memcpy(order, src, sizeof(size_t)*count);
+}
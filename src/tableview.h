@@ -0,0 +1,41 @@
+#ifndef TABLEVIEW_H
+#define TABLEVIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "widget.h"
+
+// A TableView shows rows from a columnar data source which is read in place: each column is an array with one value per row, and a callback gives the current number of rows.
+// Only the visible cells are drawn (using a shared glyph atlas, so there are no per cell widgets or textures), and sorting only reorders an array of row indices,
+// so scrolling, sorting and resizing never touch other widgets and (except for sorting itself) do not depend on the number of rows.
+// Clicking a column's header sorts by that column (clicking again reverses the order), and the mouse wheel scrolls.
+
+typedef enum {
+	DTableViewColumnTypeInt, // values are int64_t
+	DTableViewColumnTypeDouble, // values are double
+	DTableViewColumnTypeString, // values are const char *, with NULL shown as empty
+} DTableViewColumnType;
+
+typedef size_t (DTableViewRowCountFunction)(void *userData);
+
+DWidget *dTableViewNew(int width, int height, DTableViewRowCountFunction *rowCountFunction, void *userData); // size of the visible area in pixels (excluding padding)
+
+size_t dTableViewAddColumn(DWidget *tableView, const char *title, DTableViewColumnType type, const void *values); // returns index of new column. values is not copied, so must remain valid
+void dTableViewSetColumnValues(DWidget *tableView, size_t column, const void *values); // e.g. after the array has been reallocated
+void dTableViewSetColumnWidth(DWidget *tableView, size_t column, int width); // in pixels, or 0 to fit the widest cell shown so far (the default)
+void dTableViewRowsChanged(DWidget *tableView); // call after values or the number of rows change, to re-sort and redraw
+
+void dTableViewSetSize(DWidget *tableView, int width, int height);
+
+void dTableViewSort(DWidget *tableView, size_t column, bool ascending); // rows with equal values keep their previous order (so sorting by one column then another orders by both), unless rows were added or removed since, in which case they are in data source order
+void dTableViewSetUnsorted(DWidget *tableView); // show rows in data source order
+size_t dTableViewGetSortColumn(const DWidget *tableView); // returns SIZE_MAX if unsorted
+
+void dTableViewScrollTo(DWidget *tableView, size_t row); // row is shown at the top, if possible
+size_t dTableViewGetScrollRow(const DWidget *tableView);
+
+size_t dTableViewGetRowCount(const DWidget *tableView);
+size_t dTableViewGetSourceRow(DWidget *tableView, size_t row); // maps a displayed row to its index in the data source
+
+#endif
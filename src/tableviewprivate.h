@@ -0,0 +1,8 @@
+#ifndef TABLEVIEWPRIVATE_H
+#define TABLEVIEWPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dTableViewConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height, DTableViewRowCountFunction *rowCountFunction, void *userData);
+
+#endif
@@ -0,0 +1,1028 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+#include "textview.h"
+#include "textviewprivate.h"
+#include "timer.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+const DColour dTextViewBackgroundColour={.r=16, .g=16, .b=16, .a=255};
+const DColour dTextViewCaretColour={.r=255, .g=255, .b=255, .a=255};
+const SDL_Color dTextViewTextColour={255,255,255,255};
+
+const DTimeMs dTextViewBlinkInterval=500;
+const int dTextViewCaretWidth=2;
+const size_t dTextViewGapMin=64; // minimum gap size after growing the text buffer
+
+void dTextViewVTableDestructor(DWidget *widget);
+void dTextViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dTextViewVTableGetMinWidth(DWidget *widget);
+int dTextViewVTableGetMinHeight(DWidget *widget);
+int dTextViewVTableGetWidth(DWidget *widget);
+int dTextViewVTableGetHeight(DWidget *widget);
+
+DWidgetSignalReturn dTextViewHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData);
+DWidgetSignalReturn dTextViewHandlerWidgetKeyDown(const DWidgetSignalEvent *event, void *userData);
+DWidgetSignalReturn dTextViewHandlerWidgetTextInput(const DWidgetSignalEvent *event, void *userData);
+DWidgetSignalReturn dTextViewHandlerWidgetFocusIn(const DWidgetSignalEvent *event, void *userData);
+DWidgetSignalReturn dTextViewHandlerWidgetFocusOut(const DWidgetSignalEvent *event, void *userData);
+
+void dTextViewBlinkCallback(DTimerId id, void *userData);
+
+// Gap buffer helpers
+size_t dTextViewGetLengthData(const DWidgetObjectData *data);
+char dTextViewGetChar(const DWidgetObjectData *data, size_t offset);
+size_t dTextViewGetLineCountData(const DWidgetObjectData *data);
+size_t dTextViewGetLineStart(const DWidgetObjectData *data, size_t line);
+size_t dTextViewGetLineEnd(const DWidgetObjectData *data, size_t line); // offset of the line's '\n' (or the end of the text)
+size_t dTextViewGetCursorLine(const DWidgetObjectData *data);
+void dTextViewMoveGap(DWidgetObjectData *data, size_t offset);
+void dTextViewReserveGap(DWidgetObjectData *data, size_t size);
+void dTextViewReserveLineGap(DWidgetObjectData *data, size_t count);
+const char *dTextViewCopyLine(DWidgetObjectData *data, size_t line); // returns null terminated copy in scratch buffer, valid until next call
+size_t dTextViewPrevCharOffset(const DWidgetObjectData *data, size_t offset); // handles UTF-8 multi-byte sequences
+size_t dTextViewNextCharOffset(const DWidgetObjectData *data, size_t offset);
+
+// Editing (these update the line cache, scroll position and damaged area as needed)
+void dTextViewInsertBytes(DWidget *widget, const char *text, size_t len);
+void dTextViewDeleteBackward(DWidget *widget, size_t len);
+void dTextViewDeleteForward(DWidget *widget, size_t len);
+void dTextViewMoveCursor(DWidget *widget, size_t offset, bool keepColumn);
+void dTextViewEdited(DWidget *widget, size_t line, size_t removedLines, size_t addedLines);
+
+// Rendering helpers
+int dTextViewGetLineHeight(void);
+size_t dTextViewGetVisibleRows(const DWidgetObjectData *data); // includes any partially visible row
+int dTextViewGetCaretX(DWidget *widget);
+bool dTextViewScrollToCursor(DWidget *widget); // returns true if scroll position changed
+void dTextViewCaretReset(DWidget *widget); // makes caret visible and restarts blink timer
+void dTextViewDamageLines(DWidget *widget, size_t first, size_t last); // last is inclusive and can be SIZE_MAX for all lines after first
+void dTextViewDamageCaret(DWidget *widget);
+
+// Line texture cache
+DTextViewLineCacheEntry *dTextViewLineCacheGet(DWidget *widget, SDL_Renderer *renderer, size_t line); // renders line if not cached. returns NULL on failure
+void dTextViewLineCacheEdit(DWidgetObjectData *data, size_t line, size_t removedLines, size_t addedLines);
+void dTextViewLineCacheClear(DWidgetObjectData *data);
+void dTextViewLineCacheEntryClear(DTextViewLineCacheEntry *entry);
+
+DWidget *dTextViewNew(int width, int height) {
+	assert(width>=0);
+	assert(height>=0);
+
+	// Create widget instance
+	DWidget *textView=dWidgetNew(DWidgetTypeTextView);
+
+	// Call constructor
+	dTextViewConstructor(textView, textView->base, width, height);
+
+	return textView;
+}
+
+void dTextViewConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeTextView);
+	assert(width>=0);
+	assert(height>=0);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields (starting with an empty text and a single line)
+	data->d.textView.textAlloc=dTextViewGapMin;
+	data->d.textView.text=dMallocTaggedNoFail(data->d.textView.textAlloc, dWidgetGetBaseType(widget));
+	data->d.textView.gapStart=0;
+	data->d.textView.gapEnd=data->d.textView.textAlloc;
+
+	data->d.textView.lineAlloc=16;
+	data->d.textView.lineStarts=dMallocTaggedNoFail(sizeof(size_t)*data->d.textView.lineAlloc, dWidgetGetBaseType(widget));
+	data->d.textView.lineStarts[0]=0;
+	data->d.textView.lineGapStart=1;
+	data->d.textView.lineGapEnd=data->d.textView.lineAlloc;
+
+	data->d.textView.viewportWidth=width;
+	data->d.textView.viewportHeight=height;
+	data->d.textView.scrollLine=0;
+	data->d.textView.desiredColumn=SIZE_MAX;
+
+	data->d.textView.caretX=-1;
+	data->d.textView.caretVisible=false;
+	data->d.textView.blinkTimer=0;
+
+	data->d.textView.lineCache=NULL;
+	data->d.textView.lineCacheCount=0;
+	data->d.textView.lineScratchAlloc=64;
+	data->d.textView.lineScratch=dMallocTaggedNoFail(data->d.textView.lineScratchAlloc, dWidgetGetBaseType(widget)); // allocated here so it is tagged (reallocating keeps the tag)
+
+	// Setup vtable
+	data->vtable.destructor=&dTextViewVTableDestructor;
+	data->vtable.redraw=&dTextViewVTableRedraw;
+	data->vtable.getMinWidth=&dTextViewVTableGetMinWidth;
+	data->vtable.getMinHeight=&dTextViewVTableGetMinHeight;
+	data->vtable.getWidth=&dTextViewVTableGetWidth;
+	data->vtable.getHeight=&dTextViewVTableGetHeight;
+
+	// Connect signals to handle editing
+	if (!dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetButtonPress, &dTextViewHandlerWidgetButtonPress, NULL) ||
+	    !dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetKeyDown, &dTextViewHandlerWidgetKeyDown, NULL) ||
+	    !dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetTextInput, &dTextViewHandlerWidgetTextInput, NULL) ||
+	    !dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetFocusIn, &dTextViewHandlerWidgetFocusIn, NULL) ||
+	    !dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetFocusOut, &dTextViewHandlerWidgetFocusOut, NULL)) {
+		// This shouldn't really happen - there is no reason the handlers can fail to connect
+		dFatalError("error: could not connect internal signals for TextView %p\n", widget);
+	}
+}
+
+char *dTextViewGetText(const DWidget *textView) {
+	assert(textView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(textView, DWidgetTypeTextView);
+
+	// Copy the two halves either side of the gap
+	size_t beforeGap=data->d.textView.gapStart;
+	size_t afterGap=data->d.textView.textAlloc-data->d.textView.gapEnd;
+	char *text=dMallocNoFail(beforeGap+afterGap+1);
+	memcpy(text, data->d.textView.text, beforeGap);
+	memcpy(text+beforeGap, data->d.textView.text+data->d.textView.gapEnd, afterGap);
+	text[beforeGap+afterGap]='\0';
+
+	return text;
+}
+
+size_t dTextViewGetLength(const DWidget *textView) {
+	assert(textView!=NULL);
+
+	return dTextViewGetLengthData(dWidgetGetObjectDataConstNoFail(textView, DWidgetTypeTextView));
+}
+
+size_t dTextViewGetLineCount(const DWidget *textView) {
+	assert(textView!=NULL);
+
+	return dTextViewGetLineCountData(dWidgetGetObjectDataConstNoFail(textView, DWidgetTypeTextView));
+}
+
+size_t dTextViewGetCursor(const DWidget *textView) {
+	assert(textView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(textView, DWidgetTypeTextView);
+
+	return data->d.textView.gapStart;
+}
+
+void dTextViewSetText(DWidget *textView, const char *text) {
+	assert(textView!=NULL);
+	assert(text!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(textView, DWidgetTypeTextView);
+
+	// Count lines
+	size_t len=strlen(text);
+	size_t newlineCount=0;
+	for(const char *c=memchr(text, '\n', len); c!=NULL; c=memchr(c+1, '\n', len-(c+1-text)))
+		++newlineCount;
+
+	// Place all text after the gap, so that the cursor is at the start
+	data->d.textView.textAlloc=len+dTextViewGapMin;
+	data->d.textView.text=dReallocNoFail(data->d.textView.text, data->d.textView.textAlloc);
+	data->d.textView.gapStart=0;
+	data->d.textView.gapEnd=dTextViewGapMin;
+	memcpy(data->d.textView.text+data->d.textView.gapEnd, text, len);
+
+	// Similarly all lines but the first go after the line gap (stored as offsets from the end of the text)
+	data->d.textView.lineAlloc=newlineCount+16;
+	data->d.textView.lineStarts=dReallocNoFail(data->d.textView.lineStarts, sizeof(size_t)*data->d.textView.lineAlloc);
+	data->d.textView.lineStarts[0]=0;
+	data->d.textView.lineGapStart=1;
+	data->d.textView.lineGapEnd=data->d.textView.lineAlloc-newlineCount;
+	size_t line=data->d.textView.lineGapEnd;
+	for(size_t i=0; i<len; ++i)
+		if (text[i]=='\n')
+			data->d.textView.lineStarts[line++]=len-(i+1);
+
+	// Reset view
+	data->d.textView.scrollLine=0;
+	data->d.textView.desiredColumn=SIZE_MAX;
+	data->d.textView.caretX=-1;
+	dTextViewLineCacheClear(data);
+
+	dTextViewDamageLines(textView, 0, SIZE_MAX);
+	dTextViewCaretReset(textView);
+}
+
+void dTextViewInsert(DWidget *textView, const char *text) {
+	assert(textView!=NULL);
+	assert(text!=NULL);
+
+	dTextViewInsertBytes(textView, text, strlen(text));
+}
+
+void dTextViewSetCursor(DWidget *textView, size_t offset) {
+	assert(textView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(textView, DWidgetTypeTextView);
+
+	// Clamp to length, and ensure we are not in the middle of a UTF-8 sequence
+	size_t len=dTextViewGetLengthData(data);
+	if (offset>len)
+		offset=len;
+	while(offset>0 && offset<len && (dTextViewGetChar(data, offset)&0xC0)==0x80)
+		--offset;
+
+	dTextViewMoveCursor(textView, offset, false);
+}
+
+void dTextViewVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Stop blinking
+	if (data->d.textView.blinkTimer!=0)
+		dTimerCancel(data->d.textView.blinkTimer);
+
+	// Free memory
+	dTextViewLineCacheClear(data);
+	dFree(data->d.textView.lineCache);
+	dFree(data->d.textView.lineScratch);
+	dFree(data->d.textView.lineStarts);
+	dFree(data->d.textView.text);
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dTextViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	// Restrict drawing to the text area (and to any existing clip rect)
+	SDL_Rect viewRect={
+	    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
+	    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
+	    .w=data->d.textView.viewportWidth,
+	    .h=data->d.textView.viewportHeight,
+	};
+
+	SDL_Rect oldClip;
+	bool oldClipped=SDL_RenderIsClipEnabled(renderer);
+	if (oldClipped)
+		SDL_RenderGetClipRect(renderer, &oldClip);
+
+	SDL_Rect clip=viewRect;
+	if (oldClipped && !SDL_IntersectRect(&oldClip, &viewRect, &clip))
+		return;
+	SDL_RenderSetClipRect(renderer, &clip);
+
+	// Draw background
+	dSetRenderDrawColour(renderer, &dTextViewBackgroundColour);
+	SDL_RenderFillRect(renderer, &clip);
+
+	// Draw only lines which overlap the clip rect, using cached textures where possible
+	int lineHeight=dTextViewGetLineHeight();
+	size_t lineCount=dTextViewGetLineCountData(data);
+	size_t firstLine=data->d.textView.scrollLine+(clip.y-viewRect.y)/lineHeight;
+	size_t lastLine=data->d.textView.scrollLine+(clip.y+clip.h-1-viewRect.y)/lineHeight;
+	for(size_t line=firstLine; line<=lastLine && line<lineCount; ++line) {
+		DTextViewLineCacheEntry *entry=dTextViewLineCacheGet(widget, renderer, line);
+		if (entry==NULL || entry->texture==NULL)
+			continue;
+
+		SDL_Rect destRect={
+		    .x=viewRect.x,
+		    .y=viewRect.y+(int)(line-data->d.textView.scrollLine)*lineHeight,
+		    .w=entry->width,
+		    .h=entry->height,
+		};
+		SDL_RenderCopy(renderer, entry->texture, NULL, &destRect);
+	}
+
+	// Draw caret
+	size_t cursorLine=dTextViewGetCursorLine(data);
+	if (data->d.textView.blinkTimer!=0 && data->d.textView.caretVisible && cursorLine>=firstLine && cursorLine<=lastLine) {
+		SDL_Rect caretRect={
+		    .x=viewRect.x+dTextViewGetCaretX(widget),
+		    .y=viewRect.y+(int)(cursorLine-data->d.textView.scrollLine)*lineHeight,
+		    .w=dTextViewCaretWidth,
+		    .h=lineHeight,
+		};
+		dSetRenderDrawColour(renderer, &dTextViewCaretColour);
+		SDL_RenderFillRect(renderer, &caretRect);
+	}
+
+	// Restore clip rect
+	SDL_RenderSetClipRect(renderer, (oldClipped ? &oldClip : NULL));
+}
+
+int dTextViewVTableGetMinWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	return dWidgetGetWidth(widget);
+}
+
+int dTextViewVTableGetMinHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	return dWidgetGetHeight(widget);
+}
+
+int dTextViewVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	return data->d.textView.viewportWidth+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dTextViewVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	return data->d.textView.viewportHeight+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+DWidgetSignalReturn dTextViewHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Only interested in left clicks
+	if (event->d.widgetButtonPress.button!=DWidgetMouseButtonLeft)
+		return DWidgetSignalReturnContinue;
+
+	dWidgetGrabKeyboardFocus(widget);
+
+	// Find line clicked on
+	int x=event->d.widgetButtonPress.x-dWidgetGetGlobalX(widget)-dWidgetGetPaddingLeft(widget);
+	int y=event->d.widgetButtonPress.y-dWidgetGetGlobalY(widget)-dWidgetGetPaddingTop(widget);
+	size_t line=data->d.textView.scrollLine+(y>0 ? (size_t)(y/dTextViewGetLineHeight()) : 0);
+	size_t lineCount=dTextViewGetLineCountData(data);
+	if (line>=lineCount)
+		line=lineCount-1;
+
+	// Find character clicked on, by measuring how many fit before the click position
+	size_t offset=dTextViewGetLineStart(data, line);
+	TTF_Font *font=dFontGet();
+	if (font!=NULL && x>0) {
+		const char *lineText=dTextViewCopyLine(data, line);
+		int extent, count;
+		if (TTF_MeasureUTF8(font, lineText, x, &extent, &count)==0) {
+			// Count is in characters, so convert to bytes
+			const char *c=lineText;
+			for(int i=0; i<count && *c!='\0'; ++i)
+				do ++c; while((*c&0xC0)==0x80);
+			offset+=c-lineText;
+		}
+	}
+
+	dTextViewMoveCursor(widget, offset, false);
+
+	return DWidgetSignalReturnStop;
+}
+
+DWidgetSignalReturn dTextViewHandlerWidgetKeyDown(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	bool ctrl=((event->d.widgetKeyDown.mod&KMOD_CTRL)!=0);
+	size_t cursor=data->d.textView.gapStart;
+	size_t cursorLine=dTextViewGetCursorLine(data);
+	size_t lineCount=dTextViewGetLineCountData(data);
+
+	switch(event->d.widgetKeyDown.key) {
+		case SDLK_LEFT:
+			dTextViewMoveCursor(widget, dTextViewPrevCharOffset(data, cursor), false);
+		break;
+		case SDLK_RIGHT:
+			dTextViewMoveCursor(widget, dTextViewNextCharOffset(data, cursor), false);
+		break;
+		case SDLK_UP:
+		case SDLK_DOWN:
+		case SDLK_PAGEUP:
+		case SDLK_PAGEDOWN: {
+			// Find target line
+			size_t distance=1;
+			if (event->d.widgetKeyDown.key==SDLK_PAGEUP || event->d.widgetKeyDown.key==SDLK_PAGEDOWN) {
+				int fullRows=data->d.textView.viewportHeight/dTextViewGetLineHeight();
+				distance=(fullRows>1 ? (size_t)fullRows : 1);
+			}
+
+			size_t line;
+			if (event->d.widgetKeyDown.key==SDLK_UP || event->d.widgetKeyDown.key==SDLK_PAGEUP)
+				line=(cursorLine>distance ? cursorLine-distance : 0);
+			else
+				line=(lineCount-1-cursorLine>distance ? cursorLine+distance : lineCount-1);
+
+			// Aim for the same column as when vertical movement started
+			if (data->d.textView.desiredColumn==SIZE_MAX)
+				data->d.textView.desiredColumn=cursor-dTextViewGetLineStart(data, cursorLine);
+
+			size_t lineStart=dTextViewGetLineStart(data, line);
+			size_t lineEnd=dTextViewGetLineEnd(data, line);
+			size_t offset=(lineEnd-lineStart>data->d.textView.desiredColumn ? lineStart+data->d.textView.desiredColumn : lineEnd);
+			while(offset>lineStart && offset<lineEnd && (dTextViewGetChar(data, offset)&0xC0)==0x80)
+				--offset;
+
+			dTextViewMoveCursor(widget, offset, true);
+		} break;
+		case SDLK_HOME:
+			dTextViewMoveCursor(widget, (ctrl ? 0 : dTextViewGetLineStart(data, cursorLine)), false);
+		break;
+		case SDLK_END:
+			dTextViewMoveCursor(widget, (ctrl ? dTextViewGetLengthData(data) : dTextViewGetLineEnd(data, cursorLine)), false);
+		break;
+		case SDLK_BACKSPACE:
+			dTextViewDeleteBackward(widget, cursor-dTextViewPrevCharOffset(data, cursor));
+		break;
+		case SDLK_DELETE:
+			dTextViewDeleteForward(widget, dTextViewNextCharOffset(data, cursor)-cursor);
+		break;
+		case SDLK_RETURN:
+		case SDLK_KP_ENTER:
+			dTextViewInsertBytes(widget, "\n", 1);
+		break;
+		default:
+			// Not a key we use - let parents have a go
+			return DWidgetSignalReturnContinue;
+		break;
+	}
+
+	return DWidgetSignalReturnStop;
+}
+
+DWidgetSignalReturn dTextViewHandlerWidgetTextInput(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	dTextViewInsert(event->widget, event->d.widgetTextInput.text);
+
+	return DWidgetSignalReturnStop;
+}
+
+DWidgetSignalReturn dTextViewHandlerWidgetFocusIn(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	// Start blinking caret
+	dTextViewCaretReset(event->widget);
+
+	return DWidgetSignalReturnContinue;
+}
+
+DWidgetSignalReturn dTextViewHandlerWidgetFocusOut(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(event->widget, DWidgetTypeTextView);
+
+	// Stop blinking and hide caret
+	if (data->d.textView.blinkTimer!=0) {
+		dTimerCancel(data->d.textView.blinkTimer);
+		data->d.textView.blinkTimer=0;
+	}
+	data->d.textView.caretVisible=false;
+	dTextViewDamageCaret(event->widget);
+
+	return DWidgetSignalReturnContinue;
+}
+
+void dTextViewBlinkCallback(DTimerId id, void *userData) {
+	assert(userData!=NULL);
+
+	DWidget *widget=userData;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Toggle caret, redrawing only the area it covers
+	data->d.textView.caretVisible=!data->d.textView.caretVisible;
+	dTextViewDamageCaret(widget);
+}
+
+size_t dTextViewGetLengthData(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	return data->d.textView.textAlloc-(data->d.textView.gapEnd-data->d.textView.gapStart);
+}
+
+char dTextViewGetChar(const DWidgetObjectData *data, size_t offset) {
+	assert(data!=NULL);
+	assert(offset<dTextViewGetLengthData(data));
+
+	if (offset<data->d.textView.gapStart)
+		return data->d.textView.text[offset];
+	return data->d.textView.text[offset+(data->d.textView.gapEnd-data->d.textView.gapStart)];
+}
+
+size_t dTextViewGetLineCountData(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	return data->d.textView.lineGapStart+(data->d.textView.lineAlloc-data->d.textView.lineGapEnd);
+}
+
+size_t dTextViewGetLineStart(const DWidgetObjectData *data, size_t line) {
+	assert(data!=NULL);
+	assert(line<dTextViewGetLineCountData(data));
+
+	if (line<data->d.textView.lineGapStart)
+		return data->d.textView.lineStarts[line];
+	return dTextViewGetLengthData(data)-data->d.textView.lineStarts[line+(data->d.textView.lineGapEnd-data->d.textView.lineGapStart)];
+}
+
+size_t dTextViewGetLineEnd(const DWidgetObjectData *data, size_t line) {
+	assert(data!=NULL);
+	assert(line<dTextViewGetLineCountData(data));
+
+	if (line+1<dTextViewGetLineCountData(data))
+		return dTextViewGetLineStart(data, line+1)-1;
+	return dTextViewGetLengthData(data);
+}
+
+size_t dTextViewGetCursorLine(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	return data->d.textView.lineGapStart-1;
+}
+
+void dTextViewMoveGap(DWidgetObjectData *data, size_t offset) {
+	assert(data!=NULL);
+	assert(offset<=dTextViewGetLengthData(data));
+
+	char *text=data->d.textView.text;
+
+	// Move text gap by shifting the bytes in between across it
+	if (offset<data->d.textView.gapStart) {
+		size_t count=data->d.textView.gapStart-offset;
+		memmove(text+data->d.textView.gapEnd-count, text+offset, count);
+		data->d.textView.gapStart-=count;
+		data->d.textView.gapEnd-=count;
+	} else if (offset>data->d.textView.gapStart) {
+		size_t count=offset-data->d.textView.gapStart;
+		memmove(text+data->d.textView.gapStart, text+data->d.textView.gapEnd, count);
+		data->d.textView.gapStart+=count;
+		data->d.textView.gapEnd+=count;
+	}
+
+	// Move line gap so that it directly follows the line containing the cursor, converting offsets between the two representations as they cross
+	size_t len=dTextViewGetLengthData(data);
+	size_t *lineStarts=data->d.textView.lineStarts;
+	while(data->d.textView.lineGapStart>1 && lineStarts[data->d.textView.lineGapStart-1]>offset) {
+		--data->d.textView.lineGapStart;
+		--data->d.textView.lineGapEnd;
+		lineStarts[data->d.textView.lineGapEnd]=len-lineStarts[data->d.textView.lineGapStart];
+	}
+	while(data->d.textView.lineGapEnd<data->d.textView.lineAlloc && len-lineStarts[data->d.textView.lineGapEnd]<=offset) {
+		lineStarts[data->d.textView.lineGapStart]=len-lineStarts[data->d.textView.lineGapEnd];
+		++data->d.textView.lineGapStart;
+		++data->d.textView.lineGapEnd;
+	}
+}
+
+void dTextViewReserveGap(DWidgetObjectData *data, size_t size) {
+	assert(data!=NULL);
+
+	// Already big enough?
+	if (data->d.textView.gapEnd-data->d.textView.gapStart>=size)
+		return;
+
+	// Grow buffer geometrically, moving text after the gap to the new end
+	size_t afterGap=data->d.textView.textAlloc-data->d.textView.gapEnd;
+	size_t newAlloc=2*data->d.textView.textAlloc;
+	if (newAlloc<data->d.textView.textAlloc+size+dTextViewGapMin)
+		newAlloc=data->d.textView.textAlloc+size+dTextViewGapMin;
+
+	data->d.textView.text=dReallocNoFail(data->d.textView.text, newAlloc);
+	memmove(data->d.textView.text+newAlloc-afterGap, data->d.textView.text+data->d.textView.gapEnd, afterGap);
+	data->d.textView.gapEnd=newAlloc-afterGap;
+	data->d.textView.textAlloc=newAlloc;
+}
+
+void dTextViewReserveLineGap(DWidgetObjectData *data, size_t count) {
+	assert(data!=NULL);
+
+	// Already big enough?
+	if (data->d.textView.lineGapEnd-data->d.textView.lineGapStart>=count)
+		return;
+
+	// Grow array geometrically, moving entries after the gap to the new end
+	size_t afterGap=data->d.textView.lineAlloc-data->d.textView.lineGapEnd;
+	size_t newAlloc=2*data->d.textView.lineAlloc;
+	if (newAlloc<data->d.textView.lineAlloc+count)
+		newAlloc=data->d.textView.lineAlloc+count;
+
+	data->d.textView.lineStarts=dReallocNoFail(data->d.textView.lineStarts, sizeof(size_t)*newAlloc);
+	memmove(data->d.textView.lineStarts+newAlloc-afterGap, data->d.textView.lineStarts+data->d.textView.lineGapEnd, sizeof(size_t)*afterGap);
+	data->d.textView.lineGapEnd=newAlloc-afterGap;
+	data->d.textView.lineAlloc=newAlloc;
+}
+
+const char *dTextViewCopyLine(DWidgetObjectData *data, size_t line) {
+	assert(data!=NULL);
+
+	size_t start=dTextViewGetLineStart(data, line);
+	size_t end=dTextViewGetLineEnd(data, line);
+	size_t len=end-start;
+
+	if (len+1>data->d.textView.lineScratchAlloc) {
+		data->d.textView.lineScratchAlloc=2*(len+1);
+		data->d.textView.lineScratch=dReallocNoFail(data->d.textView.lineScratch, data->d.textView.lineScratchAlloc);
+	}
+
+	// Copy parts before and after the gap (either of which may be empty)
+	const char *text=data->d.textView.text;
+	size_t gapStart=data->d.textView.gapStart, gapSize=data->d.textView.gapEnd-data->d.textView.gapStart;
+	size_t beforeCount=(start<gapStart ? (end<gapStart ? end : gapStart)-start : 0);
+	memcpy(data->d.textView.lineScratch, text+start, beforeCount);
+	memcpy(data->d.textView.lineScratch+beforeCount, text+start+beforeCount+gapSize, len-beforeCount);
+	data->d.textView.lineScratch[len]='\0';
+
+	return data->d.textView.lineScratch;
+}
+
+size_t dTextViewPrevCharOffset(const DWidgetObjectData *data, size_t offset) {
+	assert(data!=NULL);
+
+	if (offset==0)
+		return 0;
+
+	// Skip back over continuation bytes
+	do
+		--offset;
+	while(offset>0 && (dTextViewGetChar(data, offset)&0xC0)==0x80);
+
+	return offset;
+}
+
+size_t dTextViewNextCharOffset(const DWidgetObjectData *data, size_t offset) {
+	assert(data!=NULL);
+
+	size_t len=dTextViewGetLengthData(data);
+	if (offset>=len)
+		return len;
+
+	// Skip forward over continuation bytes
+	do
+		++offset;
+	while(offset<len && (dTextViewGetChar(data, offset)&0xC0)==0x80);
+
+	return offset;
+}
+
+void dTextViewInsertBytes(DWidget *widget, const char *text, size_t len) {
+	assert(widget!=NULL);
+	assert(text!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	if (len==0)
+		return;
+
+	// Ensure enough space for text and any new lines
+	size_t newlineCount=0;
+	for(size_t i=0; i<len; ++i)
+		newlineCount+=(text[i]=='\n');
+	dTextViewReserveGap(data, len);
+	dTextViewReserveLineGap(data, newlineCount);
+
+	// Copy text into gap, adding line starts after each newline
+	// (lines after the gap are stored relative to the end of the text, and so need no adjustment)
+	size_t line=dTextViewGetCursorLine(data);
+	for(size_t i=0; i<len; ++i) {
+		data->d.textView.text[data->d.textView.gapStart++]=text[i];
+		if (text[i]=='\n')
+			data->d.textView.lineStarts[data->d.textView.lineGapStart++]=data->d.textView.gapStart;
+	}
+
+	dTextViewEdited(widget, line, 0, newlineCount);
+}
+
+void dTextViewDeleteBackward(DWidget *widget, size_t len) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+	assert(len<=data->d.textView.gapStart);
+
+	if (len==0)
+		return;
+
+	// Grow gap backwards, removing the start of the cursor's line whenever we delete the newline before it
+	size_t removedLines=0;
+	for(size_t i=0; i<len; ++i) {
+		if (data->d.textView.text[--data->d.textView.gapStart]=='\n') {
+			--data->d.textView.lineGapStart;
+			++removedLines;
+		}
+	}
+
+	dTextViewEdited(widget, dTextViewGetCursorLine(data), removedLines, 0);
+}
+
+void dTextViewDeleteForward(DWidget *widget, size_t len) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+	assert(len<=data->d.textView.textAlloc-data->d.textView.gapEnd);
+
+	if (len==0)
+		return;
+
+	// Grow gap forwards, removing the start of the following line whenever we delete the newline before it
+	size_t removedLines=0;
+	for(size_t i=0; i<len; ++i) {
+		if (data->d.textView.text[data->d.textView.gapEnd++]=='\n') {
+			++data->d.textView.lineGapEnd;
+			++removedLines;
+		}
+	}
+
+	dTextViewEdited(widget, dTextViewGetCursorLine(data), removedLines, 0);
+}
+
+void dTextViewMoveCursor(DWidget *widget, size_t offset, bool keepColumn) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	if (!keepColumn)
+		data->d.textView.desiredColumn=SIZE_MAX;
+
+	// No change?
+	if (offset==data->d.textView.gapStart)
+		return;
+
+	// Erase caret at old position, move, and then draw at new position
+	dTextViewDamageCaret(widget);
+	dTextViewMoveGap(data, offset);
+	data->d.textView.caretX=-1;
+
+	if (dTextViewScrollToCursor(widget))
+		dTextViewDamageLines(widget, data->d.textView.scrollLine, SIZE_MAX);
+	else
+		dTextViewDamageCaret(widget);
+
+	dTextViewCaretReset(widget);
+}
+
+void dTextViewEdited(DWidget *widget, size_t line, size_t removedLines, size_t addedLines) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	data->d.textView.desiredColumn=SIZE_MAX;
+	data->d.textView.caretX=-1;
+
+	// Only the edited line needs re-rendering, although later lines may have moved
+	dTextViewLineCacheEdit(data, line, removedLines, addedLines);
+
+	// Redraw edited line only, unless lines were added or removed in which case everything below it has also moved
+	if (dTextViewScrollToCursor(widget))
+		dTextViewDamageLines(widget, data->d.textView.scrollLine, SIZE_MAX);
+	else
+		dTextViewDamageLines(widget, line, (removedLines==0 && addedLines==0 ? line : SIZE_MAX));
+
+	dTextViewCaretReset(widget);
+}
+
+int dTextViewGetLineHeight(void) {
+	TTF_Font *font=dFontGet();
+	int lineHeight=(font!=NULL ? TTF_FontLineSkip(font) : dFontSize);
+	return (lineHeight>0 ? lineHeight : 1);
+}
+
+size_t dTextViewGetVisibleRows(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	int lineHeight=dTextViewGetLineHeight();
+	return (data->d.textView.viewportHeight+lineHeight-1)/lineHeight;
+}
+
+int dTextViewGetCaretX(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Cached?
+	if (data->d.textView.caretX>=0)
+		return data->d.textView.caretX;
+
+	// Measure text between start of line and cursor
+	int width=0;
+	size_t lineStart=dTextViewGetLineStart(data, dTextViewGetCursorLine(data));
+	TTF_Font *font=dFontGet();
+	if (font!=NULL && data->d.textView.gapStart>lineStart) {
+		const char *lineText=dTextViewCopyLine(data, dTextViewGetCursorLine(data));
+		data->d.textView.lineScratch[data->d.textView.gapStart-lineStart]='\0';
+		if (TTF_SizeUTF8(font, lineText, &width, NULL)!=0)
+			width=0;
+	}
+
+	data->d.textView.caretX=width;
+	return width;
+}
+
+bool dTextViewScrollToCursor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Keep cursor's line entirely within the viewport (where possible)
+	size_t cursorLine=dTextViewGetCursorLine(data);
+	int fullRows=data->d.textView.viewportHeight/dTextViewGetLineHeight();
+	size_t rows=(fullRows>1 ? (size_t)fullRows : 1);
+
+	size_t scrollLine=data->d.textView.scrollLine;
+	if (cursorLine<scrollLine)
+		scrollLine=cursorLine;
+	else if (cursorLine>=scrollLine+rows)
+		scrollLine=cursorLine-rows+1;
+
+	if (scrollLine==data->d.textView.scrollLine)
+		return false;
+
+	data->d.textView.scrollLine=scrollLine;
+	return true;
+}
+
+void dTextViewCaretReset(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Not focused?
+	if (!dWidgetHasKeyboardFocus(widget))
+		return;
+
+	// Show caret and restart blinking, so that it stays solid while typing or moving
+	if (data->d.textView.blinkTimer!=0)
+		dTimerCancel(data->d.textView.blinkTimer);
+	data->d.textView.blinkTimer=dTimerAddRepeating(dTextViewBlinkInterval, &dTextViewBlinkCallback, widget);
+
+	if (!data->d.textView.caretVisible) {
+		data->d.textView.caretVisible=true;
+		dTextViewDamageCaret(widget);
+	}
+}
+
+void dTextViewDamageLines(DWidget *widget, size_t first, size_t last) {
+	assert(widget!=NULL);
+	assert(first<=last);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Clamp to visible rows
+	size_t scrollLine=data->d.textView.scrollLine;
+	size_t rows=dTextViewGetVisibleRows(data);
+	if (last<scrollLine || first>=scrollLine+rows)
+		return;
+	if (first<scrollLine)
+		first=scrollLine;
+	if (last>=scrollLine+rows)
+		last=scrollLine+rows-1;
+
+	int lineHeight=dTextViewGetLineHeight();
+	SDL_Rect rect={
+	    .x=dWidgetGetPaddingLeft(widget),
+	    .y=dWidgetGetPaddingTop(widget)+(int)(first-scrollLine)*lineHeight,
+	    .w=data->d.textView.viewportWidth,
+	    .h=(int)(last-first+1)*lineHeight,
+	};
+
+	// Don't spill into bottom padding
+	int bottom=dWidgetGetPaddingTop(widget)+data->d.textView.viewportHeight;
+	if (rect.y+rect.h>bottom)
+		rect.h=bottom-rect.y;
+
+	dWidgetSetDirtyRect(widget, &rect);
+}
+
+void dTextViewDamageCaret(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Caret not visible in viewport?
+	size_t cursorLine=dTextViewGetCursorLine(data);
+	if (cursorLine<data->d.textView.scrollLine || cursorLine>=data->d.textView.scrollLine+dTextViewGetVisibleRows(data))
+		return;
+
+	int lineHeight=dTextViewGetLineHeight();
+	SDL_Rect rect={
+	    .x=dWidgetGetPaddingLeft(widget)+dTextViewGetCaretX(widget),
+	    .y=dWidgetGetPaddingTop(widget)+(int)(cursorLine-data->d.textView.scrollLine)*lineHeight,
+	    .w=dTextViewCaretWidth,
+	    .h=lineHeight,
+	};
+	dWidgetSetDirtyRect(widget, &rect);
+}
+
+DTextViewLineCacheEntry *dTextViewLineCacheGet(DWidget *widget, SDL_Renderer *renderer, size_t line) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTextView);
+
+	// Ensure cache can hold all visible lines plus one
+	size_t rows=dTextViewGetVisibleRows(data);
+	if (data->d.textView.lineCacheCount<rows+1) {
+		data->d.textView.lineCache=dReallocTaggedNoFail(data->d.textView.lineCache, sizeof(DTextViewLineCacheEntry)*(rows+1), dWidgetGetBaseType(widget));
+		for(size_t i=data->d.textView.lineCacheCount; i<rows+1; ++i) {
+			data->d.textView.lineCache[i].line=SIZE_MAX;
+			data->d.textView.lineCache[i].texture=NULL;
+		}
+		data->d.textView.lineCacheCount=rows+1;
+	}
+
+	// Search for existing entry, noting one which can be reused if not found
+	// (any entry not for a visible line - there must be at least one as there are more entries than rows)
+	DTextViewLineCacheEntry *freeEntry=NULL;
+	for(size_t i=0; i<data->d.textView.lineCacheCount; ++i) {
+		DTextViewLineCacheEntry *entry=&data->d.textView.lineCache[i];
+		if (entry->line==line)
+			return entry;
+		if (freeEntry==NULL && (entry->line==SIZE_MAX || entry->line<data->d.textView.scrollLine || entry->line>=data->d.textView.scrollLine+rows))
+			freeEntry=entry;
+	}
+	assert(freeEntry!=NULL);
+
+	dTextViewLineCacheEntryClear(freeEntry);
+
+	// Empty lines need no texture
+	const char *lineText=dTextViewCopyLine(data, line);
+	if (lineText[0]=='\0') {
+		freeEntry->line=line;
+		return freeEntry;
+	}
+
+	// Render line
+	TTF_Font *font=dFontGet();
+	if (font==NULL) {
+		dWarning("warning: could not generate line texture for widget %p (%s) - could not open font at '%s'\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)), dFontPath);
+		return NULL;
+	}
+
+	SDL_Surface *surface=TTF_RenderUTF8_Blended(font, lineText, dTextViewTextColour);
+	if (surface==NULL) {
+		dWarning("warning: could not generate line texture for widget %p (%s) - could not render to surface\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+		return NULL;
+	}
+
+	freeEntry->texture=dCreateTextureFromSurface(renderer, surface);
+	SDL_FreeSurface(surface);
+	if (freeEntry->texture==NULL) {
+		dWarning("warning: could not generate line texture for widget %p (%s) - could not create texture\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+		return NULL;
+	}
+	SDL_QueryTexture(freeEntry->texture, NULL, NULL, &freeEntry->width, &freeEntry->height);
+	freeEntry->line=line;
+
+	return freeEntry;
+}
+
+void dTextViewLineCacheEdit(DWidgetObjectData *data, size_t line, size_t removedLines, size_t addedLines) {
+	assert(data!=NULL);
+
+	// Invalidate edited (and removed) lines, and renumber lines after them
+	for(size_t i=0; i<data->d.textView.lineCacheCount; ++i) {
+		DTextViewLineCacheEntry *entry=&data->d.textView.lineCache[i];
+		if (entry->line==SIZE_MAX || entry->line<line)
+			continue;
+
+		if (entry->line<=line+removedLines)
+			dTextViewLineCacheEntryClear(entry);
+		else
+			entry->line=entry->line-removedLines+addedLines;
+	}
+}
+
+void dTextViewLineCacheClear(DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	for(size_t i=0; i<data->d.textView.lineCacheCount; ++i)
+		dTextViewLineCacheEntryClear(&data->d.textView.lineCache[i]);
+}
+
+void dTextViewLineCacheEntryClear(DTextViewLineCacheEntry *entry) {
+	assert(entry!=NULL);
+
+	if (entry->texture!=NULL) {
+		dDestroyTexture(entry->texture);
+		entry->texture=NULL;
+	}
+	entry->line=SIZE_MAX;
+}
@@ -0,0 +1,23 @@
+#ifndef TEXTVIEW_H
+#define TEXTVIEW_H
+
+#include <stddef.h>
+
+#include "widget.h"
+
+// A multi-line editable text area. Text is UTF-8, with lines separated by '\n'.
+// The widget has a fixed size, scrolling internally to keep the cursor visible.
+// Clicking on it grabs keyboard focus, after which it accepts typing and the usual cursor keys.
+
+DWidget *dTextViewNew(int width, int height); // size of the visible text area in pixels (excluding padding)
+
+char *dTextViewGetText(const DWidget *textView); // returns a newly allocated copy, which the caller must free with dFree
+size_t dTextViewGetLength(const DWidget *textView); // in bytes
+size_t dTextViewGetLineCount(const DWidget *textView);
+size_t dTextViewGetCursor(const DWidget *textView); // byte offset
+
+void dTextViewSetText(DWidget *textView, const char *text); // also moves cursor to the start
+void dTextViewInsert(DWidget *textView, const char *text); // inserts at the cursor, leaving the cursor after the new text
+void dTextViewSetCursor(DWidget *textView, size_t offset); // offset is clamped to the length of the text
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef TEXTVIEWPRIVATE_H
+#define TEXTVIEWPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dTextViewConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height);
+
+#endif
@@ -0,0 +1,274 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "timer.h"
+#include "timerprivate.h"
+#include "util.h"
+
+// Each timer lives in a slot, with slots reused via a free list.
+// Pending timers are kept in a binary min-heap of slot indices, ordered by deadline (and then by creation order so equal deadlines fire FIFO).
+// Ids encode the slot index in the low 32 bits and the slot's generation in the high 32 bits, so stale ids are detected in O(1).
+typedef struct {
+	DTimeMs deadline;
+	DTimeMs interval; // 0 for one-shot timers
+	uint64_t sequence;
+	DTimerCallback *callback;
+	void *userData;
+	uint32_t generation; // incremented each time the slot is freed
+	uint32_t heapIndex; // index into dTimerHeap, or dTimerSlotFree if slot is not in use
+	uint32_t nextFree;
+} DTimerSlot;
+
+const uint32_t dTimerSlotFree=UINT32_MAX; // heapIndex value for unused slots
+const uint32_t dTimerSlotNone=UINT32_MAX; // end of free list
+
+DTimerSlot *dTimerSlots=NULL;
+uint32_t dTimerSlotCount=0;
+uint32_t dTimerSlotAlloc=0;
+uint32_t dTimerSlotFreeHead=UINT32_MAX;
+
+uint32_t *dTimerHeap=NULL; // slot indices
+uint32_t dTimerHeapCount=0;
+uint32_t dTimerHeapAlloc=0;
+
+uint64_t dTimerSequence=0;
+
+DTimerId dTimerAddInternal(DTimeMs delay, DTimeMs interval, DTimerCallback *callback, void *userData);
+
+DTimerSlot *dTimerGetSlot(DTimerId id); // returns NULL if id does not refer to a pending timer
+uint32_t dTimerSlotAllocate(void);
+void dTimerSlotRelease(uint32_t slot);
+
+bool dTimerHeapLess(uint32_t a, uint32_t b); // compares two heap positions
+void dTimerHeapSet(uint32_t index, uint32_t slot);
+void dTimerHeapPush(uint32_t slot);
+void dTimerHeapRemove(uint32_t index);
+void dTimerHeapSiftUp(uint32_t index);
+void dTimerHeapSiftDown(uint32_t index);
+
+DTimerId dTimerAdd(DTimeMs delay, DTimerCallback *callback, void *userData) {
+	assert(callback!=NULL);
+
+	return dTimerAddInternal(delay, 0, callback, userData);
+}
+
+DTimerId dTimerAddRepeating(DTimeMs interval, DTimerCallback *callback, void *userData) {
+	assert(interval>0);
+	assert(callback!=NULL);
+
+	return dTimerAddInternal(interval, interval, callback, userData);
+}
+
+bool dTimerCancel(DTimerId id) {
+	DTimerSlot *timer=dTimerGetSlot(id);
+	if (timer==NULL)
+		return false;
+
+	// Remove from heap and free slot
+	dTimerHeapRemove(timer->heapIndex);
+	dTimerSlotRelease((uint32_t)id);
+
+	return true;
+}
+
+bool dTimerIsPending(DTimerId id) {
+	return (dTimerGetSlot(id)!=NULL);
+}
+
+bool dTimerGetNextDeadline(DTimeMs *deadline) {
+	assert(deadline!=NULL);
+
+	if (dTimerHeapCount==0)
+		return false;
+
+	*deadline=dTimerSlots[dTimerHeap[0]].deadline;
+	return true;
+}
+
+void dTimerDispatch(DTimeMs now) {
+	// Fire timers in deadline order until the earliest remaining one is in the future
+	// Note: repeating timers are always rescheduled after now, so this terminates even if callbacks add more timers
+	while(dTimerHeapCount>0) {
+		uint32_t slot=dTimerHeap[0];
+		DTimerSlot *timer=&dTimerSlots[slot];
+		if (timer->deadline>now)
+			break;
+
+		DTimerId id=(((DTimerId)timer->generation)<<32) | slot;
+		DTimerCallback *callback=timer->callback;
+		void *userData=timer->userData;
+
+		// Reschedule or release before invoking callback, so that it is free to cancel or add timers
+		if (timer->interval>0) {
+			// Keep to the original schedule to avoid drift, unless we have fallen a whole interval behind (in which case skip missed firings)
+			timer->deadline+=timer->interval;
+			if (timer->deadline<=now)
+				timer->deadline=now+timer->interval;
+			timer->sequence=dTimerSequence++;
+			dTimerHeapSiftDown(0);
+		} else {
+			dTimerHeapRemove(0);
+			dTimerSlotRelease(slot);
+		}
+
+		callback(id, userData);
+	}
+}
+
+void dTimerQuit(void) {
+	dFree(dTimerSlots);
+	dTimerSlots=NULL;
+	dTimerSlotCount=0;
+	dTimerSlotAlloc=0;
+	dTimerSlotFreeHead=dTimerSlotNone;
+
+	dFree(dTimerHeap);
+	dTimerHeap=NULL;
+	dTimerHeapCount=0;
+	dTimerHeapAlloc=0;
+}
+
+DTimerId dTimerAddInternal(DTimeMs delay, DTimeMs interval, DTimerCallback *callback, void *userData) {
+	assert(callback!=NULL);
+
+	// Fill in slot
+	uint32_t slot=dTimerSlotAllocate();
+	DTimerSlot *timer=&dTimerSlots[slot];
+	timer->deadline=dGetTimeMs()+delay;
+	timer->interval=interval;
+	timer->sequence=dTimerSequence++;
+	timer->callback=callback;
+	timer->userData=userData;
+
+	// Add to heap
+	dTimerHeapPush(slot);
+
+	return (((DTimerId)timer->generation)<<32) | slot;
+}
+
+DTimerSlot *dTimerGetSlot(DTimerId id) {
+	uint32_t slot=(uint32_t)id;
+	uint32_t generation=(uint32_t)(id>>32);
+
+	if (id==0 || slot>=dTimerSlotCount)
+		return NULL;
+
+	DTimerSlot *timer=&dTimerSlots[slot];
+	if (timer->generation!=generation || timer->heapIndex==dTimerSlotFree)
+		return NULL;
+
+	return timer;
+}
+
+uint32_t dTimerSlotAllocate(void) {
+	// Reuse a free slot if possible
+	if (dTimerSlotFreeHead!=dTimerSlotNone) {
+		uint32_t slot=dTimerSlotFreeHead;
+		dTimerSlotFreeHead=dTimerSlots[slot].nextFree;
+		return slot;
+	}
+
+	// Otherwise append a new one
+	if (dTimerSlotCount==dTimerSlotAlloc) {
+		if (dTimerSlotAlloc>=dTimerSlotNone/2)
+			dFatalError("error: too many timers\n");
+		dTimerSlotAlloc=(dTimerSlotAlloc>0 ? 2*dTimerSlotAlloc : 64);
+		dTimerSlots=dReallocNoFail(dTimerSlots, sizeof(DTimerSlot)*dTimerSlotAlloc);
+	}
+
+	uint32_t slot=dTimerSlotCount++;
+	// Start slot 0 at generation 1 so that no id is ever 0
+	dTimerSlots[slot].generation=(slot==0 ? 1 : 0);
+	dTimerSlots[slot].heapIndex=dTimerSlotFree;
+	return slot;
+}
+
+void dTimerSlotRelease(uint32_t slot) {
+	assert(slot<dTimerSlotCount);
+
+	DTimerSlot *timer=&dTimerSlots[slot];
+	timer->heapIndex=dTimerSlotFree;
+	timer->callback=NULL;
+	timer->userData=NULL;
+
+	// Bump generation so old ids become stale (skipping 0 for slot 0, see dTimerSlotAllocate)
+	++timer->generation;
+	if (slot==0 && timer->generation==0)
+		timer->generation=1;
+
+	timer->nextFree=dTimerSlotFreeHead;
+	dTimerSlotFreeHead=slot;
+}
+
+bool dTimerHeapLess(uint32_t a, uint32_t b) {
+	assert(a<dTimerHeapCount);
+	assert(b<dTimerHeapCount);
+
+	const DTimerSlot *timerA=&dTimerSlots[dTimerHeap[a]];
+	const DTimerSlot *timerB=&dTimerSlots[dTimerHeap[b]];
+
+	if (timerA->deadline!=timerB->deadline)
+		return (timerA->deadline<timerB->deadline);
+	return (timerA->sequence<timerB->sequence);
+}
+
+void dTimerHeapSet(uint32_t index, uint32_t slot) {
+	dTimerHeap[index]=slot;
+	dTimerSlots[slot].heapIndex=index;
+}
+
+void dTimerHeapPush(uint32_t slot) {
+	if (dTimerHeapCount==dTimerHeapAlloc) {
+		dTimerHeapAlloc=(dTimerHeapAlloc>0 ? 2*dTimerHeapAlloc : 64);
+		dTimerHeap=dReallocNoFail(dTimerHeap, sizeof(uint32_t)*dTimerHeapAlloc);
+	}
+
+	uint32_t index=dTimerHeapCount++;
+	dTimerHeapSet(index, slot);
+	dTimerHeapSiftUp(index);
+}
+
+void dTimerHeapRemove(uint32_t index) {
+	assert(index<dTimerHeapCount);
+
+	// Move last entry into the gap and restore heap order (it could need to move either way)
+	uint32_t last=--dTimerHeapCount;
+	if (index==last)
+		return;
+
+	dTimerHeapSet(index, dTimerHeap[last]);
+	if (index>0 && dTimerHeapLess(index, (index-1)/2))
+		dTimerHeapSiftUp(index);
+	else
+		dTimerHeapSiftDown(index);
+}
+
+void dTimerHeapSiftUp(uint32_t index) {
+	while(index>0) {
+		uint32_t parent=(index-1)/2;
+		if (!dTimerHeapLess(index, parent))
+			break;
+
+		uint32_t slot=dTimerHeap[index];
+		dTimerHeapSet(index, dTimerHeap[parent]);
+		dTimerHeapSet(parent, slot);
+		index=parent;
+	}
+}
+
+void dTimerHeapSiftDown(uint32_t index) {
+	while(1) {
+		uint32_t left=2*index+1, right=left+1, smallest=index;
+		if (left<dTimerHeapCount && dTimerHeapLess(left, smallest))
+			smallest=left;
+		if (right<dTimerHeapCount && dTimerHeapLess(right, smallest))
+			smallest=right;
+		if (smallest==index)
+			break;
+
+		uint32_t slot=dTimerHeap[index];
+		dTimerHeapSet(index, dTimerHeap[smallest]);
+		dTimerHeapSet(smallest, slot);
+		index=smallest;
+	}
+}
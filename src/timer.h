@@ -0,0 +1,21 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util.h"
+
+// Timers are dispatched by digitsLoop on the UI thread, and so these functions should only be called from that thread.
+// Adding or cancelling a timer is O(log n) in the number of pending timers.
+
+typedef uint64_t DTimerId; // 0 is never a valid id, and ids are not reused
+
+typedef void (DTimerCallback)(DTimerId id, void *userData);
+
+DTimerId dTimerAdd(DTimeMs delay, DTimerCallback *callback, void *userData); // one-shot, fires once delay ms from now
+DTimerId dTimerAddRepeating(DTimeMs interval, DTimerCallback *callback, void *userData); // fires every interval ms (which must be non-zero) until cancelled
+bool dTimerCancel(DTimerId id); // returns false if the timer has already fired (one-shot only) or been cancelled. can be called from within the callback
+bool dTimerIsPending(DTimerId id);
+
+#endif
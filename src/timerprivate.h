@@ -0,0 +1,13 @@
+#ifndef TIMERPRIVATE_H
+#define TIMERPRIVATE_H
+
+#include <stdbool.h>
+
+#include "timer.h"
+
+bool dTimerGetNextDeadline(DTimeMs *deadline); // returns false if no timers are pending
+void dTimerDispatch(DTimeMs now); // invokes the callbacks of all timers due at or before the given time
+
+void dTimerQuit(void); // cancels all timers without invoking them (called by digitsQuit)
+
+#endif
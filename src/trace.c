@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "trace.h"
+#include "traceprivate.h"
+#include "util.h"
+
+#define DTraceDetailMax 48 // including terminating null
+
+typedef struct {
+	const char *name;
+	const char *category;
+	DTimeUs start;
+	DTimeUs duration;
+	char detail[DTraceDetailMax]; // empty string if none
+} DTraceSpan;
+
+const size_t dTraceBufferSize=65536; // max spans waiting to be written, must be a power of two
+const DTimeMs dTraceWriterIntervalMs=10; // writer thread sleeps for this long whenever it empties the buffer
+
+// Single producer (UI thread), single consumer (writer thread) ring buffer
+// head and tail count spans ever written and read, and so only ever increase
+DTraceSpan *dTraceBuffer=NULL;
+atomic_size_t dTraceHead;
+atomic_size_t dTraceTail;
+
+bool dTraceActive=false; // only accessed by the UI thread
+atomic_bool dTraceStopFlag;
+size_t dTraceDropped=0;
+size_t dTraceWritten=0; // only accessed by the writer thread (and by the UI thread once it has exited)
+FILE *dTraceFile=NULL;
+SDL_Thread *dTraceThread=NULL;
+
+int dTraceWriterMain(void *userData);
+void dTraceWriteAvailable(void);
+void dTraceWriteSpan(const DTraceSpan *span);
+void dTraceWriteString(const char *string); // writes string as a quoted JSON string
+
+bool dTraceStart(const char *path) {
+	assert(path!=NULL);
+
+	// Already tracing?
+	if (dTraceActive) {
+		dWarning("warning: could not start trace to '%s' - already tracing\n", path);
+		return false;
+	}
+
+	// Open file and write header
+	dTraceFile=fopen(path, "w");
+	if (dTraceFile==NULL) {
+		dWarning("warning: could not start trace - could not open '%s' for writing\n", path);
+		return false;
+	}
+	fprintf(dTraceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(dTraceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"digits UI\"}}");
+
+	// Setup buffer and start writer
+	dTraceBuffer=dMallocNoFail(sizeof(DTraceSpan)*dTraceBufferSize);
+	atomic_store(&dTraceHead, 0);
+	atomic_store(&dTraceTail, 0);
+	atomic_store(&dTraceStopFlag, false);
+	dTraceDropped=0;
+	dTraceWritten=0;
+
+	dTraceThread=SDL_CreateThread(&dTraceWriterMain, "digits trace", NULL);
+	if (dTraceThread==NULL) {
+		dWarning("warning: could not start trace - could not create writer thread: %s\n", SDL_GetError());
+		dFree(dTraceBuffer);
+		dTraceBuffer=NULL;
+		fclose(dTraceFile);
+		dTraceFile=NULL;
+		return false;
+	}
+
+	dTraceActive=true;
+
+	return true;
+}
+
+void dTraceStop(void) {
+	// Not even tracing?
+	if (!dTraceActive)
+		return;
+
+	dTraceActive=false;
+
+	// Ask writer to finish off any remaining spans and wait for it
+	atomic_store(&dTraceStopFlag, true);
+	SDL_WaitThread(dTraceThread, NULL);
+	dTraceThread=NULL;
+
+	// Write footer and close file
+	fprintf(dTraceFile, "\n]}\n");
+	if (fclose(dTraceFile)!=0)
+		dWarning("warning: error closing trace file\n");
+	dTraceFile=NULL;
+
+	if (dTraceDropped>0)
+		dWarning("warning: trace dropped %zu spans (of %zu) as the buffer was full\n", dTraceDropped, dTraceDropped+dTraceWritten);
+
+	dFree(dTraceBuffer);
+	dTraceBuffer=NULL;
+}
+
+bool dTraceIsActive(void) {
+	return dTraceActive;
+}
+
+DTimeUs dTraceBegin(void) {
+	if (!dTraceActive)
+		return 0;
+
+	return dGetTimeUs();
+}
+
+void dTraceEnd(DTimeUs start, const char *name, const char *category, const char *detail) {
+	assert(name!=NULL);
+	assert(category!=NULL);
+	// detail can be NULL
+
+	// Not tracing (or tracing started part way through span)?
+	if (!dTraceActive || start==0)
+		return;
+
+	DTimeUs end=dGetTimeUs();
+
+	// Buffer full?
+	size_t head=atomic_load_explicit(&dTraceHead, memory_order_relaxed);
+	size_t tail=atomic_load_explicit(&dTraceTail, memory_order_acquire);
+	if (head-tail==dTraceBufferSize) {
+		++dTraceDropped;
+		return;
+	}
+
+	// Fill in span and then publish it to the writer
+	DTraceSpan *span=&dTraceBuffer[head&(dTraceBufferSize-1)];
+	span->name=name;
+	span->category=category;
+	span->start=start;
+	span->duration=(end>start ? end-start : 0);
+	if (detail!=NULL) {
+		strncpy(span->detail, detail, DTraceDetailMax-1);
+		span->detail[DTraceDetailMax-1]='\0';
+
+		// If truncated then remove the last UTF-8 sequence, which may be incomplete
+		size_t len=strlen(span->detail);
+		if (len==DTraceDetailMax-1) {
+			while(len>0 && (span->detail[len-1]&0xC0)==0x80)
+				--len;
+			if (len>0 && (span->detail[len-1]&0x80))
+				--len;
+			span->detail[len]='\0';
+		}
+	} else
+		span->detail[0]='\0';
+
+	atomic_store_explicit(&dTraceHead, head+1, memory_order_release);
+}
+
+int dTraceWriterMain(void *userData) {
+	assert(userData==NULL);
+
+	while(1) {
+		// Check stop flag before writing, so everything pushed before it was set is written before exiting
+		bool stop=atomic_load(&dTraceStopFlag);
+
+		dTraceWriteAvailable();
+
+		if (stop)
+			break;
+
+		dDelayMs(dTraceWriterIntervalMs);
+	}
+
+	return 0;
+}
+
+void dTraceWriteAvailable(void) {
+	size_t tail=atomic_load_explicit(&dTraceTail, memory_order_relaxed);
+	size_t head=atomic_load_explicit(&dTraceHead, memory_order_acquire);
+
+	for(; tail!=head; ++tail)
+		dTraceWriteSpan(&dTraceBuffer[tail&(dTraceBufferSize-1)]);
+
+	// Release slots back to the UI thread
+	atomic_store_explicit(&dTraceTail, tail, memory_order_release);
+}
+
+void dTraceWriteSpan(const DTraceSpan *span) {
+	assert(span!=NULL);
+
+	// Complete ('X') event, so only one is needed per span
+	fprintf(dTraceFile, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,\"name\":", (unsigned long long)span->start, (unsigned long long)span->duration);
+	dTraceWriteString(span->name);
+	fprintf(dTraceFile, ",\"cat\":");
+	dTraceWriteString(span->category);
+	if (span->detail[0]!='\0') {
+		fprintf(dTraceFile, ",\"args\":{\"detail\":");
+		dTraceWriteString(span->detail);
+		fprintf(dTraceFile, "}");
+	}
+	fprintf(dTraceFile, "}");
+
+	++dTraceWritten;
+}
+
+void dTraceWriteString(const char *string) {
+	assert(string!=NULL);
+
+	fputc('"', dTraceFile);
+	for(const unsigned char *c=(const unsigned char *)string; *c!='\0'; ++c) {
+		if (*c=='"' || *c=='\\')
+			fprintf(dTraceFile, "\\%c", *c);
+		else if (*c<0x20)
+			fprintf(dTraceFile, "\\u%04x", *c);
+		else
+			fputc(*c, dTraceFile);
+	}
+	fputc('"', dTraceFile);
+}
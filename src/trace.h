@@ -0,0 +1,14 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+// Tracing writes a timeline of frames, signals and rendering in the Chrome trace event JSON format (viewable in chrome://tracing or Perfetto).
+// Spans are recorded by the UI thread into a lock-free buffer and written to the file by a background thread, so tracing does not block on IO.
+// If the buffer fills faster than it can be written then spans are dropped (and a warning is given when tracing stops).
+
+bool dTraceStart(const char *path); // fails if already tracing or the file cannot be opened
+void dTraceStop(void); // writes any remaining spans and closes the file. called automatically by digitsQuit
+bool dTraceIsActive(void);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef TRACEPRIVATE_H
+#define TRACEPRIVATE_H
+
+#include <stdbool.h>
+
+#include "trace.h"
+#include "util.h"
+
+// Spans should only be recorded from the UI thread.
+// name and category must be string literals (or otherwise outlive the trace), while detail is copied (and truncated if long).
+// Typical use:
+//   DTimeUs traceStart=dTraceBegin();
+//   ...
+//   dTraceEnd(traceStart, "name", "category", NULL);
+
+DTimeUs dTraceBegin(void); // returns 0 if not tracing
+void dTraceEnd(DTimeUs start, const char *name, const char *category, const char *detail); // detail can be NULL. does nothing if start is 0
+
+#endif
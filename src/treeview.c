@@ -0,0 +1,540 @@
+#include <assert.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "fontprivate.h"
+#include "glyphatlasprivate.h"
+#include "traceprivate.h"
+#include "treeview.h"
+#include "treeviewprivate.h"
+#include "util.h"
+#include "utilprivate.h"
+#include "widgetprivate.h"
+
+// An expanded node. Collapsed nodes are not stored at all, and are instead found by index within their parent when needed.
+struct DTreeViewNode {
+	DTreeViewNode *parent; // NULL for the root
+	void *node; // user's node (NULL for the root)
+	size_t index; // index within parent's children
+	size_t childCount; // as reported when expanded
+	size_t rowCount; // rows shown beneath this node - its children, plus the rows beneath any of them which are expanded
+
+	DTreeViewNode **expanded; // expanded children, in order of index
+	size_t expandedCount;
+};
+
+typedef struct {
+	DTreeViewNode *parent; // expanded node the row is a child of
+	size_t index; // index of row within parent's children
+	DTreeViewNode *expanded; // row's own node if expanded, otherwise NULL
+	size_t depth;
+} DTreeViewRowLocation;
+
+const DColour dTreeViewBackgroundColour={.r=16, .g=16, .b=16, .a=255};
+const DColour dTreeViewTextColour={.r=255, .g=255, .b=255, .a=255};
+const DColour dTreeViewMarkerColour={.r=160, .g=160, .b=160, .a=255};
+
+const int dTreeViewIndent=16; // in pixels per level of depth, with the expand marker drawn in the first level
+const int dTreeViewWheelRows=3; // rows scrolled per step of the mouse wheel
+
+void dTreeViewVTableDestructor(DWidget *widget);
+void dTreeViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
+int dTreeViewVTableGetWidth(DWidget *widget);
+int dTreeViewVTableGetHeight(DWidget *widget);
+
+DWidgetSignalReturn dTreeViewHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData);
+DWidgetSignalReturn dTreeViewHandlerWidgetMouseWheel(const DWidgetSignalEvent *event, void *userData);
+
+int dTreeViewGetRowHeight(void);
+size_t dTreeViewGetVisibleRows(const DWidgetObjectData *data); // fully visible rows
+void dTreeViewLocateRow(const DWidgetObjectData *data, size_t row, DTreeViewRowLocation *location);
+void *dTreeViewGetLocationNode(const DWidgetObjectData *data, const DTreeViewRowLocation *location);
+
+DTreeViewNode *dTreeViewNodeNew(DWidget *widget, DTreeViewNode *parent, void *node, size_t index, size_t childCount);
+void dTreeViewNodeFree(DTreeViewNode *node); // also frees expanded descendants
+
+DWidget *dTreeViewNew(int width, int height, DTreeViewChildCountFunction *childCountFunction, DTreeViewChildFunction *childFunction, DTreeViewTextFunction *textFunction, void *userData) {
+	assert(width>=0);
+	assert(height>=0);
+	assert(childCountFunction!=NULL);
+	assert(childFunction!=NULL);
+	assert(textFunction!=NULL);
+
+	// Create widget instance
+	DWidget *treeView=dWidgetNew(DWidgetTypeTreeView);
+
+	// Call constructor
+	dTreeViewConstructor(treeView, treeView->base, width, height, childCountFunction, childFunction, textFunction, userData);
+
+	return treeView;
+}
+
+void dTreeViewConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height, DTreeViewChildCountFunction *childCountFunction, DTreeViewChildFunction *childFunction, DTreeViewTextFunction *textFunction, void *userData) {
+	assert(widget!=NULL);
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeTreeView);
+	assert(width>=0);
+	assert(height>=0);
+	assert(childCountFunction!=NULL);
+	assert(childFunction!=NULL);
+	assert(textFunction!=NULL);
+
+	// Call super constructor first
+	dWidgetConstructor(widget, data->super);
+
+	// Init fields
+	data->d.treeView.viewportWidth=width;
+	data->d.treeView.viewportHeight=height;
+	data->d.treeView.childCountFunction=childCountFunction;
+	data->d.treeView.childFunction=childFunction;
+	data->d.treeView.textFunction=textFunction;
+	data->d.treeView.userData=userData;
+	data->d.treeView.root=dTreeViewNodeNew(widget, NULL, NULL, 0, childCountFunction(NULL, userData));
+	data->d.treeView.scrollRow=0;
+
+	// Setup vtable
+	data->vtable.destructor=&dTreeViewVTableDestructor;
+	data->vtable.redraw=&dTreeViewVTableRedraw;
+	data->vtable.getMinWidth=&dTreeViewVTableGetWidth;
+	data->vtable.getMinHeight=&dTreeViewVTableGetHeight;
+	data->vtable.getWidth=&dTreeViewVTableGetWidth;
+	data->vtable.getHeight=&dTreeViewVTableGetHeight;
+
+	// Connect signals for expanding and scrolling
+	if (!dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetButtonPress, &dTreeViewHandlerWidgetButtonPress, NULL) ||
+	    !dWidgetSignalConnect(widget, DWidgetSignalTypeWidgetMouseWheel, &dTreeViewHandlerWidgetMouseWheel, NULL)) {
+		// This shouldn't really happen - there is no reason the handlers can fail to connect
+		dFatalError("error: could not connect internal signals for TreeView %p\n", widget);
+	}
+}
+
+void dTreeViewSetSize(DWidget *treeView, int width, int height) {
+	assert(treeView!=NULL);
+	assert(width>=0);
+	assert(height>=0);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(treeView, DWidgetTypeTreeView);
+
+	// No change?
+	if (data->d.treeView.viewportWidth==width && data->d.treeView.viewportHeight==height)
+		return;
+
+	data->d.treeView.viewportWidth=width;
+	data->d.treeView.viewportHeight=height;
+
+	// More rows may now fit
+	dTreeViewScrollTo(treeView, data->d.treeView.scrollRow);
+
+	dWidgetSetDirty(treeView);
+}
+
+void dTreeViewRefresh(DWidget *treeView) {
+	assert(treeView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(treeView, DWidgetTypeTreeView);
+
+	// Forget all expanded nodes, and start again from the root's current children
+	dTreeViewNodeFree(data->d.treeView.root);
+	data->d.treeView.root=dTreeViewNodeNew(treeView, NULL, NULL, 0, data->d.treeView.childCountFunction(NULL, data->d.treeView.userData));
+
+	// Keep scroll position valid if rows were removed
+	dTreeViewScrollTo(treeView, data->d.treeView.scrollRow);
+
+	dWidgetSetDirtyAppearance(treeView);
+}
+
+size_t dTreeViewGetRowCount(const DWidget *treeView) {
+	assert(treeView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(treeView, DWidgetTypeTreeView);
+
+	return data->d.treeView.root->rowCount;
+}
+
+void *dTreeViewGetRowNode(DWidget *treeView, size_t row) {
+	assert(treeView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(treeView, DWidgetTypeTreeView);
+	assert(row<data->d.treeView.root->rowCount);
+
+	DTreeViewRowLocation location;
+	dTreeViewLocateRow(data, row, &location);
+	return dTreeViewGetLocationNode(data, &location);
+}
+
+size_t dTreeViewGetRowDepth(const DWidget *treeView, size_t row) {
+	assert(treeView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(treeView, DWidgetTypeTreeView);
+	assert(row<data->d.treeView.root->rowCount);
+
+	DTreeViewRowLocation location;
+	dTreeViewLocateRow(data, row, &location);
+	return location.depth;
+}
+
+bool dTreeViewExpandRow(DWidget *treeView, size_t row) {
+	assert(treeView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(treeView, DWidgetTypeTreeView);
+	assert(row<data->d.treeView.root->rowCount);
+
+	// Already expanded?
+	DTreeViewRowLocation location;
+	dTreeViewLocateRow(data, row, &location);
+	if (location.expanded!=NULL)
+		return true;
+
+	// Nothing to expand?
+	void *node=dTreeViewGetLocationNode(data, &location);
+	size_t childCount=data->d.treeView.childCountFunction(node, data->d.treeView.userData);
+	if (childCount==0)
+		return false;
+
+	// Insert into parent's expanded children, keeping them in order of index
+	DTreeViewNode *parent=location.parent;
+	DTreeViewNode *expanded=dTreeViewNodeNew(treeView, parent, node, location.index, childCount);
+	size_t insertIndex=parent->expandedCount;
+	while(insertIndex>0 && parent->expanded[insertIndex-1]->index>location.index)
+		--insertIndex;
+	parent->expanded=dReallocTaggedNoFail(parent->expanded, sizeof(DTreeViewNode *)*(parent->expandedCount+1), dWidgetGetBaseType(treeView));
+	memmove(parent->expanded+insertIndex+1, parent->expanded+insertIndex, sizeof(DTreeViewNode *)*(parent->expandedCount-insertIndex));
+	parent->expanded[insertIndex]=expanded;
+	++parent->expandedCount;
+
+	// Update row counts on the way back up to the root
+	for(DTreeViewNode *ancestor=parent; ancestor!=NULL; ancestor=ancestor->parent)
+		ancestor->rowCount+=childCount;
+
+	// Keep the same rows in view if expanded above them
+	if (row<data->d.treeView.scrollRow)
+		data->d.treeView.scrollRow+=childCount;
+
+	dWidgetSetDirtyAppearance(treeView);
+
+	return true;
+}
+
+void dTreeViewCollapseRow(DWidget *treeView, size_t row) {
+	assert(treeView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(treeView, DWidgetTypeTreeView);
+	assert(row<data->d.treeView.root->rowCount);
+
+	// Not expanded?
+	DTreeViewRowLocation location;
+	dTreeViewLocateRow(data, row, &location);
+	DTreeViewNode *expanded=location.expanded;
+	if (expanded==NULL)
+		return;
+
+	// Remove from parent's expanded children
+	DTreeViewNode *parent=location.parent;
+	size_t removeIndex=0;
+	while(parent->expanded[removeIndex]!=expanded)
+		++removeIndex;
+	memmove(parent->expanded+removeIndex, parent->expanded+removeIndex+1, sizeof(DTreeViewNode *)*(parent->expandedCount-removeIndex-1));
+	--parent->expandedCount;
+
+	// Update row counts on the way back up to the root
+	size_t removedRows=expanded->rowCount;
+	for(DTreeViewNode *ancestor=parent; ancestor!=NULL; ancestor=ancestor->parent)
+		ancestor->rowCount-=removedRows;
+
+	dTreeViewNodeFree(expanded);
+
+	// Keep the same rows in view if collapsed above them (or show the collapsed row if the top row was removed)
+	if (data->d.treeView.scrollRow>row+removedRows)
+		data->d.treeView.scrollRow-=removedRows;
+	else if (data->d.treeView.scrollRow>row)
+		data->d.treeView.scrollRow=row;
+	dTreeViewScrollTo(treeView, data->d.treeView.scrollRow);
+
+	dWidgetSetDirtyAppearance(treeView);
+}
+
+bool dTreeViewIsRowExpanded(const DWidget *treeView, size_t row) {
+	assert(treeView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(treeView, DWidgetTypeTreeView);
+	assert(row<data->d.treeView.root->rowCount);
+
+	DTreeViewRowLocation location;
+	dTreeViewLocateRow(data, row, &location);
+	return (location.expanded!=NULL);
+}
+
+void dTreeViewScrollTo(DWidget *treeView, size_t row) {
+	assert(treeView!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(treeView, DWidgetTypeTreeView);
+
+	// Clamp so that the last row is no further up than the bottom of the view
+	size_t rowCount=data->d.treeView.root->rowCount;
+	size_t visibleRows=dTreeViewGetVisibleRows(data);
+	size_t maxRow=(rowCount>visibleRows ? rowCount-visibleRows : 0);
+	if (row>maxRow)
+		row=maxRow;
+
+	// No change?
+	if (row==data->d.treeView.scrollRow)
+		return;
+
+	data->d.treeView.scrollRow=row;
+
+	dWidgetSetDirtyAppearance(treeView);
+}
+
+size_t dTreeViewGetScrollRow(const DWidget *treeView) {
+	assert(treeView!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(treeView, DWidgetTypeTreeView);
+
+	return data->d.treeView.scrollRow;
+}
+
+void dTreeViewVTableDestructor(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTreeView);
+
+	// Free expanded nodes
+	dTreeViewNodeFree(data->d.treeView.root);
+
+	// Call super destructor
+	dWidgetDestructor(widget, data->super);
+}
+
+void dTreeViewVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
+	assert(widget!=NULL);
+	assert(renderer!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTreeView);
+
+	// Call super redraw
+	dWidgetRedraw(widget, data->super, renderer);
+
+	// Restrict drawing to the tree area (and to any existing clip rect)
+	SDL_Rect viewRect={
+	    .x=dWidgetGetGlobalX(widget)+dWidgetGetPaddingLeft(widget),
+	    .y=dWidgetGetGlobalY(widget)+dWidgetGetPaddingTop(widget),
+	    .w=data->d.treeView.viewportWidth,
+	    .h=data->d.treeView.viewportHeight,
+	};
+
+	SDL_Rect oldClip;
+	bool oldClipped=SDL_RenderIsClipEnabled(renderer);
+	if (oldClipped)
+		SDL_RenderGetClipRect(renderer, &oldClip);
+
+	SDL_Rect clip=viewRect;
+	if (oldClipped && !SDL_IntersectRect(&oldClip, &viewRect, &clip))
+		return;
+	SDL_RenderSetClipRect(renderer, &clip);
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Draw background
+	dSetRenderDrawColour(renderer, &dTreeViewBackgroundColour);
+	SDL_RenderFillRect(renderer, &clip);
+
+	DGlyphAtlas *atlas=dGlyphAtlasGet(renderer);
+	size_t rowCount=data->d.treeView.root->rowCount;
+	if (atlas!=NULL && rowCount>0) {
+		// Draw only rows which overlap the clip rect, fetching their nodes as needed
+		int rowHeight=dTreeViewGetRowHeight();
+		size_t firstRow=data->d.treeView.scrollRow+(clip.y-viewRect.y)/rowHeight;
+		size_t lastRow=data->d.treeView.scrollRow+(clip.y+clip.h-1-viewRect.y)/rowHeight;
+		for(size_t row=firstRow; row<=lastRow && row<rowCount; ++row) {
+			DTreeViewRowLocation location;
+			dTreeViewLocateRow(data, row, &location);
+			void *node=dTreeViewGetLocationNode(data, &location);
+
+			int x=viewRect.x+(int)location.depth*dTreeViewIndent;
+			int y=viewRect.y+(int)(row-data->d.treeView.scrollRow)*rowHeight;
+			int maxWidth=viewRect.x+viewRect.w-x;
+			if (maxWidth<=0)
+				continue;
+
+			// Draw marker for nodes which can be expanded or collapsed
+			if (location.expanded!=NULL)
+				dGlyphAtlasDrawText(atlas, renderer, x, y, "-", &dTreeViewMarkerColour, maxWidth);
+			else if (data->d.treeView.childCountFunction(node, data->d.treeView.userData)>0)
+				dGlyphAtlasDrawText(atlas, renderer, x, y, "+", &dTreeViewMarkerColour, maxWidth);
+
+			// Draw text
+			const char *text=data->d.treeView.textFunction(node, data->d.treeView.userData);
+			if (text!=NULL)
+				dGlyphAtlasDrawText(atlas, renderer, x+dTreeViewIndent, y, text, &dTreeViewTextColour, maxWidth-dTreeViewIndent);
+		}
+	}
+
+	// Restore clip rect
+	SDL_RenderSetClipRect(renderer, (oldClipped ? &oldClip : NULL));
+
+	dTraceEnd(traceStart, "tree view redraw", "render", NULL);
+}
+
+int dTreeViewVTableGetWidth(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTreeView);
+
+	return data->d.treeView.viewportWidth+dWidgetGetPaddingLeft(widget)+dWidgetGetPaddingRight(widget);
+}
+
+int dTreeViewVTableGetHeight(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTreeView);
+
+	return data->d.treeView.viewportHeight+dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
+}
+
+DWidgetSignalReturn dTreeViewHandlerWidgetButtonPress(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTreeView);
+
+	// Only interested in left clicks
+	if (event->d.widgetButtonPress.button!=DWidgetMouseButtonLeft)
+		return DWidgetSignalReturnContinue;
+
+	int x=event->d.widgetButtonPress.x-dWidgetGetGlobalX(widget)-dWidgetGetPaddingLeft(widget);
+	int y=event->d.widgetButtonPress.y-dWidgetGetGlobalY(widget)-dWidgetGetPaddingTop(widget);
+	if (x<0 || y<0)
+		return DWidgetSignalReturnContinue;
+
+	// Find row clicked on and expand or collapse it
+	size_t row=data->d.treeView.scrollRow+(size_t)(y/dTreeViewGetRowHeight());
+	if (row>=data->d.treeView.root->rowCount)
+		return DWidgetSignalReturnContinue;
+
+	if (dTreeViewIsRowExpanded(widget, row))
+		dTreeViewCollapseRow(widget, row);
+	else
+		dTreeViewExpandRow(widget, row);
+
+	return DWidgetSignalReturnStop;
+}
+
+DWidgetSignalReturn dTreeViewHandlerWidgetMouseWheel(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData==NULL);
+
+	DWidget *widget=event->widget;
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeTreeView);
+
+	if (event->d.widgetMouseWheel.y==0)
+		return DWidgetSignalReturnContinue;
+
+	// Scroll up for positive y (away from the user)
+	size_t rows=(size_t)(event->d.widgetMouseWheel.y>0 ? event->d.widgetMouseWheel.y : -event->d.widgetMouseWheel.y)*dTreeViewWheelRows;
+	size_t scrollRow=data->d.treeView.scrollRow;
+	if (event->d.widgetMouseWheel.y>0)
+		scrollRow=(scrollRow>rows ? scrollRow-rows : 0);
+	else
+		scrollRow+=rows;
+	dTreeViewScrollTo(widget, scrollRow);
+
+	return DWidgetSignalReturnStop;
+}
+
+int dTreeViewGetRowHeight(void) {
+	TTF_Font *font=dFontGet();
+	int rowHeight=(font!=NULL ? TTF_FontLineSkip(font) : dFontSize);
+	return (rowHeight>0 ? rowHeight : 1);
+}
+
+size_t dTreeViewGetVisibleRows(const DWidgetObjectData *data) {
+	assert(data!=NULL);
+
+	return (size_t)(data->d.treeView.viewportHeight/dTreeViewGetRowHeight());
+}
+
+void dTreeViewLocateRow(const DWidgetObjectData *data, size_t row, DTreeViewRowLocation *location) {
+	assert(data!=NULL);
+	assert(row<data->d.treeView.root->rowCount);
+	assert(location!=NULL);
+
+	// Walk down from the root, with row relative to the first row beneath parent.
+	// Within each expanded node, the rows before an expanded child are its collapsed siblings, so only the expanded children need checking.
+	DTreeViewNode *parent=data->d.treeView.root;
+	size_t depth=0;
+	while(1) {
+		size_t skippedRows=0; // rows beneath expanded children passed so far
+		DTreeViewNode *descend=NULL;
+		for(size_t i=0; i<parent->expandedCount; ++i) {
+			DTreeViewNode *child=parent->expanded[i];
+			size_t childRow=child->index+skippedRows;
+			if (row<childRow)
+				break;
+
+			if (row==childRow) {
+				location->parent=parent;
+				location->index=child->index;
+				location->expanded=child;
+				location->depth=depth;
+				return;
+			}
+
+			if (row<=childRow+child->rowCount) {
+				row-=childRow+1;
+				descend=child;
+				break;
+			}
+
+			skippedRows+=child->rowCount;
+		}
+
+		// Row is a collapsed child of parent?
+		if (descend==NULL) {
+			location->parent=parent;
+			location->index=row-skippedRows;
+			location->expanded=NULL;
+			location->depth=depth;
+			return;
+		}
+
+		parent=descend;
+		++depth;
+	}
+}
+
+void *dTreeViewGetLocationNode(const DWidgetObjectData *data, const DTreeViewRowLocation *location) {
+	assert(data!=NULL);
+	assert(location!=NULL);
+
+	// Expanded nodes are stored, others are fetched by index
+	if (location->expanded!=NULL)
+		return location->expanded->node;
+	return data->d.treeView.childFunction(location->parent->node, location->index, data->d.treeView.userData);
+}
+
+DTreeViewNode *dTreeViewNodeNew(DWidget *widget, DTreeViewNode *parent, void *node, size_t index, size_t childCount) {
+	assert(widget!=NULL);
+
+	DTreeViewNode *treeNode=dMallocTaggedNoFail(sizeof(DTreeViewNode), dWidgetGetBaseType(widget));
+	treeNode->parent=parent;
+	treeNode->node=node;
+	treeNode->index=index;
+	treeNode->childCount=childCount;
+	treeNode->rowCount=childCount;
+	treeNode->expanded=NULL;
+	treeNode->expandedCount=0;
+
+	return treeNode;
+}
+
+void dTreeViewNodeFree(DTreeViewNode *node) {
+	assert(node!=NULL);
+
+	for(size_t i=0; i<node->expandedCount; ++i)
+		dTreeViewNodeFree(node->expanded[i]);
+	dFree(node->expanded);
+	dFree(node);
+}
@@ -0,0 +1,35 @@
+#ifndef TREEVIEW_H
+#define TREEVIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "widget.h"
+
+// A TreeView shows a hierarchy which is read through callbacks rather than built up front: nodes are opaque pointers,
+// and the view asks for a node's child count when it is expanded, and for children (and their text) only when they are on screen.
+// Only expanded nodes are stored, each with a count of the rows shown beneath it, so expanding or collapsing a node is O(depth) regardless of how many children it has,
+// and finding the node for a row only walks the expanded nodes on the way down to it. Rows are drawn like a TableView's, using the shared glyph atlas.
+// Clicking a row expands or collapses it, and the mouse wheel scrolls.
+
+typedef size_t (DTreeViewChildCountFunction)(void *node, void *userData); // node is NULL for the (hidden) root
+typedef void *(DTreeViewChildFunction)(void *node, size_t index, void *userData); // returns child index of node (NULL for the root, as above)
+typedef const char *(DTreeViewTextFunction)(void *node, void *userData); // returned text need only remain valid until the next call
+
+DWidget *dTreeViewNew(int width, int height, DTreeViewChildCountFunction *childCountFunction, DTreeViewChildFunction *childFunction, DTreeViewTextFunction *textFunction, void *userData); // size of the visible area in pixels (excluding padding)
+
+void dTreeViewSetSize(DWidget *treeView, int width, int height);
+void dTreeViewRefresh(DWidget *treeView); // call after the hierarchy changes. collapses all nodes
+
+size_t dTreeViewGetRowCount(const DWidget *treeView);
+void *dTreeViewGetRowNode(DWidget *treeView, size_t row);
+size_t dTreeViewGetRowDepth(const DWidget *treeView, size_t row); // 0 for children of the root
+
+bool dTreeViewExpandRow(DWidget *treeView, size_t row); // returns false if the row's node has no children
+void dTreeViewCollapseRow(DWidget *treeView, size_t row); // also collapses any expanded descendants
+bool dTreeViewIsRowExpanded(const DWidget *treeView, size_t row);
+
+void dTreeViewScrollTo(DWidget *treeView, size_t row); // row is shown at the top, if possible
+size_t dTreeViewGetScrollRow(const DWidget *treeView);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef TREEVIEWPRIVATE_H
+#define TREEVIEWPRIVATE_H
+
+#include "widgetprivate.h"
+
+void dTreeViewConstructor(DWidget *widget, DWidgetObjectData *data, int width, int height, DTreeViewChildCountFunction *childCountFunction, DTreeViewChildFunction *childFunction, DTreeViewTextFunction *textFunction, void *userData);
+
+#endif
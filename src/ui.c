@@ -0,0 +1,711 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bin.h"
+#include "box.h"
+#include "button.h"
+#include "container.h"
+#include "containerprivate.h"
+#include "label.h"
+#include "textbutton.h"
+#include "ui.h"
+#include "util.h"
+#include "widget.h"
+#include "widgetprivate.h"
+#include "window.h"
+
+#define DUiMagic "DUI1"
+#define DUiVersion 1
+#define DUiDepthMax 256 // maximum nesting of widgets in the text form
+
+// Node types are independent of DWidgetType so that compiled files remain valid if new widget types are added
+typedef enum {
+	DUiNodeTypeBin,
+	DUiNodeTypeBox,
+	DUiNodeTypeButton,
+	DUiNodeTypeLabel,
+	DUiNodeTypeTextButton,
+	DUiNodeTypeWindow,
+	DUiNodeTypeNB,
+} DUiNodeType;
+
+typedef enum {
+	DUiNodeFlagHExpand=1,
+	DUiNodeFlagVExpand=2,
+	DUiNodeFlagVertical=4,
+} DUiNodeFlag;
+
+// Binary layout is: header, node array, string table
+// All offsets are in bytes from the start of the file, and all values are in native byte order.
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t nodeCount;
+	uint32_t nodesOffset;
+	uint32_t stringsSize;
+	uint32_t stringsOffset;
+} DUiHeader;
+
+// Nodes are stored in pre-order, so a parent always comes before its children
+typedef struct {
+	uint8_t type; // DUiNodeType
+	uint8_t flags; // DUiNodeFlag bitset
+	uint16_t padding[4]; // top, bottom, left, right
+	int32_t parent; // index of parent node, or -1 for a root
+	uint32_t childCount; // number of nodes which have this node as their parent (used to allocate child arrays up front)
+	uint32_t text; // offset into string table, 0 being the empty string
+	uint32_t name; // offset into string table, 0 if no name given
+	int32_t width, height; // only used by windows
+} DUiNode;
+
+_Static_assert(sizeof(DUiNode)==36, "unexpected DUiNode padding");
+
+struct DUi {
+	void *map;
+	size_t mapSize;
+
+	const DUiHeader *header;
+	const DUiNode *nodes;
+	const char *strings;
+
+	DWidget **widgets; // one entry per node
+};
+
+typedef struct {
+	DUiNode *nodes;
+	size_t nodeCount;
+
+	char *strings;
+	size_t stringsSize;
+
+	uint32_t *stringTable; // hash table of string offsets used to intern strings, 0 indicating an empty slot
+	size_t stringTableAlloc; // always a power of two
+	size_t stringTableCount;
+} DUiCompiler;
+
+static const char *dUiNodeTypeNames[DUiNodeTypeNB]={
+	[DUiNodeTypeBin]="bin",
+	[DUiNodeTypeBox]="box",
+	[DUiNodeTypeButton]="button",
+	[DUiNodeTypeLabel]="label",
+	[DUiNodeTypeTextButton]="textbutton",
+	[DUiNodeTypeWindow]="window",
+};
+
+bool dUiCompileLine(DUiCompiler *compiler, char *line, size_t lineNumber, int32_t *stack, size_t *stackIndents, size_t *stackCount, const char *textPath);
+char *dUiCompileNextToken(char **cursor, bool *quoted); // returns NULL if no tokens remain (or on error, in which case *cursor is set to NULL)
+bool dUiCompileParseInt(const char *token, int min, int max, int *value);
+uint32_t dUiCompileInternString(DUiCompiler *compiler, const char *string);
+uint32_t dUiCompileHashString(const char *string);
+void dUiCompileStringTableInsert(DUiCompiler *compiler, uint32_t offset);
+void dUiCompilerFree(DUiCompiler *compiler);
+
+bool dUiNodeTypeCanHaveChildren(DUiNodeType type);
+size_t dUiNodeTypeMaxChildren(DUiNodeType type);
+
+bool dUiVerify(const DUi *ui, const char *binaryPath);
+DWidget *dUiInstantiateNode(const DUi *ui, const DUiNode *node);
+
+bool dUiCompile(const char *textPath, const char *binaryPath) {
+	assert(textPath!=NULL);
+	assert(binaryPath!=NULL);
+
+	// Open text file
+	FILE *textFile=fopen(textPath, "r");
+	if (textFile==NULL) {
+		dWarning("warning: could not compile UI description - could not open '%s'\n", textPath);
+		return false;
+	}
+
+	// Setup compiler state, with the empty string at offset 0
+	DUiCompiler compiler;
+	compiler.nodes=NULL;
+	compiler.nodeCount=0;
+	compiler.strings=dMallocNoFail(1);
+	compiler.strings[0]='\0';
+	compiler.stringsSize=1;
+	compiler.stringTableAlloc=1024;
+	compiler.stringTable=dMallocNoFail(sizeof(uint32_t)*compiler.stringTableAlloc);
+	memset(compiler.stringTable, 0, sizeof(uint32_t)*compiler.stringTableAlloc);
+	compiler.stringTableCount=0;
+
+	// Stack of nodes which may be parents of the next line, along with their indentation
+	int32_t stack[DUiDepthMax];
+	size_t stackIndents[DUiDepthMax];
+	size_t stackCount=0;
+
+	// Parse each line in turn
+	char *line=NULL;
+	size_t lineAlloc=0;
+	size_t lineNumber=0;
+	bool success=true;
+	while(getline(&line, &lineAlloc, textFile)!=-1) {
+		++lineNumber;
+		if (!dUiCompileLine(&compiler, line, lineNumber, stack, stackIndents, &stackCount, textPath)) {
+			success=false;
+			break;
+		}
+	}
+	free(line);
+	fclose(textFile);
+
+	if (success && compiler.nodeCount==0) {
+		dWarning("warning: could not compile UI description '%s' - no widgets given\n", textPath);
+		success=false;
+	}
+
+	// Write binary file
+	if (success) {
+		DUiHeader header;
+		memcpy(header.magic, DUiMagic, 4);
+		header.version=DUiVersion;
+		header.nodeCount=compiler.nodeCount;
+		header.nodesOffset=sizeof(DUiHeader);
+		header.stringsSize=compiler.stringsSize;
+		header.stringsOffset=header.nodesOffset+sizeof(DUiNode)*compiler.nodeCount;
+
+		FILE *binaryFile=fopen(binaryPath, "wb");
+		if (binaryFile==NULL) {
+			dWarning("warning: could not compile UI description - could not open '%s' for writing\n", binaryPath);
+			success=false;
+		} else {
+			if (fwrite(&header, sizeof(header), 1, binaryFile)!=1 ||
+			    fwrite(compiler.nodes, sizeof(DUiNode), compiler.nodeCount, binaryFile)!=compiler.nodeCount ||
+			    fwrite(compiler.strings, 1, compiler.stringsSize, binaryFile)!=compiler.stringsSize) {
+				dWarning("warning: could not compile UI description - could not write to '%s'\n", binaryPath);
+				success=false;
+			}
+			if (fclose(binaryFile)!=0)
+				success=false;
+		}
+	}
+
+	// Tidy up
+	dUiCompilerFree(&compiler);
+
+	return success;
+}
+
+DUi *dUiLoad(const char *binaryPath) {
+	assert(binaryPath!=NULL);
+
+	// Map file into memory
+	int fd=open(binaryPath, O_RDONLY);
+	if (fd==-1) {
+		dWarning("warning: could not load UI description - could not open '%s'\n", binaryPath);
+		return NULL;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat)!=0 || fileStat.st_size<(off_t)sizeof(DUiHeader)) {
+		dWarning("warning: could not load UI description '%s' - file too small\n", binaryPath);
+		close(fd);
+		return NULL;
+	}
+
+	void *map=mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map==MAP_FAILED) {
+		dWarning("warning: could not load UI description - could not map '%s'\n", binaryPath);
+		return NULL;
+	}
+
+	DUi *ui=dMallocNoFail(sizeof(DUi));
+	ui->map=map;
+	ui->mapSize=fileStat.st_size;
+	ui->header=map;
+	ui->nodes=(const DUiNode *)((const char *)map+ui->header->nodesOffset);
+	ui->strings=(const char *)map+ui->header->stringsOffset;
+	ui->widgets=NULL;
+
+	// Check file is well formed before creating any widgets
+	if (!dUiVerify(ui, binaryPath)) {
+		dUiFree(ui);
+		return NULL;
+	}
+
+	// Create widgets in a single pass - as nodes are in pre-order each parent will already exist when we reach its children
+	// All invalidation is deferred until the end, via an update transaction opened on the first root.
+	size_t nodeCount=ui->header->nodeCount;
+	ui->widgets=dMallocNoFail(sizeof(DWidget *)*nodeCount);
+	for(size_t i=0; i<nodeCount; ++i) {
+		const DUiNode *node=&ui->nodes[i];
+
+		DWidget *widget=dUiInstantiateNode(ui, node);
+		ui->widgets[i]=widget;
+
+		if (i==0)
+			dWidgetBeginUpdate(widget);
+
+		if (node->parent!=-1)
+			dContainerAdd(ui->widgets[node->parent], widget);
+	}
+	dWidgetEndUpdate(ui->widgets[0]);
+
+	return ui;
+}
+
+void dUiFree(DUi *ui) {
+	// NULL check
+	if (ui==NULL)
+		return;
+
+	// Free memory
+	munmap(ui->map, ui->mapSize);
+	dFree(ui->widgets);
+	dFree(ui);
+}
+
+size_t dUiGetRootCount(const DUi *ui) {
+	assert(ui!=NULL);
+
+	size_t count=0;
+	for(size_t i=0; i<ui->header->nodeCount; ++i)
+		if (ui->nodes[i].parent==-1)
+			++count;
+	return count;
+}
+
+DWidget *dUiGetRootN(DUi *ui, size_t n) {
+	assert(ui!=NULL);
+
+	for(size_t i=0; i<ui->header->nodeCount; ++i)
+		if (ui->nodes[i].parent==-1 && n--==0)
+			return ui->widgets[i];
+	return NULL;
+}
+
+DWidget *dUiGetWidget(DUi *ui, const char *name) {
+	assert(ui!=NULL);
+	assert(name!=NULL);
+
+	for(size_t i=0; i<ui->header->nodeCount; ++i)
+		if (ui->nodes[i].name!=0 && strcmp(ui->strings+ui->nodes[i].name, name)==0)
+			return ui->widgets[i];
+	return NULL;
+}
+
+bool dUiCompileLine(DUiCompiler *compiler, char *line, size_t lineNumber, int32_t *stack, size_t *stackIndents, size_t *stackCount, const char *textPath) {
+	assert(compiler!=NULL);
+	assert(line!=NULL);
+	assert(stack!=NULL);
+	assert(stackIndents!=NULL);
+	assert(stackCount!=NULL);
+	assert(textPath!=NULL);
+
+	// Measure indentation
+	size_t indent=0;
+	while(line[indent]==' ' || line[indent]=='\t')
+		++indent;
+
+	// Blank line or comment?
+	char *cursor=line+indent;
+	if (*cursor=='\0' || *cursor=='\n' || *cursor=='\r' || *cursor=='#')
+		return true;
+
+	// Parse widget type
+	bool quoted;
+	char *token=dUiCompileNextToken(&cursor, &quoted);
+	DUiNodeType type;
+	for(type=0; type<DUiNodeTypeNB; ++type)
+		if (token!=NULL && !quoted && strcmp(token, dUiNodeTypeNames[type])==0)
+			break;
+	if (type==DUiNodeTypeNB) {
+		dWarning("warning: %s:%zu: expected widget type\n", textPath, lineNumber);
+		return false;
+	}
+
+	// Find parent by popping anything indented at least as much as this line
+	while(*stackCount>0 && stackIndents[*stackCount-1]>=indent)
+		--*stackCount;
+	int32_t parent=(*stackCount>0 ? stack[*stackCount-1] : -1);
+
+	if (parent!=-1) {
+		DUiNode *parentNode=&compiler->nodes[parent];
+		if (!dUiNodeTypeCanHaveChildren(parentNode->type)) {
+			dWarning("warning: %s:%zu: %s cannot have children\n", textPath, lineNumber, dUiNodeTypeNames[parentNode->type]);
+			return false;
+		}
+		if (parentNode->childCount>=dUiNodeTypeMaxChildren(parentNode->type)) {
+			dWarning("warning: %s:%zu: %s can only have a single child\n", textPath, lineNumber, dUiNodeTypeNames[parentNode->type]);
+			return false;
+		}
+		if (type==DUiNodeTypeWindow) {
+			dWarning("warning: %s:%zu: window must not be indented\n", textPath, lineNumber);
+			return false;
+		}
+	}
+
+	if (*stackCount==DUiDepthMax) {
+		dWarning("warning: %s:%zu: widgets nested too deeply\n", textPath, lineNumber);
+		return false;
+	}
+
+	// Create node
+	DUiNode node;
+	memset(&node, 0, sizeof(node));
+	node.type=type;
+	node.parent=parent;
+
+	// Parse type specific arguments
+	switch(type) {
+		case DUiNodeTypeWindow:
+		case DUiNodeTypeLabel:
+		case DUiNodeTypeTextButton:
+			token=dUiCompileNextToken(&cursor, &quoted);
+			if (token==NULL || !quoted) {
+				dWarning("warning: %s:%zu: expected quoted text\n", textPath, lineNumber);
+				return false;
+			}
+			node.text=dUiCompileInternString(compiler, token);
+
+			if (type==DUiNodeTypeWindow) {
+				int width, height;
+				if (!dUiCompileParseInt(dUiCompileNextToken(&cursor, &quoted), 0, INT32_MAX, &width) || !dUiCompileParseInt(dUiCompileNextToken(&cursor, &quoted), 0, INT32_MAX, &height)) {
+					dWarning("warning: %s:%zu: expected window width and height\n", textPath, lineNumber);
+					return false;
+				}
+				node.width=width;
+				node.height=height;
+			}
+		break;
+		case DUiNodeTypeBox:
+			token=dUiCompileNextToken(&cursor, &quoted);
+			if (token!=NULL && !quoted && strcmp(token, "horizontal")==0)
+				;
+			else if (token!=NULL && !quoted && strcmp(token, "vertical")==0)
+				node.flags|=DUiNodeFlagVertical;
+			else {
+				dWarning("warning: %s:%zu: expected box orientation (horizontal or vertical)\n", textPath, lineNumber);
+				return false;
+			}
+		break;
+		case DUiNodeTypeBin:
+		case DUiNodeTypeButton:
+		case DUiNodeTypeNB:
+		break;
+	}
+
+	// Parse optional properties
+	while((token=dUiCompileNextToken(&cursor, &quoted))!=NULL) {
+		char *value=strchr(token, '=');
+		if (value!=NULL)
+			*value++='\0';
+
+		int padding;
+		if (!quoted && value==NULL && strcmp(token, "hexpand")==0)
+			node.flags|=DUiNodeFlagHExpand;
+		else if (!quoted && value==NULL && strcmp(token, "vexpand")==0)
+			node.flags|=DUiNodeFlagVExpand;
+		else if (!quoted && value!=NULL && strcmp(token, "name")==0 && value[0]!='\0')
+			node.name=dUiCompileInternString(compiler, value);
+		else if (!quoted && value!=NULL && strncmp(token, "padding", 7)==0 && dUiCompileParseInt(value, 0, UINT16_MAX, &padding)) {
+			if (strcmp(token, "padding")==0)
+				node.padding[0]=node.padding[1]=node.padding[2]=node.padding[3]=padding;
+			else if (strcmp(token, "padding-top")==0)
+				node.padding[0]=padding;
+			else if (strcmp(token, "padding-bottom")==0)
+				node.padding[1]=padding;
+			else if (strcmp(token, "padding-left")==0)
+				node.padding[2]=padding;
+			else if (strcmp(token, "padding-right")==0)
+				node.padding[3]=padding;
+			else {
+				dWarning("warning: %s:%zu: unknown property '%s'\n", textPath, lineNumber, token);
+				return false;
+			}
+		} else {
+			dWarning("warning: %s:%zu: bad property '%s'\n", textPath, lineNumber, token);
+			return false;
+		}
+	}
+	if (cursor==NULL) {
+		dWarning("warning: %s:%zu: unterminated string\n", textPath, lineNumber);
+		return false;
+	}
+
+	// Add node to array and update parent
+	if (compiler->nodeCount>=INT32_MAX) {
+		dWarning("warning: %s:%zu: too many widgets\n", textPath, lineNumber);
+		return false;
+	}
+	compiler->nodes=dReallocNoFail(compiler->nodes, sizeof(DUiNode)*(compiler->nodeCount+1));
+	compiler->nodes[compiler->nodeCount]=node;
+	if (parent!=-1)
+		++compiler->nodes[parent].childCount;
+
+	// Push onto stack as a potential parent for following lines
+	stack[*stackCount]=compiler->nodeCount;
+	stackIndents[*stackCount]=indent;
+	++*stackCount;
+
+	++compiler->nodeCount;
+
+	return true;
+}
+
+char *dUiCompileNextToken(char **cursor, bool *quoted) {
+	assert(cursor!=NULL);
+	assert(quoted!=NULL);
+
+	// Previous error?
+	char *c=*cursor;
+	if (c==NULL)
+		return NULL;
+
+	// Skip whitespace
+	while(*c==' ' || *c=='\t' || *c=='\n' || *c=='\r')
+		++c;
+	if (*c=='\0' || *c=='#') {
+		*cursor=c;
+		return NULL;
+	}
+
+	char *token;
+	if (*c=='"') {
+		// Quoted string - unescape in place
+		*quoted=true;
+		token=++c;
+		char *out=c;
+		while(*c!='"') {
+			if (*c=='\0' || *c=='\n') {
+				*cursor=NULL;
+				return NULL;
+			}
+			if (*c=='\\' && (c[1]=='"' || c[1]=='\\'))
+				++c;
+			*out++=*c++;
+		}
+		++c;
+		*out='\0';
+	} else {
+		// Bare word
+		*quoted=false;
+		token=c;
+		while(*c!='\0' && *c!=' ' && *c!='\t' && *c!='\n' && *c!='\r')
+			++c;
+		if (*c!='\0')
+			*c++='\0';
+	}
+
+	*cursor=c;
+	return token;
+}
+
+bool dUiCompileParseInt(const char *token, int min, int max, int *value) {
+	assert(value!=NULL);
+
+	if (token==NULL || token[0]=='\0')
+		return false;
+
+	char *end;
+	long result=strtol(token, &end, 10);
+	if (*end!='\0' || result<min || result>max)
+		return false;
+
+	*value=result;
+	return true;
+}
+
+uint32_t dUiCompileInternString(DUiCompiler *compiler, const char *string) {
+	assert(compiler!=NULL);
+	assert(string!=NULL);
+
+	// Empty string is always at offset 0
+	if (string[0]=='\0')
+		return 0;
+
+	// Look for existing copy
+	size_t mask=compiler->stringTableAlloc-1;
+	for(size_t slot=dUiCompileHashString(string)&mask; compiler->stringTable[slot]!=0; slot=(slot+1)&mask)
+		if (strcmp(compiler->strings+compiler->stringTable[slot], string)==0)
+			return compiler->stringTable[slot];
+
+	// Append to string data
+	size_t size=strlen(string)+1;
+	if (compiler->stringsSize+size>UINT32_MAX)
+		dFatalError("error: UI description string table too large\n");
+	uint32_t offset=compiler->stringsSize;
+	compiler->strings=dReallocNoFail(compiler->strings, compiler->stringsSize+size);
+	memcpy(compiler->strings+offset, string, size);
+	compiler->stringsSize+=size;
+
+	// Add to hash table for future lookups
+	dUiCompileStringTableInsert(compiler, offset);
+
+	return offset;
+}
+
+uint32_t dUiCompileHashString(const char *string) {
+	assert(string!=NULL);
+
+	// FNV-1a
+	uint32_t hash=2166136261u;
+	for(const char *c=string; *c!='\0'; ++c)
+		hash=(hash^(uint8_t)*c)*16777619u;
+	return hash;
+}
+
+void dUiCompileStringTableInsert(DUiCompiler *compiler, uint32_t offset) {
+	assert(compiler!=NULL);
+	assert(offset>0 && offset<compiler->stringsSize);
+
+	// Grow table first if it would become more than half full
+	if (2*(compiler->stringTableCount+1)>compiler->stringTableAlloc) {
+		size_t oldAlloc=compiler->stringTableAlloc;
+		uint32_t *oldTable=compiler->stringTable;
+
+		compiler->stringTableAlloc*=2;
+		compiler->stringTable=dMallocNoFail(sizeof(uint32_t)*compiler->stringTableAlloc);
+		memset(compiler->stringTable, 0, sizeof(uint32_t)*compiler->stringTableAlloc);
+		compiler->stringTableCount=0;
+		for(size_t i=0; i<oldAlloc; ++i)
+			if (oldTable[i]!=0)
+				dUiCompileStringTableInsert(compiler, oldTable[i]);
+		dFree(oldTable);
+	}
+
+	// Linear probe for a free slot
+	size_t mask=compiler->stringTableAlloc-1;
+	size_t slot=dUiCompileHashString(compiler->strings+offset)&mask;
+	while(compiler->stringTable[slot]!=0)
+		slot=(slot+1)&mask;
+
+	compiler->stringTable[slot]=offset;
+	++compiler->stringTableCount;
+}
+
+void dUiCompilerFree(DUiCompiler *compiler) {
+	assert(compiler!=NULL);
+
+	dFree(compiler->nodes);
+	dFree(compiler->strings);
+	dFree(compiler->stringTable);
+}
+
+bool dUiNodeTypeCanHaveChildren(DUiNodeType type) {
+	return (dUiNodeTypeMaxChildren(type)>0);
+}
+
+size_t dUiNodeTypeMaxChildren(DUiNodeType type) {
+	switch(type) {
+		case DUiNodeTypeBox:
+			return SIZE_MAX;
+		break;
+		case DUiNodeTypeBin:
+		case DUiNodeTypeButton:
+		case DUiNodeTypeWindow:
+			return 1;
+		break;
+		case DUiNodeTypeLabel:
+		case DUiNodeTypeTextButton:
+		case DUiNodeTypeNB:
+		break;
+	}
+
+	return 0;
+}
+
+bool dUiVerify(const DUi *ui, const char *binaryPath) {
+	assert(ui!=NULL);
+	assert(binaryPath!=NULL);
+
+	const DUiHeader *header=ui->header;
+
+	// Check header
+	if (memcmp(header->magic, DUiMagic, 4)!=0 || header->version!=DUiVersion) {
+		dWarning("warning: could not load UI description '%s' - bad header (not a compiled UI description, or compiled for a different version)\n", binaryPath);
+		return false;
+	}
+	if (header->nodeCount==0 || header->nodeCount>INT32_MAX ||
+	    header->nodesOffset%_Alignof(DUiNode)!=0 ||
+	    header->nodesOffset>ui->mapSize || (ui->mapSize-header->nodesOffset)/sizeof(DUiNode)<header->nodeCount ||
+	    header->stringsOffset>ui->mapSize || ui->mapSize-header->stringsOffset<header->stringsSize ||
+	    header->stringsSize==0 || ui->strings[0]!='\0' || ui->strings[header->stringsSize-1]!='\0') {
+		dWarning("warning: could not load UI description '%s' - truncated or corrupt\n", binaryPath);
+		return false;
+	}
+
+	// Check nodes
+	uint32_t *childCounts=dMallocNoFail(sizeof(uint32_t)*header->nodeCount);
+	memset(childCounts, 0, sizeof(uint32_t)*header->nodeCount);
+
+	bool valid=true;
+	for(size_t i=0; i<header->nodeCount && valid; ++i) {
+		const DUiNode *node=&ui->nodes[i];
+		valid=(node->type<DUiNodeTypeNB &&
+		       node->text<header->stringsSize && node->name<header->stringsSize &&
+		       node->parent>=-1 && node->parent<(int32_t)i &&
+		       (node->type!=DUiNodeTypeWindow || (node->parent==-1 && node->width>=0 && node->height>=0)) &&
+		       node->childCount<=dUiNodeTypeMaxChildren(node->type));
+		if (valid && node->parent!=-1)
+			++childCounts[node->parent];
+	}
+	for(size_t i=0; i<header->nodeCount && valid; ++i)
+		valid=(childCounts[i]==ui->nodes[i].childCount);
+
+	dFree(childCounts);
+
+	if (!valid)
+		dWarning("warning: could not load UI description '%s' - invalid node data\n", binaryPath);
+
+	return valid;
+}
+
+DWidget *dUiInstantiateNode(const DUi *ui, const DUiNode *node) {
+	assert(ui!=NULL);
+	assert(node!=NULL);
+
+	// Create widget
+	DWidget *widget=NULL;
+	switch((DUiNodeType)node->type) {
+		case DUiNodeTypeBin:
+			widget=dBinNew(NULL);
+		break;
+		case DUiNodeTypeBox:
+			widget=dBoxNew((node->flags & DUiNodeFlagVertical) ? DWidgetOrientationVertical : DWidgetOrientationHorizontal);
+		break;
+		case DUiNodeTypeButton:
+			widget=dButtonNew(NULL);
+		break;
+		case DUiNodeTypeLabel:
+			widget=dLabelNew(ui->strings+node->text);
+		break;
+		case DUiNodeTypeTextButton:
+			widget=dTextButtonNew(ui->strings+node->text);
+		break;
+		case DUiNodeTypeWindow:
+			widget=dWindowNew(ui->strings+node->text, node->width, node->height);
+		break;
+		case DUiNodeTypeNB:
+			assert(false);
+		break;
+	}
+
+	// Allocate space for all children at once
+	if (node->childCount>0)
+		dContainerReserve(widget, node->childCount);
+
+	// Apply layout properties (skipping defaults)
+	if (node->padding[0]!=0)
+		dWidgetSetPaddingTop(widget, node->padding[0]);
+	if (node->padding[1]!=0)
+		dWidgetSetPaddingBottom(widget, node->padding[1]);
+	if (node->padding[2]!=0)
+		dWidgetSetPaddingLeft(widget, node->padding[2]);
+	if (node->padding[3]!=0)
+		dWidgetSetPaddingRight(widget, node->padding[3]);
+	if (node->flags & DUiNodeFlagHExpand)
+		dWidgetSetHExpand(widget, true);
+	if (node->flags & DUiNodeFlagVExpand)
+		dWidgetSetVExpand(widget, true);
+
+	return widget;
+}
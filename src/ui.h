@@ -0,0 +1,37 @@
+#ifndef UI_H
+#define UI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "widget.h"
+
+// UI descriptions allow a widget tree to be built from a precompiled binary file rather than imperatively.
+//
+// The text form is compiled with dUiCompile. Each line describes one widget, with children indented further than their parent:
+//
+//   # comments start with a hash
+//   window "My Window" 640 480
+//     box vertical
+//       label "lolwut noob" vexpand
+//       box horizontal padding=5
+//         label "(spacer)" hexpand
+//         textbutton "Ok" name=ok
+//
+// Widget lines are one of: window "title" width height, bin, box horizontal|vertical, button, label "text", textbutton "text"
+// Optional properties are: name=identifier, padding=n, padding-top=n, padding-bottom=n, padding-left=n, padding-right=n, hexpand, vexpand
+//
+// The binary form is mapped into memory by dUiLoad and instantiated in a single linear pass.
+
+typedef struct DUi DUi;
+
+bool dUiCompile(const char *textPath, const char *binaryPath); // returns false (and prints a warning) on any syntax or IO error
+
+DUi *dUiLoad(const char *binaryPath); // returns NULL on failure
+void dUiFree(DUi *ui); // note: this does not free the widgets created, which are owned by the caller as normal
+
+size_t dUiGetRootCount(const DUi *ui);
+DWidget *dUiGetRootN(DUi *ui, size_t n); // returns NULL if n is out of range
+DWidget *dUiGetWidget(DUi *ui, const char *name); // returns NULL if no widget was given this name
+
+#endif
@@ -1,20 +1,74 @@
 #include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <SDL2/SDL.h>
 
+#include "memoryprivate.h"
+#include "profilerprivate.h"
 #include "util.h"
 #include "utilprivate.h"
+#include "widgetprivate.h"
+
+// Every allocation is preceded by a header recording its size and owner, for memory accounting
+typedef union {
+	struct {
+		size_t size;
+		DWidgetType tag;
+	} h;
+	max_align_t align; // keep the memory returned to the caller suitably aligned
+} DAllocHeader;
+
+bool dVirtualTimeActive=false;
+DTimeMs dVirtualTime=0;
 
 void *dMallocNoFail(size_t size) {
-	return dReallocNoFail(NULL, size);
+	return dReallocTaggedNoFail(NULL, size, DWidgetTypeNB);
 }
 
 void *dReallocNoFail(void *ptr, size_t size) {
-	ptr=realloc(ptr, size);
+	return dReallocTaggedNoFail(ptr, size, DWidgetTypeNB);
+}
+
+void dFree(void *ptr) {
 	if (ptr==NULL)
+		return;
+
+	DAllocHeader *header=((DAllocHeader *)ptr)-1;
+	dMemoryAccountFree(header->h.tag, header->h.size);
+	free(header);
+}
+
+void *dMallocTaggedNoFail(size_t size, DWidgetType tag) {
+	return dReallocTaggedNoFail(NULL, size, tag);
+}
+
+void *dReallocTaggedNoFail(void *ptr, size_t size, DWidgetType tag) {
+	assert(tag>=0 && tag<=DWidgetTypeNB);
+
+	if (size>SIZE_MAX-sizeof(DAllocHeader))
 		dFatalError("error: memory allocation failure\n");
-	return ptr;
+
+	// Existing allocation keeps its original tag
+	DAllocHeader *header=(ptr!=NULL ? ((DAllocHeader *)ptr)-1 : NULL);
+	size_t oldSize=(header!=NULL ? header->h.size : 0);
+	if (header!=NULL)
+		tag=header->h.tag;
+
+	header=realloc(header, sizeof(DAllocHeader)+size);
+	if (header==NULL)
+		dFatalError("error: memory allocation failure\n");
+
+	header->h.size=size;
+	header->h.tag=tag;
+	if (ptr==NULL)
+		dMemoryAccountAlloc(tag, size);
+	else
+		dMemoryAccountRealloc(tag, oldSize, size);
+
+	return header+1;
 }
 
 void dFatalError(const char *format, ...) {
@@ -53,9 +107,64 @@ void dDelayMs(DTimeMs delay) {
 	SDL_Delay(delay);
 }
 
+DTimeMs dGetTimeMs(void) {
+	if (dVirtualTimeActive)
+		return dVirtualTime;
+
+	return SDL_GetTicks64();
+}
+
+DTimeUs dGetTimeUs(void) {
+	// Split conversion to avoid overflowing for large counter values
+	Uint64 counter=SDL_GetPerformanceCounter();
+	Uint64 frequency=SDL_GetPerformanceFrequency();
+	return (counter/frequency)*1000000+((counter%frequency)*1000000)/frequency;
+}
+
+void dSetVirtualTimeMs(DTimeMs time) {
+	assert(!dVirtualTimeActive || time>=dVirtualTime);
+
+	dVirtualTime=time;
+	dVirtualTimeActive=true;
+}
+
+void dClearVirtualTime(void) {
+	dVirtualTimeActive=false;
+}
+
 void dSetRenderDrawColour(SDL_Renderer *renderer, const DColour *colour) {
 	assert(renderer!=NULL);
 	assert(colour!=NULL);
 
 	SDL_SetRenderDrawColor(renderer, colour->r, colour->g, colour->b, colour->a);
 }
+
+SDL_Texture *dCreateTexture(SDL_Renderer *renderer, Uint32 format, int access, int width, int height) {
+	assert(renderer!=NULL);
+
+	SDL_Texture *texture=SDL_CreateTexture(renderer, format, access, width, height);
+	if (texture!=NULL)
+		dMemoryAccountTextureNew(renderer, texture);
+	return texture;
+}
+
+SDL_Texture *dCreateTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface) {
+	assert(renderer!=NULL);
+	assert(surface!=NULL);
+
+	SDL_Texture *texture=SDL_CreateTextureFromSurface(renderer, surface);
+	if (texture!=NULL) {
+		dProfilerCountTextureUpload();
+		dWidgetCountersAddTextureUpload();
+		dMemoryAccountTextureNew(renderer, texture);
+	}
+	return texture;
+}
+
+void dDestroyTexture(SDL_Texture *texture) {
+	if (texture==NULL)
+		return;
+
+	dMemoryAccountTextureFree(texture);
+	SDL_DestroyTexture(texture);
+}
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 
 typedef uint64_t DTimeMs;
+typedef uint64_t DTimeUs;
 
 typedef struct {
 	uint8_t r, g, b, a; // values in range 0-255
@@ -13,6 +14,10 @@ typedef struct {
 
 void *dMallocNoFail(size_t size);
 void *dReallocNoFail(void *ptr, size_t size);
+// Note: allocations carry a hidden header for memory accounting (see memory.h), so unlike in earlier versions
+// memory from dMallocNoFail/dReallocNoFail (including anything returned to the caller, e.g. by dTextViewGetText)
+// must be freed with dFree - passing it to free is undefined behaviour.
+void dFree(void *ptr);
 
 void dFatalError(const char *format, ...);
 void dFatalErrorV(const char *format, va_list ap);
@@ -21,5 +26,7 @@ void dWarning(const char *format, ...);
 void dWarningV(const char *format, va_list ap);
 
 void dDelayMs(DTimeMs delay);
+DTimeMs dGetTimeMs(void); // monotonic, relative to an arbitrary start point (virtual while replaying input, see replay.h)
+DTimeUs dGetTimeUs(void); // as dGetTimeMs but higher resolution (and not necessarily the same start point), and always real time
 
 #endif
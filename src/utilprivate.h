@@ -4,7 +4,23 @@
 #include <SDL2/SDL.h>
 
 #include "util.h"
+#include "widget.h"
+
+// As dMallocNoFail/dReallocNoFail, but memory is attributed to the given widget type for memory accounting (DWidgetTypeNB for none)
+// Reallocating keeps the original tag.
+void *dMallocTaggedNoFail(size_t size, DWidgetType tag);
+void *dReallocTaggedNoFail(void *ptr, size_t size, DWidgetType tag);
+
+// Virtual time, used when replaying input (UI thread only)
+// While set dGetTimeMs returns the given time rather than real time, which should not go backwards.
+void dSetVirtualTimeMs(DTimeMs time);
+void dClearVirtualTime(void);
 
 void dSetRenderDrawColour(SDL_Renderer *renderer, const DColour *colour);
 
+// Texture wrappers which keep memory accounting up to date (and for dCreateTextureFromSurface, count an upload for the profiler and widget counters)
+SDL_Texture *dCreateTexture(SDL_Renderer *renderer, Uint32 format, int access, int width, int height);
+SDL_Texture *dCreateTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface);
+void dDestroyTexture(SDL_Texture *texture); // texture can be NULL
+
 #endif
@@ -1,13 +1,20 @@
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "animationprivate.h"
 #include "binprivate.h"
 #include "container.h"
 #include "containerprivate.h"
 #include "labelprivate.h"
+#include "memoryprivate.h"
+#include "pool.h"
+#include "traceprivate.h"
 #include "util.h"
+#include "utilprivate.h"
 #include "widget.h"
 #include "widgetprivate.h"
 #include "windowprivate.h"
@@ -18,33 +25,102 @@ static const DWidgetType dWidgetTypeExtends[DWidgetTypeNB]={
 	[DWidgetTypeBin]=DWidgetTypeContainer,
 	[DWidgetTypeBox]=DWidgetTypeContainer,
 	[DWidgetTypeButton]=DWidgetTypeBin,
+	[DWidgetTypeCanvas]=DWidgetTypeWidget,
+	[DWidgetTypeChart]=DWidgetTypeWidget,
 	[DWidgetTypeContainer]=DWidgetTypeWidget,
+	[DWidgetTypeImage]=DWidgetTypeWidget,
 	[DWidgetTypeLabel]=DWidgetTypeWidget,
+	[DWidgetTypeLogView]=DWidgetTypeWidget,
+	[DWidgetTypeNumber]=DWidgetTypeWidget,
+	[DWidgetTypeTableView]=DWidgetTypeWidget,
 	[DWidgetTypeTextButton]=DWidgetTypeButton,
+	[DWidgetTypeTextView]=DWidgetTypeWidget,
+	[DWidgetTypeTreeView]=DWidgetTypeWidget,
 	[DWidgetTypeWindow]=DWidgetTypeBin,
 	[DWidgetTypeWidget]=DWidgetTypeNB,
 };
 
+unsigned dWidgetLayoutGenerationLast=0; // last generation given out to a tree, so that every invalidation gives a value not seen before
+
+bool dWidgetCountersEnabled=false;
+size_t dWidgetCountersVTable[DWidgetTypeNB][DWidgetVTableEntryNB]; // current frame
+size_t dWidgetCountersVTableLast[DWidgetTypeNB][DWidgetVTableEntryNB]; // last completed frame
+size_t dWidgetCountersTextureUploads=0;
+size_t dWidgetCountersTextureUploadsLast=0;
+
+// Parallel layout (see dWidgetLayoutMeasureParallel)
+typedef struct {
+	DWidget *parent;
+	size_t first, count; // range of parent's children to measure
+} DWidgetLayoutRun;
+
+typedef struct {
+	DWidgetLayoutFlag flag;
+	DWidgetLayoutRun *runs;
+	size_t runCount, runAlloc;
+	atomic_size_t runNext; // next run to be claimed (by a worker or the UI thread)
+	atomic_size_t runsDone;
+	size_t refCount; // UI thread only - one for the pass itself plus one per pool task which has not yet completed
+} DWidgetLayoutPass;
+
+const size_t dWidgetLayoutParallelThreshold=16384; // subtrees with fewer widgets than this are always measured on the UI thread alone
+const size_t dWidgetLayoutParallelGrainMin=1024; // fewest widgets worth measuring as a single run
+
+bool dWidgetLayoutParallelActive=false; // UI thread only - prevents starting a pass from within another
+SDL_sem *dWidgetLayoutParallelDoneSem=NULL; // shared by all passes (only one runs at a time) - posted once all runs of the current pass are done, created on first use
+_Thread_local bool dWidgetLayoutOnWorker=false; // true while measuring runs on a pool worker
+_Thread_local bool dWidgetLayoutWorkerFailed=false; // set if the child being measured on a pool worker needs the UI thread (see dWidgetLayoutRequireUiThread)
+
+DWidgetObjectData *dWidgetUpdateGetWindowData(DWidget *widget); // returns object data of the window containing widget, or NULL if it is not within one
+bool dWidgetUpdateIsOpen(DWidget *widget); // returns true if a transaction is open within widget's window
+DWidgetUpdatePendingEntry *dWidgetUpdatePendingAdd(DWidget *widget); // returns widget's entry in its window's pending list, adding one (with an empty rect) if needed
+void dWidgetUpdateCommit(DWidget *window); // marks window as dirty (or damaged, if all pending widgets only have a rect)
+void dWidgetUpdateForget(DWidget *widget); // removes widget from its window's pending list (if present)
+
+void dWidgetCountersAddVTable(DWidgetType type, DWidgetVTableEntry entry);
+
+void dWidgetLayoutInvalidate(DWidget *widget); // invalidates cached layout of every widget in the same tree as the given one (but not others)
+bool dWidgetLayoutCacheGet(const DWidget *widget, DWidgetLayoutFlag flag, const int *field, int *value); // returns true and sets *value if cached copy of field is valid
+void dWidgetLayoutCacheSet(DWidget *widget, DWidgetLayoutFlag flag, int *field, int value);
+bool dWidgetLayoutIsCached(const DWidget *widget, DWidgetLayoutFlag flag);
+
+int dWidgetLayoutMeasure(DWidget *widget, DWidgetLayoutFlag flag); // calls the getter for the given flag (which must be one of width, height, min width or min height)
+void dWidgetLayoutMeasureParallel(DWidget *widget, DWidgetLayoutFlag flag); // if widget has a large subtree, measures its descendants across the pool, leaving the results in the layout cache
+void dWidgetLayoutCollectRuns(DWidgetLayoutPass *pass, DWidget *container, size_t grain);
+void dWidgetLayoutAddRun(DWidgetLayoutPass *pass, DWidget *parent, size_t first, size_t count); // does nothing if count is 0
+void dWidgetLayoutMeasureRuns(DWidgetLayoutPass *pass); // claims and measures runs until none are left
+void dWidgetLayoutPassRelease(DWidgetLayoutPass *pass);
+void dWidgetLayoutPoolTask(void *userData);
+void dWidgetLayoutPoolCompletion(void *userData);
+
 int dWidgetVTableGetMinWidth(DWidget *widget);
 int dWidgetVTableGetMinHeight(DWidget *widget);
 int dWidgetVTableGetWidth(DWidget *widget);
 int dWidgetVTableGetHeight(DWidget *widget);
 
-DWidgetObjectData *dWidgetObjectDataNew(DWidgetType type);
+DWidgetObjectData *dWidgetObjectDataNew(DWidgetType type, DWidgetType tag); // tag is the base type, for memory accounting
 void dWidgetObjectDataFree(DWidgetObjectData *data);
 
 DWidget *dWidgetNew(DWidgetType type) {
 	assert(dWidgetTypeIsValid(type));
 
 	// Allocate widget memory and init fields
-	DWidget *widget=dMallocNoFail(sizeof(DWidget));
+	DWidget *widget=dMallocTaggedNoFail(sizeof(DWidget), type);
+	dMemoryAccountWidgetNew(type);
 
 	widget->base=NULL;
 	widget->parent=NULL;
 	memset(widget->signalsCount, 0, sizeof(widget->signalsCount[0])*DWidgetSignalTypeNB);
+	widget->updatePendingIndex=SIZE_MAX;
+	widget->subtreeSize=1;
+	widget->layoutRoot=widget;
+	widget->layoutGeneration=0;
+	dWidgetLayoutInvalidate(widget);
+	widget->layout.generation=0;
+	widget->layout.flags=0;
 
 	// Initialise all sub classes - base one and any others it derives from
-	widget->base=dWidgetObjectDataNew(type);
+	widget->base=dWidgetObjectDataNew(type, type);
 
 	return widget;
 }
@@ -81,6 +157,7 @@ void dWidgetDestructor(DWidget *widget, DWidgetObjectData *data) {
 	// starting from the given sub class
 	while(data!=NULL) {
 		if (data->vtable.destructor!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryDestructor);
 			data->vtable.destructor(widget);
 			break;
 		}
@@ -102,6 +179,23 @@ SDL_Renderer *dWidgetGetRenderer(DWidget *widget) {
 void dWidgetSetDirty(DWidget *widget) {
 	assert(widget!=NULL);
 
+	// Cached geometry of any widget in the same window may now be wrong
+	dWidgetLayoutInvalidate(widget);
+
+	// Mark containing window as dirty to redraw
+	dWidgetSetDirtyAppearance(widget);
+}
+
+void dWidgetSetDirtyAppearance(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// If an update transaction is open within the widget's window simply remember the widget for later,
+	// avoiding walking up the tree to find the window on every call
+	if (dWidgetUpdateIsOpen(widget)) {
+		dWidgetUpdatePendingAdd(widget)->whole=true;
+		return;
+	}
+
 	DWidget *window=dWidgetGetWindow(widget);
 	if (window==NULL)
 		return;
@@ -109,6 +203,66 @@ void dWidgetSetDirty(DWidget *widget) {
 	dWindowSetDirty(window);
 }
 
+void dWidgetSetDirtyRect(DWidget *widget, const SDL_Rect *rect) {
+	assert(widget!=NULL);
+	assert(rect!=NULL);
+
+	// If an update transaction is open then remember the area for later, as with dWidgetSetDirtyAppearance
+	// (also avoiding computing the widget's position, which may yet change before the transaction ends)
+	if (dWidgetUpdateIsOpen(widget)) {
+		DWidgetUpdatePendingEntry *entry=dWidgetUpdatePendingAdd(widget);
+		if (entry->whole || rect->w<=0 || rect->h<=0)
+			return;
+		if (entry->rect.w>0 && entry->rect.h>0)
+			SDL_UnionRect(&entry->rect, rect, &entry->rect);
+		else
+			entry->rect=*rect;
+		return;
+	}
+
+	DWidget *window=dWidgetGetWindow(widget);
+	if (window==NULL)
+		return;
+
+	// Clip to the widget's own area
+	SDL_Rect bounds={.x=0, .y=0, .w=dWidgetGetWidth(widget), .h=dWidgetGetHeight(widget)};
+	SDL_Rect damage;
+	if (!SDL_IntersectRect(rect, &bounds, &damage))
+		return;
+
+	// Convert to window coordinates
+	damage.x+=dWidgetGetGlobalX(widget);
+	damage.y+=dWidgetGetGlobalY(widget);
+
+	dWindowAddDamage(window, &damage);
+}
+
+void dWidgetSetDirtyBounds(DWidget *widget) {
+	assert(widget!=NULL);
+
+	SDL_Rect rect={.x=0, .y=0, .w=dWidgetGetWidth(widget), .h=dWidgetGetHeight(widget)};
+	dWidgetSetDirtyRect(widget, &rect);
+}
+
+unsigned dWidgetGetLayoutGeneration(const DWidget *widget) {
+	assert(widget!=NULL);
+
+	return widget->layoutRoot->layoutGeneration;
+}
+
+void dWidgetSetLayoutRoot(DWidget *widget, DWidget *root) {
+	assert(widget!=NULL);
+	assert(root!=NULL);
+
+	widget->layoutRoot=root;
+
+	if (dWidgetGetHasType(widget, DWidgetTypeContainer)) {
+		size_t childCount=dContainerGetChildCount(widget);
+		for(size_t i=0; i<childCount; ++i)
+			dWidgetSetLayoutRoot(dContainerGetChildN(widget, i), root);
+	}
+}
+
 void dWidgetRedraw(DWidget *widget, DWidgetObjectData *data, SDL_Renderer *renderer) {
 	assert(widget!=NULL);
 	// data can be NULL
@@ -118,6 +272,7 @@ void dWidgetRedraw(DWidget *widget, DWidgetObjectData *data, SDL_Renderer *rende
 	// starting from the given sub class
 	while(data!=NULL) {
 		if (data->vtable.redraw!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryRedraw);
 			data->vtable.redraw(widget, renderer);
 			break;
 		}
@@ -131,14 +286,27 @@ void dWidgetFree(DWidget *widget) {
 	if (widget==NULL)
 		return;
 
+	// Ensure no pending update transaction or cached layout still refers to this widget
+	dWidgetUpdateForget(widget);
+	dWidgetLayoutInvalidate(widget);
+
+	// Similarly for the window's pointer state
+	DWidget *window=dWidgetGetWindow(widget);
+	if (window!=NULL && window!=widget)
+		dWindowForgetWidget(window, widget);
+
+	// Stop any animations of this widget
+	dAnimationForgetWidget(widget);
+
 	// Call first destructor we find (if any), starting with the base class
 	dWidgetDestructor(widget, widget->base);
 
 	// Free base object (and any others it derives from)
+	dMemoryAccountWidgetFree(widget->base->type);
 	dWidgetObjectDataFree(widget->base);
 
 	// Free memory
-	free(widget);
+	dFree(widget);
 }
 
 DWidget *dWidgetGetParent(DWidget *widget) {
@@ -244,10 +412,22 @@ DWidget *dWidgetGetWidgetByXY(DWidget *widget, int globalX, int globalY) {
 int dWidgetGetMinWidth(DWidget *widget) {
 	assert(widget!=NULL);
 
+	// Use cached value if nothing has changed since it was computed
+	int value;
+	if (dWidgetLayoutCacheGet(widget, DWidgetLayoutFlagMinWidth, &widget->layout.minWidth, &value))
+		return value;
+
+	// Large subtrees have their children measured in parallel first, so the vtable call below finds their values cached
+	dWidgetLayoutMeasureParallel(widget, DWidgetLayoutFlagMinWidth);
+
 	DWidgetObjectData *data;
 	for(data=widget->base; data!=NULL; data=data->super)
-		if (data->vtable.getMinWidth!=NULL)
-			return data->vtable.getMinWidth(widget);
+		if (data->vtable.getMinWidth!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryGetMinWidth);
+			value=data->vtable.getMinWidth(widget);
+			dWidgetLayoutCacheSet(widget, DWidgetLayoutFlagMinWidth, &widget->layout.minWidth, value);
+			return value;
+		}
 
 	dFatalError("error: widget %p (%s) has no getMinWidth vtable entry\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
 	return 0;
@@ -256,10 +436,22 @@ int dWidgetGetMinWidth(DWidget *widget) {
 int dWidgetGetMinHeight(DWidget *widget) {
 	assert(widget!=NULL);
 
+	// Use cached value if nothing has changed since it was computed
+	int value;
+	if (dWidgetLayoutCacheGet(widget, DWidgetLayoutFlagMinHeight, &widget->layout.minHeight, &value))
+		return value;
+
+	// Large subtrees have their children measured in parallel first, so the vtable call below finds their values cached
+	dWidgetLayoutMeasureParallel(widget, DWidgetLayoutFlagMinHeight);
+
 	DWidgetObjectData *data;
 	for(data=widget->base; data!=NULL; data=data->super)
-		if (data->vtable.getMinHeight!=NULL)
-			return data->vtable.getMinHeight(widget);
+		if (data->vtable.getMinHeight!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryGetMinHeight);
+			value=data->vtable.getMinHeight(widget);
+			dWidgetLayoutCacheSet(widget, DWidgetLayoutFlagMinHeight, &widget->layout.minHeight, value);
+			return value;
+		}
 
 	dFatalError("error: widget %p (%s) has no getMinHeight vtable entry\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
 	return 0;
@@ -268,10 +460,22 @@ int dWidgetGetMinHeight(DWidget *widget) {
 int dWidgetGetWidth(DWidget *widget) {
 	assert(widget!=NULL);
 
+	// Use cached value if nothing has changed since it was computed
+	int value;
+	if (dWidgetLayoutCacheGet(widget, DWidgetLayoutFlagWidth, &widget->layout.width, &value))
+		return value;
+
+	// Large subtrees have their children measured in parallel first, so the vtable call below finds their values cached
+	dWidgetLayoutMeasureParallel(widget, DWidgetLayoutFlagWidth);
+
 	DWidgetObjectData *data;
 	for(data=widget->base; data!=NULL; data=data->super)
-		if (data->vtable.getWidth!=NULL)
-			return data->vtable.getWidth(widget);
+		if (data->vtable.getWidth!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryGetWidth);
+			value=data->vtable.getWidth(widget);
+			dWidgetLayoutCacheSet(widget, DWidgetLayoutFlagWidth, &widget->layout.width, value);
+			return value;
+		}
 
 	dFatalError("error: widget %p (%s) has no getWidth vtable entry\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
 	return 0;
@@ -280,10 +484,22 @@ int dWidgetGetWidth(DWidget *widget) {
 int dWidgetGetHeight(DWidget *widget) {
 	assert(widget!=NULL);
 
+	// Use cached value if nothing has changed since it was computed
+	int value;
+	if (dWidgetLayoutCacheGet(widget, DWidgetLayoutFlagHeight, &widget->layout.height, &value))
+		return value;
+
+	// Large subtrees have their children measured in parallel first, so the vtable call below finds their values cached
+	dWidgetLayoutMeasureParallel(widget, DWidgetLayoutFlagHeight);
+
 	DWidgetObjectData *data;
 	for(data=widget->base; data!=NULL; data=data->super)
-		if (data->vtable.getHeight!=NULL)
-			return data->vtable.getHeight(widget);
+		if (data->vtable.getHeight!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryGetHeight);
+			value=data->vtable.getHeight(widget);
+			dWidgetLayoutCacheSet(widget, DWidgetLayoutFlagHeight, &widget->layout.height, value);
+			return value;
+		}
 
 	dFatalError("error: widget %p (%s) has no getHeight vtable entry\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
 	return 0;
@@ -298,10 +514,18 @@ int dWidgetGetGlobalX(DWidget *widget) {
 	if (parent==NULL)
 		return 0;
 
+	// Use cached value if nothing has changed since it was computed
+	int value;
+	if (dWidgetLayoutCacheGet(widget, DWidgetLayoutFlagGlobalX, &widget->layout.globalX, &value))
+		return value;
+
 	// Grab parents position and our offset within, and return sum
 	int parentPos=dWidgetGetGlobalX(parent);
 	int offset=dWidgetGetChildXOffset(parent, widget);
-	return parentPos+offset;
+	value=parentPos+offset;
+
+	dWidgetLayoutCacheSet(widget, DWidgetLayoutFlagGlobalX, &widget->layout.globalX, value);
+	return value;
 }
 
 int dWidgetGetGlobalY(DWidget *widget) {
@@ -313,10 +537,18 @@ int dWidgetGetGlobalY(DWidget *widget) {
 	if (parent==NULL)
 		return 0;
 
+	// Use cached value if nothing has changed since it was computed
+	int value;
+	if (dWidgetLayoutCacheGet(widget, DWidgetLayoutFlagGlobalY, &widget->layout.globalY, &value))
+		return value;
+
 	// Grab parents position and our offset within, and return sum
 	int parentPos=dWidgetGetGlobalY(parent);
 	int offset=dWidgetGetChildYOffset(parent, widget);
-	return parentPos+offset;
+	value=parentPos+offset;
+
+	dWidgetLayoutCacheSet(widget, DWidgetLayoutFlagGlobalY, &widget->layout.globalY, value);
+	return value;
 }
 
 int dWidgetGetChildXOffset(DWidget *parent, DWidget *child) {
@@ -326,8 +558,10 @@ int dWidgetGetChildXOffset(DWidget *parent, DWidget *child) {
 
 	DWidgetObjectData *data;
 	for(data=parent->base; data!=NULL; data=data->super)
-		if (data->vtable.getChildXOffset!=NULL)
+		if (data->vtable.getChildXOffset!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryGetChildXOffset);
 			return data->vtable.getChildXOffset(parent, child);
+		}
 
 	dFatalError("error: widget %p (%s) has no getChildXOffset vtable entry\n", parent, dWidgetTypeToString(dWidgetGetBaseType(parent)));
 	return 0;
@@ -340,8 +574,10 @@ int dWidgetGetChildYOffset(DWidget *parent, DWidget *child) {
 
 	DWidgetObjectData *data;
 	for(data=parent->base; data!=NULL; data=data->super)
-		if (data->vtable.getChildYOffset!=NULL)
+		if (data->vtable.getChildYOffset!=NULL) {
+			dWidgetCountersAddVTable(data->type, DWidgetVTableEntryGetChildYOffset);
 			return data->vtable.getChildYOffset(parent, child);
+		}
 
 	dFatalError("error: widget %p (%s) has no getChildYOffset vtable entry\n", parent, dWidgetTypeToString(dWidgetGetBaseType(parent)));
 	return 0;
@@ -502,6 +738,93 @@ void dWidgetSetVExpand(DWidget *widget, bool vexpand) {
 	dWidgetSetDirty(widget);
 }
 
+void dWidgetBeginUpdate(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// Nothing to defer if not within a window (invalidation does nothing until the widget is added to one)
+	DWidgetObjectData *windowData=dWidgetUpdateGetWindowData(widget);
+	if (windowData==NULL)
+		return;
+
+	// Setters check the depth of their own window to decide whether to defer invalidation
+	++windowData->d.window.updateDepth;
+}
+
+void dWidgetEndUpdate(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *windowData=dWidgetUpdateGetWindowData(widget);
+	if (windowData==NULL)
+		return;
+
+	if (windowData->d.window.updateDepth==0) {
+		dWarning("warning: dWidgetEndUpdate called on widget %p (%s) without matching dWidgetBeginUpdate\n", widget, dWidgetTypeToString(dWidgetGetBaseType(widget)));
+		return;
+	}
+
+	// Commit if this was the outermost transaction within this window
+	if (--windowData->d.window.updateDepth==0)
+		dWidgetUpdateCommit(widget->layoutRoot);
+}
+
+bool dWidgetCapturePointer(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidget *window=dWidgetGetWindow(widget);
+	if (window==NULL)
+		return false;
+
+	dWindowSetPointerCapture(window, widget);
+	return true;
+}
+
+void dWidgetReleasePointer(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// Do we actually hold the capture?
+	DWidget *window=dWidgetGetWindow(widget);
+	if (window==NULL || dWindowGetPointerCapture(window)!=widget)
+		return;
+
+	dWindowSetPointerCapture(window, NULL);
+}
+
+bool dWidgetHasPointerCapture(const DWidget *widget) {
+	assert(widget!=NULL);
+
+	const DWidget *window=dWidgetGetWindowConst(widget);
+	return (window!=NULL && dWindowGetPointerCaptureConst(window)==widget);
+}
+
+bool dWidgetGrabKeyboardFocus(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidget *window=dWidgetGetWindow(widget);
+	if (window==NULL)
+		return false;
+
+	dWindowSetKeyboardFocusWidget(window, widget);
+	return true;
+}
+
+void dWidgetReleaseKeyboardFocus(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// Do we actually have focus?
+	DWidget *window=dWidgetGetWindow(widget);
+	if (window==NULL || dWindowGetKeyboardFocusWidget(window)!=widget)
+		return;
+
+	dWindowSetKeyboardFocusWidget(window, NULL);
+}
+
+bool dWidgetHasKeyboardFocus(const DWidget *widget) {
+	assert(widget!=NULL);
+
+	const DWidget *window=dWidgetGetWindowConst(widget);
+	return (window!=NULL && dWindowGetKeyboardFocusWidgetConst(window)==widget);
+}
+
 bool dWidgetSignalConnect(DWidget *widget, DWidgetSignalType type, DWidgetSignalHandler *handler, void *userData) {
 	assert(widget!=NULL);
 	assert(dWidgetSignalTypeIsValid(type));
@@ -532,13 +855,26 @@ DWidgetSignalReturn dWidgetSignalInvoke(const DWidgetSignalEvent *event) {
 	assert(dWidgetSignalTypeIsValid(event->type));
 	assert(event->widget!=NULL);
 
+	// No handlers? (common when bubbling, so avoid tracing these)
+	size_t count=event->widget->signalsCount[event->type];
+	if (count==0)
+		return DWidgetSignalReturnContinue;
+
+	DTimeUs traceStart=dTraceBegin();
+
 	// Loop over registered handlers calling each one in turn (stopping early if any handlers request this)
-	for(size_t i=0; i<event->widget->signalsCount[event->type]; ++i) {
+	DWidgetSignalReturn result=DWidgetSignalReturnContinue;
+	for(size_t i=0; i<count; ++i) {
 		const DWidgetSignalData *signalData=&event->widget->signals[event->type][i];
-		if (signalData->handler(event, signalData->userData)==DWidgetSignalReturnStop)
-			return DWidgetSignalReturnStop;
+		if (signalData->handler(event, signalData->userData)==DWidgetSignalReturnStop) {
+			result=DWidgetSignalReturnStop;
+			break;
+		}
 	}
-	return DWidgetSignalReturnContinue;
+
+	dTraceEnd(traceStart, dWidgetSignalTypeToString(event->type), "signal", dWidgetTypeToString(dWidgetGetBaseType(event->widget)));
+
+	return result;
 }
 
 void dWidgetDebug(DWidget *widget, int indentation) {
@@ -558,6 +894,54 @@ void dWidgetDebug(DWidget *widget, int indentation) {
 		for(size_t i=0; i<childCount; ++i)
 			dWidgetDebug(dContainerGetChildN(widget, i), indentation+2);
 	}
+
+	// Print counters once, after the whole tree
+	if (indentation==0 && dWidgetCountersEnabled) {
+		printf("counters for last frame: %zu texture uploads\n", dWidgetCountersTextureUploadsLast);
+		for(DWidgetType type=0; type<DWidgetTypeNB; ++type)
+			for(DWidgetVTableEntry entry=0; entry<DWidgetVTableEntryNB; ++entry)
+				if (dWidgetCountersVTableLast[type][entry]>0)
+					printf("  %s %s: %zu\n", dWidgetTypeToString(type), dWidgetVTableEntryToString(entry), dWidgetCountersVTableLast[type][entry]);
+	}
+}
+
+void dWidgetCountersSetEnabled(bool enabled) {
+	dWidgetCountersEnabled=enabled;
+}
+
+bool dWidgetCountersGetEnabled(void) {
+	return dWidgetCountersEnabled;
+}
+
+size_t dWidgetCountersGetVTable(DWidgetType type, DWidgetVTableEntry entry) {
+	assert(dWidgetTypeIsValid(type));
+	assert(dWidgetVTableEntryIsValid(entry));
+
+	return dWidgetCountersVTableLast[type][entry];
+}
+
+size_t dWidgetCountersGetTextureUploads(void) {
+	return dWidgetCountersTextureUploadsLast;
+}
+
+void dWidgetCountersFrameEnd(void) {
+	if (!dWidgetCountersEnabled)
+		return;
+
+	memcpy(dWidgetCountersVTableLast, dWidgetCountersVTable, sizeof(dWidgetCountersVTable));
+	memset(dWidgetCountersVTable, 0, sizeof(dWidgetCountersVTable));
+	dWidgetCountersTextureUploadsLast=dWidgetCountersTextureUploads;
+	dWidgetCountersTextureUploads=0;
+}
+
+void dWidgetCountersAddTextureUpload(void) {
+	if (dWidgetCountersEnabled)
+		++dWidgetCountersTextureUploads;
+}
+
+void dWidgetCountersAddVTable(DWidgetType type, DWidgetVTableEntry entry) {
+	if (dWidgetCountersEnabled)
+		++dWidgetCountersVTable[type][entry];
 }
 
 bool dWidgetOrientationIsValid(DWidgetOrientation orientation) {
@@ -572,9 +956,17 @@ static const char *dWidgetTypeStrings[DWidgetTypeNB]={
 	[DWidgetTypeBin]="Bin",
 	[DWidgetTypeBox]="Box",
 	[DWidgetTypeButton]="Button",
+	[DWidgetTypeCanvas]="Canvas",
+	[DWidgetTypeChart]="Chart",
 	[DWidgetTypeContainer]="Container",
+	[DWidgetTypeImage]="Image",
 	[DWidgetTypeLabel]="Label",
+	[DWidgetTypeLogView]="LogView",
+	[DWidgetTypeNumber]="Number",
+	[DWidgetTypeTableView]="TableView",
 	[DWidgetTypeTextButton]="TextButton",
+	[DWidgetTypeTextView]="TextView",
+	[DWidgetTypeTreeView]="TreeView",
 	[DWidgetTypeWindow]="Window",
 	[DWidgetTypeWidget]="Widget",
 };
@@ -584,6 +976,26 @@ const char *dWidgetTypeToString(DWidgetType type) {
 	return dWidgetTypeStrings[type];
 }
 
+bool dWidgetVTableEntryIsValid(DWidgetVTableEntry entry) {
+	return (entry>=0 && entry<DWidgetVTableEntryNB);
+}
+
+static const char *dWidgetVTableEntryStrings[DWidgetVTableEntryNB]={
+	[DWidgetVTableEntryDestructor]="destructor",
+	[DWidgetVTableEntryRedraw]="redraw",
+	[DWidgetVTableEntryGetMinWidth]="getMinWidth",
+	[DWidgetVTableEntryGetMinHeight]="getMinHeight",
+	[DWidgetVTableEntryGetWidth]="getWidth",
+	[DWidgetVTableEntryGetHeight]="getHeight",
+	[DWidgetVTableEntryGetChildXOffset]="getChildXOffset",
+	[DWidgetVTableEntryGetChildYOffset]="getChildYOffset",
+};
+const char *dWidgetVTableEntryToString(DWidgetVTableEntry entry) {
+	assert(dWidgetVTableEntryIsValid(entry));
+
+	return dWidgetVTableEntryStrings[entry];
+}
+
 bool dWidgetSignalTypeIsValid(DWidgetSignalType type) {
 	return (type>=0 && type<DWidgetSignalTypeNB);
 }
@@ -594,6 +1006,12 @@ static const char *dWidgetSignalTypeStrings[]={
 	[DWidgetSignalTypeWidgetButtonRelease]="WidgetButtonRelease",
 	[DWidgetSignalTypeWidgetEnter]="WidgetEnter",
 	[DWidgetSignalTypeWidgetLeave]="WidgetLeave",
+	[DWidgetSignalTypeWidgetMouseMotion]="WidgetMouseMotion",
+	[DWidgetSignalTypeWidgetMouseWheel]="WidgetMouseWheel",
+	[DWidgetSignalTypeWidgetKeyDown]="WidgetKeyDown",
+	[DWidgetSignalTypeWidgetTextInput]="WidgetTextInput",
+	[DWidgetSignalTypeWidgetFocusIn]="WidgetFocusIn",
+	[DWidgetSignalTypeWidgetFocusOut]="WidgetFocusOut",
 	[DWidgetSignalTypeWindowClose]="WindowClose",
 };
 const char *dWidgetSignalTypeToString(DWidgetSignalType type) {
@@ -613,6 +1031,12 @@ DWidgetType dWidgetSignalTypeToWidgetType(DWidgetSignalType type) {
 		case DWidgetSignalTypeWidgetButtonRelease:
 		case DWidgetSignalTypeWidgetEnter:
 		case DWidgetSignalTypeWidgetLeave:
+		case DWidgetSignalTypeWidgetMouseMotion:
+		case DWidgetSignalTypeWidgetMouseWheel:
+		case DWidgetSignalTypeWidgetKeyDown:
+		case DWidgetSignalTypeWidgetTextInput:
+		case DWidgetSignalTypeWidgetFocusIn:
+		case DWidgetSignalTypeWidgetFocusOut:
 			return DWidgetTypeWidget;
 		break;
 		case DWidgetSignalTypeWindowClose:
@@ -674,6 +1098,365 @@ const DWidgetObjectData *dWidgetGetObjectDataConstNoFail(const DWidget *widget,
 	return data;
 }
 
+DWidgetObjectData *dWidgetUpdateGetWindowData(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// Windows are always the root of their tree, so this avoids walking up to find one
+	return dWidgetGetObjectData(widget->layoutRoot, DWidgetTypeWindow);
+}
+
+bool dWidgetUpdateIsOpen(DWidget *widget) {
+	assert(widget!=NULL);
+
+	DWidgetObjectData *windowData=dWidgetUpdateGetWindowData(widget);
+	return (windowData!=NULL && windowData->d.window.updateDepth>0);
+}
+
+void dWidgetUpdateCommit(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *windowData=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+	assert(windowData->d.window.updateDepth==0);
+
+	DWidgetUpdatePendingEntry *pending=windowData->d.window.updatePending;
+	size_t pendingCount=windowData->d.window.updatePendingCount;
+
+	// Nothing to do?
+	if (pendingCount==0)
+		return;
+
+	// All pending widgets are within this window, so a single widget needing redrawing in full means the whole window does
+	bool whole=false;
+	for(size_t i=0; i<pendingCount && !whole; ++i)
+		whole=pending[i].whole;
+
+	// Otherwise add damage for each pending rect (now the transaction is closed this is no longer deferred)
+	if (whole)
+		dWindowSetDirty(window);
+	else {
+		for(size_t i=0; i<pendingCount; ++i)
+			dWidgetSetDirtyRect(pending[i].widget, &pending[i].rect);
+	}
+
+	// Clear pending list (keeping the memory for next time)
+	for(size_t i=0; i<pendingCount; ++i)
+		pending[i].widget->updatePendingIndex=SIZE_MAX;
+	windowData->d.window.updatePendingCount=0;
+}
+
+DWidgetUpdatePendingEntry *dWidgetUpdatePendingAdd(DWidget *widget) {
+	assert(widget!=NULL);
+	assert(dWidgetUpdateIsOpen(widget));
+
+	DWidgetObjectData *windowData=dWidgetUpdateGetWindowData(widget);
+
+	// Already have an entry?
+	if (widget->updatePendingIndex!=SIZE_MAX)
+		return &windowData->d.window.updatePending[widget->updatePendingIndex];
+
+	if (windowData->d.window.updatePendingCount==windowData->d.window.updatePendingAlloc) {
+		windowData->d.window.updatePendingAlloc=(windowData->d.window.updatePendingAlloc>0 ? 2*windowData->d.window.updatePendingAlloc : 64);
+		windowData->d.window.updatePending=dReallocTaggedNoFail(windowData->d.window.updatePending, sizeof(DWidgetUpdatePendingEntry)*windowData->d.window.updatePendingAlloc, DWidgetTypeWindow);
+	}
+
+	widget->updatePendingIndex=windowData->d.window.updatePendingCount;
+	DWidgetUpdatePendingEntry *entry=&windowData->d.window.updatePending[windowData->d.window.updatePendingCount++];
+	entry->widget=widget;
+	entry->whole=false;
+	entry->rect=(SDL_Rect){.x=0, .y=0, .w=0, .h=0};
+
+	return entry;
+}
+
+void dWidgetUpdateForget(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// Not pending?
+	size_t index=widget->updatePendingIndex;
+	if (index==SIZE_MAX)
+		return;
+
+	// Remove entry by moving the last one into its place (order is not important)
+	DWidgetObjectData *windowData=dWidgetUpdateGetWindowData(widget);
+	assert(windowData!=NULL);
+	DWidgetUpdatePendingEntry *pending=windowData->d.window.updatePending;
+	pending[index]=pending[--windowData->d.window.updatePendingCount];
+	pending[index].widget->updatePendingIndex=index;
+	widget->updatePendingIndex=SIZE_MAX;
+}
+
+void dWidgetUpdateWindowFree(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *windowData=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	if (windowData->d.window.updateDepth>0)
+		dWarning("warning: window %p freed with %zu update transaction(s) still open\n", window, windowData->d.window.updateDepth);
+
+	// Any widgets still pending are no longer
+	for(size_t i=0; i<windowData->d.window.updatePendingCount; ++i)
+		windowData->d.window.updatePending[i].widget->updatePendingIndex=SIZE_MAX;
+
+	dFree(windowData->d.window.updatePending);
+	windowData->d.window.updatePending=NULL;
+	windowData->d.window.updatePendingCount=0;
+	windowData->d.window.updatePendingAlloc=0;
+	windowData->d.window.updateDepth=0;
+}
+
+void dWidgetQuit(void) {
+	// Note: the pool has already been stopped by now (see digitsQuit), so no late layout task can be using this
+	if (dWidgetLayoutParallelDoneSem!=NULL) {
+		SDL_DestroySemaphore(dWidgetLayoutParallelDoneSem);
+		dWidgetLayoutParallelDoneSem=NULL;
+	}
+}
+
+void dWidgetLayoutInvalidate(DWidget *widget) {
+	assert(widget!=NULL);
+
+	// Giving the tree a new generation invalidates all cached values within it at once
+	// (generations are never reused across trees, so widgets moved from another tree cannot match by accident)
+	if (++dWidgetLayoutGenerationLast==0)
+		++dWidgetLayoutGenerationLast;
+	widget->layoutRoot->layoutGeneration=dWidgetLayoutGenerationLast;
+}
+
+bool dWidgetLayoutCacheGet(const DWidget *widget, DWidgetLayoutFlag flag, const int *field, int *value) {
+	assert(widget!=NULL);
+	assert(field!=NULL);
+	assert(value!=NULL);
+
+	if (widget->layout.generation!=widget->layoutRoot->layoutGeneration || !(widget->layout.flags & flag))
+		return false;
+
+	*value=*field;
+	return true;
+}
+
+void dWidgetLayoutCacheSet(DWidget *widget, DWidgetLayoutFlag flag, int *field, int value) {
+	assert(widget!=NULL);
+	assert(field!=NULL);
+
+	// Value depends on a widget which could not be measured on this pool worker?
+	// (it is left uncached so that the UI thread measures it again)
+	if (dWidgetLayoutWorkerFailed)
+		return;
+
+	// Clear any values left over from an old generation
+	if (widget->layout.generation!=widget->layoutRoot->layoutGeneration) {
+		widget->layout.generation=widget->layoutRoot->layoutGeneration;
+		widget->layout.flags=0;
+	}
+
+	*field=value;
+	widget->layout.flags|=flag;
+}
+
+bool dWidgetLayoutIsCached(const DWidget *widget, DWidgetLayoutFlag flag) {
+	assert(widget!=NULL);
+
+	return (widget->layout.generation==widget->layoutRoot->layoutGeneration && (widget->layout.flags & flag));
+}
+
+bool dWidgetLayoutRequireUiThread(void) {
+	if (!dWidgetLayoutOnWorker)
+		return true;
+
+	// Abandon measuring the current child - values computed from here on are not cached (see dWidgetLayoutCacheSet)
+	dWidgetLayoutWorkerFailed=true;
+	return false;
+}
+
+int dWidgetLayoutMeasure(DWidget *widget, DWidgetLayoutFlag flag) {
+	assert(widget!=NULL);
+
+	switch(flag) {
+		case DWidgetLayoutFlagWidth: return dWidgetGetWidth(widget);
+		case DWidgetLayoutFlagHeight: return dWidgetGetHeight(widget);
+		case DWidgetLayoutFlagMinWidth: return dWidgetGetMinWidth(widget);
+		case DWidgetLayoutFlagMinHeight: return dWidgetGetMinHeight(widget);
+		case DWidgetLayoutFlagGlobalX:
+		case DWidgetLayoutFlagGlobalY:
+		break;
+	}
+
+	assert(false);
+	return 0;
+}
+
+void dWidgetLayoutMeasureParallel(DWidget *widget, DWidgetLayoutFlag flag) {
+	assert(widget!=NULL);
+
+	// Small subtrees are quicker to measure directly
+	if (widget->subtreeSize<dWidgetLayoutParallelThreshold)
+		return;
+
+	// Only the UI thread starts passes, and only one at a time (runs are never split further once handed out)
+	if (dWidgetLayoutOnWorker || dWidgetLayoutParallelActive)
+		return;
+
+	// Vtable call counters are not thread safe, and the pool may not be running
+	if (dWidgetCountersEnabled || dPoolGetWorkerCount()==0)
+		return;
+
+	if (dWidgetGetObjectData(widget, DWidgetTypeContainer)==NULL)
+		return;
+
+	if (dWidgetLayoutParallelDoneSem==NULL) {
+		dWidgetLayoutParallelDoneSem=SDL_CreateSemaphore(0);
+		if (dWidgetLayoutParallelDoneSem==NULL) {
+			dWarning("warning: could not create semaphore for parallel layout: %s\n", SDL_GetError());
+			return;
+		}
+	}
+
+	DTimeUs traceStart=dTraceBegin();
+
+	// Split the subtree into runs of siblings, small enough to share out evenly but large enough to be worth claiming
+	// Note: runs are disjoint sets of subtrees, so no two threads ever write to the same widget's layout cache
+	size_t workerCount=dPoolGetWorkerCount();
+	size_t grain=widget->subtreeSize/(8*(workerCount+1));
+	if (grain<dWidgetLayoutParallelGrainMin)
+		grain=dWidgetLayoutParallelGrainMin;
+
+	DWidgetLayoutPass *pass=dMallocNoFail(sizeof(DWidgetLayoutPass));
+	pass->flag=flag;
+	pass->runs=NULL;
+	pass->runCount=0;
+	pass->runAlloc=0;
+	atomic_init(&pass->runNext, 0);
+	atomic_init(&pass->runsDone, 0);
+	pass->refCount=1;
+
+	dWidgetLayoutCollectRuns(pass, widget, grain);
+
+	// Not enough to share?
+	if (pass->runCount<2) {
+		dWidgetLayoutPassRelease(pass);
+		return;
+	}
+
+	// Hand runs out to the pool while also measuring them here, so we never wait on a task which has not started
+	// (e.g. if all workers are busy with something else)
+	dWidgetLayoutParallelActive=true;
+
+	size_t taskCount=(workerCount<pass->runCount-1 ? workerCount : pass->runCount-1);
+	for(size_t i=0; i<taskCount; ++i) {
+		++pass->refCount;
+		dPoolSubmit(&dWidgetLayoutPoolTask, &dWidgetLayoutPoolCompletion, pass);
+	}
+
+	dWidgetLayoutMeasureRuns(pass);
+
+	// Wait for any runs still being measured by workers
+	SDL_SemWait(dWidgetLayoutParallelDoneSem);
+
+	dWidgetLayoutParallelActive=false;
+
+	dTraceEnd(traceStart, "parallel layout", "layout", dWidgetTypeToString(dWidgetGetBaseType(widget)));
+
+	// Results are merged by the caller as normal, walking children in order and finding their values cached,
+	// so final sizes do not depend on which thread measured what
+	dWidgetLayoutPassRelease(pass);
+}
+
+void dWidgetLayoutCollectRuns(DWidgetLayoutPass *pass, DWidget *container, size_t grain) {
+	assert(pass!=NULL);
+	assert(container!=NULL);
+
+	size_t childCount=dContainerGetChildCount(container);
+	size_t runFirst=0, runSize=0;
+	for(size_t i=0; i<childCount; ++i) {
+		DWidget *child=dContainerGetChildN(container, i);
+
+		// Children which have already been measured are cheap, no matter how large
+		size_t size=(dWidgetLayoutIsCached(child, pass->flag) ? 1 : child->subtreeSize);
+
+		// Split children which are too large by themselves (only containers can be)
+		if (size>grain) {
+			dWidgetLayoutAddRun(pass, container, runFirst, i-runFirst);
+			dWidgetLayoutCollectRuns(pass, child, grain);
+			runFirst=i+1;
+			runSize=0;
+			continue;
+		}
+
+		// Start a new run if this child would make the current one too large
+		if (runSize+size>grain) {
+			dWidgetLayoutAddRun(pass, container, runFirst, i-runFirst);
+			runFirst=i;
+			runSize=0;
+		}
+		runSize+=size;
+	}
+	dWidgetLayoutAddRun(pass, container, runFirst, childCount-runFirst);
+}
+
+void dWidgetLayoutAddRun(DWidgetLayoutPass *pass, DWidget *parent, size_t first, size_t count) {
+	assert(pass!=NULL);
+	assert(parent!=NULL);
+
+	if (count==0)
+		return;
+
+	if (pass->runCount==pass->runAlloc) {
+		pass->runAlloc=(pass->runAlloc>0 ? 2*pass->runAlloc : 64);
+		pass->runs=dReallocNoFail(pass->runs, sizeof(DWidgetLayoutRun)*pass->runAlloc);
+	}
+
+	DWidgetLayoutRun *run=&pass->runs[pass->runCount++];
+	run->parent=parent;
+	run->first=first;
+	run->count=count;
+}
+
+void dWidgetLayoutMeasureRuns(DWidgetLayoutPass *pass) {
+	assert(pass!=NULL);
+
+	while(1) {
+		size_t index=atomic_fetch_add(&pass->runNext, 1);
+		if (index>=pass->runCount)
+			break;
+
+		const DWidgetLayoutRun *run=&pass->runs[index];
+		for(size_t i=0; i<run->count; ++i) {
+			// Children are independent, so a failure only affects the child it occurs within
+			dWidgetLayoutWorkerFailed=false;
+			dWidgetLayoutMeasure(dContainerGetChildN(run->parent, run->first+i), pass->flag);
+		}
+		dWidgetLayoutWorkerFailed=false;
+
+		if (atomic_fetch_add(&pass->runsDone, 1)+1==pass->runCount)
+			SDL_SemPost(dWidgetLayoutParallelDoneSem);
+	}
+}
+
+void dWidgetLayoutPassRelease(DWidgetLayoutPass *pass) {
+	assert(pass!=NULL);
+	assert(pass->refCount>0);
+
+	if (--pass->refCount>0)
+		return;
+
+	dFree(pass->runs);
+	dFree(pass);
+}
+
+void dWidgetLayoutPoolTask(void *userData) {
+	// Note: unlike most pool tasks this does touch widgets - which is safe as the UI thread is blocked until all runs are done,
+	// and a task which starts late finds no runs left to claim
+	DWidgetLayoutPass *pass=userData;
+
+	dWidgetLayoutOnWorker=true;
+	dWidgetLayoutMeasureRuns(pass);
+	dWidgetLayoutOnWorker=false;
+}
+
+void dWidgetLayoutPoolCompletion(void *userData) {
+	dWidgetLayoutPassRelease(userData);
+}
+
 int dWidgetVTableGetMinWidth(DWidget *widget) {
 	assert(widget!=NULL);
 
@@ -698,9 +1481,9 @@ int dWidgetVTableGetHeight(DWidget *widget) {
 	return dWidgetGetPaddingTop(widget)+dWidgetGetPaddingBottom(widget);
 }
 
-DWidgetObjectData *dWidgetObjectDataNew(DWidgetType type) {
+DWidgetObjectData *dWidgetObjectDataNew(DWidgetType type, DWidgetType tag) {
 	// Allocate memory and set basic fields
-	DWidgetObjectData *data=dMallocNoFail(sizeof(DWidgetObjectData));
+	DWidgetObjectData *data=dMallocTaggedNoFail(sizeof(DWidgetObjectData), tag);
 
 	data->type=type;
 	data->super=NULL;
@@ -718,7 +1501,7 @@ DWidgetObjectData *dWidgetObjectDataNew(DWidgetType type) {
 	// note: this recurses until we hit DWidgetTypeWidget
 	DWidgetType superType=dWidgetTypeExtends[type];
 	if (superType!=DWidgetTypeNB)
-		data->super=dWidgetObjectDataNew(superType);
+		data->super=dWidgetObjectDataNew(superType, tag);
 
 	return data;
 }
@@ -732,5 +1515,5 @@ void dWidgetObjectDataFree(DWidgetObjectData *data) {
 	dWidgetObjectDataFree(data->super);
 
 	// Free object memory itself
-	free(data);
+	dFree(data);
 }
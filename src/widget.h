@@ -2,6 +2,7 @@
 #define WIDGET_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef enum {
 	DWidgetOrientationHorizontal,
@@ -12,14 +13,34 @@ typedef enum {
 	DWidgetTypeBin,
 	DWidgetTypeBox,
 	DWidgetTypeButton,
+	DWidgetTypeCanvas,
+	DWidgetTypeChart,
 	DWidgetTypeContainer,
+	DWidgetTypeImage,
 	DWidgetTypeLabel,
+	DWidgetTypeLogView,
+	DWidgetTypeNumber,
+	DWidgetTypeTableView,
 	DWidgetTypeTextButton,
+	DWidgetTypeTextView,
+	DWidgetTypeTreeView,
 	DWidgetTypeWindow,
 	DWidgetTypeWidget, // common base widget
 	DWidgetTypeNB,
 } DWidgetType;
 
+typedef enum {
+	DWidgetVTableEntryDestructor,
+	DWidgetVTableEntryRedraw,
+	DWidgetVTableEntryGetMinWidth,
+	DWidgetVTableEntryGetMinHeight,
+	DWidgetVTableEntryGetWidth,
+	DWidgetVTableEntryGetHeight,
+	DWidgetVTableEntryGetChildXOffset,
+	DWidgetVTableEntryGetChildYOffset,
+	DWidgetVTableEntryNB,
+} DWidgetVTableEntry;
+
 typedef struct DWidget DWidget;
 
 typedef enum {
@@ -28,6 +49,12 @@ typedef enum {
 	DWidgetSignalTypeWidgetButtonRelease,
 	DWidgetSignalTypeWidgetEnter, // cursor has entered this widget
 	DWidgetSignalTypeWidgetLeave, // cursor has left this widget
+	DWidgetSignalTypeWidgetMouseMotion, // cursor has moved within this widget (or anywhere, if this widget has captured the pointer)
+	DWidgetSignalTypeWidgetMouseWheel, // sent to the widget under the cursor (or which has captured the pointer) and then up through its parents
+	DWidgetSignalTypeWidgetKeyDown, // sent to the widget with keyboard focus (or the window if none) and then up through its parents
+	DWidgetSignalTypeWidgetTextInput, // as with KeyDown
+	DWidgetSignalTypeWidgetFocusIn, // widget has gained keyboard focus (not sent to parents)
+	DWidgetSignalTypeWidgetFocusOut, // widget has lost keyboard focus (not sent to parents)
 	DWidgetSignalTypeWindowClose,
 	DWidgetSignalTypeNB,
 } DWidgetSignalType;
@@ -40,20 +67,52 @@ typedef enum {
 	DWidgetMouseButtonX2,
 } DWidgetMouseButton;
 
+typedef struct {
+	int x, y;
+} DWidgetPoint;
+
 typedef struct {
 	DWidgetMouseButton button;
+	int x, y; // relative to the top left of the root Window
 } DWidgetSignalEventWidgetButtonPress;
 
 typedef struct {
 	DWidgetMouseButton button;
+	int x, y; // relative to the top left of the root Window
 } DWidgetSignalEventWidgetButtonRelease;
 
+// Motion events are merged so that at most one is generated per window per frame
+typedef struct {
+	int x, y; // latest position, relative to the top left of the root Window
+	int relX, relY; // total movement since the previous motion event
+	const DWidgetPoint *path; // every position reported since the previous motion event, oldest first (so the last entry is x,y)
+	size_t pathCount; // always at least 1
+} DWidgetSignalEventWidgetMouseMotion;
+
+typedef struct {
+	int x, y; // amount scrolled, with positive x to the right and positive y away from the user (i.e. up)
+} DWidgetSignalEventWidgetMouseWheel;
+
+typedef struct {
+	int key; // SDL_Keycode
+	unsigned mod; // SDL_Keymod bitset
+	bool repeat; // true if generated by the key being held down
+} DWidgetSignalEventWidgetKeyDown;
+
+typedef struct {
+	const char *text; // UTF-8, null terminated
+} DWidgetSignalEventWidgetTextInput;
+
 typedef struct {
 	DWidgetSignalType type;
 	DWidget *widget;
 	union {
 		DWidgetSignalEventWidgetButtonPress widgetButtonPress;
 		DWidgetSignalEventWidgetButtonRelease widgetButtonRelease;
+		DWidgetSignalEventWidgetMouseMotion widgetMouseMotion;
+		DWidgetSignalEventWidgetMouseWheel widgetMouseWheel;
+		DWidgetSignalEventWidgetKeyDown widgetKeyDown;
+		DWidgetSignalEventWidgetTextInput widgetTextInput;
 	} d;
 } DWidgetSignalEvent;
 
@@ -102,16 +161,47 @@ void dWidgetSetOrientation(DWidget *widget, DWidgetOrientation orientation);
 void dWidgetSetHExpand(DWidget *widget, bool hexpand);
 void dWidgetSetVExpand(DWidget *widget, bool vexpand);
 
+// Update transactions - each window has its own, opened by passing any widget within it.
+// While a window's transaction is open, invalidations caused by setters on widgets within it are collected rather than resolved immediately (other windows are not affected).
+// When the outermost transaction is committed (via dWidgetEndUpdate) the window is marked dirty once
+// (or only damaged, if all changes within it were to areas of widgets which support partial redraws).
+// Transactions can be nested, and each dWidgetBeginUpdate must be paired with a dWidgetEndUpdate on a widget within the same window.
+// Both do nothing for widgets not within a window.
+void dWidgetBeginUpdate(DWidget *widget);
+void dWidgetEndUpdate(DWidget *widget);
+
+// Pointer capture - while a widget holds the capture, all pointer events for its window are sent to it without hit testing
+// (Enter and Leave events are also not generated while the capture is held)
+bool dWidgetCapturePointer(DWidget *widget); // fails if widget is not within a Window
+void dWidgetReleasePointer(DWidget *widget); // does nothing if widget does not currently hold the capture
+bool dWidgetHasPointerCapture(const DWidget *widget);
+
+// Keyboard focus - at most one widget per window has focus, and receives KeyDown and TextInput events first
+bool dWidgetGrabKeyboardFocus(DWidget *widget); // fails if widget is not within a Window
+void dWidgetReleaseKeyboardFocus(DWidget *widget); // does nothing if widget does not currently have focus
+bool dWidgetHasKeyboardFocus(const DWidget *widget);
+
 bool dWidgetSignalConnect(DWidget *widget, DWidgetSignalType type, DWidgetSignalHandler *handler, void *userData);
 DWidgetSignalReturn dWidgetSignalInvoke(const DWidgetSignalEvent *event); // returns DWidgetSignalReturnStop if any handlers do, otherwise returns DWidgetSignalReturnContinue
 
-void dWidgetDebug(DWidget *widget, int indentation);
+void dWidgetDebug(DWidget *widget, int indentation); // also prints the counters below for the last frame if enabled (and indentation is 0)
+
+// Counters of how many times each vtable entry actually runs (i.e. excluding cached layout), broken down by the widget type which implements it.
+// Counts are per frame of digitsLoop, to help spot work which grows faster than the widget tree.
+// While enabled, large trees are measured on the UI thread alone (rather than in parallel on the pool) so that counting needs no locking.
+void dWidgetCountersSetEnabled(bool enabled); // disabled by default
+bool dWidgetCountersGetEnabled(void);
+size_t dWidgetCountersGetVTable(DWidgetType type, DWidgetVTableEntry entry); // count for the last completed frame
+size_t dWidgetCountersGetTextureUploads(void); // count for the last completed frame
 
 bool dWidgetOrientationIsValid(DWidgetOrientation orientation);
 
 bool dWidgetTypeIsValid(DWidgetType type);
 const char *dWidgetTypeToString(DWidgetType type);
 
+bool dWidgetVTableEntryIsValid(DWidgetVTableEntry entry);
+const char *dWidgetVTableEntryToString(DWidgetVTableEntry entry);
+
 bool dWidgetSignalTypeIsValid(DWidgetSignalType type);
 const char *dWidgetSignalTypeToString(DWidgetSignalType type);
 DWidgetType dWidgetSignalTypeToWidgetType(DWidgetSignalType type);
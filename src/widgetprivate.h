@@ -3,6 +3,14 @@
 
 #include <SDL2/SDL.h>
 
+#include "animation.h"
+#include "canvas.h"
+#include "chart.h"
+#include "imagecacheprivate.h"
+#include "latencyprivate.h"
+#include "tableview.h"
+#include "timer.h"
+#include "treeview.h"
 #include "widget.h"
 
 #define DWidgetSignalDataMax 16
@@ -27,21 +35,214 @@ typedef struct {
 	DWidgetVTableGetChildYOffset *getChildYOffset;
 } DWidgetVTable;
 
+typedef struct {
+	// Position of the most recently queried child, allowing children to be iterated in order without summing all previous siblings each time
+	unsigned offsetGeneration; // layout generation offset was computed for
+	size_t offsetIndex;
+	int offset;
+} DWidgetObjectDataBox;
+
 typedef struct {
 	bool pressed; // true if currently held down (i.e. mid click)
+
+	DColour colour; // current body colour, animated towards the pressed or released colour
+	DColour colourFrom; // body colour when the current animation started
+	DAnimationId colourAnimation; // 0 if not animating
 } DWidgetObjectDataButton;
 
+typedef enum {
+	DCanvasCommandTypeColour,
+	DCanvasCommandTypeLines,
+	DCanvasCommandTypeRects,
+	DCanvasCommandTypeFillRects,
+	DCanvasCommandTypeText,
+} DCanvasCommandType;
+
+typedef struct {
+	DCanvasCommandType type;
+	union {
+		DColour colour;
+		struct {
+			size_t start, count; // range within points array (for Lines, in pairs) or rects array
+		} batch;
+		struct {
+			int x, y;
+			size_t offset; // of null terminated string within text array
+		} text;
+	} d;
+} DCanvasCommand;
+
+typedef struct {
+	int width, height;
+
+	// Command buffer (consecutive primitives of the same kind are merged into one command when recorded)
+	DCanvasCommand *commands;
+	size_t commandCount, commandAlloc;
+	SDL_Point *points;
+	size_t pointCount, pointAlloc;
+	SDL_Rect *rects;
+	size_t rectCount, rectAlloc;
+	char *text;
+	size_t textSize, textAlloc;
+	DColour colour; // current colour while recording
+
+	DCanvasRecordCallback *recordCallback;
+	void *recordUserData;
+	bool recordPending; // call recordCallback before next redraw
+	bool recording; // currently within recordCallback
+
+	SDL_Texture *texture; // commands rendered once, NULL if not yet created (or render targets are not supported)
+	SDL_Renderer *textureRenderer;
+	bool textureValid; // false if commands have changed since texture was rendered
+
+	SDL_Rect *scratch; // offset copies of rects, used when drawing directly
+	size_t scratchAlloc;
+} DWidgetObjectDataCanvas;
+
+typedef struct DChartShared DChartShared;
+
+typedef struct {
+	int width, height;
+	size_t capacity; // samples shown per series
+	size_t bucketSize; // samples per pixel column
+
+	DChartShared *shared; // state needed by appending threads (freed later if a notification is still queued)
+	DChartSeries **series;
+	size_t seriesCount;
+
+	bool autoRange;
+	float rangeMin, rangeMax; // used if autoRange is false
+
+	SDL_Rect *rects; // one per pixel column, used when drawing
+} DWidgetObjectDataChart;
+
 typedef struct {
 	DWidget **children;
 	size_t childCount;
+	size_t childAlloc; // number of entries allocated in children array
 } DWidgetObjectDataContainer;
 
+typedef struct {
+	DImageCacheEntry *entry; // shared with other images of the same source and size
+} DWidgetObjectDataImage;
+
 typedef struct {
 	char *text;
 
 	SDL_Texture *texture;
+	int textWidth, textHeight; // measured from font metrics when text is set, so that layout (including on pool workers) does not need the texture
+	bool textMeasured;
 } DWidgetObjectDataLabel;
 
+typedef struct DLogViewFile DLogViewFile;
+
+typedef struct {
+	size_t line; // SIZE_MAX if entry unused
+	SDL_Texture *texture; // NULL for empty lines
+	int width, height;
+} DLogViewLineCacheEntry;
+
+typedef struct {
+	int viewportWidth, viewportHeight;
+
+	DLogViewFile *file; // mapping and line index (freed later if a scan is still running on the pool)
+	DTimerId followTimer; // checks for the file changing size
+
+	size_t scrollLine;
+	bool follow; // keep the last line in view as lines are added
+
+	DLogViewLineCacheEntry *lineCache; // rendered textures for (at least) the visible lines
+	size_t lineCacheCount;
+	char *lineScratch; // null terminated copy of the line being rendered
+} DWidgetObjectDataLogView;
+
+typedef struct {
+	int64_t value;
+	unsigned decimals;
+
+	size_t cellCount;
+	char *cells; // character shown in each cell (' ' if blank), not null terminated
+	char *scratch; // cells for the new value, compared against cells to find those which changed
+	int cellWidth, cellHeight; // from the font's metrics, so known before there is a renderer
+} DWidgetObjectDataNumber;
+
+typedef struct {
+	char *title;
+	DTableViewColumnType type;
+	const void *values;
+	int fixedWidth; // 0 to fit contents
+	int width; // current width of contents (excluding cell padding). when fitting contents this only grows, so columns do not jump around while scrolling
+} DTableViewColumn;
+
+typedef struct {
+	int viewportWidth, viewportHeight;
+
+	DTableViewRowCountFunction *rowCountFunction;
+	void *rowCountUserData;
+
+	DTableViewColumn *columns;
+	size_t columnCount;
+
+	// Displayed order of rows as indices into the data source (only used when sorted)
+	size_t sortColumn; // SIZE_MAX if unsorted
+	bool sortAscending;
+	size_t *order;
+	size_t orderCount; // row count when last sorted
+	bool orderValid; // false if needs sorting again before use
+
+	size_t scrollRow;
+
+	char cellText[64]; // scratch buffer for formatting numbers
+} DWidgetObjectDataTableView;
+
+typedef struct {
+	size_t line; // SIZE_MAX if entry unused
+	SDL_Texture *texture; // NULL for empty lines
+	int width, height;
+} DTextViewLineCacheEntry;
+
+typedef struct {
+	// Text is held in a gap buffer, with the gap kept at the cursor so that edits there are O(1) amortised
+	char *text;
+	size_t textAlloc;
+	size_t gapStart, gapEnd; // gap is [gapStart, gapEnd), and gapStart is also the cursor position
+
+	// Offsets of the start of each line, also held in a gap buffer with the gap directly after the cursor's line.
+	// Entries before the gap are offsets from the start of the text, those after are offsets from the end,
+	// so that inserting or deleting at the cursor never requires updating later lines.
+	size_t *lineStarts;
+	size_t lineAlloc;
+	size_t lineGapStart, lineGapEnd;
+
+	int viewportWidth, viewportHeight; // size of visible text area, excluding padding
+	size_t scrollLine; // first visible line
+	size_t desiredColumn; // byte column to aim for when moving up/down (SIZE_MAX to use current)
+
+	int caretX; // pixel offset of caret from start of its line (-1 if needs computing)
+	bool caretVisible; // toggled by blink timer
+	DTimerId blinkTimer; // 0 if not focused
+
+	DTextViewLineCacheEntry *lineCache; // rendered textures for (at least) the visible lines
+	size_t lineCacheCount;
+	char *lineScratch; // buffer used to copy a line out of the gap buffer
+	size_t lineScratchAlloc;
+} DWidgetObjectDataTextView;
+
+typedef struct DTreeViewNode DTreeViewNode;
+
+typedef struct {
+	int viewportWidth, viewportHeight;
+
+	DTreeViewChildCountFunction *childCountFunction;
+	DTreeViewChildFunction *childFunction;
+	DTreeViewTextFunction *textFunction;
+	void *userData;
+
+	DTreeViewNode *root; // always expanded, but not itself shown as a row
+
+	size_t scrollRow;
+} DWidgetObjectDataTreeView;
+
 typedef struct {
 	int paddingTop;
 	int paddingBottom;
@@ -53,13 +254,61 @@ typedef struct {
 	bool hexpand, vexpand; // horizontal and vertical expand flags
 } DWidgetObjectDataWidget;
 
+// Update transaction state (see dWidgetBeginUpdate)
+typedef struct {
+	DWidget *widget;
+	bool whole; // if false only rect needs redrawing
+	SDL_Rect rect; // relative to widget's top left (empty if nothing added yet)
+} DWidgetUpdatePendingEntry;
+
+typedef struct {
+	DWidget *widget;
+	size_t parent; // index of parent entry, or SIZE_MAX for the root
+	SDL_Rect rect; // relative to the window
+} DWindowHitEntry;
+
+typedef struct {
+	size_t *entries; // indices of entries overlapping this cell, in increasing (i.e. pre-) order
+	size_t count, alloc;
+} DWindowHitCell;
+
 typedef struct {
 	SDL_Window *sdlWindow;
 	SDL_Renderer *renderer;
 
-	bool dirty; // true if need to redraw
+	bool dirty; // true if need to redraw everything
+	bool damaged; // true if need to redraw the area given by damage (ignored if dirty is set)
+	SDL_Rect damage;
+	SDL_Texture *target; // persistent copy of window contents, allowing partial redraws (NULL if not supported or not yet created)
+	int targetWidth, targetHeight;
 
 	DWidget *mouseFocusWidget; // widget under the mouse (can be NULL if mouse not inside window)
+	DWidget *pointerCaptureWidget; // widget receiving all pointer events (NULL if none)
+	DWidget *keyboardFocusWidget; // widget receiving key and text input events first (NULL if none)
+	bool mouseInside; // is the mouse within the window
+	int mouseX, mouseY; // last known mouse position
+
+	// Update transactions opened on widgets within this window
+	size_t updateDepth; // number of open transactions
+	DWidgetUpdatePendingEntry *updatePending; // widgets which have been invalidated while a transaction was open, at most one entry each (see DWidget.updatePendingIndex)
+	size_t updatePendingCount;
+	size_t updatePendingAlloc; // kept between transactions rather than reallocating each time
+
+	// Spatial index used for hit testing, brought up to date lazily when the layout generation changes
+	// Entries are all widgets in the window in pre-order, and each grid cell holds the indices of entries which overlap it (also in pre-order).
+	// Only entries whose bounds have changed are moved between cells, the index is only rebuilt from scratch if widgets are added or removed or the grid size changes.
+	unsigned hitGeneration; // layout generation the index was last updated for (0 if never built)
+	bool hitStructureChanged; // set when widgets are added to or removed from the window, as entries then no longer match the tree
+	DWindowHitEntry *hitEntries;
+	size_t hitEntryCount, hitEntryAlloc;
+	int hitGridCols, hitGridRows;
+	DWindowHitCell *hitCells; // hitGridCols*hitGridRows cells, in rows
+	size_t hitCellAlloc;
+	size_t hitLast; // entry index of the previous hit test result (SIZE_MAX if none)
+
+	DLatencyWindow *latency; // NULL until the first sample is recorded
+
+	size_t textureBytes, texturePeakBytes; // see dMemoryGetTextureBytes
 } DWidgetObjectDataWindow;
 
 typedef struct DWidgetObjectData DWidgetObjectData;
@@ -67,9 +316,18 @@ struct DWidgetObjectData {
 	DWidgetType type;
 	DWidgetObjectData *super;
 	union {
+		DWidgetObjectDataBox box;
 		DWidgetObjectDataButton button;
+		DWidgetObjectDataCanvas canvas;
+		DWidgetObjectDataChart chart;
 		DWidgetObjectDataContainer container;
+		DWidgetObjectDataImage image;
 		DWidgetObjectDataLabel label;
+		DWidgetObjectDataLogView logView;
+		DWidgetObjectDataNumber number;
+		DWidgetObjectDataTableView tableView;
+		DWidgetObjectDataTextView textView;
+		DWidgetObjectDataTreeView treeView;
 		DWidgetObjectDataWidget widget;
 		DWidgetObjectDataWindow window;
 	} d;
@@ -82,12 +340,37 @@ typedef struct {
 	void *userData;
 } DWidgetSignalData;
 
+typedef enum {
+	DWidgetLayoutFlagWidth=1,
+	DWidgetLayoutFlagHeight=2,
+	DWidgetLayoutFlagMinWidth=4,
+	DWidgetLayoutFlagMinHeight=8,
+	DWidgetLayoutFlagGlobalX=16,
+	DWidgetLayoutFlagGlobalY=32,
+} DWidgetLayoutFlag;
+
+// Geometry computed via the vtable is cached here until something which may affect layout changes (see dWidgetSetDirty)
+typedef struct {
+	unsigned generation; // values are only valid if this matches the layout generation of the widget's tree (see DWidget.layoutRoot)
+	unsigned flags; // DWidgetLayoutFlag bitset indicating which values are valid
+	int width, height;
+	int minWidth, minHeight;
+	int globalX, globalY;
+} DWidgetLayoutCache;
+
 struct DWidget {
 	DWidgetObjectData *base;
 	DWidget *parent;
 
 	DWidgetSignalData signals[DWidgetSignalTypeNB][DWidgetSignalDataMax];
 	size_t signalsCount[DWidgetSignalTypeNB];
+
+	size_t updatePendingIndex; // index of this widget's entry in its window's update transaction pending list, or SIZE_MAX if it has none
+
+	size_t subtreeSize; // number of widgets in this subtree (including this one), kept up to date by dContainerAdd
+	DWidget *layoutRoot; // topmost ancestor (or this widget if it has no parent), kept up to date by dContainerAdd
+	unsigned layoutGeneration; // only used on root widgets - changes whenever cached layout within this tree is invalidated (never 0)
+	DWidgetLayoutCache layout;
 };
 
 DWidget *dWidgetNew(DWidgetType type);
@@ -95,7 +378,21 @@ void dWidgetConstructor(DWidget *widget, DWidgetObjectData *data);
 void dWidgetDestructor(DWidget *widget, DWidgetObjectData *data); // starts from data sub class when searching for vtable entries (if data is NULL then function does nothing)
 
 SDL_Renderer *dWidgetGetRenderer(DWidget *widget); // returns NULL if not a Window or descendant of a Window
-void dWidgetSetDirty(DWidget *widget); // sets dirty flag of containing window
+void dWidgetSetDirty(DWidget *widget); // sets dirty flag of containing window (deferred if an update transaction is open) and invalidates cached layout
+void dWidgetSetDirtyAppearance(DWidget *widget); // as dWidgetSetDirty, but for changes which cannot affect the size or position of any widget
+void dWidgetSetDirtyRect(DWidget *widget, const SDL_Rect *rect); // as dWidgetSetDirtyAppearance, but only the given area (relative to the widget's top left) is redrawn
+void dWidgetSetDirtyBounds(DWidget *widget); // as dWidgetSetDirtyRect, covering the whole widget
+
+unsigned dWidgetGetLayoutGeneration(const DWidget *widget); // changes whenever cached layout within widget's tree (e.g. its window) is invalidated (never 0)
+void dWidgetSetLayoutRoot(DWidget *widget, DWidget *root); // sets root of widget and all of its descendants, e.g. after adding it to a container
+bool dWidgetLayoutRequireUiThread(void); // returns false if measuring on a pool worker (see dWidgetLayoutMeasureParallel), in which case the caller should return without side effects and the subtree is measured again on the UI thread
+
+void dWidgetUpdateWindowFree(DWidget *window); // frees window's update transaction state (called by the window destructor)
+
+void dWidgetQuit(void); // frees memory kept between parallel layout passes (called by digitsQuit)
+
+void dWidgetCountersFrameEnd(void); // makes the current counts available via the getters and starts counting again from 0
+void dWidgetCountersAddTextureUpload(void);
 
 void dWidgetRedraw(DWidget *widget, DWidgetObjectData *data, SDL_Renderer *renderer); // starts from data sub class when searching for vtable entries (if data is NULL then function does nothing)
 
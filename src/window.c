@@ -1,10 +1,17 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <SDL2/SDL.h>
 
 #include "binprivate.h"
+#include "container.h"
 #include "digitsprivate.h"
+#include "glyphatlasprivate.h"
+#include "imagecacheprivate.h"
+#include "profilerprivate.h"
+#include "traceprivate.h"
 #include "util.h"
 #include "utilprivate.h"
 #include "widgetprivate.h"
@@ -13,6 +20,20 @@
 
 const DColour dWindowBackgroundColour={.r=32, .g=32, .b=32, .a=255};
 
+const int dWindowHitCellSize=64; // width and height of each cell in the hit testing grid, in pixels
+
+void dWindowHitIndexUpdate(DWidget *window); // brings spatial index up to date if layout has changed since it was last updated
+void dWindowHitIndexRebuild(DWidget *window); // rebuilds spatial index from scratch
+void dWindowHitIndexAddWidget(DWidgetObjectData *data, DWidget *widget, size_t parent);
+void dWindowHitIndexFree(DWidgetObjectData *data);
+bool dWindowHitEntryContains(const DWindowHitEntry *entry, int x, int y);
+void dWindowHitEntryGetRect(const DWindowHitEntry *entry, SDL_Rect *rect); // queries current bounds of entry's widget
+bool dWindowHitCellsForRect(const DWidgetObjectData *data, const SDL_Rect *rect, SDL_Rect *cells); // gives range of cells (in cell units) which rect overlaps, returns false if none
+void dWindowHitCellInsert(DWindowHitCell *cell, size_t index); // keeps entries in order
+void dWindowHitCellRemove(DWindowHitCell *cell, size_t index);
+
+bool dWindowTargetUpdate(DWidget *window); // ensures target texture exists and matches window size, returns false if not possible
+
 void dWindowVTableDestructor(DWidget *widget);
 void dWindowVTableRedraw(DWidget *widget, SDL_Renderer *renderer);
 int dWindowVTableGetWidth(DWidget *widget);
@@ -47,7 +68,33 @@ void dWindowConstructor(DWidget *widget, DWidgetObjectData *data, const char *ti
 	data->d.window.sdlWindow=NULL;
 	data->d.window.renderer=NULL;
 	data->d.window.dirty=true;
+	data->d.window.damaged=false;
+	data->d.window.target=NULL;
+	data->d.window.targetWidth=0;
+	data->d.window.targetHeight=0;
 	data->d.window.mouseFocusWidget=NULL;
+	data->d.window.pointerCaptureWidget=NULL;
+	data->d.window.keyboardFocusWidget=NULL;
+	data->d.window.mouseInside=false;
+	data->d.window.mouseX=0;
+	data->d.window.mouseY=0;
+	data->d.window.hitGeneration=0;
+	data->d.window.hitStructureChanged=true;
+	data->d.window.hitEntries=NULL;
+	data->d.window.hitEntryCount=0;
+	data->d.window.hitEntryAlloc=0;
+	data->d.window.hitGridCols=0;
+	data->d.window.hitGridRows=0;
+	data->d.window.hitCells=NULL;
+	data->d.window.hitCellAlloc=0;
+	data->d.window.hitLast=SIZE_MAX;
+	data->d.window.updateDepth=0;
+	data->d.window.updatePending=NULL;
+	data->d.window.updatePendingCount=0;
+	data->d.window.updatePendingAlloc=0;
+	data->d.window.latency=NULL;
+	data->d.window.textureBytes=0;
+	data->d.window.texturePeakBytes=0;
 
 	// Create SDL backing window and add some custom data to point back to our widget
 	data->d.window.sdlWindow=SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_RESIZABLE);
@@ -56,8 +103,10 @@ void dWindowConstructor(DWidget *widget, DWidgetObjectData *data, const char *ti
 
 	SDL_SetWindowData(data->d.window.sdlWindow, "widget", widget);
 
-	// Create SDL renderer for widget drawing
+	// Create SDL renderer for widget drawing, falling back to software rendering if no accelerated renderer is available (e.g. with the dummy video driver)
 	data->d.window.renderer=SDL_CreateRenderer(data->d.window.sdlWindow, -1, SDL_RENDERER_ACCELERATED);
+	if (data->d.window.renderer==NULL)
+		data->d.window.renderer=SDL_CreateRenderer(data->d.window.sdlWindow, -1, SDL_RENDERER_SOFTWARE);
 	if (data->d.window.renderer==NULL)
 		dFatalError("error: could not create SDL renderer for widget %p\n", widget);
 
@@ -96,6 +145,32 @@ void dWindowSetDirty(DWidget *window) {
 	data->d.window.dirty=true;
 }
 
+void dWindowAddDamage(DWidget *window, const SDL_Rect *rect) {
+	assert(window!=NULL);
+	assert(rect!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	// Ignore empty rects
+	if (rect->w<=0 || rect->h<=0)
+		return;
+
+	// Merge with any existing damage
+	if (data->d.window.damaged)
+		SDL_UnionRect(&data->d.window.damage, rect, &data->d.window.damage);
+	else
+		data->d.window.damage=*rect;
+	data->d.window.damaged=true;
+}
+
+DWidget *dWindowGetMouseFocusWidget(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	return data->d.window.mouseFocusWidget;
+}
+
 void dWindowSetMouseFocusWidget(DWidget *window, DWidget *newWidget) {
 	assert(window!=NULL);
 	assert(newWidget==NULL || newWidget==window || dWidgetIsAncestor(window, newWidget));
@@ -157,20 +232,193 @@ void dWindowSetMouseFocusWidget(DWidget *window, DWidget *newWidget) {
 	data->d.window.mouseFocusWidget=newWidget;
 }
 
+void dWindowSetMouseInside(DWidget *window, bool inside) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	data->d.window.mouseInside=inside;
+}
+
+void dWindowSetMousePosition(DWidget *window, int x, int y) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	data->d.window.mouseX=x;
+	data->d.window.mouseY=y;
+}
+
+DWidget *dWindowGetPointerCapture(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	return data->d.window.pointerCaptureWidget;
+}
+
+const DWidget *dWindowGetPointerCaptureConst(const DWidget *window) {
+	assert(window!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(window, DWidgetTypeWindow);
+
+	return data->d.window.pointerCaptureWidget;
+}
+
+void dWindowSetPointerCapture(DWidget *window, DWidget *widget) {
+	assert(window!=NULL);
+	assert(widget==NULL || widget==window || dWidgetIsAncestor(window, widget));
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	// No change?
+	if (data->d.window.pointerCaptureWidget==widget)
+		return;
+
+	data->d.window.pointerCaptureWidget=widget;
+
+	// If released, widget under the mouse may have changed during the capture so generate any Enter/Leave events now
+	if (widget==NULL)
+		dWindowSetMouseFocusWidget(window, (data->d.window.mouseInside ? dWindowGetWidgetByXY(window, data->d.window.mouseX, data->d.window.mouseY) : NULL));
+}
+
+DWidget *dWindowGetKeyboardFocusWidget(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	return data->d.window.keyboardFocusWidget;
+}
+
+const DWidget *dWindowGetKeyboardFocusWidgetConst(const DWidget *window) {
+	assert(window!=NULL);
+
+	const DWidgetObjectData *data=dWidgetGetObjectDataConstNoFail(window, DWidgetTypeWindow);
+
+	return data->d.window.keyboardFocusWidget;
+}
+
+void dWindowSetKeyboardFocusWidget(DWidget *window, DWidget *widget) {
+	assert(window!=NULL);
+	assert(widget==NULL || widget==window || dWidgetIsAncestor(window, widget));
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	// No change?
+	DWidget *oldWidget=data->d.window.keyboardFocusWidget;
+	if (oldWidget==widget)
+		return;
+
+	// Update before invoking signals so handlers see the new state
+	data->d.window.keyboardFocusWidget=widget;
+
+	DWidgetSignalEvent dEvent;
+	if (oldWidget!=NULL) {
+		dEvent.type=DWidgetSignalTypeWidgetFocusOut;
+		dEvent.widget=oldWidget;
+		dWidgetSignalInvoke(&dEvent);
+	}
+	if (widget!=NULL) {
+		dEvent.type=DWidgetSignalTypeWidgetFocusIn;
+		dEvent.widget=widget;
+		dWidgetSignalInvoke(&dEvent);
+	}
+}
+
+void dWindowForgetWidget(DWidget *window, const DWidget *widget) {
+	assert(window!=NULL);
+	assert(widget!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	if (data->d.window.pointerCaptureWidget==widget)
+		data->d.window.pointerCaptureWidget=NULL;
+	if (data->d.window.mouseFocusWidget==widget)
+		data->d.window.mouseFocusWidget=NULL;
+	if (data->d.window.keyboardFocusWidget==widget)
+		data->d.window.keyboardFocusWidget=NULL;
+
+	// Spatial index may have an entry for it
+	dWindowHitIndexInvalidate(window);
+}
+
+void dWindowHitIndexInvalidate(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	data->d.window.hitStructureChanged=true;
+	data->d.window.hitLast=SIZE_MAX;
+}
+
+DWidget *dWindowGetWidgetByXY(DWidget *window, int x, int y) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	// Ensure index is up to date
+	dWindowHitIndexUpdate(window);
+
+	// Outside of window entirely?
+	const DWindowHitEntry *entries=data->d.window.hitEntries;
+	if (data->d.window.hitEntryCount==0 || !dWindowHitEntryContains(&entries[0], x, y))
+		return NULL;
+
+	// Fast path - still inside the same widget as last time, and it has no children which might now be hit instead
+	// This relies on containers never overlapping their children with one another, or placing them outside of their own bounds.
+	size_t last=data->d.window.hitLast;
+	if (last<data->d.window.hitEntryCount && dWindowHitEntryContains(&entries[last], x, y) &&
+	    (last+1==data->d.window.hitEntryCount || entries[last+1].parent!=last))
+		return entries[last].widget;
+
+	// Scan entries overlapping this cell
+	// As these are in pre-order we can replicate dWidgetGetWidgetByXY's descent by only accepting a hit on a child of the current result,
+	// which also means only the first child hit (in order) is used, as its siblings have a different parent to the new result.
+	int col=x/dWindowHitCellSize;
+	int row=y/dWindowHitCellSize;
+	if (col>=data->d.window.hitGridCols || row>=data->d.window.hitGridRows)
+		return NULL;
+	size_t cell=((size_t)row)*data->d.window.hitGridCols+col;
+
+	const DWindowHitCell *hitCell=&data->d.window.hitCells[cell];
+	size_t result=SIZE_MAX;
+	for(size_t i=0; i<hitCell->count; ++i) {
+		size_t index=hitCell->entries[i];
+		if (entries[index].parent==result && dWindowHitEntryContains(&entries[index], x, y))
+			result=index;
+	}
+
+	if (result==SIZE_MAX)
+		return NULL;
+
+	data->d.window.hitLast=result;
+	return entries[result].widget;
+}
+
 void dWindowVTableDestructor(DWidget *widget) {
 	assert(widget!=NULL);
 
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeWindow);
 
-	// Destry SDL window and renderer
-	if (data->d.window.renderer!=NULL)
+	// Call super destructor first, as anything it frees may still need our renderer (e.g. to destroy textures)
+	dWidgetDestructor(widget, data->super);
+
+	// Free hit testing index, update transaction state and latency stats
+	dWindowHitIndexFree(data);
+	dWidgetUpdateWindowFree(widget);
+	dLatencyWindowFree(data->d.window.latency);
+
+	// Destroy target texture and any cached textures for our renderer, before the renderer itself and finally the SDL window
+	if (data->d.window.target!=NULL)
+		dDestroyTexture(data->d.window.target);
+	if (data->d.window.renderer!=NULL) {
+		dImageCacheForgetRenderer(data->d.window.renderer);
+		dGlyphAtlasForgetRenderer(data->d.window.renderer);
 		SDL_DestroyRenderer(data->d.window.renderer);
+	}
 	if (data->d.window.sdlWindow!=NULL)
 		SDL_DestroyWindow(data->d.window.sdlWindow);
 
-	// Call super destructor
-	dWidgetDestructor(widget, data->super);
-
 	// Deregister to remove from list of windows
 	digitsDeregisterWindow(widget);
 }
@@ -182,21 +430,93 @@ void dWindowVTableRedraw(DWidget *widget, SDL_Renderer *renderer) {
 	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(widget, DWidgetTypeWindow);
 
 	// Not even dirty?
-	if (!data->d.window.dirty)
+	if (!data->d.window.dirty && !data->d.window.damaged)
 		return;
 
-	// Clear entire window to background colour
-	dSetRenderDrawColour(renderer, &dWindowBackgroundColour);
-	SDL_RenderClear(renderer);
+	dProfilerCountWidgetDrawn();
+	DTimeUs traceStart=dTraceBegin();
+
+	// Layout is brought up to date as widgets are measured while drawing
+	// (the hit index is not updated here but lazily on the next hit test, so frames which change layout do not also have to walk every widget for it)
+	DTimeUs phaseStart=dGetTimeUs();
+	dLatencyMarkLayout(widget);
+	phaseStart=dProfilerPhaseEnd(DProfilerPhaseLayout, phaseStart);
+
+	// Draw into persistent target texture if possible, so only the damaged area needs redrawing
+	// (otherwise fall back to redrawing everything directly)
+	bool useTarget=dWindowTargetUpdate(widget);
+	if (useTarget)
+		SDL_SetRenderTarget(renderer, data->d.window.target);
+	else
+		data->d.window.dirty=true;
+
+	if (data->d.window.dirty) {
+		// Clear entire window to background colour
+		dSetRenderDrawColour(renderer, &dWindowBackgroundColour);
+		SDL_RenderClear(renderer);
+
+		// Call super redraw
+		dWidgetRedraw(widget, data->super, renderer);
+	} else {
+		// Restrict drawing to damaged area, clearing only that to background colour
+		// (containers skip children outside of the clip rect, see dContainerVTableRedraw)
+		SDL_RenderSetClipRect(renderer, &data->d.window.damage);
+		dSetRenderDrawColour(renderer, &dWindowBackgroundColour);
+		SDL_RenderFillRect(renderer, &data->d.window.damage);
+
+		// Call super redraw
+		dWidgetRedraw(widget, data->super, renderer);
+
+		SDL_RenderSetClipRect(renderer, NULL);
+	}
 
-	// Call super redraw
-	dWidgetRedraw(widget, data->super, renderer);
+	phaseStart=dProfilerPhaseEnd(DProfilerPhaseDraw, phaseStart);
+	DTimeUs tracePresentStart=dTraceBegin();
+
+	// Copy target to screen
+	if (useTarget) {
+		SDL_SetRenderTarget(renderer, NULL);
+		SDL_RenderCopy(renderer, data->d.window.target, NULL, NULL);
+	}
 
 	// Update screen
 	SDL_RenderPresent(renderer);
+	dLatencyMarkPresent(widget);
+	dProfilerPhaseEnd(DProfilerPhasePresent, phaseStart);
+	dTraceEnd(tracePresentStart, "present", "render", NULL);
 
-	// Clear dirty flag
+	// Clear dirty flags
 	data->d.window.dirty=false;
+	data->d.window.damaged=false;
+
+	dTraceEnd(traceStart, "window redraw", "render", dWindowGetTitle(widget));
+}
+
+bool dWindowTargetUpdate(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	if (!SDL_RenderTargetSupported(data->d.window.renderer))
+		return false;
+
+	// Already have a target of the correct size?
+	int width=dWidgetGetWidth(window);
+	int height=dWidgetGetHeight(window);
+	if (data->d.window.target!=NULL && data->d.window.targetWidth==width && data->d.window.targetHeight==height)
+		return true;
+
+	// (Re)create target, which requires a full redraw
+	if (data->d.window.target!=NULL)
+		dDestroyTexture(data->d.window.target);
+	data->d.window.target=dCreateTexture(data->d.window.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+	if (data->d.window.target==NULL)
+		return false;
+	data->d.window.targetWidth=width;
+	data->d.window.targetHeight=height;
+	data->d.window.dirty=true;
+
+	return true;
 }
 
 int dWindowVTableGetWidth(DWidget *widget) {
@@ -218,3 +538,231 @@ int dWindowVTableGetHeight(DWidget *widget) {
 	SDL_GetWindowSize(data->d.window.sdlWindow, NULL, &height);
 	return height;
 }
+
+void dWindowHitIndexUpdate(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	// Already up to date?
+	unsigned generation=dWidgetGetLayoutGeneration(window);
+	if (data->d.window.hitGeneration==generation && !data->d.window.hitStructureChanged)
+		return;
+
+	// Widgets added or removed, or grid size changed? Then entries no longer line up so start again
+	int cols=(dWidgetGetWidth(window)+dWindowHitCellSize-1)/dWindowHitCellSize;
+	int rows=(dWidgetGetHeight(window)+dWindowHitCellSize-1)/dWindowHitCellSize;
+	if (cols<1)
+		cols=1;
+	if (rows<1)
+		rows=1;
+	if (data->d.window.hitStructureChanged || cols!=data->d.window.hitGridCols || rows!=data->d.window.hitGridRows) {
+		dWindowHitIndexRebuild(window);
+		return;
+	}
+
+	// Otherwise only move entries whose bounds have changed between cells
+	// (most layout changes, e.g. a label's text, only move a handful of widgets, leaving the rest of the grid untouched)
+	for(size_t i=0; i<data->d.window.hitEntryCount; ++i) {
+		DWindowHitEntry *entry=&data->d.window.hitEntries[i];
+		SDL_Rect rect;
+		dWindowHitEntryGetRect(entry, &rect);
+		if (rect.x==entry->rect.x && rect.y==entry->rect.y && rect.w==entry->rect.w && rect.h==entry->rect.h)
+			continue;
+
+		SDL_Rect oldCells, newCells;
+		bool hasOld=dWindowHitCellsForRect(data, &entry->rect, &oldCells);
+		bool hasNew=dWindowHitCellsForRect(data, &rect, &newCells);
+		entry->rect=rect;
+
+		if (hasOld) {
+			for(int row=oldCells.y; row<oldCells.y+oldCells.h; ++row)
+				for(int col=oldCells.x; col<oldCells.x+oldCells.w; ++col) {
+					SDL_Point point={.x=col, .y=row};
+					if (!hasNew || !SDL_PointInRect(&point, &newCells))
+						dWindowHitCellRemove(&data->d.window.hitCells[((size_t)row)*cols+col], i);
+				}
+		}
+		if (hasNew) {
+			for(int row=newCells.y; row<newCells.y+newCells.h; ++row)
+				for(int col=newCells.x; col<newCells.x+newCells.w; ++col) {
+					SDL_Point point={.x=col, .y=row};
+					if (!hasOld || !SDL_PointInRect(&point, &oldCells))
+						dWindowHitCellInsert(&data->d.window.hitCells[((size_t)row)*cols+col], i);
+				}
+		}
+	}
+
+	data->d.window.hitGeneration=generation;
+}
+
+void dWindowHitIndexRebuild(DWidget *window) {
+	assert(window!=NULL);
+
+	DWidgetObjectData *data=dWidgetGetObjectDataNoFail(window, DWidgetTypeWindow);
+
+	// Gather all widgets in pre-order along with their bounds
+	data->d.window.hitEntryCount=0;
+	data->d.window.hitLast=SIZE_MAX;
+	dWindowHitIndexAddWidget(data, window, SIZE_MAX);
+
+	// Compute grid size to cover the window
+	int windowWidth=dWidgetGetWidth(window);
+	int windowHeight=dWidgetGetHeight(window);
+	int cols=(windowWidth+dWindowHitCellSize-1)/dWindowHitCellSize;
+	int rows=(windowHeight+dWindowHitCellSize-1)/dWindowHitCellSize;
+	if (cols<1)
+		cols=1;
+	if (rows<1)
+		rows=1;
+	size_t cellCount=((size_t)cols)*rows;
+
+	data->d.window.hitGridCols=cols;
+	data->d.window.hitGridRows=rows;
+
+	// Empty all cells, keeping their memory for reuse
+	if (cellCount>data->d.window.hitCellAlloc) {
+		data->d.window.hitCells=dReallocTaggedNoFail(data->d.window.hitCells, sizeof(DWindowHitCell)*cellCount, DWidgetTypeWindow);
+		memset(data->d.window.hitCells+data->d.window.hitCellAlloc, 0, sizeof(DWindowHitCell)*(cellCount-data->d.window.hitCellAlloc));
+		data->d.window.hitCellAlloc=cellCount;
+	}
+	for(size_t cell=0; cell<cellCount; ++cell)
+		data->d.window.hitCells[cell].count=0;
+
+	// Fill in entry indices, which will be in pre-order within each cell as we add them in order
+	for(size_t i=0; i<data->d.window.hitEntryCount; ++i) {
+		SDL_Rect cells;
+		if (!dWindowHitCellsForRect(data, &data->d.window.hitEntries[i].rect, &cells))
+			continue;
+		for(int row=cells.y; row<cells.y+cells.h; ++row)
+			for(int col=cells.x; col<cells.x+cells.w; ++col)
+				dWindowHitCellInsert(&data->d.window.hitCells[((size_t)row)*cols+col], i);
+	}
+
+	data->d.window.hitGeneration=dWidgetGetLayoutGeneration(window);
+	data->d.window.hitStructureChanged=false;
+}
+
+void dWindowHitIndexAddWidget(DWidgetObjectData *data, DWidget *widget, size_t parent) {
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeWindow);
+	assert(widget!=NULL);
+
+	// Add entry for this widget
+	if (data->d.window.hitEntryCount==data->d.window.hitEntryAlloc) {
+		data->d.window.hitEntryAlloc=(data->d.window.hitEntryAlloc>0 ? 2*data->d.window.hitEntryAlloc : 64);
+		data->d.window.hitEntries=dReallocTaggedNoFail(data->d.window.hitEntries, sizeof(DWindowHitEntry)*data->d.window.hitEntryAlloc, DWidgetTypeWindow);
+	}
+
+	size_t index=data->d.window.hitEntryCount++;
+	DWindowHitEntry *entry=&data->d.window.hitEntries[index];
+	entry->widget=widget;
+	entry->parent=parent;
+	dWindowHitEntryGetRect(entry, &entry->rect);
+
+	// If this is a container, recurse to handle children
+	if (dWidgetGetHasType(widget, DWidgetTypeContainer)) {
+		size_t childCount=dContainerGetChildCount(widget);
+		for(size_t i=0; i<childCount; ++i)
+			dWindowHitIndexAddWidget(data, dContainerGetChildN(widget, i), index);
+	}
+}
+
+void dWindowHitIndexFree(DWidgetObjectData *data) {
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeWindow);
+
+	dFree(data->d.window.hitEntries);
+	for(size_t cell=0; cell<data->d.window.hitCellAlloc; ++cell)
+		dFree(data->d.window.hitCells[cell].entries);
+	dFree(data->d.window.hitCells);
+
+	data->d.window.hitGeneration=0;
+	data->d.window.hitStructureChanged=true;
+	data->d.window.hitEntries=NULL;
+	data->d.window.hitEntryCount=0;
+	data->d.window.hitEntryAlloc=0;
+	data->d.window.hitGridCols=0;
+	data->d.window.hitGridRows=0;
+	data->d.window.hitCells=NULL;
+	data->d.window.hitCellAlloc=0;
+	data->d.window.hitLast=SIZE_MAX;
+}
+
+bool dWindowHitEntryContains(const DWindowHitEntry *entry, int x, int y) {
+	assert(entry!=NULL);
+
+	return (x>=entry->rect.x && x<entry->rect.x+entry->rect.w && y>=entry->rect.y && y<entry->rect.y+entry->rect.h);
+}
+
+void dWindowHitEntryGetRect(const DWindowHitEntry *entry, SDL_Rect *rect) {
+	assert(entry!=NULL);
+	assert(rect!=NULL);
+
+	rect->x=dWidgetGetGlobalX(entry->widget);
+	rect->y=dWidgetGetGlobalY(entry->widget);
+	rect->w=dWidgetGetWidth(entry->widget);
+	rect->h=dWidgetGetHeight(entry->widget);
+}
+
+bool dWindowHitCellsForRect(const DWidgetObjectData *data, const SDL_Rect *rect, SDL_Rect *cells) {
+	assert(data!=NULL);
+	assert(data->type==DWidgetTypeWindow);
+	assert(rect!=NULL);
+	assert(cells!=NULL);
+
+	SDL_Rect gridRect={.x=0, .y=0, .w=data->d.window.hitGridCols*dWindowHitCellSize, .h=data->d.window.hitGridRows*dWindowHitCellSize};
+	SDL_Rect clipped;
+	if (!SDL_IntersectRect(rect, &gridRect, &clipped))
+		return false;
+
+	cells->x=clipped.x/dWindowHitCellSize;
+	cells->y=clipped.y/dWindowHitCellSize;
+	cells->w=(clipped.x+clipped.w-1)/dWindowHitCellSize-cells->x+1;
+	cells->h=(clipped.y+clipped.h-1)/dWindowHitCellSize-cells->y+1;
+	return true;
+}
+
+void dWindowHitCellInsert(DWindowHitCell *cell, size_t index) {
+	assert(cell!=NULL);
+
+	// Find position (entries are usually added in order, so check the end first)
+	size_t pos=cell->count;
+	if (pos>0 && cell->entries[pos-1]>index) {
+		size_t low=0, high=cell->count;
+		while(low<high) {
+			size_t mid=low+(high-low)/2;
+			if (cell->entries[mid]<index)
+				low=mid+1;
+			else
+				high=mid;
+		}
+		pos=low;
+	}
+
+	if (cell->count==cell->alloc) {
+		cell->alloc=(cell->alloc>0 ? 2*cell->alloc : 8);
+		cell->entries=dReallocTaggedNoFail(cell->entries, sizeof(size_t)*cell->alloc, DWidgetTypeWindow);
+	}
+
+	memmove(cell->entries+pos+1, cell->entries+pos, sizeof(size_t)*(cell->count-pos));
+	cell->entries[pos]=index;
+	++cell->count;
+}
+
+void dWindowHitCellRemove(DWindowHitCell *cell, size_t index) {
+	assert(cell!=NULL);
+
+	size_t low=0, high=cell->count;
+	while(low<high) {
+		size_t mid=low+(high-low)/2;
+		if (cell->entries[mid]<index)
+			low=mid+1;
+		else
+			high=mid;
+	}
+	assert(low<cell->count && cell->entries[low]==index);
+
+	memmove(cell->entries+low, cell->entries+low+1, sizeof(size_t)*(cell->count-low-1));
+	--cell->count;
+}
@@ -11,6 +11,24 @@ void dWindowConstructor(DWidget *widget, DWidgetObjectData *data, const char *ti
 SDL_Renderer *dWindowGetRenderer(DWidget *widget);
 
 void dWindowSetDirty(DWidget *window);
+void dWindowAddDamage(DWidget *window, const SDL_Rect *rect); // marks an area (relative to the window) as needing to be redrawn
+
+DWidget *dWindowGetMouseFocusWidget(DWidget *window); // returns NULL if mouse not inside window
 void dWindowSetMouseFocusWidget(DWidget *window, DWidget *newWidget);
+void dWindowSetMouseInside(DWidget *window, bool inside);
+void dWindowSetMousePosition(DWidget *window, int x, int y);
+
+DWidget *dWindowGetPointerCapture(DWidget *window); // returns NULL if no widget holds capture
+const DWidget *dWindowGetPointerCaptureConst(const DWidget *window);
+void dWindowSetPointerCapture(DWidget *window, DWidget *widget); // widget can be NULL to release
+
+DWidget *dWindowGetKeyboardFocusWidget(DWidget *window); // returns NULL if no widget has focus
+const DWidget *dWindowGetKeyboardFocusWidgetConst(const DWidget *window);
+void dWindowSetKeyboardFocusWidget(DWidget *window, DWidget *widget); // widget can be NULL to clear focus. generates FocusOut and FocusIn events
+
+void dWindowForgetWidget(DWidget *window, const DWidget *widget); // clears any references to widget (e.g. as it is being freed)
+void dWindowHitIndexInvalidate(DWidget *window); // forces the spatial index to be rebuilt from scratch on next use (e.g. as widgets have been added)
+
+DWidget *dWindowGetWidgetByXY(DWidget *window, int x, int y); // equivalent to dWidgetGetWidgetByXY but uses the window's spatial index
 
 #endif
@@ -0,0 +1,316 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+
+#include "../src/digits.h"
+#include "../src/widgetprivate.h"
+#include "../src/windowprivate.h"
+
+// Synthetic widget tree benchmarks, printing one JSON object per line to stdout:
+// {"shape":"wide","widgets":1000,"op":"hit_test","count":10000,"total_us":1234,"per_op_ns":123.4}
+// Each shape is run with 10, 100, ... widgets up to the given maximum, stopping early if a size takes longer than the budget.
+
+typedef enum {
+	BenchShapeChain, // Bins nested inside each other
+	BenchShapeWide, // single Box with every leaf as a direct child
+	BenchShapeGrid, // vertical Box of horizontal Box rows
+	BenchShapeNB,
+} BenchShape;
+
+typedef struct {
+	DWidget *window;
+	DWidget **widgets; // all widgets except the window, in pre-order
+	size_t count, alloc;
+	size_t *leaves; // indices into widgets
+	size_t leafCount;
+} BenchTree;
+
+const char *benchShapeStrings[BenchShapeNB]={
+	[BenchShapeChain]="chain",
+	[BenchShapeWide]="wide",
+	[BenchShapeGrid]="grid",
+};
+
+const size_t benchChainDepthMax=10000; // layout and redraw recurse per level, so deeper chains would overflow the stack
+const size_t benchQueryCount=100000; // max number of repeats for per-query ops
+const double benchOpBudgetFraction=0.1; // fraction of the size budget each repeated op may use
+
+double benchBudgetSeconds=10.0;
+uint64_t benchRandomState=0x9E3779B97F4A7C15llu;
+
+void benchRunShape(BenchShape shape, size_t maxWidgets);
+DTimeUs benchRunSize(BenchShape shape, size_t widgetCount); // returns total time taken
+
+void benchTreeBuild(BenchTree *tree, BenchShape shape, size_t widgetCount);
+void benchTreeAdd(BenchTree *tree, DWidget *widget, bool leaf);
+void benchTreeFree(BenchTree *tree);
+DWidget *benchNewLeaf(void);
+
+void benchReport(BenchShape shape, size_t widgetCount, const char *op, size_t count, DTimeUs totalUs);
+bool benchOpOverBudget(DTimeUs start);
+uint64_t benchRandom(void);
+
+DWidgetSignalReturn benchSignalHandler(const DWidgetSignalEvent *event, void *userData);
+
+int main(int argc, char **argv) {
+	// Parse arguments
+	if (argc>3) {
+		printf("usage: %s [max widgets (default 1000000)] [budget seconds per size (default 10)]\n", argv[0]);
+		return 1;
+	}
+
+	size_t maxWidgets=(argc>1 ? strtoull(argv[1], NULL, 10) : 1000000);
+	if (argc>2)
+		benchBudgetSeconds=atof(argv[2]);
+
+	// Use the dummy video driver so no display is needed (unless overridden)
+	setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+	if (!digitsInit()) {
+		fprintf(stderr, "error: could not init digits: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	for(BenchShape shape=0; shape<BenchShapeNB; ++shape)
+		benchRunShape(shape, maxWidgets);
+
+	digitsQuit();
+
+	return 0;
+}
+
+void benchRunShape(BenchShape shape, size_t maxWidgets) {
+	assert(shape<BenchShapeNB);
+
+	for(size_t widgetCount=10; widgetCount<=maxWidgets; widgetCount*=10) {
+		if (shape==BenchShapeChain && widgetCount>benchChainDepthMax) {
+			fprintf(stderr, "note: skipping %s with %zu widgets (max depth is %zu)\n", benchShapeStrings[shape], widgetCount, benchChainDepthMax);
+			break;
+		}
+
+		// Stop if this size was too slow, as the next will be at least 10 times slower
+		DTimeUs total=benchRunSize(shape, widgetCount);
+		if (total>benchBudgetSeconds*1000000.0) {
+			fprintf(stderr, "note: %s with %zu widgets exceeded budget (%.2fs), skipping larger sizes\n", benchShapeStrings[shape], widgetCount, total/1000000.0);
+			break;
+		}
+	}
+}
+
+DTimeUs benchRunSize(BenchShape shape, size_t widgetCount) {
+	assert(shape<BenchShapeNB);
+
+	DTimeUs sizeStart=dGetTimeUs();
+	DTimeUs start;
+	size_t count;
+
+	// Construction
+	BenchTree tree;
+	start=dGetTimeUs();
+	benchTreeBuild(&tree, shape, widgetCount);
+	benchReport(shape, tree.count, "construct", tree.count, dGetTimeUs()-start);
+
+	DWidget *root=tree.widgets[0];
+	int width=dWidgetGetWidth(tree.window);
+	int height=dWidgetGetHeight(tree.window);
+
+	// Layout queries, first with nothing cached (changing padding invalidates all layout) then again with everything cached
+	dWidgetSetPadding(root, 1);
+	start=dGetTimeUs();
+	dWidgetGetWidth(root);
+	for(size_t i=0; i<tree.count; ++i)
+		dWidgetGetGlobalX(tree.widgets[i]);
+	benchReport(shape, tree.count, "layout_cold", tree.count, dGetTimeUs()-start);
+
+	start=dGetTimeUs();
+	dWidgetGetWidth(root);
+	for(size_t i=0; i<tree.count; ++i)
+		dWidgetGetGlobalX(tree.widgets[i]);
+	benchReport(shape, tree.count, "layout_warm", tree.count, dGetTimeUs()-start);
+
+	// Hit testing by walking the tree
+	start=dGetTimeUs();
+	for(count=0; count<benchQueryCount && !benchOpOverBudget(start); ++count)
+		dWidgetGetWidgetByXY(tree.window, benchRandom()%width, benchRandom()%height);
+	benchReport(shape, tree.count, "hit_test", count, dGetTimeUs()-start);
+
+	// Hit testing using the window's spatial index (building it is timed separately)
+	start=dGetTimeUs();
+	dWindowGetWidgetByXY(tree.window, 0, 0);
+	benchReport(shape, tree.count, "hit_index_build", 1, dGetTimeUs()-start);
+
+	start=dGetTimeUs();
+	for(count=0; count<benchQueryCount && !benchOpOverBudget(start); ++count)
+		dWindowGetWidgetByXY(tree.window, benchRandom()%width, benchRandom()%height);
+	benchReport(shape, tree.count, "hit_test_indexed", count, dGetTimeUs()-start);
+
+	// Signal dispatch, bubbling a button press from a random leaf up to the window as digitsLoop does
+	size_t handled=0;
+	dWidgetSignalConnect(tree.window, DWidgetSignalTypeWidgetButtonPress, &benchSignalHandler, &handled);
+	start=dGetTimeUs();
+	for(count=0; count<benchQueryCount && !benchOpOverBudget(start); ++count) {
+		DWidgetSignalEvent event;
+		event.type=DWidgetSignalTypeWidgetButtonPress;
+		event.d.widgetButtonPress.button=DWidgetMouseButtonLeft;
+		event.d.widgetButtonPress.x=0;
+		event.d.widgetButtonPress.y=0;
+		DWidget *target=tree.widgets[tree.leaves[benchRandom()%tree.leafCount]];
+		while(target!=NULL) {
+			event.widget=target;
+			if (dWidgetSignalInvoke(&event)==DWidgetSignalReturnStop)
+				break;
+			target=dWidgetGetParent(target);
+		}
+	}
+	benchReport(shape, tree.count, "signal_dispatch", count, dGetTimeUs()-start);
+	if (handled!=count)
+		fprintf(stderr, "warning: %zu of %zu signals did not reach the window\n", count-handled, count);
+
+	// Full redraws
+	SDL_Renderer *renderer=dWindowGetRenderer(tree.window);
+	start=dGetTimeUs();
+	for(count=0; count<benchQueryCount && !benchOpOverBudget(start); ++count) {
+		dWidgetSetDirty(tree.window);
+		dWidgetRedraw(tree.window, tree.window->base, renderer);
+	}
+	benchReport(shape, tree.count, "redraw", count, dGetTimeUs()-start);
+
+	// Teardown
+	size_t treeCount=tree.count;
+	start=dGetTimeUs();
+	benchTreeFree(&tree);
+	benchReport(shape, treeCount, "teardown", treeCount, dGetTimeUs()-start);
+
+	return dGetTimeUs()-sizeStart;
+}
+
+void benchTreeBuild(BenchTree *tree, BenchShape shape, size_t widgetCount) {
+	assert(tree!=NULL);
+	assert(shape<BenchShapeNB);
+	assert(widgetCount>0);
+
+	tree->window=dWindowNew("bench", 640, 480);
+	tree->widgets=NULL;
+	tree->count=0;
+	tree->alloc=0;
+	tree->leaves=NULL;
+	tree->leafCount=0;
+
+	// Build from the top down, adding each widget to its parent immediately as an application would
+	switch(shape) {
+		case BenchShapeChain: {
+			DWidget *parent=tree->window;
+			for(size_t i=0; i<widgetCount; ++i) {
+				DWidget *widget=(i+1<widgetCount ? dBinNew(NULL) : benchNewLeaf());
+				dBinAdd(parent, widget);
+				benchTreeAdd(tree, widget, i+1==widgetCount);
+				parent=widget;
+			}
+		} break;
+		case BenchShapeWide: {
+			DWidget *box=dBoxNew(DWidgetOrientationHorizontal);
+			dBinAdd(tree->window, box);
+			benchTreeAdd(tree, box, false);
+			for(size_t i=1; i<widgetCount; ++i) {
+				DWidget *leaf=benchNewLeaf();
+				dContainerAdd(box, leaf);
+				benchTreeAdd(tree, leaf, true);
+			}
+		} break;
+		case BenchShapeGrid: {
+			// Square grid, with the outer box and each row counting towards the total
+			size_t side=1;
+			while((side+1)*(side+2)+1<=widgetCount)
+				++side;
+
+			DWidget *outer=dBoxNew(DWidgetOrientationVertical);
+			dBinAdd(tree->window, outer);
+			benchTreeAdd(tree, outer, false);
+			for(size_t row=0; row<side; ++row) {
+				DWidget *rowBox=dBoxNew(DWidgetOrientationHorizontal);
+				dContainerAdd(outer, rowBox);
+				benchTreeAdd(tree, rowBox, false);
+				for(size_t col=0; col<side; ++col) {
+					DWidget *leaf=benchNewLeaf();
+					dContainerAdd(rowBox, leaf);
+					benchTreeAdd(tree, leaf, true);
+				}
+			}
+		} break;
+		case BenchShapeNB:
+			assert(false);
+		break;
+	}
+}
+
+void benchTreeAdd(BenchTree *tree, DWidget *widget, bool leaf) {
+	assert(tree!=NULL);
+	assert(widget!=NULL);
+
+	if (tree->count==tree->alloc) {
+		tree->alloc=(tree->alloc>0 ? 2*tree->alloc : 64);
+		tree->widgets=dReallocNoFail(tree->widgets, sizeof(DWidget *)*tree->alloc);
+		tree->leaves=dReallocNoFail(tree->leaves, sizeof(size_t)*tree->alloc);
+	}
+
+	if (leaf)
+		tree->leaves[tree->leafCount++]=tree->count;
+	tree->widgets[tree->count++]=widget;
+}
+
+void benchTreeFree(BenchTree *tree) {
+	assert(tree!=NULL);
+
+	// Containers do not free their children, so free every widget ourselves
+	// Reverse pre-order ensures children are freed before their parents
+	for(size_t i=tree->count; i>0; --i)
+		dWidgetFree(tree->widgets[i-1]);
+	dWidgetFree(tree->window);
+
+	dFree(tree->widgets);
+	dFree(tree->leaves);
+	tree->widgets=NULL;
+	tree->leaves=NULL;
+	tree->count=0;
+	tree->alloc=0;
+	tree->leafCount=0;
+}
+
+DWidget *benchNewLeaf(void) {
+	// Empty bin with padding gives a small non-zero size without needing any textures
+	DWidget *leaf=dBinNew(NULL);
+	dWidgetSetPadding(leaf, 1);
+	return leaf;
+}
+
+void benchReport(BenchShape shape, size_t widgetCount, const char *op, size_t count, DTimeUs totalUs) {
+	assert(shape<BenchShapeNB);
+	assert(op!=NULL);
+
+	printf("{\"shape\":\"%s\",\"widgets\":%zu,\"op\":\"%s\",\"count\":%zu,\"total_us\":%llu,\"per_op_ns\":%.1f}\n", benchShapeStrings[shape], widgetCount, op, count, (unsigned long long)totalUs, (count>0 ? totalUs*1000.0/count : 0.0));
+	fflush(stdout);
+}
+
+bool benchOpOverBudget(DTimeUs start) {
+	return dGetTimeUs()-start>benchBudgetSeconds*benchOpBudgetFraction*1000000.0;
+}
+
+uint64_t benchRandom(void) {
+	// xorshift64, so runs are repeatable
+	benchRandomState^=benchRandomState<<13;
+	benchRandomState^=benchRandomState>>7;
+	benchRandomState^=benchRandomState<<17;
+	return benchRandomState;
+}
+
+DWidgetSignalReturn benchSignalHandler(const DWidgetSignalEvent *event, void *userData) {
+	assert(event!=NULL);
+	assert(userData!=NULL);
+
+	size_t *handled=userData;
+	++*handled;
+
+	return DWidgetSignalReturnStop;
+}
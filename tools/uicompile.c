@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+#include "../src/ui.h"
+
+int main(int argc, char **argv) {
+	// Check arguments
+	if (argc!=3) {
+		printf("usage: %s input.txt output.dui\n", argv[0]);
+		return 1;
+	}
+
+	// Compile text description into binary form
+	if (!dUiCompile(argv[1], argv[2]))
+		return 1;
+
+	return 0;
+}